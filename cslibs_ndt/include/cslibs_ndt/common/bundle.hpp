@@ -13,7 +13,8 @@ public:
 
     inline Bundle() :
         data_({}),
-        expand_(true)
+        expand_(true),
+        dirty_(false)
     {
     }
 
@@ -64,6 +65,16 @@ public:
         expand_ = false;
     }
 
+    inline bool dirty() const
+    {
+        return dirty_;
+    }
+
+    inline void setDirty(const bool dirty) const
+    {
+        dirty_ = dirty;
+    }
+
     inline void merge(const Bundle &)
     {
     }
@@ -96,6 +107,7 @@ public:
 private:
     data_t       data_;
     mutable bool expand_;
+    mutable bool dirty_;    /// changed since the last checkpoint
 };
 }
 
@@ -0,0 +1,260 @@
+#ifndef CSLIBS_NDT_CONVERSION_FUSE_HPP
+#define CSLIBS_NDT_CONVERSION_FUSE_HPP
+
+#include <cslibs_ndt/conversion/resample.hpp>
+
+namespace cslibs_ndt {
+namespace conversion {
+
+namespace impl {
+/**
+ * @brief Rigid transformation of points and of the sufficient statistics of distributions.
+ */
+template <typename T, std::size_t Dim>
+struct rigid {
+    using gaussian_t = cslibs_math::statistics::StableDistribution<T,Dim,3>;
+    using vector_t   = Eigen::Matrix<T,Dim,1>;
+    using matrix_t   = Eigen::Matrix<T,Dim,Dim>;
+    using point_t    = typename map::traits<Dim,T>::point_t;
+
+    template <typename transform_t>
+    inline explicit rigid(const transform_t &tf)
+    {
+        t = (tf * point_t(vector_t::Zero().eval())).data();
+        for (std::size_t d = 0 ; d < Dim ; ++d) {
+            vector_t e = vector_t::Zero();
+            e(d) = static_cast<T>(1);
+            R.col(d) = (tf * point_t(e)).data() - t;
+        }
+    }
+
+    inline bool identity(const T eps) const
+    {
+        return R.isIdentity(eps) && t.isZero(eps);
+    }
+
+    inline vector_t operator () (const vector_t &p) const
+    {
+        return R * p + t;
+    }
+
+    /// the scatter matrix, (n - 1) times the covariance, is rotated, the mean is transformed
+    inline gaussian_t operator () (const gaussian_t &g) const
+    {
+        const std::size_t n = g.getN();
+        if (n == 0)
+            return gaussian_t();
+
+        const matrix_t scatter = n > 1 ? (g.getCovariance() * static_cast<T>(n - 1)).eval() : matrix_t::Zero().eval();
+        return gaussian_t(n, (*this)(g.getMean()), (R * scatter * R.transpose()).eval());
+    }
+
+    matrix_t R;
+    vector_t t;
+};
+
+template <template <typename,std::size_t> class data_t, typename T, std::size_t Dim>
+struct fuse {};
+
+template <typename T, std::size_t Dim>
+struct fuse<Distribution,T,Dim> {
+    static inline Distribution<T,Dim> transform(const Distribution<T,Dim> &d, const rigid<T,Dim> &tf)
+    {
+        Distribution<T,Dim> r;
+        using gaussian_t = typename rigid<T,Dim>::gaussian_t;
+        static_cast<gaussian_t&>(r) = tf(static_cast<const gaussian_t&>(d));
+        return r;
+    }
+};
+
+template <typename T, std::size_t Dim>
+struct fuse<OccupancyDistribution,T,Dim> {
+    static inline OccupancyDistribution<T,Dim> transform(const OccupancyDistribution<T,Dim> &d, const rigid<T,Dim> &tf)
+    {
+        return d.getDistribution() ? OccupancyDistribution<T,Dim>(d.numFree(), tf(*(d.getDistribution()))) :
+                                     OccupancyDistribution<T,Dim>(d.numFree());
+    }
+};
+}
+
+/**
+ * @brief Fuse maps, e.g. of several robots or sessions, by merging the sufficient statistics of
+ *        their distributions instead of inserting the raw data again. Maps in other frames are
+ *        transformed like resample does it: the distributions of the first storage are rotated and
+ *        translated into the frame of the target and added to the bundle containing their mean.
+ *        Maps on the same grid are merged storage by storage. Either way the storages of the
+ *        target are merged in parallel. Distributions with weighted occupancy are not supported.
+ *        The changed bundles of the target and their neighbours, which share the changed
+ *        distributions, are marked dirty.
+ */
+template <std::size_t Dim,
+          template <typename,std::size_t> class data_t,
+          typename T,
+          template <typename, typename, typename...> class backend_t = map::tags::default_types<map::tags::dynamic_map>::template default_backend_t>
+struct fuse {
+    using map_t = map::Map<map::tags::dynamic_map,Dim,data_t,T,backend_t>;
+
+    /**
+     * @brief Merge a map into another one, the target keeps its frame and resolution.
+     * @param src           map to add
+     * @param dst           target map
+     * @param num_threads   maximum number of threads
+     */
+    template <typename src_map_t>
+    static inline void into(const src_map_t &src,
+                            map_t &dst,
+                            const std::size_t num_threads = utility::default_thread_count())
+    {
+        const impl::rigid<T,Dim> dst_T_src(dst.getInitialOrigin().inverse() * src.getInitialOrigin());
+        if (src.getResolution() == dst.getResolution() && dst_T_src.identity(static_cast<T>(1e-6)))
+            accumulate(src, dst, num_threads);
+        else
+            rebin(src, dst, dst_T_src, num_threads);
+    }
+
+    /**
+     * @brief Fuse many maps with a reduction tree, pairs of maps are fused in parallel.
+     * @param maps          maps to fuse, empty entries are skipped
+     * @param num_threads   maximum number of threads
+     * @return a new map in the frame and resolution of the first map, nullptr if there is none
+     */
+    template <typename src_map_t>
+    static inline typename map_t::Ptr from(const std::vector<std::shared_ptr<src_map_t>> &maps,
+                                           const std::size_t num_threads = utility::default_thread_count())
+    {
+        std::vector<std::shared_ptr<src_map_t>> src;
+        for (const auto &m : maps) {
+            if (m)
+                src.emplace_back(m);
+        }
+        if (src.empty())
+            return nullptr;
+
+        /// the leaves copy pairs of maps into the common frame, the other levels merge in place
+        std::vector<typename map_t::Ptr> level((src.size() + 1ul) / 2ul);
+        reduce(level.size(), num_threads, [&src, &level](const std::size_t k, const std::size_t threads) {
+            level[k].reset(new map_t(src.front()->getInitialOrigin(), src.front()->getResolution()));
+            into(*src[2ul * k], *level[k], threads);
+            if (2ul * k + 1ul < src.size())
+                into(*src[2ul * k + 1ul], *level[k], threads);
+        });
+
+        while (level.size() > 1ul) {
+            const std::size_t pairs = level.size() / 2ul;
+            reduce(pairs, num_threads, [&level](const std::size_t k, const std::size_t threads) {
+                into(*level[2ul * k + 1ul], *level[2ul * k], threads);
+            });
+            for (std::size_t k = 0 ; k < pairs ; ++k)
+                level[k] = level[2ul * k];
+            if (level.size() % 2ul)
+                level[pairs] = level.back();
+            level.resize(level.size() - pairs);
+        }
+        return level.front();
+    }
+
+private:
+    template <typename Fn>
+    static inline void reduce(const std::size_t pairs,
+                              const std::size_t num_threads,
+                              const Fn &function)
+    {
+        const std::size_t threads = std::max(1ul, num_threads / std::max(1ul, pairs));
+        utility::parallel_for(0ul, pairs, [&function, threads](const std::size_t k) {
+            function(k, threads);
+        }, num_threads);
+    }
+
+    /// same grid, every storage of the source is added to the same storage of the target
+    template <typename src_map_t>
+    static inline void accumulate(const src_map_t &src,
+                                  map_t &dst,
+                                  const std::size_t num_threads)
+    {
+        using index_t = typename src_map_t::index_t;
+        using impl_t  = impl::resample<data_t,T,Dim>;
+
+        std::vector<index_t> indices;
+        src.getBundleIndices(indices);
+        for (const index_t &bi : indices)
+            dst.getDistributionBundle(bi);
+
+        const auto &storages = dst.getStorages();
+        utility::parallel_for(0ul, map_t::bin_count, [&src, &storages](const std::size_t i) {
+            const typename map_t::distribution_storage_ptr_t &storage = storages[i];
+            src.getStorages()[i]->traverse([&storage](const index_t &si, const data_t<T,Dim> &d) {
+                if (data_t<T,Dim> *t = storage->get(si))
+                    impl_t::merge(d, *t);
+            });
+        }, num_threads);
+
+        markDirty(dst, indices);
+    }
+
+    /// other frame or resolution, the first storage of the source is transformed and resampled
+    template <typename src_map_t>
+    static inline void rebin(const src_map_t &src,
+                             map_t &dst,
+                             const impl::rigid<T,Dim> &dst_T_src,
+                             const std::size_t num_threads)
+    {
+        using index_t  = typename src_map_t::index_t;
+        using bundle_t = typename map_t::distribution_bundle_t;
+        using vector_t = Eigen::Matrix<T,Dim,1>;
+        using impl_t   = impl::resample<data_t,T,Dim>;
+        using fuse_t   = impl::fuse<data_t,T,Dim>;
+
+        const T src_resolution        = src.getResolution();
+        const T bundle_resolution_inv = 1.0 / dst.getBundleResolution();
+        std::vector<data_t<T,Dim>, Eigen::aligned_allocator<data_t<T,Dim>>> children;
+        std::vector<const bundle_t*>                                         bundles;
+        std::vector<index_t>                                                 indices;
+        src.getStorages()[0]->traverse([&dst, &dst_T_src, &children, &bundles, &indices, src_resolution, bundle_resolution_inv](const index_t &si, const data_t<T,Dim> &d) {
+            data_t<T,Dim> c = fuse_t::transform(d, dst_T_src);
+            vector_t m;
+            if (!impl_t::mean(c, m)) {
+                for (std::size_t i = 0 ; i < Dim ; ++i)
+                    m(i) = (static_cast<T>(si[i]) + 0.5) * src_resolution;
+                m = dst_T_src(m);
+            }
+
+            index_t bi;
+            for (std::size_t i = 0 ; i < Dim ; ++i)
+                bi[i] = static_cast<int>(std::floor(m(i) * bundle_resolution_inv));
+            if (const bundle_t *b = dst.getDistributionBundle(bi)) {
+                children.emplace_back(std::move(c));
+                bundles.emplace_back(b);
+                indices.emplace_back(bi);
+            }
+        });
+
+        utility::parallel_for(0ul, map_t::bin_count, [&children, &bundles](const std::size_t i) {
+            for (std::size_t k = 0 ; k < children.size() ; ++k)
+                impl_t::merge(children[k], *(bundles[k]->at(i)));
+        }, num_threads);
+
+        markDirty(dst, indices);
+    }
+
+    /// the distributions of a bundle are shared with its neighbours, the dirty list is not synchronized
+    template <typename index_t>
+    static inline void markDirty(const map_t &dst,
+                                 const std::vector<index_t> &indices)
+    {
+        static constexpr typename map_t::neighborhood_t grid{};
+        for (const index_t &bi : indices) {
+            dst.markDirty(bi);
+            grid.visit([&dst, &bi](typename map_t::neighborhood_t::offset_t o) {
+                index_t n;
+                for (std::size_t i = 0 ; i < Dim ; ++i)
+                    n[i] = bi[i] + o[i];
+                dst.markDirty(n);
+            });
+        }
+    }
+};
+
+}
+}
+
+#endif // CSLIBS_NDT_CONVERSION_FUSE_HPP
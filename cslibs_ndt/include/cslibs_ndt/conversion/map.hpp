@@ -4,32 +4,86 @@
 #include <cslibs_ndt/map/map.hpp>
 #include <cslibs_ndt/common/distribution.hpp>
 #include <cslibs_ndt/common/occupancy_distribution.hpp>
+#include <cslibs_ndt/common/weighted_occupancy_distribution.hpp>
+#include <cslibs_ndt/utility/bundles.hpp>
+#include <cslibs_ndt/utility/parallel.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <vector>
 
 namespace cslibs_ndt {
 namespace conversion {
 
 namespace impl {
+/**
+ * @brief Independent copy of a distribution, occupied parts are never shared between maps.
+ */
 template <template <typename,std::size_t> class data_t, typename T, std::size_t Dim>
 struct convert {};
 
 template <typename T, std::size_t Dim>
 struct convert<Distribution,T,Dim> {
-    static inline void from(const Distribution<T,Dim>* const& f, Distribution<T,Dim>* const& t)
+    static inline Distribution<T,Dim> copy(const Distribution<T,Dim> &d)
     {
-        *t = *f;
+        return d;
     }
 };
 
 template <typename T, std::size_t Dim>
 struct convert<OccupancyDistribution,T,Dim> {
-    static inline void from(const OccupancyDistribution<T,Dim>* const& f, OccupancyDistribution<T,Dim>* const& t)
+    /// empty distributions are not copied, their bins stay default constructed
+    static inline OccupancyDistribution<T,Dim> copy(const OccupancyDistribution<T,Dim> &d)
+    {
+        return d.numFree() > 0 || d.numOccupied() > 0 ? d : OccupancyDistribution<T,Dim>();
+    }
+};
+
+template <typename T, std::size_t Dim>
+struct convert<WeightedOccupancyDistribution,T,Dim> {
+    /// the copy constructor shares the occupied distribution
+    static inline WeightedOccupancyDistribution<T,Dim> copy(const WeightedOccupancyDistribution<T,Dim> &d)
     {
-        if (f && (f->numFree() > 0 || f->numOccupied() > 0))
-            *t = *f;
+        return d.getDistribution() ? WeightedOccupancyDistribution<T,Dim>(d.weightFree(), *(d.getDistribution())) :
+                                     WeightedOccupancyDistribution<T,Dim>(d.weightFree());
     }
 };
+
+/**
+ * @brief Copy all storages of a map into prepared storages, one storage per thread, and
+ *        build the bundle storage of the copy in one pass over the bundle indices, which
+ *        are returned.
+ */
+template <typename src_map_t, typename dst_map_t, std::size_t Dim, template <typename,std::size_t> class data_t, typename T, typename prepare_t>
+inline void copy(const src_map_t &src,
+                 typename dst_map_t::distribution_storage_array_t &storages,
+                 const typename dst_map_t::distribution_bundle_storage_ptr_t &bundles,
+                 std::vector<typename src_map_t::index_t> &indices,
+                 const prepare_t &prepare,
+                 const std::size_t num_threads)
+{
+    using index_t = typename src_map_t::index_t;
+
+    utility::parallel_for(0ul, dst_map_t::bin_count, [&src, &storages, &prepare](const std::size_t i) {
+        storages[i].reset(new typename dst_map_t::distribution_storage_t);
+        prepare(i, storages[i]);
+        typename dst_map_t::distribution_storage_t &storage = *storages[i];
+        src.getStorages()[i]->traverse([&storage](const index_t &si, const data_t<T,Dim> &d) {
+            storage.insert(si, convert<data_t,T,Dim>::copy(d));
+        });
+    }, num_threads);
+
+    indices.clear();
+    src.getBundleIndices(indices);
+    utility::allocate_bundles<dst_map_t,Dim>(indices, bundles, storages, num_threads);
+}
 }
 
+/**
+ * @brief Convert a map between static and dynamic layout. The distribution storages are copied
+ *        directly into storages of the target layout, sized up front and in parallel, and the
+ *        bundles are resolved afterwards, instead of allocating each bundle of the target map.
+ */
 template <map::tags::option option_to_t,
           map::tags::option option_from_t,
           std::size_t Dim,
@@ -49,25 +103,36 @@ struct convert<map::tags::dynamic_map,option_from_t,Dim,data_t,T,backend_to_t,ba
     using src_map_t = map::Map<option_from_t,Dim,data_t,T,backend_from_t>;
     using dst_map_t = map::Map<map::tags::dynamic_map,Dim,data_t,T,backend_to_t>;
 
-    static inline typename dst_map_t::Ptr from(const typename src_map_t::Ptr& src)
+    static inline typename dst_map_t::Ptr from(const typename src_map_t::Ptr& src,
+                                               const std::size_t num_threads = utility::default_thread_count())
     {
         if (!src)
             return nullptr;
 
-        typename dst_map_t::Ptr dst(new dst_map_t(src->getInitialOrigin(),
-                                                  src->getResolution()));
-
-        static constexpr std::size_t bin_count  = utility::two_pow(Dim);
         using index_t = typename src_map_t::index_t;
-        using bundle_t = cslibs_ndt::Bundle<data_t<T,Dim>*, bin_count>;
-        src->traverse([&dst](const index_t &bi, const bundle_t &b) {
-            if (const bundle_t* b_dst = dst->getDistributionBundle(bi)) {
-                for (std::size_t i = 0 ; i < bin_count ; ++i)
-                    impl::convert<data_t,T,Dim>::from(b.at(i), b_dst->at(i));
+        typename dst_map_t::distribution_storage_array_t storages;
+        typename dst_map_t::distribution_bundle_storage_ptr_t bundles(new typename dst_map_t::distribution_bundle_storage_t);
+        std::vector<index_t> indices;
+        impl::copy<src_map_t,dst_map_t,Dim,data_t,T>(*src, storages, bundles, indices,
+                                                     [](const std::size_t, const typename dst_map_t::distribution_storage_ptr_t &) {},
+                                                     num_threads);
+
+        /// the extents of the bundles, a static source spans its whole grid
+        index_t min_bundle_index = utility::create<int,Dim>(std::numeric_limits<int>::max());
+        index_t max_bundle_index = utility::create<int,Dim>(std::numeric_limits<int>::min());
+        for (const index_t &bi : indices) {
+            for (std::size_t d = 0 ; d < Dim ; ++d) {
+                min_bundle_index[d] = std::min(min_bundle_index[d], bi[d]);
+                max_bundle_index[d] = std::max(max_bundle_index[d], bi[d]);
             }
-        });
-
-        return dst;
+        }
+
+        return typename dst_map_t::Ptr(new dst_map_t(src->getInitialOrigin(),
+                                                     src->getResolution(),
+                                                     min_bundle_index,
+                                                     max_bundle_index,
+                                                     bundles,
+                                                     storages));
     }
 };
 
@@ -81,7 +146,8 @@ struct convert<map::tags::static_map,option_from_t,Dim,data_t,T,backend_to_t,bac
     using src_map_t = map::Map<option_from_t,Dim,data_t,T,backend_from_t>;
     using dst_map_t = map::Map<map::tags::static_map,Dim,data_t,T,backend_to_t>;
 
-    static inline typename dst_map_t::Ptr from(const typename src_map_t::Ptr& src)
+    static inline typename dst_map_t::Ptr from(const typename src_map_t::Ptr& src,
+                                               const std::size_t num_threads = utility::default_thread_count())
     {
         if (!src)
             return nullptr;
@@ -95,21 +161,28 @@ struct convert<map::tags::static_map,option_from_t,Dim,data_t,T,backend_to_t,bac
         const typename dst_map_t::size_t size =
                 cslibs_math::common::cast<std::size_t>(std::ceil(cslibs_math::common::cast<T>(max_distribution_index - min_distribution_index) / 2.0));
 
-        typename dst_map_t::Ptr dst(new dst_map_t(src->getInitialOrigin(),
-                                                  src->getResolution(),
-                                                  size,
-                                                  min_distribution_index));
-
-        static constexpr std::size_t bin_count  = utility::two_pow(Dim);
-        using bundle_t = cslibs_ndt::Bundle<data_t<T,Dim>*, bin_count>;
-        src->traverse([&dst](const index_t &bi, const bundle_t &b) {
-            if (const bundle_t* b_dst = dst->getDistributionBundle(bi)) {
-                for (std::size_t i = 0 ; i < bin_count ; ++i)
-                    impl::convert<data_t,T,Dim>::from(b.at(i), b_dst->at(i));
-            }
-        });
-
-        return dst;
+        /// sized like the storages of a static map constructed with size and minimum index
+        index_t offset;
+        for (std::size_t i = 0 ; i < Dim ; ++i)
+            offset[i] = min_distribution_index[i] >> 1;
+        auto prepare = [&size, &offset](const std::size_t i, const typename dst_map_t::distribution_storage_ptr_t &storage) {
+            storage->template set<cis::option::tags::array_size>(i == 0 ? size : size + 1ul);
+            storage->template set<cis::option::tags::array_offset>(offset);
+        };
+
+        typename dst_map_t::distribution_storage_array_t storages;
+        typename dst_map_t::distribution_bundle_storage_ptr_t bundles(new typename dst_map_t::distribution_bundle_storage_t);
+        bundles->template set<cis::option::tags::array_size>(size * 2ul);
+        bundles->template set<cis::option::tags::array_offset>(min_distribution_index);
+        std::vector<index_t> indices;
+        impl::copy<src_map_t,dst_map_t,Dim,data_t,T>(*src, storages, bundles, indices, prepare, num_threads);
+
+        return typename dst_map_t::Ptr(new dst_map_t(src->getInitialOrigin(),
+                                                     src->getResolution(),
+                                                     size,
+                                                     bundles,
+                                                     storages,
+                                                     min_distribution_index));
     }
 };
 
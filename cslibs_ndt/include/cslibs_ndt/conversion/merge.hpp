@@ -0,0 +1,86 @@
+#ifndef CSLIBS_NDT_CONVERSION_MERGE_HPP
+#define CSLIBS_NDT_CONVERSION_MERGE_HPP
+
+#include <cslibs_ndt/utility/parallel.hpp>
+
+#include <array>
+#include <utility>
+#include <vector>
+
+namespace cslibs_ndt {
+namespace conversion {
+/**
+ * @brief Merge the overlapping distributions of each bundle of a map into one distribution per
+ *        bundle index, e.g. for maps holding a single distribution per cell. The bundles are
+ *        partitioned into square tiles which are merged in parallel, the merged distributions are
+ *        inserted into the pre-sized destination storage afterwards.
+ * @param src           source map
+ * @param dst           destination storage, indexed by bundle index
+ * @param min_index     minimum bundle index of the source map
+ * @param max_index     maximum bundle index of the source map
+ * @param tile_size     edge length of a tile in bundles
+ * @param num_threads   maximum number of threads
+ */
+template <typename src_map_t, typename storage_t>
+inline void merge(const src_map_t &src,
+                  storage_t &dst,
+                  const typename src_map_t::index_t &min_index,
+                  const typename src_map_t::index_t &max_index,
+                  const std::size_t tile_size   = 64ul,
+                  const std::size_t num_threads = utility::default_thread_count())
+{
+    using index_t        = typename src_map_t::index_t;
+    using bundle_t       = typename src_map_t::distribution_bundle_t;
+    using distribution_t = typename src_map_t::distribution_t;
+    static constexpr std::size_t Dim = std::tuple_size<index_t>::value;
+
+    std::vector<std::pair<const index_t, const bundle_t*>> bundles;
+    src.getBundles(bundles);
+    if (bundles.empty())
+        return;
+
+    /// tiles in row-major order, bundles sorted by tile
+    std::size_t tile_count = 1ul;
+    std::array<std::size_t, Dim> tile_stride;
+    for (std::size_t d = 0 ; d < Dim ; ++d) {
+        tile_stride[d] = tile_count;
+        tile_count    *= static_cast<std::size_t>(max_index[d] - min_index[d]) / tile_size + 1ul;
+    }
+    auto tile = [&min_index, &tile_stride, tile_size](const index_t &bi) {
+        std::size_t t = 0ul;
+        for (std::size_t d = 0 ; d < Dim ; ++d)
+            t += static_cast<std::size_t>(bi[d] - min_index[d]) / tile_size * tile_stride[d];
+        return t;
+    };
+
+    std::vector<std::size_t> tile_begin(tile_count + 1ul, 0ul);
+    for (const auto &b : bundles)
+        ++tile_begin[tile(b.first) + 1ul];
+    for (std::size_t t = 0 ; t < tile_count ; ++t)
+        tile_begin[t + 1ul] += tile_begin[t];
+
+    std::vector<std::size_t> order(bundles.size());
+    {
+        std::vector<std::size_t> next(tile_begin.begin(), tile_begin.end() - 1);
+        for (std::size_t j = 0 ; j < bundles.size() ; ++j)
+            order[next[tile(bundles[j].first)]++] = j;
+    }
+
+    std::vector<distribution_t, typename distribution_t::allocator_t> merged(bundles.size());
+    utility::parallel_for(0ul, tile_count, [&bundles, &tile_begin, &order, &merged](const std::size_t t) {
+        for (std::size_t j = tile_begin[t] ; j < tile_begin[t + 1ul] ; ++j) {
+            const bundle_t *b = bundles[order[j]].second;
+            for (std::size_t i = 0 ; i < src_map_t::bin_count ; ++i) {
+                if (const distribution_t *d = b->at(i))
+                    merged[j] += *d;
+            }
+        }
+    }, num_threads);
+
+    for (std::size_t j = 0 ; j < merged.size() ; ++j)
+        dst.insert(bundles[order[j]].first, std::move(merged[j]));
+}
+}
+}
+
+#endif // CSLIBS_NDT_CONVERSION_MERGE_HPP
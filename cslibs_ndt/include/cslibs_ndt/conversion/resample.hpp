@@ -0,0 +1,178 @@
+#ifndef CSLIBS_NDT_CONVERSION_RESAMPLE_HPP
+#define CSLIBS_NDT_CONVERSION_RESAMPLE_HPP
+
+#include <cslibs_ndt/map/map.hpp>
+#include <cslibs_ndt/common/distribution.hpp>
+#include <cslibs_ndt/common/occupancy_distribution.hpp>
+#include <cslibs_ndt/common/weighted_occupancy_distribution.hpp>
+#include <cslibs_ndt/utility/parallel.hpp>
+
+namespace cslibs_ndt {
+namespace conversion {
+
+namespace impl {
+template <template <typename,std::size_t> class data_t, typename T, std::size_t Dim>
+struct resample {};
+
+template <typename T, std::size_t Dim>
+struct resample<Distribution,T,Dim> {
+    static inline bool mean(const Distribution<T,Dim> &d, Eigen::Matrix<T,Dim,1> &m)
+    {
+        if (!d.valid())
+            return false;
+        m = d.getMean();
+        return true;
+    }
+
+    static inline void merge(const Distribution<T,Dim> &f, Distribution<T,Dim> &t)
+    {
+        t += f;
+    }
+};
+
+template <typename T, std::size_t Dim>
+struct resample<OccupancyDistribution,T,Dim> {
+    static inline bool mean(const OccupancyDistribution<T,Dim> &d, Eigen::Matrix<T,Dim,1> &m)
+    {
+        if (!d.getDistribution() || !d.getDistribution()->valid())
+            return false;
+        m = d.getDistribution()->getMean();
+        return true;
+    }
+
+    /// merge copies the shared distribution pointer, so the statistics are added instead
+    static inline void merge(const OccupancyDistribution<T,Dim> &f, OccupancyDistribution<T,Dim> &t)
+    {
+        t.updateFree(f.numFree());
+        if (f.getDistribution())
+            t.updateOccupied(*(f.getDistribution()));
+    }
+};
+
+template <typename T, std::size_t Dim>
+struct resample<WeightedOccupancyDistribution,T,Dim> {
+    static inline bool mean(const WeightedOccupancyDistribution<T,Dim> &d, Eigen::Matrix<T,Dim,1> &m)
+    {
+        if (!d.getDistribution() || !d.getDistribution()->valid())
+            return false;
+        m = d.getDistribution()->getMean();
+        return true;
+    }
+
+    static inline void merge(const WeightedOccupancyDistribution<T,Dim> &f, WeightedOccupancyDistribution<T,Dim> &t)
+    {
+        t.updateFree(f.weightFree());
+        t.updateOccupied(f.getDistribution());
+    }
+};
+}
+
+/**
+ * @brief Change the resolution of a map by merging the sufficient statistics of its distributions.
+ *        The first storage partitions the inserted data, each of its distributions is added to
+ *        the bundle containing its mean, or its cell center if it holds free space only, just
+ *        like a point inserted into the resampled map. Bundles are allocated first, then the
+ *        storages of the resampled map, which hold distinct distributions, are merged in parallel.
+ */
+template <std::size_t Dim,
+          template <typename,std::size_t> class data_t,
+          typename T,
+          map::tags::option option_from_t,
+          template <typename, typename, typename...> class backend_to_t = map::tags::default_types<map::tags::dynamic_map>::template default_backend_t,
+          template <typename, typename, typename...> class backend_from_t = map::tags::default_types<option_from_t>::template default_backend_t>
+struct resample {
+    using src_map_t = map::Map<option_from_t,Dim,data_t,T,backend_from_t>;
+    using dst_map_t = map::Map<map::tags::dynamic_map,Dim,data_t,T,backend_to_t>;
+
+    static inline typename dst_map_t::Ptr from(const typename src_map_t::Ptr& src,
+                                               const T resolution,
+                                               const std::size_t num_threads = utility::default_thread_count())
+    {
+        if (!src || resolution <= T())
+            return nullptr;
+
+        typename dst_map_t::Ptr dst(new dst_map_t(src->getInitialOrigin(), resolution));
+
+        using index_t  = typename src_map_t::index_t;
+        using bundle_t = typename dst_map_t::distribution_bundle_t;
+        using vector_t = Eigen::Matrix<T,Dim,1>;
+        using impl_t   = impl::resample<data_t,T,Dim>;
+
+        const T src_resolution        = src->getResolution();
+        const T bundle_resolution_inv = 1.0 / dst->getBundleResolution();
+        std::vector<const data_t<T,Dim>*> children;
+        std::vector<const bundle_t*>      bundles;
+        src->getStorages()[0]->traverse([&dst, &children, &bundles, src_resolution, bundle_resolution_inv](const index_t &si, const data_t<T,Dim> &d) {
+            vector_t m;
+            if (!impl_t::mean(d, m)) {
+                for (std::size_t i = 0 ; i < Dim ; ++i)
+                    m(i) = (static_cast<T>(si[i]) + 0.5) * src_resolution;
+            }
+
+            index_t bi;
+            for (std::size_t i = 0 ; i < Dim ; ++i)
+                bi[i] = static_cast<int>(std::floor(m(i) * bundle_resolution_inv));
+            if (const bundle_t *b = dst->getDistributionBundle(bi)) {
+                children.emplace_back(&d);
+                bundles.emplace_back(b);
+            }
+        });
+
+        utility::parallel_for(0ul, dst_map_t::bin_count, [&children, &bundles](const std::size_t i) {
+            for (std::size_t k = 0 ; k < children.size() ; ++k)
+                impl_t::merge(*children[k], *(bundles[k]->at(i)));
+        }, num_threads);
+
+        return dst;
+    }
+};
+
+/**
+ * @brief Levels of detail of a map, each level is coarser than the previous one by the given
+ *        factor and derived from it by resample, so no raw data is inserted again.
+ */
+template <std::size_t Dim,
+          template <typename,std::size_t> class data_t,
+          typename T,
+          map::tags::option option_from_t,
+          template <typename, typename, typename...> class backend_to_t = map::tags::default_types<map::tags::dynamic_map>::template default_backend_t,
+          template <typename, typename, typename...> class backend_from_t = map::tags::default_types<option_from_t>::template default_backend_t>
+struct pyramid {
+    using src_map_t = map::Map<option_from_t,Dim,data_t,T,backend_from_t>;
+    using dst_map_t = map::Map<map::tags::dynamic_map,Dim,data_t,T,backend_to_t>;
+
+    /**
+     * @param src           map
+     * @param levels        number of levels
+     * @param factor        resolution factor between consecutive levels, at least 2
+     * @param num_threads   maximum number of threads
+     * @return levels in order of decreasing detail, the first has factor times the resolution
+     *         of the map, empty on failure
+     */
+    static inline std::vector<typename dst_map_t::Ptr> from(const typename src_map_t::Ptr& src,
+                                                            const std::size_t levels,
+                                                            const std::size_t factor = 2,
+                                                            const std::size_t num_threads = utility::default_thread_count())
+    {
+        std::vector<typename dst_map_t::Ptr> maps;
+        if (!src || factor < 2)
+            return maps;
+
+        const T f = static_cast<T>(factor);
+        maps.reserve(levels);
+        for (std::size_t l = 0 ; l < levels ; ++l) {
+            const typename dst_map_t::Ptr level = l == 0 ?
+                        resample<Dim,data_t,T,option_from_t,backend_to_t,backend_from_t>::from(src, f * src->getResolution(), num_threads) :
+                        resample<Dim,data_t,T,map::tags::dynamic_map,backend_to_t,backend_to_t>::from(maps.back(), f * maps.back()->getResolution(), num_threads);
+            if (!level)
+                return std::vector<typename dst_map_t::Ptr>();
+            maps.emplace_back(level);
+        }
+        return maps;
+    }
+};
+
+}
+}
+
+#endif // CSLIBS_NDT_CONVERSION_RESAMPLE_HPP
@@ -39,6 +39,7 @@ public:
     using point_t       = typename traits<Dim,T>::point_t;
     using pointcloud_t  = typename traits<Dim,T>::pointcloud_t;
     using index_t       = std::array<int,Dim>;
+    using gradient_t    = Eigen::Matrix<T,Dim,1>;
 
     static constexpr std::size_t bin_count  = utility::two_pow(Dim);
     static constexpr T div_count = 1.0 / static_cast<T>(bin_count);
@@ -101,7 +102,8 @@ public:
         min_bundle_index_(other.min_bundle_index_),
         max_bundle_index_(other.max_bundle_index_),
         storage_(utility::create<distribution_storage_t,bin_count>(other.storage_)),
-        bundle_storage_(new distribution_bundle_storage_t(*other.bundle_storage_))
+        bundle_storage_(new distribution_bundle_storage_t(*other.bundle_storage_)),
+        dirty_bundles_(other.dirty_bundles_)
     {
     }
 
@@ -114,7 +116,8 @@ public:
         min_bundle_index_(other.min_bundle_index_),
         max_bundle_index_(other.max_bundle_index_),
         storage_(other.storage_),
-        bundle_storage_(other.bundle_storage_)
+        bundle_storage_(other.bundle_storage_),
+        dirty_bundles_(std::move(other.dirty_bundles_))
     {
     }
 
@@ -259,6 +262,42 @@ public:
         return;
     }
 
+    /**
+     * @brief Mark a bundle as changed, e.g. after modifying it through getDistributionBundle.
+     *        Updates by insertion are tracked automatically.
+     * @param bi    bundle index
+     */
+    inline void markDirty(const index_t &bi) const
+    {
+        const distribution_bundle_t *bundle = bundle_storage_->get(bi);
+        if (bundle)
+            markDirty(bi, bundle);
+    }
+
+    inline std::size_t getDirtyBundleCount() const
+    {
+        return dirty_bundles_.size();
+    }
+
+    /**
+     * @brief Get the bundles changed since the last call and mark them clean. There is one
+     *        list of dirty bundles per map, if several consumers need the changes, take them
+     *        once and hand the indices to each of them.
+     *        Like insertion, the dirty tracking is not thread-safe: it must not run
+     *        concurrently with insertions or other accesses to the dirty bundles.
+     * @param indices   indices of the changed bundles
+     */
+    inline void takeDirtyBundles(std::vector<index_t> &indices) const
+    {
+        indices.clear();
+        indices.swap(dirty_bundles_);
+        for (const index_t &bi : indices) {
+            const distribution_bundle_t *bundle = bundle_storage_->get(bi);
+            if (bundle)
+                bundle->setDirty(false);
+        }
+    }
+
     inline std::size_t getByteSize() const
     {
         std::size_t size = bundle_storage_->byte_size();
@@ -278,6 +317,7 @@ protected:
     mutable index_t                            max_bundle_index_;
     mutable distribution_storage_array_t       storage_;
     mutable distribution_bundle_storage_ptr_t  bundle_storage_;
+    mutable std::vector<index_t>               dirty_bundles_;     /// also written by const members, not synchronized
 
     template <typename content_t, typename storage_t>
     inline content_t* getAllocate(const storage_t &s,
@@ -305,6 +345,14 @@ protected:
         return bundle;
     }
 
+    inline void markDirty(const index_t &bi, const distribution_bundle_t *bundle) const
+    {
+        if (!bundle->dirty()) {
+            bundle->setDirty(true);
+            dirty_bundles_.emplace_back(bi);
+        }
+    }
+
     virtual void updateIndices(const index_t &chunk_index) const = 0;
     virtual bool valid(const index_t &index) const = 0;
 
@@ -320,6 +368,16 @@ protected:
         return false;
     }
 
+    /**
+     * @brief Rotate a gradient given in map coordinates into world coordinates.
+     * @param g_m   gradient in map coordinates
+     * @return the gradient in world coordinates
+     */
+    inline gradient_t toWorldGradient(const gradient_t &g_m) const
+    {
+        return (w_T_m_ * point_t(g_m) - w_T_m_.translation()).data();
+    }
+
     inline index_t toBundleIndex(const point_t &p_w,
                                  point_t &p_m) const
     {
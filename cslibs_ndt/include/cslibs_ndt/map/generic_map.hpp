@@ -35,6 +35,7 @@ public:
     using typename base_t::point_t;
     using typename base_t::pointcloud_t;
     using typename base_t::index_t;
+    using typename base_t::gradient_t;
     using typename base_t::index_list_t;
     using typename base_t::distribution_t;
     using typename base_t::distribution_storage_t;
@@ -196,6 +197,7 @@ public:
     using typename base_t::point_t;
     using typename base_t::pointcloud_t;
     using typename base_t::index_t;
+    using typename base_t::gradient_t;
     using typename base_t::index_list_t;
     using typename base_t::distribution_t;
     using typename base_t::distribution_storage_t;
@@ -28,6 +28,7 @@ public:
     using typename base_t::point_t;
     using typename base_t::pointcloud_t;
     using typename base_t::index_t;
+    using typename base_t::gradient_t;
     using typename base_t::index_list_t;
     using typename base_t::distribution_t;
     using typename base_t::distribution_storage_t;
@@ -136,6 +137,43 @@ public:
         return bundle ? evaluate() : T();
     }
 
+    /**
+     * @brief Non-normalized sample and its gradient.
+     * @param p         point in world coordinates
+     * @param gradient  derivative of the sample with respect to p, in world coordinates
+     * @return the sample
+     */
+    inline T sampleNonNormalized(const point_t &p,
+                                 gradient_t &gradient) const
+    {
+        gradient.setZero();
+
+        point_t pm;
+        const index_t& bi = this->toBundleIndex(p, pm);
+        if (!this->valid(bi))
+            return T();
+
+        const distribution_bundle_t *bundle = this->bundle_storage_->get(bi);
+        if (!bundle)
+            return T();
+
+        T retval = T();
+        gradient_t gradient_m = gradient_t::Zero();
+        for (std::size_t i=0; i<this->bin_count; ++i) {
+            const distribution_t *d = bundle->at(i);
+            if (!d)
+                continue;
+
+            const T sample = this->div_count * d->sampleNonNormalized(pm);
+            retval += sample;
+            if (d->valid())
+                gradient_m -= sample * (d->getInformationMatrix() * (pm.data() - d->getMean()));
+        }
+
+        gradient = this->toWorldGradient(gradient_m);
+        return retval;
+    }
+
     inline T sampleNonNormalizedBilinear(const point_t &p) const
     {
         point_t pm;
@@ -189,6 +227,7 @@ protected:
         const distribution_bundle_t *bundle = this->getAllocate(bi);
         for (std::size_t i=0; i<this->bin_count; ++i)
             *bundle->at(i) += d;//->update(d);//->data() += d;
+        this->markDirty(bi, bundle);
     }
 };
 }
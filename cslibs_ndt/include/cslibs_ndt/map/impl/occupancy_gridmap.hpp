@@ -33,6 +33,7 @@ class EIGEN_ALIGN16 Map<option_t, Dim, OccupancyDistribution, T, backend_t>
   using typename base_t::distribution_storage_ptr_t;
   using typename base_t::distribution_storage_t;
   using typename base_t::distribution_t;
+  using typename base_t::gradient_t;
   using typename base_t::index_list_t;
   using typename base_t::index_t;
   using typename base_t::point_t;
@@ -265,6 +266,43 @@ class EIGEN_ALIGN16 Map<option_t, Dim, OccupancyDistribution, T, backend_t>
     return bundle ? evaluate() : T();
   }
 
+  /**
+   * @brief Non-normalized sample and its gradient.
+   * @param p         point in world coordinates
+   * @param ivm       inverse sensor model
+   * @param gradient  derivative of the sample with respect to p, in world coordinates
+   * @return the sample
+   */
+  inline T sampleNonNormalized(const point_t& p,
+                               const typename inverse_sensor_model_t::Ptr& ivm,
+                               gradient_t& gradient) const {
+    if (!ivm) throw std::runtime_error("[OccupancyGridMap]: inverse model not set");
+
+    gradient.setZero();
+
+    point_t pm;
+    const index_t& bi = this->toBundleIndex(p, pm);
+    if (!this->valid(bi)) return T();
+
+    const distribution_bundle_t* bundle = this->bundle_storage_->get(bi);
+    if (!bundle) return T();
+
+    T retval = T();
+    gradient_t gradient_m = gradient_t::Zero();
+    for (std::size_t i = 0; i < this->bin_count; ++i) {
+      const distribution_t* d = bundle->at(i);
+      if (!d || !d->getDistribution()) continue;
+
+      const auto& data = d->getDistribution();
+      const T sample = this->div_count * data->sampleNonNormalized(pm) * d->getOccupancy(ivm);
+      retval += sample;
+      if (data->valid()) gradient_m -= sample * (data->getInformationMatrix() * (pm.data() - data->getMean()));
+    }
+
+    gradient = this->toWorldGradient(gradient_m);
+    return retval;
+  }
+
   inline T sampleNonNormalizedBilinear(const point_t& p, const typename inverse_sensor_model_t::Ptr& ivm) const {
     point_t pm;
     const index_t& i = this->toBundleIndex(p, pm);
@@ -315,11 +353,13 @@ class EIGEN_ALIGN16 Map<option_t, Dim, OccupancyDistribution, T, backend_t>
   inline void updateFree(const index_t& bi, const std::size_t& n) const {
     const distribution_bundle_t* bundle = this->getAllocate(bi);
     for (std::size_t i = 0; i < this->bin_count; ++i) bundle->at(i)->updateFree(n);
+    this->markDirty(bi, bundle);
   }
 
   inline void updateOccupied(const index_t& bi, const typename distribution_t::distribution_t& d) const {
     const distribution_bundle_t* bundle = this->getAllocate(bi);
     for (std::size_t i = 0; i < this->bin_count; ++i) bundle->at(i)->updateOccupied(d);
+    this->markDirty(bi, bundle);
   }
 };
 }  // namespace map
@@ -345,6 +345,7 @@ protected:
         distribution_bundle_t *bundle = this->getAllocate(bi);
         for (std::size_t i=0; i<this->bin_count; ++i)
             bundle->at(i)->updateFree(w);
+        this->markDirty(bi, bundle);
     }
 
     inline void updateOccupied(const index_t &bi,
@@ -353,6 +354,7 @@ protected:
         distribution_bundle_t *bundle = this->getAllocate(bi);
         for (std::size_t i=0; i<this->bin_count; ++i)
             bundle->at(i)->updateOccupied(d);
+        this->markDirty(bi, bundle);
     }
 };
 }
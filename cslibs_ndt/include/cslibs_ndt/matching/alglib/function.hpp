@@ -20,6 +20,10 @@ class Function;
  *
  *     // function calculating function value
  *     inline static void apply(const ::alglib::real_1d_array &x, ::alglib::real_1d_array &fi, void *ptr);
+ *
+ *     // function calculating function value and jacobian (jac[i][j] = d fi[i] / d x[j])
+ *     inline static void applyJacobian(const ::alglib::real_1d_array &x, ::alglib::real_1d_array &fi,
+ *                                      ::alglib::real_2d_array &jac, void *ptr);
  * };
  */
 
@@ -0,0 +1,201 @@
+#ifndef CSLIBS_NDT_MATCHING_CERES_SAMPLE_GRID_HPP
+#define CSLIBS_NDT_MATCHING_CERES_SAMPLE_GRID_HPP
+
+#include <array>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <cslibs_ndt/utility/utility.hpp>
+#include <cslibs_ndt/utility/parallel.hpp>
+
+namespace cslibs_ndt {
+namespace matching {
+namespace ceres {
+
+/**
+ * @brief Cached, tiled-sparse grid of map costs (1 - sampleNonNormalized) in world coordinates.
+ *        Cell c corresponds to the world point c * sampling_resolution, which is the convention
+ *        used by the interpolating scan match cost functors. Tiles are only allocated where the
+ *        map has bundles (plus the margin the cubic stencil needs), all other cells have cost 1.
+ *        The grid is read-only after construction and can be shared between solves and threads.
+ */
+template <std::size_t Dim>
+class SampleGrid
+{
+public:
+    using Ptr      = std::shared_ptr<SampleGrid<Dim>>;
+    using ConstPtr = std::shared_ptr<const SampleGrid<Dim>>;
+    using index_t  = std::array<int,Dim>;
+
+    static constexpr int DATA_DIMENSION = 1;
+
+    static constexpr int         tile_bits  = Dim == 2 ? 5 : 3;
+    static constexpr int         tile_size  = 1 << tile_bits;
+    static constexpr int         tile_mask  = tile_size - 1;
+    static constexpr std::size_t tile_cells = utility::two_pow(Dim * tile_bits);
+
+    /**
+     * @brief Sample the given map once on a regular grid.
+     * @param map                   the ndt map
+     * @param sampling_resolution   grid resolution in world coordinates
+     * @param args                  additional sampling arguments, e.g. an inverse sensor model
+     * @return the sampled grid
+     */
+    template <typename ndt_t, typename ... args_t>
+    static inline Ptr create(const ndt_t &map,
+                             const double &sampling_resolution,
+                             const args_t &...args)
+    {
+        using point_t = typename ndt_t::point_t;
+        using map_index_t = typename ndt_t::index_t;
+
+        static_assert(point_t::Dimension == Dim, "Map and grid dimension differ.");
+
+        Ptr grid(new SampleGrid<Dim>(sampling_resolution));
+
+        /// mark all tiles touched by a bundle, including the cubic interpolation stencil
+        std::vector<map_index_t> bundle_indices;
+        map.getBundleIndices(bundle_indices);
+
+        const auto   w_T_m = map.getInitialOrigin();
+        const double bundle_resolution = static_cast<double>(map.getBundleResolution());
+        const double sampling_resolution_inv = 1.0 / sampling_resolution;
+
+        for (const map_index_t &bi : bundle_indices) {
+            index_t cell_min, cell_max;
+            cell_min.fill(std::numeric_limits<int>::max());
+            cell_max.fill(std::numeric_limits<int>::min());
+
+            for (std::size_t c = 0 ; c < utility::two_pow(Dim) ; ++c) {
+                const point_t corner = w_T_m * utility::to_point<point_t>([&bi, &c, &bundle_resolution](const std::size_t &i) {
+                    return (bi[i] + static_cast<int>((c >> i) & 1ul)) * bundle_resolution;
+                });
+                utility::for_each<Dim>([&corner, &cell_min, &cell_max, &sampling_resolution_inv](const std::size_t &i) {
+                    const double p = static_cast<double>(corner(i)) * sampling_resolution_inv;
+                    cell_min[i] = std::min(cell_min[i], static_cast<int>(std::floor(p)) - 2);
+                    cell_max[i] = std::max(cell_max[i], static_cast<int>(std::ceil(p))  + 2);
+                });
+            }
+            grid->markTiles(cell_min, cell_max);
+        }
+
+        /// sample the tiles in parallel, the tile table is not modified anymore
+        std::vector<std::pair<index_t, tile_t*>> tiles;
+        tiles.reserve(grid->tiles_.size());
+        for (auto &t : grid->tiles_)
+            tiles.emplace_back(t.first, &t.second);
+
+        utility::parallel_for(0ul, tiles.size(), [&tiles, &map, &sampling_resolution, &args...](const std::size_t t) {
+            const index_t &ti   = tiles[t].first;
+            tile_t        &tile = *tiles[t].second;
+            tile.resize(tile_cells);
+            for (std::size_t c = 0 ; c < tile_cells ; ++c) {
+                const point_t p = utility::to_point<point_t>([&ti, &c, &sampling_resolution](const std::size_t &i) {
+                    const int local = static_cast<int>((c >> (i * tile_bits)) & tile_mask);
+                    return ((ti[i] << tile_bits) + local) * sampling_resolution;
+                });
+                tile[c] = 1.0 - static_cast<double>(map.sampleNonNormalized(p, args...));
+            }
+        });
+
+        return grid;
+    }
+
+    inline double getSamplingResolution() const
+    {
+        return sampling_resolution_;
+    }
+
+    inline std::size_t getTileCount() const
+    {
+        return tiles_.size();
+    }
+
+    inline std::size_t getByteSize() const
+    {
+        return sizeof(*this) + tiles_.size() * (sizeof(index_t) + sizeof(tile_t) + tile_cells * sizeof(double));
+    }
+
+    /**
+     * @brief Cell access as required by ::ceres::BiCubicInterpolator.
+     */
+    inline void GetValue(const int row, const int column, double* const value) const
+    {
+        *value = at(index_t{{row, column}});
+    }
+
+    /**
+     * @brief Cell access as required by TriCubicInterpolator.
+     */
+    inline void GetValue(const int row, const int column, const int slice, double* const value) const
+    {
+        *value = at(index_t{{row, column, slice}});
+    }
+
+    inline double at(const index_t &cell) const
+    {
+        index_t ti;
+        std::size_t offset = 0;
+        utility::for_each<Dim>([&cell, &ti, &offset](const std::size_t &i) {
+            ti[i]   = cell[i] >> tile_bits;
+            offset |= static_cast<std::size_t>(cell[i] & tile_mask) << (i * tile_bits);
+        });
+
+        const auto it = tiles_.find(ti);
+        return it != tiles_.end() ? it->second[offset] : 1.0;
+    }
+
+private:
+    using tile_t = std::vector<double>;
+
+    struct IndexHash {
+        inline std::size_t operator()(const index_t &i) const
+        {
+            std::size_t h = 0;
+            for (std::size_t d = 0 ; d < Dim ; ++d)
+                h = h * 73856093ul ^ static_cast<std::size_t>(static_cast<unsigned int>(i[d]));
+            return h;
+        }
+    };
+
+    explicit inline SampleGrid(const double &sampling_resolution) :
+        sampling_resolution_(sampling_resolution)
+    {
+    }
+
+    inline void markTiles(const index_t &cell_min,
+                          const index_t &cell_max)
+    {
+        index_t tile_min, tile_max;
+        utility::for_each<Dim>([&](const std::size_t &i) {
+            tile_min[i] = cell_min[i] >> tile_bits;
+            tile_max[i] = cell_max[i] >> tile_bits;
+        });
+
+        index_t ti = tile_min;
+        while (true) {
+            tiles_[ti];
+
+            std::size_t i = 0;
+            for (; i < Dim ; ++i) {
+                if (++ti[i] <= tile_max[i])
+                    break;
+                ti[i] = tile_min[i];
+            }
+            if (i == Dim)
+                break;
+        }
+    }
+
+    const double sampling_resolution_;
+    std::unordered_map<index_t, tile_t, IndexHash> tiles_;
+};
+
+}
+}
+}
+
+#endif // CSLIBS_NDT_MATCHING_CERES_SAMPLE_GRID_HPP
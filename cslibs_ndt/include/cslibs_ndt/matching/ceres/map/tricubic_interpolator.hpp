@@ -0,0 +1,95 @@
+#ifndef CSLIBS_NDT_MATCHING_CERES_TRICUBIC_INTERPOLATOR_HPP
+#define CSLIBS_NDT_MATCHING_CERES_TRICUBIC_INTERPOLATOR_HPP
+
+#include <cmath>
+#include <ceres/jet.h>
+
+namespace cslibs_ndt {
+namespace matching {
+namespace ceres {
+
+/**
+ * @brief Three-dimensional counterpart of ::ceres::BiCubicInterpolator.
+ *        Uses the same Catmull-Rom (cubic Hermite) spline along rows, columns and slices,
+ *        so the interpolated function is C1 continuous. The grid has to provide
+ *        DATA_DIMENSION == 1 and GetValue(row, column, slice, double*).
+ */
+template <typename Grid>
+class TriCubicInterpolator
+{
+public:
+    static_assert(Grid::DATA_DIMENSION == 1, "TriCubicInterpolator only supports scalar grids.");
+
+    explicit inline TriCubicInterpolator(const Grid& grid) :
+        grid_(grid)
+    {
+    }
+
+    inline void Evaluate(const double r, const double c, const double s,
+                         double* f, double* dfdr, double* dfdc, double* dfds) const
+    {
+        const int n_r = static_cast<int>(std::floor(r));
+        const int n_c = static_cast<int>(std::floor(c));
+        const int n_s = static_cast<int>(std::floor(s));
+        const double x_r = r - n_r;
+        const double x_c = c - n_c;
+        const double x_s = s - n_s;
+
+        double p_s[4], p_s_dr[4], p_s_dc[4];
+        for (int k = 0; k < 4; ++k) {
+            double p_r[4], p_r_dc[4];
+            for (int i = 0; i < 4; ++i) {
+                double v[4];
+                for (int j = 0; j < 4; ++j)
+                    grid_.GetValue(n_r + i - 1, n_c + j - 1, n_s + k - 1, &v[j]);
+                spline(v, x_c, &p_r[i], &p_r_dc[i]);
+            }
+            spline(p_r,    x_r, &p_s[k], &p_s_dr[k]);
+            spline(p_r_dc, x_r, &p_s_dc[k], nullptr);
+        }
+
+        double value, d_s;
+        spline(p_s, x_s, &value, &d_s);
+        if (f)    *f = value;
+        if (dfds) *dfds = d_s;
+        if (dfdr) spline(p_s_dr, x_s, dfdr, nullptr);
+        if (dfdc) spline(p_s_dc, x_s, dfdc, nullptr);
+    }
+
+    inline void Evaluate(const double& r, const double& c, const double& s, double* f) const
+    {
+        Evaluate(r, c, s, f, nullptr, nullptr, nullptr);
+    }
+
+    template <typename JetT>
+    inline void Evaluate(const JetT& r, const JetT& c, const JetT& s, JetT* f) const
+    {
+        double frcs, dfdr, dfdc, dfds;
+        Evaluate(r.a, c.a, s.a, &frcs, &dfdr, &dfdc, &dfds);
+        f->a = frcs;
+        f->v = dfdr * r.v + dfdc * c.v + dfds * s.v;
+    }
+
+private:
+    /// same polynomial as ::ceres::CubicHermiteSpline, specialized for scalars
+    static inline void spline(const double* p, const double x, double* f, double* dfdx)
+    {
+        const double a = 0.5 * (-p[0] + 3.0 * p[1] - 3.0 * p[2] + p[3]);
+        const double b = 0.5 * (2.0 * p[0] - 5.0 * p[1] + 4.0 * p[2] - p[3]);
+        const double c = 0.5 * (-p[0] + p[2]);
+        const double d = p[1];
+
+        if (f)
+            *f = d + x * (c + x * (b + x * a));
+        if (dfdx)
+            *dfdx = c + x * (2.0 * b + 3.0 * a * x);
+    }
+
+    const Grid& grid_;
+};
+
+}
+}
+}
+
+#endif // CSLIBS_NDT_MATCHING_CERES_TRICUBIC_INTERPOLATOR_HPP
@@ -0,0 +1,290 @@
+#ifndef CSLIBS_NDT_MATCHING_SEARCH_BRANCH_AND_BOUND_HPP
+#define CSLIBS_NDT_MATCHING_SEARCH_BRANCH_AND_BOUND_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+#include <Eigen/Core>
+#include <Eigen/StdVector>
+
+#include <cslibs_ndt/matching/search/score_pyramid.hpp>
+#include <cslibs_ndt/utility/parallel.hpp>
+
+namespace cslibs_ndt {
+namespace matching {
+namespace search {
+
+/**
+ * @brief Correlative branch-and-bound search over integer cell translations of a score pyramid
+ *        and a discrete set of rotations. Rotations are distributed over threads, which share the
+ *        best score found so far for pruning. The search stops as soon as the time budget is
+ *        exceeded and returns the best solution found until then.
+ */
+template <std::size_t Dim>
+class BranchAndBound
+{
+public:
+    using pyramid_t = ScorePyramid<Dim>;
+    using index_t   = typename pyramid_t::index_t;
+    using cell_t    = Eigen::Matrix<double,Dim,1>;
+    using cells_t   = std::vector<cell_t, Eigen::aligned_allocator<cell_t>>;
+
+    struct Parameters {
+        index_t     linear_window;  /// half extent of the translation window per axis [cells]
+        double      min_score;      /// minimum mean score of a solution
+        std::size_t num_threads;
+        double      time_budget;    /// [s], <= 0: unbounded
+
+        inline Parameters() :
+            min_score(0.5),
+            num_threads(utility::default_thread_count()),
+            time_budget(0.0)
+        {
+            linear_window.fill(0);
+        }
+    };
+
+    struct Result {
+        index_t     offset;         /// translation [cells]
+        std::size_t rotation;       /// rotation index
+        double      score;
+        bool        found;
+        bool        complete;       /// false, if the time budget was exceeded
+
+        inline Result() :
+            rotation(0),
+            score(0.0),
+            found(false),
+            complete(true)
+        {
+            offset.fill(0);
+        }
+    };
+
+    /**
+     * @brief Search the best translation and rotation.
+     * @param pyramid           the score pyramid
+     * @param rotation_count    number of rotations
+     * @param rotate            rotate(k, cells) fills the scan for rotation k in continuous cell coordinates
+     *                          of the pyramid, translated to the window center
+     * @param parameters        search parameters
+     * @return the best solution
+     */
+    template <typename rotate_t>
+    static inline Result match(const pyramid_t  &pyramid,
+                               const std::size_t rotation_count,
+                               const rotate_t   &rotate,
+                               const Parameters &parameters)
+    {
+        using clock_t = std::chrono::steady_clock;
+
+        Result result;
+        if (rotation_count == 0ul)
+            return result;
+
+        const bool bounded = parameters.time_budget > 0.0;
+        const clock_t::time_point deadline = clock_t::now() +
+                std::chrono::duration_cast<clock_t::duration>(std::chrono::duration<double>(bounded ? parameters.time_budget : 0.0));
+
+        State state(parameters, bounded, deadline);
+
+        const std::size_t num_threads = std::max<std::size_t>(1ul, std::min(parameters.num_threads, rotation_count));
+        std::vector<Result> thread_results(num_threads);
+
+        utility::parallel_for_chunks(0ul, rotation_count, [&](const std::size_t thread, const std::size_t first, const std::size_t last) {
+            Result &best = thread_results[thread];
+            cells_t cells;
+            std::vector<index_t> scan;
+
+            for (std::size_t k = first ; k < last && !state.expired() ; ++k) {
+                cells.clear();
+                rotate(k, cells);
+                if (cells.empty())
+                    continue;
+
+                scan.resize(cells.size());
+                for (std::size_t i = 0 ; i < cells.size() ; ++i)
+                    for (std::size_t d = 0 ; d < Dim ; ++d)
+                        scan[i][d] = static_cast<int>(std::floor(cells[i](d)));
+
+                const std::size_t level = pyramid.getDepth() - 1;
+                const int step = 1 << level;
+                std::vector<Candidate> candidates;
+                index_t min, max;
+                for (std::size_t d = 0 ; d < Dim ; ++d) {
+                    min[d] = -parameters.linear_window[d];
+                    max[d] =  parameters.linear_window[d];
+                }
+                forEachOffset(min, max, step, [&](const index_t &o) {
+                    const double s = score(pyramid, level, scan, o);
+                    if (s > state.best())
+                        candidates.emplace_back(o, s);
+                });
+                std::sort(candidates.begin(), candidates.end());
+                descend(pyramid, level, scan, k, candidates, state, best);
+            }
+        }, num_threads);
+
+        for (const Result &r : thread_results) {
+            if (r.found && (!result.found || r.score > result.score))
+                result = r;
+        }
+        result.complete = !state.expired();
+        return result;
+    }
+
+private:
+    struct Candidate {
+        index_t offset;
+        double  score;
+
+        inline Candidate(const index_t &o, const double s) :
+            offset(o),
+            score(s)
+        {
+        }
+
+        inline bool operator < (const Candidate &other) const
+        {
+            return score > other.score;
+        }
+    };
+
+    class State {
+    public:
+        inline State(const Parameters &parameters,
+                     const bool bounded,
+                     const std::chrono::steady_clock::time_point &deadline) :
+            parameters_(parameters),
+            bounded_(bounded),
+            deadline_(deadline),
+            best_(parameters.min_score),
+            expired_(false)
+        {
+        }
+
+        inline const Parameters& parameters() const
+        {
+            return parameters_;
+        }
+
+        inline double best() const
+        {
+            return best_.load(std::memory_order_relaxed);
+        }
+
+        inline void update(const double score)
+        {
+            double current = best_.load(std::memory_order_relaxed);
+            while (score > current && !best_.compare_exchange_weak(current, score, std::memory_order_relaxed));
+        }
+
+        inline bool expired()
+        {
+            if (!bounded_)
+                return false;
+            if (!expired_.load(std::memory_order_relaxed) && std::chrono::steady_clock::now() > deadline_)
+                expired_.store(true, std::memory_order_relaxed);
+            return expired_.load(std::memory_order_relaxed);
+        }
+
+    private:
+        const Parameters                            &parameters_;
+        const bool                                   bounded_;
+        const std::chrono::steady_clock::time_point  deadline_;
+        std::atomic<double>                          best_;
+        std::atomic<bool>                            expired_;
+    };
+
+    template <typename Fn>
+    static inline void forEachOffset(const index_t &min,
+                                     const index_t &max,
+                                     const int step,
+                                     const Fn &fn)
+    {
+        index_t o = min;
+        while (true) {
+            fn(o);
+
+            std::size_t d = 0;
+            for (; d < Dim ; ++d) {
+                if ((o[d] += step) <= max[d])
+                    break;
+                o[d] = min[d];
+            }
+            if (d == Dim)
+                break;
+        }
+    }
+
+    static inline double score(const pyramid_t &pyramid,
+                               const std::size_t level,
+                               const std::vector<index_t> &scan,
+                               const index_t &offset)
+    {
+        double s = 0.0;
+        index_t c;
+        for (const index_t &p : scan) {
+            for (std::size_t d = 0 ; d < Dim ; ++d)
+                c[d] = p[d] + offset[d];
+            s += static_cast<double>(pyramid.get(level, c));
+        }
+        return s / static_cast<double>(scan.size());
+    }
+
+    static inline void descend(const pyramid_t &pyramid,
+                               const std::size_t level,
+                               const std::vector<index_t> &scan,
+                               const std::size_t rotation,
+                               const std::vector<Candidate> &candidates,
+                               State &state,
+                               Result &best)
+    {
+        for (const Candidate &candidate : candidates) {
+            if (candidate.score <= state.best() || state.expired())
+                return;
+
+            if (level == 0ul) {
+                state.update(candidate.score);
+                if (!best.found || candidate.score > best.score) {
+                    best.offset   = candidate.offset;
+                    best.rotation = rotation;
+                    best.score    = candidate.score;
+                    best.found    = true;
+                }
+                continue;
+            }
+
+            const int h = 1 << (level - 1);
+            std::vector<Candidate> children;
+            children.reserve(1ul << Dim);
+            for (std::size_t c = 0 ; c < (1ul << Dim) ; ++c) {
+                index_t o = candidate.offset;
+                bool valid = true;
+                for (std::size_t d = 0 ; d < Dim ; ++d) {
+                    if ((c >> d) & 1ul) {
+                        o[d] += h;
+                        valid &= o[d] <= state.parameters().linear_window[d];
+                    }
+                }
+                if (!valid)
+                    continue;
+
+                const double s = score(pyramid, level - 1, scan, o);
+                if (s > state.best())
+                    children.emplace_back(o, s);
+            }
+            std::sort(children.begin(), children.end());
+            descend(pyramid, level - 1, scan, rotation, children, state, best);
+        }
+    }
+};
+
+}
+}
+}
+
+#endif // CSLIBS_NDT_MATCHING_SEARCH_BRANCH_AND_BOUND_HPP
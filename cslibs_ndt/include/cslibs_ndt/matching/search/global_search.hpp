@@ -0,0 +1,544 @@
+#ifndef CSLIBS_NDT_MATCHING_SEARCH_GLOBAL_SEARCH_HPP
+#define CSLIBS_NDT_MATCHING_SEARCH_GLOBAL_SEARCH_HPP
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include <cslibs_math/common/angle.hpp>
+
+#include <cslibs_ndt/map/traits.hpp>
+#include <cslibs_ndt/utility/parallel.hpp>
+
+namespace cslibs_ndt {
+namespace matching {
+namespace search {
+
+template <std::size_t Dim, typename T>
+struct search_traits {};
+
+template <typename T>
+struct search_traits<2,T>
+{
+    using pose_t = cslibs_math_2d::Pose2<T>;
+
+    static inline pose_t compose(const pose_t &center, const std::array<double,2> &dt, const double dyaw)
+    {
+        return pose_t(center.tx() + dt[0], center.ty() + dt[1], center.yaw() + dyaw);
+    }
+
+    static inline double yaw(const pose_t &pose)
+    {
+        return static_cast<double>(pose.yaw());
+    }
+};
+
+template <typename T>
+struct search_traits<3,T>
+{
+    using pose_t = cslibs_math_3d::Pose3<T>;
+
+    static inline pose_t compose(const pose_t &center, const std::array<double,3> &dt, const double dyaw)
+    {
+        return pose_t(cslibs_math_3d::Vector3<T>(center.tx() + dt[0], center.ty() + dt[1], center.tz() + dt[2]),
+                      cslibs_math_3d::Quaternion<T>(dyaw) * center.rotation());
+    }
+
+    static inline double yaw(const pose_t &pose)
+    {
+        return static_cast<double>(pose.rotation().yaw());
+    }
+};
+
+/**
+ * @brief Exhaustive multi-hypothesis pose search for global relocalisation.
+ *        Translations (x, y[, z]) are searched on a regular grid around a center pose, rotations
+ *        only around the world z axis. Translations are grouped into coarse cells; for every
+ *        coarse cell an upper bound of the score is obtained from a precomputed max-pooled grid
+ *        of the maximum of sampleNonNormalized per coarse cell, so only coarse cells that may
+ *        beat the current candidates are evaluated in full resolution. Yaw hypotheses are
+ *        evaluated in parallel.
+ *        The upper bounds are built once in the constructor, the search object can be reused
+ *        for multiple queries. The translation step and the coarse cell size are fixed by the
+ *        constructor for that reason. The bounds are never below the score, so pruning cannot
+ *        discard the best pose.
+ */
+template <typename ndt_t>
+class GlobalSearch
+{
+public:
+    using Ptr      = std::shared_ptr<GlobalSearch<ndt_t>>;
+    using ConstPtr = std::shared_ptr<const GlobalSearch<ndt_t>>;
+
+    using point_t  = typename ndt_t::point_t;
+    using pose_t   = typename ndt_t::pose_t;
+    using index_t  = typename ndt_t::index_t;
+    using T        = decltype(std::declval<ndt_t>().getResolution());
+    using distribution_t = typename ndt_t::distribution_t;
+
+    static constexpr std::size_t Dim = std::tuple_size<index_t>::value;
+
+    using traits_t = search_traits<Dim,T>;
+    using vector_t = Eigen::Matrix<T,Dim,1>;
+
+    struct Parameters {
+        std::array<double,Dim> linear_window;       /// half extent of the translation window per axis [m]
+        double                 angular_window;      /// half extent of the yaw window [rad]
+        double                 angular_step;        /// yaw step [rad], <= 0: derived from the scan extent
+        std::size_t            max_candidates;      /// number of returned hypotheses
+        double                 min_score;           /// minimum mean sample value of a hypothesis
+        std::size_t            num_threads;
+
+        inline Parameters() :
+            angular_window(M_PI),
+            angular_step(0.0),
+            max_candidates(10),
+            min_score(0.1),
+            num_threads(utility::default_thread_count())
+        {
+            linear_window.fill(5.0);
+        }
+    };
+
+    struct EIGEN_ALIGN16 Candidate {
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+        pose_t pose;
+        double score;
+
+        inline bool operator < (const Candidate &other) const
+        {
+            return score > other.score;
+        }
+    };
+    using candidates_t = std::vector<Candidate, Eigen::aligned_allocator<Candidate>>;
+
+    /**
+     * @brief Prepare the search on a map, the map has to outlive the search object.
+     * @param map           the ndt map
+     * @param linear_step   translation step, <= 0: bundle resolution
+     * @param coarse_factor coarse cell size in translation steps
+     * @param args          additional sampling arguments, e.g. an inverse sensor model
+     */
+    template <typename ... args_t>
+    inline GlobalSearch(const ndt_t      &map,
+                        const double      linear_step,
+                        const std::size_t coarse_factor,
+                        const args_t &... args) :
+        map_(map),
+        linear_step_(linear_step > 0.0 ? linear_step : static_cast<double>(map.getBundleResolution())),
+        coarse_factor_(std::max<std::size_t>(1ul, coarse_factor)),
+        coarse_resolution_(linear_step_ * static_cast<double>(coarse_factor_)),
+        bundle_resolution_inv_(1.0 / static_cast<double>(map.getBundleResolution())),
+        m_T_w_(map.getInitialOrigin().inverse()),
+        sample_([&map, args...](const point_t &p, const index_t &bi) {
+            return static_cast<double>(map.sampleNonNormalized(p, bi, args...));
+        }),
+        weight_([args...](const distribution_t &d) {
+            return weight(d, args...);
+        })
+    {
+        buildBounds();
+    }
+
+    inline double getLinearStep() const
+    {
+        return linear_step_;
+    }
+
+    inline double getCoarseResolution() const
+    {
+        return coarse_resolution_;
+    }
+
+    /**
+     * @brief Mean sample value of the points transformed by pose.
+     * @param pose      pose in world coordinates
+     * @param points    points in local coordinates
+     * @return the score in [0, 1]
+     */
+    template <typename points_t>
+    inline double score(const pose_t &pose, const points_t &points) const
+    {
+        if (points.empty())
+            return 0.0;
+
+        double s = 0.0;
+        for (const auto &p : points)
+            s += sample((m_T_w_ * (pose * p)).data());
+        return s / static_cast<double>(points.size());
+    }
+
+    /**
+     * @brief Search for the best poses around a center pose.
+     * @param center        center of the search window in world coordinates
+     * @param points        points in local coordinates
+     * @param parameters    search parameters
+     * @return candidates sorted by descending score
+     */
+    template <typename points_t>
+    inline candidates_t search(const pose_t     &center,
+                               const points_t   &points,
+                               const Parameters &parameters) const
+    {
+        candidates_t result;
+        if (points.empty() || parameters.max_candidates == 0ul)
+            return result;
+
+        /// yaw discretization
+        double max_range = 0.0;
+        for (const auto &p : points)
+            max_range = std::max(max_range, static_cast<double>(p.length()));
+        double angular_step = parameters.angular_step;
+        if (angular_step <= 0.0) {
+            angular_step = max_range > linear_step_ ?
+                        std::acos(1.0 - (linear_step_ * linear_step_) / (2.0 * max_range * max_range)) : 0.1;
+        }
+        const int yaw_steps = static_cast<int>(std::ceil(parameters.angular_window / angular_step));
+        const std::size_t yaw_count = static_cast<std::size_t>(2 * yaw_steps + 1);
+
+        /// translation discretization, in steps and coarse cells per axis
+        std::array<int,Dim> steps, coarse_min, coarse_max;
+        for (std::size_t d = 0 ; d < Dim ; ++d) {
+            steps[d]      = static_cast<int>(std::ceil(parameters.linear_window[d] / linear_step_));
+            coarse_min[d] = floorDiv(-steps[d], static_cast<int>(coarse_factor_));
+            coarse_max[d] = floorDiv( steps[d], static_cast<int>(coarse_factor_));
+        }
+
+        /// map frame directions of the world axes
+        std::array<vector_t,Dim> axes;
+        for (std::size_t d = 0 ; d < Dim ; ++d) {
+            vector_t e = vector_t::Zero();
+            e(d) = static_cast<T>(1);
+            axes[d] = (m_T_w_ * point_t(e)).data() - (m_T_w_ * point_t(vector_t::Zero().eval())).data();
+        }
+
+        const std::size_t num_threads = std::max<std::size_t>(1ul, std::min(parameters.num_threads, yaw_count));
+        std::vector<candidates_t> thread_candidates(num_threads);
+
+        utility::parallel_for_chunks(0ul, yaw_count, [&](const std::size_t thread, const std::size_t first, const std::size_t last) {
+            candidates_t &best = thread_candidates[thread];
+            std::vector<vector_t, Eigen::aligned_allocator<vector_t>> base(points.size());
+            std::vector<std::pair<double, std::array<int,Dim>>> cells;
+
+            for (std::size_t k = first ; k < last ; ++k) {
+                const double dyaw = (static_cast<int>(k) - yaw_steps) * angular_step;
+                const pose_t rotated = traits_t::compose(center, std::array<double,Dim>(), dyaw);
+
+                std::size_t j = 0;
+                for (const auto &p : points)
+                    base[j++] = (m_T_w_ * (rotated * p)).data();
+
+                /// upper bound per coarse cell
+                cells.clear();
+                forEachIndex(coarse_min, coarse_max, [&](const std::array<int,Dim> &c) {
+                    vector_t offset = vector_t::Zero();
+                    for (std::size_t d = 0 ; d < Dim ; ++d)
+                        offset += axes[d] * static_cast<T>(((c[d] + 0.5) * coarse_factor_) * linear_step_);
+                    double bound = 0.0;
+                    for (const auto &b : base)
+                        bound += upperBound(b + offset);
+                    bound /= static_cast<double>(base.size());
+                    if (bound >= parameters.min_score)
+                        cells.emplace_back(bound, c);
+                });
+                std::sort(cells.begin(), cells.end(),
+                          [](const std::pair<double,std::array<int,Dim>> &a, const std::pair<double,std::array<int,Dim>> &b) {
+                    return a.first > b.first;
+                });
+
+                /// full resolution evaluation of the promising cells
+                for (const auto &cell : cells) {
+                    if (cell.first < threshold(best, parameters))
+                        break;
+
+                    std::array<int,Dim> fine_min, fine_max;
+                    for (std::size_t d = 0 ; d < Dim ; ++d) {
+                        fine_min[d] = std::max(-steps[d], cell.second[d] * static_cast<int>(coarse_factor_));
+                        fine_max[d] = std::min( steps[d], (cell.second[d] + 1) * static_cast<int>(coarse_factor_) - 1);
+                    }
+
+                    Candidate cell_best;
+                    cell_best.score = -1.0;
+                    forEachIndex(fine_min, fine_max, [&](const std::array<int,Dim> &f) {
+                        vector_t offset = vector_t::Zero();
+                        std::array<double,Dim> dt;
+                        for (std::size_t d = 0 ; d < Dim ; ++d) {
+                            dt[d] = f[d] * linear_step_;
+                            offset += axes[d] * static_cast<T>(dt[d]);
+                        }
+                        double s = 0.0;
+                        for (const auto &b : base)
+                            s += sample(b + offset);
+                        s /= static_cast<double>(base.size());
+                        if (s > cell_best.score) {
+                            cell_best.score = s;
+                            cell_best.pose  = traits_t::compose(center, dt, dyaw);
+                        }
+                    });
+
+                    if (cell_best.score >= threshold(best, parameters))
+                        insert(best, cell_best, parameters.max_candidates * 4ul);
+                }
+            }
+        }, num_threads);
+
+        /// merge and suppress hypotheses describing the same pose
+        candidates_t all;
+        for (const auto &c : thread_candidates)
+            all.insert(all.end(), c.begin(), c.end());
+        std::sort(all.begin(), all.end());
+
+        const double max_linear_distance  = coarse_resolution_;
+        const double max_angular_distance = 4.0 * angular_step;
+        for (const auto &c : all) {
+            const bool suppressed = std::any_of(result.begin(), result.end(), [&](const Candidate &r) {
+                return (c.pose.translation() - r.pose.translation()).length() < max_linear_distance &&
+                        std::fabs(cslibs_math::common::angle::difference(traits_t::yaw(c.pose), traits_t::yaw(r.pose))) < max_angular_distance;
+            });
+            if (!suppressed)
+                result.emplace_back(c);
+            if (result.size() >= parameters.max_candidates)
+                break;
+        }
+        return result;
+    }
+
+private:
+    const ndt_t                                              &map_;
+    const double                                              linear_step_;
+    const std::size_t                                         coarse_factor_;
+    const double                                              coarse_resolution_;
+    const double                                              bundle_resolution_inv_;
+    const pose_t                                              m_T_w_;
+    const std::function<double(const point_t&, const index_t&)> sample_;
+    const std::function<double(const distribution_t&)>         weight_;
+
+    std::array<int,Dim>         bounds_min_;
+    std::array<int,Dim>         bounds_size_;
+    std::vector<float>          bounds_;
+
+    static inline int floorDiv(const int a, const int b)
+    {
+        return static_cast<int>(std::floor(static_cast<double>(a) / static_cast<double>(b)));
+    }
+
+    template <typename Fn>
+    static inline void forEachIndex(const std::array<int,Dim> &min,
+                                    const std::array<int,Dim> &max,
+                                    const Fn &fn)
+    {
+        for (std::size_t d = 0 ; d < Dim ; ++d)
+            if (max[d] < min[d])
+                return;
+
+        std::array<int,Dim> i = min;
+        while (true) {
+            fn(i);
+
+            std::size_t d = 0;
+            for (; d < Dim ; ++d) {
+                if (++i[d] <= max[d])
+                    break;
+                i[d] = min[d];
+            }
+            if (d == Dim)
+                break;
+        }
+    }
+
+    static inline double threshold(const candidates_t &best,
+                                   const Parameters &parameters)
+    {
+        return best.size() < parameters.max_candidates * 4ul ?
+                    parameters.min_score : std::max(parameters.min_score, best.back().score);
+    }
+
+    static inline void insert(candidates_t &best,
+                              const Candidate &candidate,
+                              const std::size_t capacity)
+    {
+        best.insert(std::upper_bound(best.begin(), best.end(), candidate), candidate);
+        if (best.size() > capacity)
+            best.pop_back();
+    }
+
+    inline double sample(const vector_t &p_m) const
+    {
+        index_t bi;
+        for (std::size_t d = 0 ; d < Dim ; ++d)
+            bi[d] = static_cast<int>(std::floor(p_m(d) * bundle_resolution_inv_));
+        const double s = sample_(point_t(p_m), bi);
+        return std::isnormal(s) ? s : 0.0;
+    }
+
+    inline double upperBound(const vector_t &p_m) const
+    {
+        std::size_t offset = 0;
+        for (std::size_t d = Dim ; d > 0 ; --d) {
+            const int c = static_cast<int>(std::floor(p_m(d - 1) / coarse_resolution_)) - bounds_min_[d - 1];
+            if (c < 0 || c >= bounds_size_[d - 1])
+                return 0.0;
+            offset = offset * static_cast<std::size_t>(bounds_size_[d - 1]) + static_cast<std::size_t>(c);
+        }
+        return static_cast<double>(bounds_[offset]);
+    }
+
+    /**
+     * @brief Max-pooled grid of the maximum of sampleNonNormalized per coarse cell in map
+     *        coordinates, dilated by one cell. A translation within a coarse cell moves a point by
+     *        at most half a coarse cell along each world axis, that is less than one coarse cell
+     *        along each map axis, whichever the orientation of the map. The rotation needs no
+     *        dilation, the bounds are evaluated for every yaw hypothesis.
+     */
+    inline void buildBounds()
+    {
+        std::vector<index_t> bundle_indices;
+        map_.getBundleIndices(bundle_indices);
+
+        const double bundle_resolution = 1.0 / bundle_resolution_inv_;
+        const index_t min_bi = map_.getMinBundleIndex();
+        const index_t max_bi = map_.getMaxBundleIndex();
+        std::size_t size = 1;
+        for (std::size_t d = 0 ; d < Dim ; ++d) {
+            bounds_min_[d]  = static_cast<int>(std::floor(min_bi[d] * bundle_resolution / coarse_resolution_)) - 1;
+            bounds_size_[d] = static_cast<int>(std::floor((max_bi[d] + 1) * bundle_resolution / coarse_resolution_)) + 2 - bounds_min_[d];
+            size *= static_cast<std::size_t>(bounds_size_[d]);
+        }
+        bounds_.assign(size, 0.0f);
+
+        /// maximum of each bundle within every coarse cell it overlaps
+        std::vector<std::vector<std::pair<std::size_t, float>>> bundle_max(bundle_indices.size());
+        utility::parallel_for(0ul, bundle_indices.size(), [this, &bundle_indices, &bundle_max, bundle_resolution](const std::size_t i) {
+            const auto *bundle = map_.get(bundle_indices[i]);
+            if (!bundle)
+                return;
+
+            std::array<peak_t, ndt_t::bin_count> peaks;
+            for (std::size_t j = 0 ; j < ndt_t::bin_count ; ++j)
+                peaks[j] = bundle->at(j) ? peak(*(bundle->at(j))) : peak_t();
+
+            const index_t &bi = bundle_indices[i];
+            std::array<int,Dim> c_min, c_max;
+            for (std::size_t d = 0 ; d < Dim ; ++d) {
+                c_min[d] = static_cast<int>(std::floor( bi[d]        * bundle_resolution / coarse_resolution_));
+                c_max[d] = static_cast<int>(std::floor((bi[d] + 1.0) * bundle_resolution / coarse_resolution_));
+            }
+            forEachIndex(c_min, c_max, [this, &bi, &peaks, &bundle_max, i, bundle_resolution](const std::array<int,Dim> &c) {
+                vector_t lo, hi;
+                std::size_t offset = 0;
+                for (std::size_t d = Dim ; d > 0 ; --d) {
+                    lo(d - 1) = static_cast<T>(std::max( bi[d - 1]      * bundle_resolution,  c[d - 1]      * coarse_resolution_));
+                    hi(d - 1) = static_cast<T>(std::min((bi[d - 1] + 1) * bundle_resolution, (c[d - 1] + 1) * coarse_resolution_));
+                    offset = offset * static_cast<std::size_t>(bounds_size_[d - 1]) + static_cast<std::size_t>(c[d - 1] - bounds_min_[d - 1]);
+                }
+
+                double m = 0.0;
+                for (const peak_t &p : peaks)
+                    m += p.max(lo, hi);
+                m *= static_cast<double>(ndt_t::div_count);
+                /// with a margin for rounding, the bound must not drop below the sample
+                bundle_max[i].emplace_back(offset, static_cast<float>(m * (1.0 + 1e-5)));
+            });
+        });
+
+        for (const auto &b : bundle_max) {
+            for (const auto &m : b)
+                bounds_[m.first] = std::max(bounds_[m.first], m.second);
+        }
+
+        /// separable max filter of width three
+        std::size_t stride = 1;
+        for (std::size_t d = 0 ; d < Dim ; ++d) {
+            const std::size_t n = static_cast<std::size_t>(bounds_size_[d]);
+            const std::vector<float> src(bounds_);
+            for (std::size_t o = 0 ; o < size ; ++o) {
+                const std::size_t c = (o / stride) % n;
+                float m = src[o];
+                if (c > 0)
+                    m = std::max(m, src[o - stride]);
+                if (c + 1 < n)
+                    m = std::max(m, src[o + stride]);
+                bounds_[o] = m;
+            }
+            stride *= n;
+        }
+    }
+
+    /**
+     * @brief Weighted Gaussian of a distribution, bounded from above within a box by its value
+     *        at the Euclidean distance of the mean to the box along the flattest direction.
+     *        Unfitted Gaussians are bounded by their weight.
+     */
+    struct peak_t {
+        double   weight = 0.0;
+        bool     valid  = false;
+        vector_t mean   = vector_t::Zero();
+        double   lambda = 0.0;      /// smallest eigenvalue of the information matrix
+
+        inline double max(const vector_t &lo, const vector_t &hi) const
+        {
+            if (weight <= 0.0 || !valid)
+                return weight;
+
+            double d2 = 0.0;
+            for (std::size_t d = 0 ; d < Dim ; ++d) {
+                const double e = std::max(0.0, std::max(static_cast<double>(lo(d) - mean(d)),
+                                                        static_cast<double>(mean(d) - hi(d))));
+                d2 += e * e;
+            }
+            return weight * std::exp(-0.5 * lambda * d2);
+        }
+    };
+
+    inline peak_t peak(const distribution_t &d) const
+    {
+        peak_t p;
+        p.weight = weight_(d);
+        const auto *g = gaussian(d);
+        if (p.weight <= 0.0 || !g || !g->valid())
+            return p;
+
+        using matrix_t = Eigen::Matrix<T,Dim,Dim>;
+        Eigen::SelfAdjointEigenSolver<matrix_t> solver;
+        solver.computeDirect(g->getInformationMatrix(), Eigen::EigenvaluesOnly);
+        p.valid  = solver.info() == Eigen::Success;
+        p.mean   = g->getMean();
+        p.lambda = std::max(0.0, static_cast<double>(solver.eigenvalues()(0)));
+        return p;
+    }
+
+    template <typename data_t, typename ... args_t>
+    static inline auto weight(const data_t &d, const args_t &...) -> decltype(d.getMean(), double())
+    {
+        return 1.0;
+    }
+
+    template <typename data_t, typename ivm_t>
+    static inline auto weight(const data_t &d, const ivm_t &ivm) -> decltype(d.getDistribution(), double())
+    {
+        return d.getDistribution() ? static_cast<double>(d.getOccupancy(ivm)) : 0.0;
+    }
+
+    template <typename data_t>
+    static inline auto gaussian(const data_t &d) -> decltype(d.getMean(), &d)
+    {
+        return &d;
+    }
+
+    template <typename data_t>
+    static inline auto gaussian(const data_t &d) -> decltype(d.getDistribution().get())
+    {
+        return d.getDistribution().get();
+    }
+};
+
+}
+}
+}
+
+#endif // CSLIBS_NDT_MATCHING_SEARCH_GLOBAL_SEARCH_HPP
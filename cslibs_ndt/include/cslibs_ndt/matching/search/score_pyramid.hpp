@@ -0,0 +1,130 @@
+#ifndef CSLIBS_NDT_MATCHING_SEARCH_SCORE_PYRAMID_HPP
+#define CSLIBS_NDT_MATCHING_SEARCH_SCORE_PYRAMID_HPP
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace cslibs_ndt {
+namespace matching {
+namespace search {
+
+/**
+ * @brief Dense score grid with precomputed max-pooled levels.
+ *        Level k stores for every cell c the maximum of level 0 over the cells [c, c + 2^k) along
+ *        each axis, all levels keep the resolution of level 0. Levels are padded on the lower side
+ *        so that windows starting in front of the grid are represented as well.
+ *        Cells outside of the grid score 0.
+ */
+template <std::size_t Dim>
+class ScorePyramid
+{
+public:
+    using Ptr      = std::shared_ptr<ScorePyramid<Dim>>;
+    using ConstPtr = std::shared_ptr<const ScorePyramid<Dim>>;
+    using index_t  = std::array<int,Dim>;
+
+    /**
+     * @brief Allocate a pyramid, level 0 is initialized with zeros.
+     * @param size      number of cells per axis
+     * @param depth     number of levels, at least one
+     */
+    inline ScorePyramid(const index_t &size,
+                        const std::size_t depth) :
+        size_(size),
+        depth_(std::max<std::size_t>(1ul, depth)),
+        padding_((1 << (depth_ - 1)) - 1)
+    {
+        std::size_t n = 1;
+        for (std::size_t d = 0 ; d < Dim ; ++d) {
+            padded_size_[d] = std::max(0, size_[d]) + padding_;
+            n *= static_cast<std::size_t>(padded_size_[d]);
+        }
+        levels_.assign(depth_, std::vector<float>(n, 0.0f));
+    }
+
+    inline const index_t& getSize() const
+    {
+        return size_;
+    }
+
+    inline std::size_t getDepth() const
+    {
+        return depth_;
+    }
+
+    inline std::size_t getByteSize() const
+    {
+        return sizeof(*this) + depth_ * (levels_.empty() ? 0ul : levels_.front().size() * sizeof(float));
+    }
+
+    /**
+     * @brief Access to level 0, the cell has to be inside of the grid. Call build() after
+     *        level 0 has been written.
+     */
+    inline float& at(const index_t &cell)
+    {
+        return levels_.front()[offset(cell)];
+    }
+
+    inline float get(const std::size_t level,
+                     const index_t &cell) const
+    {
+        std::size_t o = 0;
+        for (std::size_t d = Dim ; d > 0 ; --d) {
+            const int c = cell[d - 1] + padding_;
+            if (c < 0 || c >= padded_size_[d - 1])
+                return 0.0f;
+            o = o * static_cast<std::size_t>(padded_size_[d - 1]) + static_cast<std::size_t>(c);
+        }
+        return levels_[level][o];
+    }
+
+    /**
+     * @brief Compute the max-pooled levels from level 0, level k is the pairwise maximum of
+     *        level k - 1 shifted by 2^(k-1) cells along every axis.
+     */
+    inline void build()
+    {
+        const std::size_t n = levels_.front().size();
+        for (std::size_t k = 1 ; k < depth_ ; ++k) {
+            const int h = 1 << (k - 1);
+            std::vector<float> src = levels_[k - 1];
+            std::vector<float> &dst = levels_[k];
+
+            std::size_t stride = 1;
+            for (std::size_t d = 0 ; d < Dim ; ++d) {
+                const int ps = padded_size_[d];
+                for (std::size_t o = 0 ; o < n ; ++o) {
+                    const int c = static_cast<int>((o / stride) % static_cast<std::size_t>(ps));
+                    dst[o] = c + h < ps ? std::max(src[o], src[o + static_cast<std::size_t>(h) * stride]) : src[o];
+                }
+                stride *= static_cast<std::size_t>(ps);
+                if (d + 1 < Dim)
+                    src = dst;
+            }
+        }
+    }
+
+private:
+    const index_t                   size_;
+    const std::size_t               depth_;
+    const int                       padding_;
+    index_t                         padded_size_;
+    std::vector<std::vector<float>> levels_;
+
+    inline std::size_t offset(const index_t &cell) const
+    {
+        std::size_t o = 0;
+        for (std::size_t d = Dim ; d > 0 ; --d)
+            o = o * static_cast<std::size_t>(padded_size_[d - 1]) + static_cast<std::size_t>(cell[d - 1] + padding_);
+        return o;
+    }
+};
+
+}
+}
+}
+
+#endif // CSLIBS_NDT_MATCHING_SEARCH_SCORE_PYRAMID_HPP
@@ -0,0 +1,188 @@
+#ifndef CSLIBS_NDT_SERIALIZATION_ASYNC_HPP
+#define CSLIBS_NDT_SERIALIZATION_ASYNC_HPP
+
+#include <cslibs_ndt/map/map.hpp>
+#include <cslibs_ndt/serialization/loader.hpp>
+#include <cslibs_ndt/serialization/map.hpp>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+
+namespace cslibs_ndt {
+namespace serialization {
+namespace io {
+/**
+ * @brief Process wide background thread running queued I/O jobs in submission order.
+ */
+class Queue
+{
+public:
+    static inline Queue& instance()
+    {
+        static Queue queue;
+        return queue;
+    }
+
+    inline ~Queue()
+    {
+        {
+            std::unique_lock<std::mutex> l(mutex_);
+            stop_ = true;
+        }
+        notify_.notify_one();
+        if (worker_.joinable())
+            worker_.join();
+    }
+
+    Queue(const Queue &other) = delete;
+    Queue& operator = (const Queue &other) = delete;
+
+    inline std::future<bool> push(const std::function<bool()> &job)
+    {
+        std::packaged_task<bool()> task(job);
+        std::future<bool> result = task.get_future();
+        {
+            std::unique_lock<std::mutex> l(mutex_);
+            jobs_.emplace_back(std::move(task));
+        }
+        notify_.notify_one();
+        return result;
+    }
+
+private:
+    std::thread                             worker_;
+    std::mutex                              mutex_;
+    std::condition_variable                 notify_;
+    std::deque<std::packaged_task<bool()>>  jobs_;
+    bool                                    stop_;
+
+    inline Queue() :
+        stop_(false)
+    {
+        worker_ = std::thread([this]() { run(); });
+    }
+
+    inline void run()
+    {
+        while (true) {
+            std::packaged_task<bool()> job;
+            {
+                std::unique_lock<std::mutex> l(mutex_);
+                notify_.wait(l, [this]() { return stop_ || !jobs_.empty(); });
+                if (jobs_.empty())
+                    return;
+                job = std::move(jobs_.front());
+                jobs_.pop_front();
+            }
+            job();
+        }
+    }
+};
+}
+
+/**
+ * @brief Non-blocking save of a live map. The caller only copies the storages and the bundle
+ *        indices, rebuilding the bundles and writing happens on the I/O thread, so the map
+ *        may be modified again as soon as save returns. The copy does not start threads and
+ *        the I/O thread writes the stores one after another.
+ */
+template <map::tags::option option_t,
+          std::size_t Dim,
+          template <typename,std::size_t> class data_t,
+          typename T,
+          template <typename, typename, typename...> class backend_t = map::tags::default_types<option_t>::template default_backend_t>
+struct async
+{
+    using map_t            = cslibs_ndt::map::Map<option_t,Dim,data_t,T,backend_t>;
+    using index_t          = typename map_t::index_t;
+    using pose_t           = typename map_t::pose_t;
+    using storage_t        = typename map_t::distribution_storage_t;
+    using storages_t       = typename map_t::distribution_storage_array_t;
+    using bundle_storage_t = typename map_t::distribution_bundle_storage_t;
+    using loader_t         = loader<option_t,Dim,data_t,T,backend_t>;
+    using callback_t       = std::function<void(const bool)>;
+
+    struct snapshot {
+        pose_t                  origin;
+        T                       resolution;
+        typename map_t::size_t  size;
+        index_t                 min_index;
+        index_t                 max_index;
+        std::vector<index_t>    indices;
+        storages_t              storages;
+    };
+
+    /**
+     * @brief Save a map in the directory format of saveBinary.
+     * @param map   map, only read during the call
+     * @param path  map folder
+     * @return future holding the success of the write
+     */
+    static inline std::future<bool> save(const map_t &map,
+                                         const std::string &path)
+    {
+        const std::shared_ptr<const snapshot> s = take(map);
+        return io::Queue::instance().push([s, path]() {
+            return write(*s, path);
+        });
+    }
+
+    /**
+     * @brief Save a map in the directory format of saveBinary.
+     * @param map       map, only read during the call
+     * @param path      map folder
+     * @param callback  called on the I/O thread with the success of the write. The callback
+     *                  must not wait for another save, e.g. on its future: that save is queued
+     *                  for the same single I/O thread, which would deadlock.
+     */
+    static inline void save(const map_t &map,
+                            const std::string &path,
+                            const callback_t &callback)
+    {
+        const std::shared_ptr<const snapshot> s = take(map);
+        io::Queue::instance().push([s, path, callback]() {
+            const bool success = write(*s, path);
+            if (callback)
+                callback(success);
+            return success;
+        });
+    }
+
+    static inline std::shared_ptr<const snapshot> take(const map_t &map)
+    {
+        std::shared_ptr<snapshot> s(new snapshot);
+        s->origin     = map.getInitialOrigin();
+        s->resolution = map.getResolution();
+        s->size       = map.getSize();
+        s->min_index  = map.getMinBundleIndex();
+        s->max_index  = map.getMaxBundleIndex();
+        map.getBundleIndices(s->indices);
+
+        const storages_t &storages = map.getStorages();
+        for (std::size_t i = 0 ; i < map_t::bin_count ; ++i)
+            s->storages[i].reset(new storage_t(*storages[i]));
+        return s;
+    }
+
+private:
+    static inline bool write(const snapshot &s,
+                             const std::string &path)
+    {
+        const std::unique_ptr<loader_t> l(loader_t::create(s.origin, s.resolution, s.size, s.min_index, s.max_index, s.indices));
+        std::shared_ptr<bundle_storage_t> bundles(new bundle_storage_t);
+        l->allocateBundles(bundles, s.storages);
+
+        typename map_t::Ptr map;
+        l->createMap(bundles, s.storages, map);
+        return binary<option_t,Dim,data_t,T,backend_t>::save(*map, path, false);
+    }
+};
+
+}
+}
+
+#endif // CSLIBS_NDT_SERIALIZATION_ASYNC_HPP
@@ -0,0 +1,248 @@
+#ifndef CSLIBS_NDT_SERIALIZATION_BENCHMARK_HPP
+#define CSLIBS_NDT_SERIALIZATION_BENCHMARK_HPP
+
+#include <cslibs_ndt/serialization/map.hpp>
+#include <cslibs_ndt/serialization/buffered_io.hpp>
+
+#include <cslibs_math/random/random.hpp>
+
+#include <boost/filesystem.hpp>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+namespace cslibs_ndt {
+namespace serialization {
+namespace benchmark {
+using rng_t = cslibs_math::random::Uniform<double,1>;
+
+const std::size_t scan_size   = 1000;
+const double      scan_range  = 10.0;
+const double      scan_height = 2.0;
+
+/**
+ * @brief Random scan poses and points, flat in 2D and within a height band in 3D.
+ */
+template <std::size_t Dim>
+struct scan;
+
+template <>
+struct scan<2>
+{
+    using transform_t = cslibs_ndt::map::traits<2,double>::transform_t;
+    using point_t     = cslibs_ndt::map::traits<2,double>::point_t;
+
+    static inline transform_t pose(rng_t &rng_origin, rng_t &rng_angle)
+    {
+        return transform_t(rng_origin.get(), rng_origin.get(), rng_angle.get());
+    }
+
+    static inline point_t point(rng_t &rng_point, rng_t &)
+    {
+        return point_t(rng_point.get(), rng_point.get());
+    }
+};
+
+template <>
+struct scan<3>
+{
+    using transform_t = cslibs_ndt::map::traits<3,double>::transform_t;
+    using point_t     = cslibs_ndt::map::traits<3,double>::point_t;
+
+    static inline transform_t pose(rng_t &rng_origin, rng_t &rng_angle)
+    {
+        return transform_t(cslibs_math_3d::Vector3d(rng_origin.get(), rng_origin.get(), 0.0),
+                           cslibs_math_3d::Quaternion<double>(rng_angle.get()));
+    }
+
+    static inline point_t point(rng_t &rng_point, rng_t &rng_height)
+    {
+        return point_t(rng_point.get(), rng_point.get(), rng_height.get());
+    }
+};
+}
+
+/**
+ * Measures the throughput of the binary map serialization of the 2D and 3D dynamic maps, the map
+ * types of the dimension have to be included before instantiating run(). The block I/O row is
+ * the throughput of the buffered block writer and reader alone, writing and reading the same
+ * number of bytes in records of a distribution's size, which bounds the map rows.
+ *
+ * usage: <program> [num_points] [repetitions] [directory]
+ */
+template <std::size_t Dim>
+class SerializationBenchmark
+{
+public:
+    static inline int run(int argc, char *argv[], const std::string &program)
+    {
+        std::size_t num_points  = 1000000ul;
+        std::size_t repetitions = 5ul;
+        try {
+            if (argc > 1)
+                num_points  = std::stoul(argv[1]);
+            if (argc > 2)
+                repetitions = std::max(1ul, std::stoul(argv[2]));
+        } catch (const std::exception &) {
+            std::cerr << "usage: " << program << " [num_points] [repetitions] [directory]" << std::endl;
+            return 1;
+        }
+        const boost::filesystem::path directory = argc > 3 ? argv[3] : "/tmp";
+        const std::string suffix = "_" + std::to_string(Dim) + "d";
+
+        const scans_t scans = generateScans(num_points);
+        const transform_t origin;
+        const double resolution = 1.0;
+
+        typename gridmap_t::Ptr gridmap(new gridmap_t(origin, resolution));
+        typename occupancy_gridmap_t::Ptr occupancy_gridmap(new occupancy_gridmap_t(origin, resolution));
+        for (const auto &s : scans) {
+            gridmap->insert(s.second, s.first);
+            occupancy_gridmap->insert(s.second, s.first);
+        }
+
+        std::cout << num_points << " points, " << repetitions << " repetitions, page cache not dropped" << std::endl;
+        const std::size_t bytes = runMap("Gridmap", *gridmap, repetitions, directory / ("ndt_benchmark_gridmap" + suffix));
+        runMap("OccupancyGridmap", *occupancy_gridmap, repetitions, directory / ("ndt_benchmark_occupancy_gridmap" + suffix));
+        runBlockIO(bytes, repetitions, directory / ("ndt_benchmark_block_io" + suffix + ".bin"));
+        return 0;
+    }
+
+private:
+    using steady_clock_t      = std::chrono::steady_clock;
+    using traits_t            = cslibs_ndt::map::traits<Dim,double>;
+    using transform_t         = typename traits_t::transform_t;
+    using pointcloud_t        = typename traits_t::pointcloud_t;
+    using scans_t             = std::vector<std::pair<transform_t, typename pointcloud_t::Ptr>>;
+    using gridmap_t           = cslibs_ndt::map::Map<cslibs_ndt::map::tags::dynamic_map,Dim,cslibs_ndt::Distribution,double>;
+    using occupancy_gridmap_t = cslibs_ndt::map::Map<cslibs_ndt::map::tags::dynamic_map,Dim,cslibs_ndt::OccupancyDistribution,double>;
+
+    static inline std::size_t directorySize(const boost::filesystem::path &path)
+    {
+        std::size_t size = 0;
+        for (boost::filesystem::recursive_directory_iterator it(path), end ; it != end ; ++it) {
+            if (boost::filesystem::is_regular_file(it->path()))
+                size += boost::filesystem::file_size(it->path());
+        }
+        return size;
+    }
+
+    static inline double seconds(const steady_clock_t::time_point &start)
+    {
+        return std::chrono::duration<double>(steady_clock_t::now() - start).count();
+    }
+
+    /// short range scans keep the occupancy ray tracing cheap, the mapped area grows with the point count
+    static inline scans_t generateScans(const std::size_t num_points)
+    {
+        const double extent = 0.5 * std::sqrt(static_cast<double>(num_points));
+        benchmark::rng_t rng_origin(-extent, extent);
+        benchmark::rng_t rng_angle(-M_PI, M_PI);
+        benchmark::rng_t rng_point(-benchmark::scan_range, benchmark::scan_range);
+        benchmark::rng_t rng_height(-benchmark::scan_height, benchmark::scan_height);
+
+        scans_t scans;
+        for (std::size_t n = 0 ; n < num_points ; n += benchmark::scan_size) {
+            typename pointcloud_t::Ptr cloud(new pointcloud_t());
+            for (std::size_t i = n ; i < std::min(num_points, n + benchmark::scan_size) ; ++ i)
+                cloud->insert(benchmark::scan<Dim>::point(rng_point, rng_height));
+            scans.emplace_back(benchmark::scan<Dim>::pose(rng_origin, rng_angle), cloud);
+        }
+        return scans;
+    }
+
+    static inline void print(const std::string &name,
+                             const std::size_t bytes,
+                             const double save_time,
+                             const double load_time)
+    {
+        const double mb = static_cast<double>(bytes) / (1024.0 * 1024.0);
+        std::cout << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(10) << mb << " MB"
+                  << std::setw(12) << mb / save_time << " MB/s save"
+                  << std::setw(12) << mb / load_time << " MB/s load" << std::endl;
+    }
+
+    /**
+     * @return size of the saved map in bytes
+     */
+    template <template <typename,std::size_t> class data_t>
+    static inline std::size_t runMap(const std::string &name,
+                                     const cslibs_ndt::map::Map<cslibs_ndt::map::tags::dynamic_map,Dim,data_t,double> &map,
+                                     const std::size_t repetitions,
+                                     const boost::filesystem::path &path)
+    {
+        using binary_t = binary<cslibs_ndt::map::tags::dynamic_map,Dim,data_t,double>;
+        using map_t    = typename binary_t::map_t;
+
+        double save_time = 0.0;
+        double load_time = 0.0;
+        for (std::size_t i = 0 ; i < repetitions ; ++ i) {
+            boost::filesystem::remove_all(path);
+
+            const steady_clock_t::time_point save_start = steady_clock_t::now();
+            if (!binary_t::save(map, path.string())) {
+                std::cerr << "[SerializationBenchmark]: Saving '" << name << "' failed." << std::endl;
+                return 0ul;
+            }
+            save_time += seconds(save_start);
+
+            typename map_t::Ptr loaded;
+            const steady_clock_t::time_point load_start = steady_clock_t::now();
+            if (!binary_t::load(path.string(), loaded)) {
+                std::cerr << "[SerializationBenchmark]: Loading '" << name << "' failed." << std::endl;
+                return 0ul;
+            }
+            load_time += seconds(load_start);
+        }
+
+        const std::size_t bytes = directorySize(path);
+        print(name, bytes * repetitions, save_time, load_time);
+        boost::filesystem::remove_all(path);
+        return bytes;
+    }
+
+    static inline void runBlockIO(const std::size_t bytes,
+                                  const std::size_t repetitions,
+                                  const boost::filesystem::path &path)
+    {
+        const std::size_t record_size = sizeof(typename gridmap_t::distribution_t);
+        const std::size_t records     = bytes / record_size;
+        const std::vector<char> record(record_size, 'r');
+        std::vector<char> input(record_size);
+
+        double save_time = 0.0;
+        double load_time = 0.0;
+        for (std::size_t i = 0 ; i < repetitions ; ++ i) {
+            const steady_clock_t::time_point save_start = steady_clock_t::now();
+            BufferedOutputFile out(path.string());
+            for (std::size_t r = 0 ; r < records ; ++ r)
+                out.write(record.data(), static_cast<std::streamsize>(record_size));
+            if (!out.close()) {
+                std::cerr << "[SerializationBenchmark]: Writing blocks failed." << std::endl;
+                return;
+            }
+            save_time += seconds(save_start);
+
+            const steady_clock_t::time_point load_start = steady_clock_t::now();
+            BufferedInputFile in(path.string());
+            for (std::size_t r = 0 ; r < records ; ++ r)
+                in.read(input.data(), static_cast<std::streamsize>(record_size));
+            if (!in.is_open() || !in) {
+                std::cerr << "[SerializationBenchmark]: Reading blocks failed." << std::endl;
+                return;
+            }
+            load_time += seconds(load_start);
+        }
+
+        print("Block I/O", records * record_size * repetitions, save_time, load_time);
+        boost::filesystem::remove(path);
+    }
+};
+}
+}
+
+#endif // CSLIBS_NDT_SERIALIZATION_BENCHMARK_HPP
@@ -0,0 +1,483 @@
+#ifndef CSLIBS_NDT_SERIALIZATION_BUFFERED_IO_HPP
+#define CSLIBS_NDT_SERIALIZATION_BUFFERED_IO_HPP
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <streambuf>
+#include <string>
+
+namespace cslibs_ndt {
+namespace serialization {
+namespace io {
+static constexpr std::size_t default_block_size = 4ul << 20;
+static constexpr std::size_t buffer_alignment   = 4096ul;
+
+inline char* allocate(const std::size_t size)
+{
+    void *buffer = nullptr;
+    return ::posix_memalign(&buffer, buffer_alignment, size) == 0 ? static_cast<char*>(buffer) : nullptr;
+}
+
+/**
+ * @brief pread until count bytes are read, the end of the file is reached or an error occurs.
+ */
+inline std::size_t pread_all(const int fd, char *data, const std::size_t count, const std::size_t offset)
+{
+    std::size_t done = 0;
+    while (done < count) {
+        const ssize_t r = ::pread(fd, data + done, count - done, static_cast<off_t>(offset + done));
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r <= 0)
+            break;
+        done += static_cast<std::size_t>(r);
+    }
+    return done;
+}
+
+inline bool pwrite_all(const int fd, const char *data, const std::size_t count, const std::size_t offset)
+{
+    std::size_t done = 0;
+    while (done < count) {
+        const ssize_t w = ::pwrite(fd, data + done, count - done, static_cast<off_t>(offset + done));
+        if (w < 0 && errno == EINTR)
+            continue;
+        if (w <= 0)
+            return false;
+        done += static_cast<std::size_t>(w);
+    }
+    return true;
+}
+}
+
+/**
+ * @brief Read-only stream buffer filling large aligned blocks with pread.
+ *        Restricted to the byte range [begin, begin + length) of a file, stream positions
+ *        are relative to begin. Large reads bypass the block buffer.
+ */
+class BufferedReader : public std::streambuf
+{
+public:
+    inline explicit BufferedReader(const std::string &path,
+                                   const std::size_t begin      = 0ul,
+                                   const std::size_t length     = std::numeric_limits<std::size_t>::max(),
+                                   const std::size_t block_size = io::default_block_size) :
+        fd_(::open(path.c_str(), O_RDONLY)),
+        block_size_(std::max<std::size_t>(io::buffer_alignment, block_size)),
+        buffer_(nullptr),
+        begin_(0ul),
+        end_(0ul),
+        block_offset_(0ul)
+    {
+        struct stat st;
+        if (fd_ < 0 || ::fstat(fd_, &st) != 0 || !(buffer_ = io::allocate(block_size_))) {
+            close();
+            return;
+        }
+
+        const std::size_t file_size = static_cast<std::size_t>(st.st_size);
+        begin_        = std::min(begin, file_size);
+        end_          = begin_ + std::min(length, file_size - begin_);
+        block_offset_ = begin_;
+        ::posix_fadvise(fd_, static_cast<off_t>(begin_), static_cast<off_t>(end_ - begin_), POSIX_FADV_SEQUENTIAL);
+        setg(buffer_, buffer_, buffer_);
+    }
+
+    inline virtual ~BufferedReader()
+    {
+        close();
+    }
+
+    BufferedReader(const BufferedReader &other) = delete;
+    BufferedReader& operator = (const BufferedReader &other) = delete;
+
+    inline bool is_open() const
+    {
+        return fd_ >= 0;
+    }
+
+    /**
+     * @brief Number of readable bytes.
+     */
+    inline std::size_t size() const
+    {
+        return end_ - begin_;
+    }
+
+protected:
+    inline virtual int_type underflow() override
+    {
+        if (gptr() < egptr())
+            return traits_type::to_int_type(*gptr());
+
+        block_offset_ = position();
+        const std::size_t n = is_open() && block_offset_ < end_ ?
+                    io::pread_all(fd_, buffer_, std::min(block_size_, end_ - block_offset_), block_offset_) : 0ul;
+        setg(buffer_, buffer_, buffer_ + n);
+        return n > 0ul ? traits_type::to_int_type(*gptr()) : traits_type::eof();
+    }
+
+    inline virtual std::streamsize xsgetn(char *s, std::streamsize count) override
+    {
+        std::size_t n = static_cast<std::size_t>(std::max<std::streamsize>(0, count));
+        std::size_t done = 0;
+
+        const std::size_t buffered = std::min(n, static_cast<std::size_t>(egptr() - gptr()));
+        std::memcpy(s, gptr(), buffered);
+        gbump(static_cast<int>(buffered));
+        done += buffered;
+        n    -= buffered;
+
+        if (n >= block_size_ && is_open()) {
+            /// bypass the buffer for large reads
+            const std::size_t p = position();
+            const std::size_t r = p < end_ ? io::pread_all(fd_, s + done, std::min(n, end_ - p), p) : 0ul;
+            block_offset_ = p + r;
+            setg(buffer_, buffer_, buffer_);
+            return static_cast<std::streamsize>(done + r);
+        }
+
+        while (n > 0ul && underflow() != traits_type::eof()) {
+            const std::size_t chunk = std::min(n, static_cast<std::size_t>(egptr() - gptr()));
+            std::memcpy(s + done, gptr(), chunk);
+            gbump(static_cast<int>(chunk));
+            done += chunk;
+            n    -= chunk;
+        }
+        return static_cast<std::streamsize>(done);
+    }
+
+    inline virtual std::streamsize showmanyc() override
+    {
+        return static_cast<std::streamsize>(end_ - position());
+    }
+
+    inline virtual pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode) override
+    {
+        const off_type base = dir == std::ios_base::beg ? 0 :
+                              dir == std::ios_base::cur ? static_cast<off_type>(position() - begin_) :
+                                                          static_cast<off_type>(end_ - begin_);
+        return seekpos(pos_type(base + off), std::ios_base::in);
+    }
+
+    inline virtual pos_type seekpos(pos_type pos, std::ios_base::openmode) override
+    {
+        const off_type p = static_cast<off_type>(pos);
+        if (p < 0 || static_cast<std::size_t>(p) > end_ - begin_)
+            return pos_type(off_type(-1));
+
+        const std::size_t target = begin_ + static_cast<std::size_t>(p);
+        const std::size_t filled = static_cast<std::size_t>(egptr() - eback());
+        if (target >= block_offset_ && target < block_offset_ + filled) {
+            setg(eback(), eback() + (target - block_offset_), egptr());
+        } else {
+            block_offset_ = target;
+            setg(buffer_, buffer_, buffer_);
+        }
+        return pos;
+    }
+
+private:
+    int          fd_;
+    std::size_t  block_size_;
+    char        *buffer_;
+    std::size_t  begin_;
+    std::size_t  end_;
+    std::size_t  block_offset_;     /// file offset of eback()
+
+    inline std::size_t position() const
+    {
+        return block_offset_ + static_cast<std::size_t>(gptr() - eback());
+    }
+
+    inline void close()
+    {
+        if (fd_ >= 0)
+            ::close(fd_);
+        fd_ = -1;
+        std::free(buffer_);
+        buffer_ = nullptr;
+        setg(nullptr, nullptr, nullptr);
+    }
+};
+
+/**
+ * @brief Write-only stream buffer collecting output in large aligned blocks written with pwrite.
+ *        Seeking flushes the block, so headers can be patched after the payload was written.
+ */
+class BufferedWriter : public std::streambuf
+{
+public:
+    inline explicit BufferedWriter(const std::string &path,
+                                   const std::size_t block_size = io::default_block_size) :
+        fd_(::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)),
+        block_size_(std::max<std::size_t>(io::buffer_alignment, block_size)),
+        buffer_(io::allocate(block_size_)),
+        block_offset_(0ul),
+        size_(0ul),
+        failed_(fd_ < 0 || !buffer_)
+    {
+        setp(buffer_, buffer_ ? buffer_ + block_size_ : nullptr);
+    }
+
+    inline virtual ~BufferedWriter()
+    {
+        close();
+    }
+
+    BufferedWriter(const BufferedWriter &other) = delete;
+    BufferedWriter& operator = (const BufferedWriter &other) = delete;
+
+    inline bool is_open() const
+    {
+        return fd_ >= 0;
+    }
+
+    /**
+     * @brief Flush and close the file.
+     * @return true, if all data was written
+     */
+    inline bool close()
+    {
+        if (fd_ >= 0) {
+            flush();
+            failed_ |= ::close(fd_) != 0;
+            fd_ = -1;
+        }
+        std::free(buffer_);
+        buffer_ = nullptr;
+        setp(nullptr, nullptr);
+        return !failed_;
+    }
+
+protected:
+    inline virtual int_type overflow(int_type c) override
+    {
+        if (!flush())
+            return traits_type::eof();
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    inline virtual std::streamsize xsputn(const char *s, std::streamsize count) override
+    {
+        std::size_t n = static_cast<std::size_t>(std::max<std::streamsize>(0, count));
+        if (n >= block_size_) {
+            /// bypass the buffer for large writes
+            if (!flush() || !io::pwrite_all(fd_, s, n, block_offset_)) {
+                failed_ = true;
+                return 0;
+            }
+            block_offset_ += n;
+            size_ = std::max(size_, block_offset_);
+            return count;
+        }
+
+        std::size_t done = 0;
+        while (n > 0ul) {
+            if (pptr() == epptr() && !flush())
+                return static_cast<std::streamsize>(done);
+            const std::size_t chunk = std::min(n, static_cast<std::size_t>(epptr() - pptr()));
+            std::memcpy(pptr(), s + done, chunk);
+            pbump(static_cast<int>(chunk));
+            done += chunk;
+            n    -= chunk;
+        }
+        return count;
+    }
+
+    inline virtual int sync() override
+    {
+        return flush() ? 0 : -1;
+    }
+
+    inline virtual pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode) override
+    {
+        const off_type base = dir == std::ios_base::beg ? 0 :
+                              dir == std::ios_base::cur ? static_cast<off_type>(position()) :
+                                                          static_cast<off_type>(std::max(size_, position()));
+        if (dir == std::ios_base::cur && off == 0)
+            return pos_type(base);
+        return seekpos(pos_type(base + off), std::ios_base::out);
+    }
+
+    inline virtual pos_type seekpos(pos_type pos, std::ios_base::openmode) override
+    {
+        const off_type p = static_cast<off_type>(pos);
+        if (p < 0 || !flush())
+            return pos_type(off_type(-1));
+        block_offset_ = static_cast<std::size_t>(p);
+        return pos;
+    }
+
+private:
+    int          fd_;
+    std::size_t  block_size_;
+    char        *buffer_;
+    std::size_t  block_offset_;     /// file offset of pbase()
+    std::size_t  size_;
+    bool         failed_;
+
+    inline std::size_t position() const
+    {
+        return block_offset_ + static_cast<std::size_t>(pptr() - pbase());
+    }
+
+    inline bool flush()
+    {
+        if (failed_ || fd_ < 0)
+            return false;
+
+        const std::size_t n = static_cast<std::size_t>(pptr() - pbase());
+        if (n > 0ul) {
+            if (!io::pwrite_all(fd_, pbase(), n, block_offset_)) {
+                failed_ = true;
+                return false;
+            }
+            block_offset_ += n;
+            size_ = std::max(size_, block_offset_);
+        }
+        setp(buffer_, buffer_ + block_size_);
+        return true;
+    }
+};
+
+/**
+ * @brief Read-only stream buffer over a block of memory, e.g. a decompressed section.
+ */
+class MemoryReader : public std::streambuf
+{
+public:
+    inline MemoryReader(const char *data, const std::size_t size)
+    {
+        char *begin = const_cast<char*>(data);
+        setg(begin, begin, begin + size);
+    }
+
+    /**
+     * @brief Number of bytes not read yet.
+     */
+    inline std::size_t remaining() const
+    {
+        return static_cast<std::size_t>(egptr() - gptr());
+    }
+};
+
+/**
+ * The record readers and writers of cslibs_math take file streams. The streams below are file
+ * streams which own one of the buffers above and read or write through it from construction on,
+ * their own file buffer stays unused.
+ */
+class BufferedOutputFile : public std::ofstream
+{
+public:
+    inline explicit BufferedOutputFile(const std::string &path,
+                                       const std::size_t block_size = io::default_block_size) :
+        writer_(path, block_size)
+    {
+        std::basic_ios<char>::rdbuf(&writer_);
+    }
+
+    inline bool is_open() const
+    {
+        return writer_.is_open();
+    }
+
+    /**
+     * @brief Flush and close the file.
+     * @return true, if all data was written
+     */
+    inline bool close()
+    {
+        flush();
+        const bool good = static_cast<bool>(*this);
+        return writer_.close() && good;
+    }
+
+private:
+    BufferedWriter writer_;
+};
+
+class BufferedInputFile : public std::ifstream
+{
+public:
+    inline explicit BufferedInputFile(const std::string &path,
+                                      const std::size_t begin      = 0ul,
+                                      const std::size_t length     = std::numeric_limits<std::size_t>::max(),
+                                      const std::size_t block_size = io::default_block_size) :
+        reader_(path, begin, length, block_size)
+    {
+        std::basic_ios<char>::rdbuf(&reader_);
+    }
+
+    inline bool is_open() const
+    {
+        return reader_.is_open();
+    }
+
+    /**
+     * @brief Number of readable bytes.
+     */
+    inline std::size_t size() const
+    {
+        return reader_.size();
+    }
+
+private:
+    BufferedReader reader_;
+};
+
+class MemoryInput : public std::ifstream
+{
+public:
+    inline MemoryInput(const char *data, const std::size_t size) :
+        reader_(data, size)
+    {
+        std::basic_ios<char>::rdbuf(&reader_);
+    }
+
+    /**
+     * @brief Number of bytes not read yet.
+     */
+    inline std::size_t remaining() const
+    {
+        return reader_.remaining();
+    }
+
+private:
+    MemoryReader reader_;
+};
+
+class MemoryOutput : public std::ofstream
+{
+public:
+    inline MemoryOutput()
+    {
+        std::basic_ios<char>::rdbuf(&buffer_);
+    }
+
+    inline std::string str() const
+    {
+        return buffer_.str();
+    }
+
+private:
+    std::stringbuf buffer_;
+};
+
+}
+}
+
+#endif // CSLIBS_NDT_SERIALIZATION_BUFFERED_IO_HPP
@@ -0,0 +1,337 @@
+#ifndef CSLIBS_NDT_SERIALIZATION_CODEC_HPP
+#define CSLIBS_NDT_SERIALIZATION_CODEC_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef CSLIBS_NDT_SERIALIZATION_USE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace cslibs_ndt {
+namespace serialization {
+namespace codec {
+/**
+ * @brief General purpose codecs applied on top of the index and record encodings.
+ *        lz is a built-in LZ77 byte codec in the spirit of LZ4, zstd is available if
+ *        CSLIBS_NDT_SERIALIZATION_USE_ZSTD is defined and libzstd is linked.
+ */
+enum class type : std::uint32_t { none = 0u, lz = 1u, zstd = 2u };
+
+inline bool available(const type t)
+{
+    switch (t) {
+    case type::none:
+    case type::lz:
+        return true;
+    case type::zstd:
+#ifdef CSLIBS_NDT_SERIALIZATION_USE_ZSTD
+        return true;
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+/**
+ * @return true, if the name is one of none, lz and zstd
+ */
+inline bool from_name(const std::string &name, type &t)
+{
+    if (name == "none")
+        t = type::none;
+    else if (name == "lz")
+        t = type::lz;
+    else if (name == "zstd")
+        t = type::zstd;
+    else
+        return false;
+    return true;
+}
+
+/// variable length integers
+inline void put_varint(std::string &out, std::uint64_t v)
+{
+    while (v >= 0x80u) {
+        out.push_back(static_cast<char>(v | 0x80u));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+inline bool get_varint(const char *&p, const char *end, std::uint64_t &v)
+{
+    v = 0u;
+    for (unsigned int shift = 0 ; p < end && shift < 64u ; shift += 7u) {
+        const std::uint8_t b = static_cast<std::uint8_t>(*p++);
+        v |= static_cast<std::uint64_t>(b & 0x7Fu) << shift;
+        if (!(b & 0x80u))
+            return true;
+    }
+    return false;
+}
+
+inline std::uint64_t zigzag(const std::int64_t v)
+{
+    return (static_cast<std::uint64_t>(v) << 1) ^ static_cast<std::uint64_t>(v >> 63);
+}
+
+inline std::int64_t unzigzag(const std::uint64_t v)
+{
+    return static_cast<std::int64_t>(v >> 1) ^ -static_cast<std::int64_t>(v & 1u);
+}
+
+/**
+ * @brief FNV-1a hash, used to detect torn or corrupted blocks.
+ */
+inline std::uint64_t checksum(const char *data, const std::size_t size,
+                              std::uint64_t hash = 14695981039346656037ull)
+{
+    for (std::size_t i = 0 ; i < size ; ++i) {
+        hash ^= static_cast<std::uint8_t>(data[i]);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+/**
+ * @brief Morton (z-order) code of non-negative coordinates, 64 / Dim bits per coordinate.
+ */
+template <std::size_t Dim>
+struct morton
+{
+    static constexpr std::size_t   bits = 64ul / Dim;
+    static constexpr std::uint64_t max  = bits >= 32ul ? 0xFFFFFFFFull : ((1ull << bits) - 1ull);
+
+    static inline std::uint64_t encode(const std::array<std::uint64_t, Dim> &c)
+    {
+        std::uint64_t code = 0u;
+        for (std::size_t b = 0 ; b < bits ; ++b)
+            for (std::size_t d = 0 ; d < Dim ; ++d)
+                code |= ((c[d] >> b) & 1ull) << (b * Dim + d);
+        return code;
+    }
+
+    static inline std::array<std::uint64_t, Dim> decode(const std::uint64_t code)
+    {
+        std::array<std::uint64_t, Dim> c;
+        c.fill(0u);
+        for (std::size_t b = 0 ; b < bits ; ++b)
+            for (std::size_t d = 0 ; d < Dim ; ++d)
+                c[d] |= ((code >> (b * Dim + d)) & 1ull) << b;
+        return c;
+    }
+};
+
+/**
+ * @brief Group the i-th bytes of all fixed-size records, so that similar bytes like exponents
+ *        and signs of floating point fields become contiguous.
+ */
+inline void shuffle(const char *in, const std::size_t count, const std::size_t size, char *out)
+{
+    for (std::size_t r = 0 ; r < count ; ++r)
+        for (std::size_t b = 0 ; b < size ; ++b)
+            out[b * count + r] = in[r * size + b];
+}
+
+inline void unshuffle(const char *in, const std::size_t count, const std::size_t size, char *out)
+{
+    for (std::size_t b = 0 ; b < size ; ++b)
+        for (std::size_t r = 0 ; r < count ; ++r)
+            out[r * size + b] = in[b * count + r];
+}
+
+namespace lz {
+static constexpr std::size_t   hash_bits  = 14ul;
+static constexpr std::size_t   min_match  = 4ul;
+static constexpr std::size_t   max_offset = 65535ul;
+static constexpr std::size_t   tail       = 12ul;    /// the last bytes are always literals
+
+inline std::uint32_t read32(const std::uint8_t *p)
+{
+    std::uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline void put_length(std::string &out, std::size_t length)
+{
+    while (length >= 255ul) {
+        out.push_back(static_cast<char>(255));
+        length -= 255ul;
+    }
+    out.push_back(static_cast<char>(length));
+}
+
+inline void put_sequence(std::string &out,
+                         const std::uint8_t *literals, const std::size_t literal_length,
+                         const std::size_t offset, const std::size_t match_length)
+{
+    const std::size_t ml = match_length >= min_match ? match_length - min_match : 0ul;
+    out.push_back(static_cast<char>((std::min<std::size_t>(literal_length, 15ul) << 4) | std::min<std::size_t>(ml, 15ul)));
+    if (literal_length >= 15ul)
+        put_length(out, literal_length - 15ul);
+    out.append(reinterpret_cast<const char*>(literals), literal_length);
+    if (match_length == 0ul)
+        return;
+    out.push_back(static_cast<char>(offset & 0xFFu));
+    out.push_back(static_cast<char>(offset >> 8));
+    if (ml >= 15ul)
+        put_length(out, ml - 15ul);
+}
+
+inline void compress(const char *data, const std::size_t size, std::string &out)
+{
+    const std::uint8_t *in     = reinterpret_cast<const std::uint8_t*>(data);
+    const std::uint8_t *end    = in + size;
+    const std::uint8_t *limit  = size > tail ? end - tail : in;
+    const std::uint8_t *anchor = in;
+    const std::uint8_t *ip     = in;
+
+    std::vector<std::uint32_t> table(1ul << hash_bits, 0u);   /// position + 1
+    while (ip < limit) {
+        const std::uint32_t sequence = read32(ip);
+        const std::size_t   h        = (sequence * 2654435761u) >> (32u - hash_bits);
+        const std::size_t   position = static_cast<std::size_t>(ip - in);
+        const std::size_t   candidate = table[h];
+        table[h] = static_cast<std::uint32_t>(position + 1ul);
+
+        if (candidate == 0ul || position + 1ul - candidate > max_offset || read32(in + candidate - 1ul) != sequence) {
+            ++ip;
+            continue;
+        }
+
+        const std::uint8_t *ref = in + candidate - 1ul;
+        const std::uint8_t *mp  = ip + min_match;
+        const std::uint8_t *rp  = ref + min_match;
+        while (mp < limit && *mp == *rp) {
+            ++mp;
+            ++rp;
+        }
+        put_sequence(out, anchor, static_cast<std::size_t>(ip - anchor),
+                     static_cast<std::size_t>(ip - ref), static_cast<std::size_t>(mp - ip));
+        ip = anchor = mp;
+    }
+    put_sequence(out, anchor, static_cast<std::size_t>(end - anchor), 0ul, 0ul);
+}
+
+inline bool get_length(const std::uint8_t *&ip, const std::uint8_t *end, std::size_t &length)
+{
+    std::uint8_t b;
+    do {
+        if (ip >= end)
+            return false;
+        b = *ip++;
+        length += b;
+    } while (b == 255u);
+    return true;
+}
+
+inline bool decompress(const char *data, const std::size_t size, char *output, const std::size_t raw_size)
+{
+    const std::uint8_t *ip  = reinterpret_cast<const std::uint8_t*>(data);
+    const std::uint8_t *end = ip + size;
+    std::uint8_t *out       = reinterpret_cast<std::uint8_t*>(output);
+    std::uint8_t *op        = out;
+    std::uint8_t *out_end   = out + raw_size;
+
+    while (ip < end) {
+        const std::uint8_t token = *ip++;
+        std::size_t literal_length = token >> 4;
+        if (literal_length == 15ul && !get_length(ip, end, literal_length))
+            return false;
+        if (literal_length > static_cast<std::size_t>(end - ip) || literal_length > static_cast<std::size_t>(out_end - op))
+            return false;
+        std::memcpy(op, ip, literal_length);
+        ip += literal_length;
+        op += literal_length;
+        if (ip == end)
+            break;
+
+        if (end - ip < 2)
+            return false;
+        const std::size_t offset = static_cast<std::size_t>(ip[0]) | (static_cast<std::size_t>(ip[1]) << 8);
+        ip += 2;
+        std::size_t match_length = token & 0x0Fu;
+        if (match_length == 15ul && !get_length(ip, end, match_length))
+            return false;
+        match_length += min_match;
+        if (offset == 0ul || offset > static_cast<std::size_t>(op - out) || match_length > static_cast<std::size_t>(out_end - op))
+            return false;
+
+        const std::uint8_t *ref = op - offset;
+        for (std::size_t i = 0 ; i < match_length ; ++i)
+            op[i] = ref[i];
+        op += match_length;
+    }
+    return op == out_end;
+}
+}
+
+/**
+ * @brief Compress a buffer.
+ * @return false, if the codec is not available
+ */
+inline bool compress(const type t, const std::string &raw, std::string &out)
+{
+    out.clear();
+    switch (t) {
+    case type::none:
+        out = raw;
+        return true;
+    case type::lz:
+        out.reserve(raw.size() / 2ul);
+        lz::compress(raw.data(), raw.size(), out);
+        return true;
+    case type::zstd:
+#ifdef CSLIBS_NDT_SERIALIZATION_USE_ZSTD
+    {
+        out.resize(ZSTD_compressBound(raw.size()));
+        const std::size_t n = ZSTD_compress(&out[0], out.size(), raw.data(), raw.size(), 3);
+        if (ZSTD_isError(n))
+            return false;
+        out.resize(n);
+        return true;
+    }
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+/**
+ * @brief Decompress a buffer of known raw size.
+ * @return false, if the data is corrupt or the codec is not available
+ */
+inline bool decompress(const type t, const char *data, const std::size_t size,
+                       const std::size_t raw_size, std::string &out)
+{
+    out.resize(raw_size);
+    switch (t) {
+    case type::none:
+        if (size != raw_size)
+            return false;
+        std::memcpy(&out[0], data, size);
+        return true;
+    case type::lz:
+        return lz::decompress(data, size, &out[0], raw_size);
+    case type::zstd:
+#ifdef CSLIBS_NDT_SERIALIZATION_USE_ZSTD
+        return ZSTD_decompress(&out[0], raw_size, data, size) == raw_size;
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+}
+}
+}
+
+#endif // CSLIBS_NDT_SERIALIZATION_CODEC_HPP
@@ -0,0 +1,634 @@
+#ifndef CSLIBS_NDT_SERIALIZATION_COMPRESSED_HPP
+#define CSLIBS_NDT_SERIALIZATION_COMPRESSED_HPP
+
+#include <cslibs_ndt/map/map.hpp>
+#include <cslibs_ndt/serialization/buffered_io.hpp>
+#include <cslibs_ndt/serialization/codec.hpp>
+#include <cslibs_ndt/serialization/loader.hpp>
+#include <cslibs_ndt/serialization/mapped_file.hpp>
+#include <cslibs_ndt/serialization/single_file.hpp>
+#include <cslibs_ndt/utility/parallel.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <sstream>
+
+namespace cslibs_ndt {
+namespace serialization {
+/**
+ * Compressed single file map format:
+ *
+ *  header
+ *  bundles     - bundle indices
+ *  stores      - one section per storage: indices followed by the records
+ *
+ * Index lists are sorted in Morton order and stored as the per-axis minimum followed by
+ * varint encoded code deltas. Records keep the layout of the store files, their bytes are
+ * shuffled by position when all records have the same size. Every section is compressed
+ * on its own with the codec given in the header, so the storages decompress in parallel.
+ *
+ * Optionally the records are quantized, which is lossy: the sample count, the mean relative
+ * to the center of its cell and the upper triangle of the covariance are stored as varints.
+ * With the precision p given in the header, every component of a mean is off by at most
+ * p * resolution / 2, every entry of a covariance by at most p * resolution^2 / 2.
+ */
+namespace compressed {
+static constexpr char          magic[8] = {'C','S','N','D','T','Z','I','P'};
+static constexpr std::uint32_t version  = 1u;
+
+enum class records : std::uint32_t { exact = 0u, quantized = 1u };
+
+struct section {
+    std::uint64_t offset;
+    std::uint64_t size;         /// compressed
+    std::uint64_t raw_size;
+    std::uint64_t count;
+    std::uint64_t record_size;  /// 0: variable record size, not shuffled
+};
+
+struct header {
+    char          magic[8];
+    std::uint32_t version;
+    std::uint32_t dimension;
+    std::uint32_t option;
+    std::uint32_t data_type;
+    std::uint32_t scalar_size;
+    std::uint32_t bin_count;
+    std::uint32_t codec;
+    std::uint32_t records;
+    double        origin[7];
+    double        resolution;
+    double        precision;    /// quantization step relative to the resolution
+    std::uint64_t size[3];
+    std::int32_t  min_index[3];
+    std::int32_t  max_index[3];
+    section       bundles;
+    section       stores[file::max_bin_count];
+};
+static_assert(std::is_standard_layout<header>::value, "compressed::header has to be standard layout.");
+
+/**
+ * @brief Sort indices in Morton order relative to their per-axis minimum.
+ * @param indices   indices
+ * @param min       per-axis minimum
+ * @param order     Morton code and position in indices, sorted
+ * @return false, if the index range exceeds the Morton code
+ */
+template <std::size_t Dim>
+inline bool morton_order(const std::vector<std::array<int,Dim>> &indices,
+                         std::array<int,Dim> &min,
+                         std::vector<std::pair<std::uint64_t, std::size_t>> &order)
+{
+    using morton_t = codec::morton<Dim>;
+
+    min.fill(0);
+    if (!indices.empty())
+        min = indices.front();
+    for (const auto &index : indices)
+        for (std::size_t d = 0 ; d < Dim ; ++d)
+            min[d] = std::min(min[d], index[d]);
+
+    order.resize(indices.size());
+    for (std::size_t j = 0 ; j < indices.size() ; ++j) {
+        std::array<std::uint64_t, Dim> c;
+        for (std::size_t d = 0 ; d < Dim ; ++d) {
+            c[d] = static_cast<std::uint64_t>(static_cast<std::int64_t>(indices[j][d]) - min[d]);
+            if (c[d] > morton_t::max)
+                return false;
+        }
+        order[j] = std::make_pair(morton_t::encode(c), j);
+    }
+    std::sort(order.begin(), order.end());
+    return true;
+}
+
+template <std::size_t Dim>
+inline void encode_indices(const std::array<int,Dim> &min,
+                           const std::vector<std::pair<std::uint64_t, std::size_t>> &order,
+                           std::string &out)
+{
+    for (std::size_t d = 0 ; d < Dim ; ++d)
+        codec::put_varint(out, codec::zigzag(min[d]));
+    std::uint64_t previous = 0u;
+    for (const auto &o : order) {
+        codec::put_varint(out, o.first - previous);
+        previous = o.first;
+    }
+}
+
+template <std::size_t Dim>
+inline bool decode_indices(const char *&p, const char *end,
+                           const std::size_t count,
+                           std::vector<std::array<int,Dim>> &indices)
+{
+    std::array<int,Dim> min;
+    for (std::size_t d = 0 ; d < Dim ; ++d) {
+        std::uint64_t v;
+        if (!codec::get_varint(p, end, v))
+            return false;
+        min[d] = static_cast<int>(codec::unzigzag(v));
+    }
+
+    indices.resize(count);
+    std::uint64_t code = 0u;
+    for (auto &index : indices) {
+        std::uint64_t delta;
+        if (!codec::get_varint(p, end, delta))
+            return false;
+        code += delta;
+        const std::array<std::uint64_t, Dim> c = codec::morton<Dim>::decode(code);
+        for (std::size_t d = 0 ; d < Dim ; ++d)
+            index[d] = static_cast<int>(static_cast<std::int64_t>(c[d]) + min[d]);
+    }
+    return true;
+}
+
+/**
+ * @brief Quantization steps of quantized records.
+ */
+struct quantization {
+    inline quantization(const double precision,
+                        const double resolution) :
+        mean_step(precision * resolution),
+        covariance_step(precision * resolution * resolution)
+    {
+    }
+
+    double mean_step;
+    double covariance_step;
+};
+
+inline void put_quantized(std::string &out, const double v, const double step)
+{
+    codec::put_varint(out, codec::zigzag(static_cast<std::int64_t>(std::llround(v / step))));
+}
+
+inline bool get_quantized(const char *&p, const char *end, const double step, double &v)
+{
+    std::uint64_t e;
+    if (!codec::get_varint(p, end, e))
+        return false;
+    v = static_cast<double>(codec::unzigzag(e)) * step;
+    return true;
+}
+
+/**
+ * @brief Quantized sufficient statistics: sample count, mean relative to the cell center and
+ *        the upper triangle of the covariance, the scatter matrix is restored from both.
+ */
+template <typename T, std::size_t Dim>
+struct gaussian {
+    using gaussian_t = cslibs_math::statistics::StableDistribution<T,Dim,3>;
+    using vector_t   = Eigen::Matrix<T,Dim,1>;
+    using matrix_t   = Eigen::Matrix<T,Dim,Dim>;
+
+    static inline void encode(const gaussian_t &g,
+                              const vector_t &center,
+                              const quantization &q,
+                              std::string &out)
+    {
+        const std::size_t n = g.getN();
+        codec::put_varint(out, n);
+        if (n == 0ul)
+            return;
+
+        const vector_t mean = g.getMean();
+        for (std::size_t i = 0 ; i < Dim ; ++i)
+            put_quantized(out, static_cast<double>(mean(i) - center(i)), q.mean_step);
+        if (n == 1ul)
+            return;
+
+        const matrix_t covariance = g.getScatter() / static_cast<T>(n - 1ul);
+        for (std::size_t i = 0 ; i < Dim ; ++i)
+            for (std::size_t j = i ; j < Dim ; ++j)
+                put_quantized(out, static_cast<double>(covariance(i, j)), q.covariance_step);
+    }
+
+    static inline bool decode(const char *&p, const char *end,
+                              const vector_t &center,
+                              const quantization &q,
+                              gaussian_t &g)
+    {
+        std::uint64_t n;
+        if (!codec::get_varint(p, end, n))
+            return false;
+        if (n == 0u) {
+            g = gaussian_t();
+            return true;
+        }
+
+        vector_t mean;
+        for (std::size_t i = 0 ; i < Dim ; ++i) {
+            double v;
+            if (!get_quantized(p, end, q.mean_step, v))
+                return false;
+            mean(i) = center(i) + static_cast<T>(v);
+        }
+
+        matrix_t scatter = matrix_t::Zero();
+        if (n > 1u) {
+            for (std::size_t i = 0 ; i < Dim ; ++i) {
+                for (std::size_t j = i ; j < Dim ; ++j) {
+                    double v;
+                    if (!get_quantized(p, end, q.covariance_step, v))
+                        return false;
+                    scatter(i, j) = scatter(j, i) = static_cast<T>(v * static_cast<double>(n - 1u));
+                }
+            }
+        }
+        g = gaussian_t(static_cast<std::size_t>(n), mean, scatter);
+        return true;
+    }
+};
+
+/**
+ * @brief Quantized records per distribution type, weighted occupancy is not supported.
+ */
+template <template <typename,std::size_t> class data_t, typename T, std::size_t Dim>
+struct quantized {
+    static constexpr bool supported = false;
+
+    static inline void encode(const data_t<T,Dim> &, const Eigen::Matrix<T,Dim,1> &, const quantization &, std::string &)
+    {
+    }
+
+    static inline bool decode(const char *&, const char *, const Eigen::Matrix<T,Dim,1> &, const quantization &, data_t<T,Dim> &)
+    {
+        return false;
+    }
+};
+
+template <typename T, std::size_t Dim>
+struct quantized<Distribution,T,Dim> {
+    static constexpr bool supported = true;
+    using gaussian_t = typename gaussian<T,Dim>::gaussian_t;
+
+    static inline void encode(const Distribution<T,Dim> &d, const Eigen::Matrix<T,Dim,1> &center, const quantization &q, std::string &out)
+    {
+        gaussian<T,Dim>::encode(d, center, q, out);
+    }
+
+    static inline bool decode(const char *&p, const char *end, const Eigen::Matrix<T,Dim,1> &center, const quantization &q, Distribution<T,Dim> &d)
+    {
+        return gaussian<T,Dim>::decode(p, end, center, q, static_cast<gaussian_t&>(d));
+    }
+};
+
+template <typename T, std::size_t Dim>
+struct quantized<OccupancyDistribution,T,Dim> {
+    static constexpr bool supported = true;
+    using gaussian_t = typename gaussian<T,Dim>::gaussian_t;
+
+    static inline void encode(const OccupancyDistribution<T,Dim> &d, const Eigen::Matrix<T,Dim,1> &center, const quantization &q, std::string &out)
+    {
+        codec::put_varint(out, d.numFree());
+        gaussian<T,Dim>::encode(d.getDistribution() ? *(d.getDistribution()) : gaussian_t(), center, q, out);
+    }
+
+    static inline bool decode(const char *&p, const char *end, const Eigen::Matrix<T,Dim,1> &center, const quantization &q, OccupancyDistribution<T,Dim> &d)
+    {
+        std::uint64_t num_free;
+        gaussian_t g;
+        if (!codec::get_varint(p, end, num_free) || !gaussian<T,Dim>::decode(p, end, center, q, g))
+            return false;
+        d = g.getN() > 0ul ? OccupancyDistribution<T,Dim>(static_cast<std::size_t>(num_free), g) :
+                             OccupancyDistribution<T,Dim>(static_cast<std::size_t>(num_free));
+        return true;
+    }
+};
+
+inline bool check(const header &h,
+                  const std::size_t dimension,
+                  const map::tags::option option,
+                  const file::data_type type,
+                  const std::size_t scalar_size)
+{
+    if (std::memcmp(h.magic, magic, sizeof(magic)) != 0) {
+        std::cerr << "Not a compressed map file." << std::endl;
+        return false;
+    }
+    if (h.version != version) {
+        std::cerr << "Unsupported compressed map file version " << h.version << ", expected " << version << "." << std::endl;
+        return false;
+    }
+    if (h.dimension != dimension || h.option != static_cast<std::uint32_t>(option) ||
+            h.data_type != static_cast<std::uint32_t>(type) || h.scalar_size != scalar_size ||
+            h.bin_count != utility::two_pow(dimension)) {
+        std::cerr << "Compressed map file does not match the requested map type." << std::endl;
+        return false;
+    }
+    if (!codec::available(static_cast<codec::type>(h.codec))) {
+        std::cerr << "Codec " << h.codec << " of the compressed map file is not available." << std::endl;
+        return false;
+    }
+    if (h.records != static_cast<std::uint32_t>(records::exact) &&
+            !(h.records == static_cast<std::uint32_t>(records::quantized) && h.precision > 0.0)) {
+        std::cerr << "Unsupported record encoding " << h.records << " of the compressed map file." << std::endl;
+        return false;
+    }
+    return true;
+}
+}
+
+template <map::tags::option option_t,
+          std::size_t Dim,
+          template <typename,std::size_t> class data_t,
+          typename T,
+          template <typename, typename, typename...> class backend_t = map::tags::default_types<option_t>::template default_backend_t>
+struct compressed_file
+{
+    using map_t            = cslibs_ndt::map::Map<option_t,Dim,data_t,T,backend_t>;
+    using index_t          = typename map_t::index_t;
+    using pose_t           = typename map_t::pose_t;
+    using distribution_t   = typename map_t::distribution_t;
+    using storage_ptr_t    = typename map_t::distribution_storage_ptr_t;
+    using storages_t       = typename map_t::distribution_storage_array_t;
+    using bundle_storage_t = typename map_t::distribution_bundle_storage_t;
+    using loader_t         = loader<option_t,Dim,data_t,T,backend_t>;
+    using order_t          = std::vector<std::pair<std::uint64_t, std::size_t>>;
+
+    static_assert(map_t::bin_count <= file::max_bin_count, "Too many storages for the file format.");
+
+    /**
+     * @brief Save a map compressed.
+     * @param map       map to save
+     * @param path      file path
+     * @param c         codec applied to every section
+     * @param precision quantization step of the records relative to the resolution, lossy,
+     *                  0: records are stored exactly
+     */
+    static inline bool save(const map_t &map,
+                            const std::string &path,
+                            const codec::type c = codec::type::lz,
+                            const double precision = 0.0)
+    {
+        if (!codec::available(c)) {
+            std::cerr << "Codec " << static_cast<std::uint32_t>(c) << " is not available." << std::endl;
+            return false;
+        }
+        if (precision > 0.0 && !compressed::quantized<data_t,T,Dim>::supported) {
+            std::cerr << "Quantized records are not supported for this distribution type." << std::endl;
+            return false;
+        }
+
+        compressed::header h;
+        std::memset(&h, 0, sizeof(h));
+        std::memcpy(h.magic, compressed::magic, sizeof(compressed::magic));
+        h.version     = compressed::version;
+        h.dimension   = static_cast<std::uint32_t>(Dim);
+        h.option      = static_cast<std::uint32_t>(option_t);
+        h.data_type   = static_cast<std::uint32_t>(file::data_type_id<data_t>::value);
+        h.scalar_size = static_cast<std::uint32_t>(sizeof(T));
+        h.bin_count   = static_cast<std::uint32_t>(map_t::bin_count);
+        h.codec       = static_cast<std::uint32_t>(c);
+        h.records     = static_cast<std::uint32_t>(precision > 0.0 ? compressed::records::quantized : compressed::records::exact);
+        h.resolution  = static_cast<double>(map.getResolution());
+        h.precision   = precision > 0.0 ? precision : 0.0;
+        file::encode(map.getInitialOrigin(), h.origin);
+        for (std::size_t i = 0 ; i < Dim ; ++i) {
+            h.size[i]      = static_cast<std::uint64_t>(map.getSize()[i]);
+            h.min_index[i] = map.getMinBundleIndex()[i];
+            h.max_index[i] = map.getMaxBundleIndex()[i];
+        }
+
+        /// encode and compress the bundle indices and all storages in parallel
+        std::array<std::string, map_t::bin_count + 1ul> blocks;
+        std::array<compressed::section*, map_t::bin_count + 1ul> sections;
+        sections[0] = &h.bundles;
+        for (std::size_t i = 0 ; i < map_t::bin_count ; ++i)
+            sections[i + 1ul] = &h.stores[i];
+
+        const storages_t &storages = map.getStorages();
+        std::atomic_bool success(true);
+        utility::parallel_for(0ul, map_t::bin_count + 1ul, [&](const std::size_t k) {
+            std::string raw;
+            const bool encoded = k == 0ul ? encodeBundles(map, raw, *sections[k]) :
+                                            encodeStorage(storages[k - 1ul], k - 1ul, h, raw, *sections[k]);
+            if (!encoded || !codec::compress(c, raw, blocks[k]))
+                success = false;
+            sections[k]->raw_size = raw.size();
+            sections[k]->size     = blocks[k].size();
+        }, map_t::bin_count + 1ul);
+        if (!success) {
+            std::cerr << "Could not encode the map, the bundle index range is too large." << std::endl;
+            return false;
+        }
+
+        std::uint64_t offset = sizeof(h);
+        for (compressed::section *s : sections) {
+            s->offset = offset;
+            offset   += s->size;
+        }
+
+        BufferedOutputFile out(path);
+        if (!out.is_open()) {
+            std::cerr << "Could not open '" << path << "'" << std::endl;
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        for (const std::string &block : blocks)
+            out.write(block.data(), static_cast<std::streamsize>(block.size()));
+        return out.close();
+    }
+
+    static inline bool load(const std::string &path,
+                            typename map_t::Ptr &map)
+    {
+        const MappedFile::Ptr mapped = MappedFile::open(path, true);
+        if (!mapped)
+            return false;
+
+        const compressed::header *h = mapped->as<compressed::header>(0ul);
+        if (!h || !compressed::check(*h, Dim, option_t, file::data_type_id<data_t>::value, sizeof(T)))
+            return false;
+        const codec::type c = static_cast<codec::type>(h->codec);
+
+        std::string raw;
+        std::vector<index_t> indices;
+        if (!decompress(*mapped, c, h->bundles, raw)) {
+            std::cerr << "Map file '" << path << "' is corrupt." << std::endl;
+            return false;
+        }
+        const char *p = raw.data();
+        if (!compressed::decode_indices<Dim>(p, raw.data() + raw.size(), h->bundles.count, indices)) {
+            std::cerr << "Map file '" << path << "' is corrupt." << std::endl;
+            return false;
+        }
+
+        pose_t origin;
+        file::decode(h->origin, origin);
+        typename map_t::size_t size;
+        index_t min_index, max_index;
+        for (std::size_t j = 0 ; j < Dim ; ++j) {
+            size[j]      = static_cast<std::size_t>(h->size[j]);
+            min_index[j] = h->min_index[j];
+            max_index[j] = h->max_index[j];
+        }
+        const std::unique_ptr<loader_t> l(loader_t::create(origin, static_cast<T>(h->resolution), size, min_index, max_index, indices));
+
+        /// every storage is decompressed and decoded by its own thread
+        storages_t storages;
+        std::atomic_bool success(true);
+        utility::parallel_for(0ul, map_t::bin_count, [&](const std::size_t i) {
+            l->allocateStorage(i, storages[i]);
+            if (!decodeStorage(*mapped, c, i, *h, storages[i]))
+                success = false;
+        }, map_t::bin_count);
+        if (!success) {
+            std::cerr << "Map file '" << path << "' is corrupt." << std::endl;
+            return false;
+        }
+
+        std::shared_ptr<bundle_storage_t> bundles(new bundle_storage_t);
+        l->allocateBundles(bundles, storages);
+        l->createMap(bundles, storages, map);
+        return true;
+    }
+
+private:
+    static inline bool encodeBundles(const map_t &map,
+                                     std::string &raw,
+                                     compressed::section &s)
+    {
+        std::vector<index_t> indices;
+        map.getBundleIndices(indices);
+
+        index_t min;
+        order_t order;
+        if (!compressed::morton_order<Dim>(indices, min, order))
+            return false;
+        compressed::encode_indices<Dim>(min, order, raw);
+        s.count = indices.size();
+        return true;
+    }
+
+    /// storage cells are shifted by half a cell along the axes of the unset bits of the storage
+    static inline Eigen::Matrix<T,Dim,1> center(const std::size_t storage,
+                                                const index_t &index,
+                                                const double resolution)
+    {
+        Eigen::Matrix<T,Dim,1> c;
+        for (std::size_t d = 0 ; d < Dim ; ++d)
+            c(d) = static_cast<T>((static_cast<double>(index[d]) + (((storage >> d) & 1ul) ? 0.0 : 0.5)) * resolution);
+        return c;
+    }
+
+    static inline bool encodeStorage(const storage_ptr_t &storage,
+                                     const std::size_t i,
+                                     const compressed::header &h,
+                                     std::string &raw,
+                                     compressed::section &s)
+    {
+        std::vector<index_t> indices;
+        std::vector<const distribution_t*> data;
+        storage->traverse([&indices, &data](const index_t &index, const distribution_t &d) {
+            indices.emplace_back(index);
+            data.emplace_back(&d);
+        });
+
+        index_t min;
+        order_t order;
+        if (!compressed::morton_order<Dim>(indices, min, order))
+            return false;
+        compressed::encode_indices<Dim>(min, order, raw);
+        s.count = indices.size();
+
+        if (h.records == static_cast<std::uint32_t>(compressed::records::quantized)) {
+            const compressed::quantization q(h.precision, h.resolution);
+            for (const auto &o : order)
+                compressed::quantized<data_t,T,Dim>::encode(*data[o.second], center(i, indices[o.second], h.resolution), q, raw);
+            s.record_size = 0ul;
+            return true;
+        }
+
+        /// records in the layout of the store files
+        MemoryOutput out;
+        std::size_t record_size = 0ul;
+        bool fixed_size = true;
+        for (const auto &o : order) {
+            const std::streamoff before = out.tellp();
+            cslibs_ndt::write(*data[o.second], out);
+            const std::size_t size = static_cast<std::size_t>(out.tellp() - before);
+            fixed_size  &= record_size == 0ul || size == record_size;
+            record_size  = size;
+        }
+        const std::string records = out.str();
+
+        s.record_size = fixed_size ? record_size : 0ul;
+        if (s.record_size > 0ul) {
+            const std::size_t offset = raw.size();
+            raw.resize(offset + records.size());
+            codec::shuffle(records.data(), order.size(), record_size, &raw[offset]);
+        } else {
+            raw += records;
+        }
+        return static_cast<bool>(out);
+    }
+
+    static inline bool decompress(const MappedFile &mapped,
+                                  const codec::type c,
+                                  const compressed::section &s,
+                                  std::string &raw)
+    {
+        const char *data = mapped.as<char>(s.offset, s.size);
+        return (data || s.size == 0ul) && codec::decompress(c, data, s.size, s.raw_size, raw);
+    }
+
+    static inline bool decodeStorage(const MappedFile &mapped,
+                                     const codec::type c,
+                                     const std::size_t i,
+                                     const compressed::header &h,
+                                     storage_ptr_t &storage)
+    {
+        const compressed::section &s = h.stores[i];
+        std::string raw;
+        std::vector<index_t> indices;
+        if (!decompress(mapped, c, s, raw))
+            return false;
+        const char *p   = raw.data();
+        const char *end = raw.data() + raw.size();
+        if (!compressed::decode_indices<Dim>(p, end, s.count, indices))
+            return false;
+
+        if (h.records == static_cast<std::uint32_t>(compressed::records::quantized)) {
+            const compressed::quantization q(h.precision, h.resolution);
+            for (const index_t &index : indices) {
+                distribution_t d;
+                if (!compressed::quantized<data_t,T,Dim>::decode(p, end, center(i, index, h.resolution), q, d))
+                    return false;
+                storage->insert(index, d);
+            }
+            return p == end;
+        }
+
+        std::string records;
+        if (s.record_size > 0ul) {
+            if (static_cast<std::size_t>(end - p) != s.count * s.record_size)
+                return false;
+            records.resize(static_cast<std::size_t>(end - p));
+            codec::unshuffle(p, s.count, s.record_size, &records[0]);
+        } else {
+            records.assign(p, end);
+        }
+
+        MemoryInput in(records.data(), records.size());
+        try {
+            for (const index_t &index : indices) {
+                distribution_t d;
+                cslibs_ndt::read(in, d);
+                if (!in)
+                    return false;
+                storage->insert(index, d);
+            }
+        } catch (const std::exception &e) {
+            std::cerr << "Failed decoding storage '" << e.what() << std::endl;
+            return false;
+        }
+        return in.remaining() == 0ul;
+    }
+};
+
+}
+}
+
+#endif // CSLIBS_NDT_SERIALIZATION_COMPRESSED_HPP
@@ -0,0 +1,427 @@
+#ifndef CSLIBS_NDT_SERIALIZATION_CONVERTER_HPP
+#define CSLIBS_NDT_SERIALIZATION_CONVERTER_HPP
+
+#include <cslibs_ndt/conversion/map.hpp>
+#include <cslibs_ndt/conversion/resample.hpp>
+#include <cslibs_ndt/serialization/compressed.hpp>
+#include <cslibs_ndt/serialization/map.hpp>
+#include <cslibs_ndt/serialization/single_file.hpp>
+#include <cslibs_ndt/serialization/tiled_map.hpp>
+
+#include <boost/filesystem.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace cslibs_ndt {
+namespace serialization {
+namespace format {
+/**
+ * @brief On-disk map formats: the directory of saveBinary, the single file of saveFile,
+ *        the compressed file of saveCompressed and the tile directory of saveTiled, which
+ *        only holds dynamic maps.
+ */
+enum class type { directory, file, compressed, tiled, unknown };
+
+/**
+ * @brief Format specific settings for writing maps.
+ */
+struct options {
+    codec::type codec     = codec::type::lz;    /// codec of compressed maps
+    double      precision = 0.0;                /// quantization of compressed records, 0 for lossless
+    std::size_t tile_size = 32ul;               /// bundles per tile edge of tiled maps
+};
+
+inline type from_name(const std::string &name)
+{
+    if (name == "directory")
+        return type::directory;
+    if (name == "file")
+        return type::file;
+    if (name == "compressed")
+        return type::compressed;
+    if (name == "tiled")
+        return type::tiled;
+    return type::unknown;
+}
+
+inline std::string to_name(const type t)
+{
+    switch (t) {
+    case type::directory:  return "directory";
+    case type::file:       return "file";
+    case type::compressed: return "compressed";
+    case type::tiled:      return "tiled";
+    default:               return "unknown";
+    }
+}
+
+/**
+ * @brief Format of an existing map, identified by the file magic.
+ */
+inline type detect(const std::string &path)
+{
+    if (boost::filesystem::is_directory(path))
+        return boost::filesystem::exists(boost::filesystem::path(path) / "tiles.bin") ? type::tiled : type::directory;
+
+    char m[8] = {};
+    std::ifstream in(path, std::ios::binary);
+    if (!in.read(m, sizeof(m)))
+        return type::unknown;
+    if (std::memcmp(m, file::magic, sizeof(m)) == 0)
+        return type::file;
+    if (std::memcmp(m, compressed::magic, sizeof(m)) == 0)
+        return type::compressed;
+    return type::unknown;
+}
+
+/**
+ * @brief Format of a map to be written, chosen by the extension: .ndtz is compressed,
+ *        .bin is a single file, anything else a directory.
+ */
+inline type from_extension(const std::string &path)
+{
+    const std::string extension = boost::filesystem::path(path).extension().string();
+    if (extension == ".ndtz")
+        return type::compressed;
+    if (extension == ".bin")
+        return type::file;
+    return type::directory;
+}
+
+/**
+ * @brief Size of a map on disk in bytes.
+ */
+inline std::size_t byte_size(const std::string &path)
+{
+    boost::system::error_code ec;
+    if (!boost::filesystem::is_directory(path, ec)) {
+        const std::uintmax_t size = boost::filesystem::file_size(path, ec);
+        return ec ? 0ul : static_cast<std::size_t>(size);
+    }
+
+    std::size_t size = 0ul;
+    for (boost::filesystem::recursive_directory_iterator it(path, ec), end ; !ec && it != end ; it.increment(ec)) {
+        if (boost::filesystem::is_regular_file(it->path(), ec))
+            size += static_cast<std::size_t>(boost::filesystem::file_size(it->path(), ec));
+    }
+    return size;
+}
+}
+
+/**
+ * @brief Tiled maps are dynamic, other layouts are rejected.
+ */
+template <map::tags::option option_t,
+          std::size_t Dim,
+          template <typename,std::size_t> class data_t,
+          typename T,
+          template <typename, typename, typename...> class backend_t>
+struct tiled_format
+{
+    using map_t = cslibs_ndt::map::Map<option_t,Dim,data_t,T,backend_t>;
+
+    static inline bool load(const std::string &path,
+                            typename map_t::Ptr &)
+    {
+        std::cerr << "Tiled map '" << path << "' can only be loaded as a dynamic map." << std::endl;
+        return false;
+    }
+
+    static inline bool save(const map_t &,
+                            const std::string &path,
+                            const std::size_t)
+    {
+        std::cerr << "Tiled map '" << path << "' can only be saved from a dynamic map." << std::endl;
+        return false;
+    }
+};
+
+template <std::size_t Dim,
+          template <typename,std::size_t> class data_t,
+          typename T,
+          template <typename, typename, typename...> class backend_t>
+struct tiled_format<map::tags::dynamic_map,Dim,data_t,T,backend_t>
+{
+    using map_t = cslibs_ndt::map::Map<map::tags::dynamic_map,Dim,data_t,T,backend_t>;
+
+    static inline bool load(const std::string &path,
+                            typename map_t::Ptr &map)
+    {
+        return tiled<Dim,data_t,T,backend_t>::load(path, map);
+    }
+
+    static inline bool save(const map_t &map,
+                            const std::string &path,
+                            const std::size_t tile_size)
+    {
+        return tiled<Dim,data_t,T,backend_t>::save(map, path, tile_size);
+    }
+};
+
+/**
+ * @brief Load and save a map in any of the on-disk formats.
+ */
+template <map::tags::option option_t,
+          std::size_t Dim,
+          template <typename,std::size_t> class data_t,
+          typename T,
+          template <typename, typename, typename...> class backend_t = map::tags::default_types<option_t>::template default_backend_t>
+struct any_format
+{
+    using map_t = cslibs_ndt::map::Map<option_t,Dim,data_t,T,backend_t>;
+
+    static inline bool load(const std::string &path,
+                            const format::type f,
+                            typename map_t::Ptr &map)
+    {
+        switch (f) {
+        case format::type::directory:  return binary<option_t,Dim,data_t,T,backend_t>::load(path, map);
+        case format::type::file:       return single_file<option_t,Dim,data_t,T,backend_t>::load(path, map);
+        case format::type::compressed: return compressed_file<option_t,Dim,data_t,T,backend_t>::load(path, map);
+        case format::type::tiled:      return tiled_format<option_t,Dim,data_t,T,backend_t>::load(path, map);
+        default:
+            std::cerr << "Unknown format of map '" << path << "'." << std::endl;
+            return false;
+        }
+    }
+
+    static inline bool save(const map_t &map,
+                            const std::string &path,
+                            const format::type f,
+                            const format::options &o = format::options())
+    {
+        switch (f) {
+        case format::type::directory:  return binary<option_t,Dim,data_t,T,backend_t>::save(map, path);
+        case format::type::file:       return single_file<option_t,Dim,data_t,T,backend_t>::save(map, path);
+        case format::type::compressed: return compressed_file<option_t,Dim,data_t,T,backend_t>::save(map, path, o.codec, o.precision);
+        case format::type::tiled:      return tiled_format<option_t,Dim,data_t,T,backend_t>::save(map, path, o.tile_size);
+        default:
+            std::cerr << "Unknown format for map '" << path << "'." << std::endl;
+            return false;
+        }
+    }
+};
+
+namespace io {
+/**
+ * @brief Bounded queue handing maps from one pipeline stage to the next.
+ */
+template <typename value_t>
+class Channel
+{
+public:
+    inline explicit Channel(const std::size_t capacity) :
+        capacity_(std::max<std::size_t>(1ul, capacity)),
+        closed_(false)
+    {
+    }
+
+    inline void push(value_t &&value)
+    {
+        std::unique_lock<std::mutex> l(mutex_);
+        not_full_.wait(l, [this]() { return values_.size() < capacity_; });
+        values_.emplace_back(std::move(value));
+        not_empty_.notify_one();
+    }
+
+    /**
+     * @return false, if the channel is closed and empty
+     */
+    inline bool pop(value_t &value)
+    {
+        std::unique_lock<std::mutex> l(mutex_);
+        not_empty_.wait(l, [this]() { return closed_ || !values_.empty(); });
+        if (values_.empty())
+            return false;
+        value = std::move(values_.front());
+        values_.pop_front();
+        not_full_.notify_one();
+        return true;
+    }
+
+    inline void close()
+    {
+        std::unique_lock<std::mutex> l(mutex_);
+        closed_ = true;
+        not_empty_.notify_all();
+    }
+
+private:
+    const std::size_t        capacity_;
+    bool                     closed_;
+    std::deque<value_t>      values_;
+    std::mutex               mutex_;
+    std::condition_variable  not_empty_;
+    std::condition_variable  not_full_;
+};
+}
+
+/**
+ * @brief Converts maps between formats, static and dynamic layouts and resolutions.
+ *        Loading, converting and saving run on their own threads, so for a batch of maps
+ *        the stages overlap, and loading and saving are parallel per storage in addition.
+ */
+template <map::tags::option option_from_t,
+          map::tags::option option_to_t,
+          std::size_t Dim,
+          template <typename,std::size_t> class data_t,
+          typename T>
+class Converter
+{
+public:
+    using src_map_t = cslibs_ndt::map::Map<option_from_t,Dim,data_t,T>;
+    using dst_map_t = cslibs_ndt::map::Map<option_to_t,Dim,data_t,T>;
+    using dyn_map_t = cslibs_ndt::map::Map<map::tags::dynamic_map,Dim,data_t,T>;
+
+    struct job {
+        std::string     input;
+        std::string     output;
+        format::type    output_format;
+    };
+
+    struct report {
+        job             task;
+        bool            success       = false;
+        std::size_t     input_bytes   = 0ul;
+        std::size_t     output_bytes  = 0ul;
+        std::size_t     bundles       = 0ul;
+        double          load_time     = 0.0;
+        double          convert_time  = 0.0;
+        double          save_time     = 0.0;
+    };
+
+    using callback_t = std::function<void(const report&)>;
+
+    /**
+     * @param resolution    resolution of the converted maps, 0 to keep it
+     * @param options       settings of the output formats
+     */
+    inline explicit Converter(const T resolution = T(),
+                              const format::options &options = format::options()) :
+        resolution_(resolution),
+        options_(options)
+    {
+    }
+
+    /**
+     * @brief Convert all jobs.
+     * @param jobs      input and output paths
+     * @param callback  called with the report of each job, in order
+     * @return true, if all jobs succeeded
+     */
+    inline bool run(const std::vector<job> &jobs,
+                    const callback_t &callback) const
+    {
+        io::Channel<std::pair<report, typename src_map_t::Ptr>> loaded(1ul);
+        io::Channel<std::pair<report, typename dst_map_t::Ptr>> converted(1ul);
+
+        std::thread loader([&jobs, &loaded]() {
+            for (const job &j : jobs) {
+                report r;
+                r.task        = j;
+                r.input_bytes = format::byte_size(j.input);
+
+                typename src_map_t::Ptr map;
+                const steady_clock_t::time_point start = steady_clock_t::now();
+                r.success   = any_format<option_from_t,Dim,data_t,T>::load(j.input, format::detect(j.input), map);
+                r.load_time = seconds(start);
+                loaded.push(std::make_pair(r, map));
+            }
+            loaded.close();
+        });
+
+        std::thread converter([this, &loaded, &converted]() {
+            std::pair<report, typename src_map_t::Ptr> in;
+            while (loaded.pop(in)) {
+                report &r = in.first;
+                typename dst_map_t::Ptr map;
+                if (r.success) {
+                    const steady_clock_t::time_point start = steady_clock_t::now();
+                    map = convert(in.second);
+                    in.second.reset();
+                    r.convert_time = seconds(start);
+                    r.success      = map != nullptr;
+                    r.bundles      = map ? bundleCount(*map) : 0ul;
+                }
+                converted.push(std::make_pair(r, map));
+            }
+            converted.close();
+        });
+
+        bool success = true;
+        std::pair<report, typename dst_map_t::Ptr> out;
+        while (converted.pop(out)) {
+            report &r = out.first;
+            if (r.success) {
+                const steady_clock_t::time_point start = steady_clock_t::now();
+                r.success      = any_format<option_to_t,Dim,data_t,T>::save(*out.second, r.task.output, r.task.output_format, options_);
+                r.save_time    = seconds(start);
+                r.output_bytes = format::byte_size(r.task.output);
+            }
+            out.second.reset();
+            success &= r.success;
+            if (callback)
+                callback(r);
+        }
+
+        loader.join();
+        converter.join();
+        return success;
+    }
+
+private:
+    using steady_clock_t = std::chrono::steady_clock;
+
+    const T               resolution_;
+    const format::options options_;
+
+    template <map::tags::option to_t, map::tags::option from_t, typename dummy = void>
+    struct layout {
+        static inline typename cslibs_ndt::map::Map<to_t,Dim,data_t,T>::Ptr from(const typename cslibs_ndt::map::Map<from_t,Dim,data_t,T>::Ptr &src)
+        {
+            return conversion::convert<to_t,from_t,Dim,data_t,T>::from(src);
+        }
+    };
+    template <map::tags::option option_t, typename dummy>
+    struct layout<option_t,option_t,dummy> {
+        static inline typename cslibs_ndt::map::Map<option_t,Dim,data_t,T>::Ptr from(const typename cslibs_ndt::map::Map<option_t,Dim,data_t,T>::Ptr &src)
+        {
+            return src;
+        }
+    };
+
+    inline typename dst_map_t::Ptr convert(const typename src_map_t::Ptr &src) const
+    {
+        if (resolution_ > T() && resolution_ != src->getResolution()) {
+            const typename dyn_map_t::Ptr resampled = conversion::resample<Dim,data_t,T,option_from_t>::from(src, resolution_);
+            return layout<option_to_t,map::tags::dynamic_map>::from(resampled);
+        }
+        return layout<option_to_t,option_from_t>::from(src);
+    }
+
+    static inline std::size_t bundleCount(const dst_map_t &map)
+    {
+        std::size_t count = 0ul;
+        map.traverse([&count](const typename dst_map_t::index_t &, const typename dst_map_t::distribution_bundle_t &) {
+            ++count;
+        });
+        return count;
+    }
+
+    static inline double seconds(const steady_clock_t::time_point &start)
+    {
+        return std::chrono::duration<double>(steady_clock_t::now() - start).count();
+    }
+};
+
+}
+}
+
+#endif // CSLIBS_NDT_SERIALIZATION_CONVERTER_HPP
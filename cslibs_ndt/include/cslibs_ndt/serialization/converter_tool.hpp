@@ -0,0 +1,196 @@
+#ifndef CSLIBS_NDT_SERIALIZATION_CONVERTER_TOOL_HPP
+#define CSLIBS_NDT_SERIALIZATION_CONVERTER_TOOL_HPP
+
+#include <cslibs_ndt/serialization/converter.hpp>
+
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+namespace cslibs_ndt {
+namespace serialization {
+/**
+ * Command line driver of the 2D and 3D map converters, the map types of the dimension have
+ * to be included before instantiating run().
+ *
+ * usage: <program> [options] <input> <output> [<input> <output> ...]
+ *
+ *  --type gridmap|occupancy                  map type, default gridmap
+ *  --from static|dynamic                     layout of the input maps, default dynamic
+ *  --to static|dynamic                       layout of the output maps, default the input layout
+ *  --format directory|file|compressed|tiled  output format, default by extension (.bin file, .ndtz compressed)
+ *  --codec none|lz|zstd                      codec of compressed maps, default lz, zstd if built with it
+ *  --precision <p>                           quantization step of compressed records relative to the resolution, default 0 (lossless)
+ *  --tile-size <n>                           bundles per tile edge of tiled maps, default 32
+ *  --resolution <m>                          resolution of the output maps, default the input resolution
+ *
+ * The input format is detected, tiled maps are read and written by the dynamic layout only.
+ */
+template <std::size_t Dim>
+class ConverterTool
+{
+public:
+    static inline int run(int argc, char *argv[], const std::string &program)
+    {
+        arguments args;
+        if (!parse(argc, argv, args)) {
+            usage(program);
+            return 1;
+        }
+
+        const bool success = args.type == "gridmap" ? convert<cslibs_ndt::Distribution>(args) :
+                                                      convert<cslibs_ndt::OccupancyDistribution>(args);
+        return success ? 0 : 1;
+    }
+
+private:
+    using option_t = cslibs_ndt::map::tags::option;
+    using format_t = format::type;
+
+    struct arguments {
+        std::string                                      type        = "gridmap";
+        option_t                                         from        = cslibs_ndt::map::tags::dynamic_map;
+        option_t                                         to          = cslibs_ndt::map::tags::dynamic_map;
+        bool                                             to_set      = false;
+        format_t                                         format      = format_t::unknown;
+        format::options                                  options;
+        double                                           resolution  = 0.0;
+        std::vector<std::pair<std::string,std::string>>  paths;
+    };
+
+    static inline void usage(const std::string &program)
+    {
+        const std::string indent(program.size() + 8, ' ');
+        std::cerr << "usage: " << program << " [--type gridmap|occupancy] [--from static|dynamic] [--to static|dynamic]\n"
+                  << indent << "[--format directory|file|compressed|tiled] [--codec none|lz|zstd] [--precision <p>]\n"
+                  << indent << "[--tile-size <n>] [--resolution <m>]\n"
+                  << indent << "<input> <output> [<input> <output> ...]\n"
+                  << "tiled maps are read and written by the dynamic layout only." << std::endl;
+    }
+
+    static inline bool option(const std::string &name, option_t &o)
+    {
+        if (name == "static")
+            o = cslibs_ndt::map::tags::static_map;
+        else if (name == "dynamic")
+            o = cslibs_ndt::map::tags::dynamic_map;
+        else
+            return false;
+        return true;
+    }
+
+    static inline bool number(const std::string &value, double &n)
+    {
+        try {
+            std::size_t end = 0ul;
+            n = std::stod(value, &end);
+            return end == value.size() && n >= 0.0;
+        } catch (const std::exception &) {
+            return false;
+        }
+    }
+
+    static inline bool count(const std::string &value, std::size_t &n)
+    {
+        if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos)
+            return false;
+        try {
+            n = static_cast<std::size_t>(std::stoull(value));
+            return n > 0ul;
+        } catch (const std::exception &) {
+            return false;
+        }
+    }
+
+    static inline bool parse(int argc, char *argv[], arguments &args)
+    {
+        std::vector<std::string> positional;
+        for (int i = 1 ; i < argc ; ++ i) {
+            const std::string arg = argv[i];
+            if (arg.compare(0, 2, "--") != 0) {
+                positional.emplace_back(arg);
+                continue;
+            }
+            if (i + 1 >= argc)
+                return false;
+
+            const std::string value = argv[++i];
+            if (arg == "--type")
+                args.type = value;
+            else if (arg == "--from" && option(value, args.from))
+                continue;
+            else if (arg == "--to" && option(value, args.to))
+                args.to_set = true;
+            else if (arg == "--format" && (args.format = format::from_name(value)) != format_t::unknown)
+                continue;
+            else if (arg == "--codec" && codec::from_name(value, args.options.codec) && codec::available(args.options.codec))
+                continue;
+            else if (arg == "--precision" && number(value, args.options.precision))
+                continue;
+            else if (arg == "--tile-size" && count(value, args.options.tile_size))
+                continue;
+            else if (arg == "--resolution" && number(value, args.resolution))
+                continue;
+            else
+                return false;
+        }
+
+        if (positional.empty() || positional.size() % 2 != 0)
+            return false;
+        for (std::size_t i = 0 ; i < positional.size() ; i += 2)
+            args.paths.emplace_back(positional[i], positional[i + 1]);
+        if (!args.to_set)
+            args.to = args.from;
+        return args.type == "gridmap" || args.type == "occupancy";
+    }
+
+    template <option_t from_t, option_t to_t, template <typename,std::size_t> class data_t>
+    static inline bool convert(const arguments &args)
+    {
+        using converter_t = Converter<from_t,to_t,Dim,data_t,double>;
+
+        std::vector<typename converter_t::job> jobs;
+        for (const auto &p : args.paths) {
+            const format_t f = args.format != format_t::unknown ? args.format : format::from_extension(p.second);
+            jobs.emplace_back(typename converter_t::job{p.first, p.second, f});
+        }
+
+        std::size_t input_bytes = 0ul;
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        const bool success = converter_t(args.resolution, args.options).run(jobs, [&input_bytes](const typename converter_t::report &r) {
+            const double mb = static_cast<double>(r.input_bytes) / (1024.0 * 1024.0);
+            input_bytes += r.input_bytes;
+            if (!r.success) {
+                std::cerr << "[MapConverter]: Converting '" << r.task.input << "' failed." << std::endl;
+                return;
+            }
+            std::cout << r.task.input << " -> " << r.task.output << " (" << format::to_name(r.task.output_format) << ")\n"
+                      << std::fixed << std::setprecision(2)
+                      << "  " << r.bundles << " bundles, " << mb << " MB -> " << static_cast<double>(r.output_bytes) / (1024.0 * 1024.0) << " MB\n"
+                      << "  load "    << r.load_time    << " s (" << mb / r.load_time << " MB/s), "
+                      << "convert "   << r.convert_time << " s, "
+                      << "save "      << r.save_time    << " s (" << mb / r.save_time << " MB/s)" << std::endl;
+        });
+
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << jobs.size() << " maps in " << std::fixed << std::setprecision(2) << seconds << " s, "
+                  << static_cast<double>(input_bytes) / (1024.0 * 1024.0) / seconds << " MB/s" << std::endl;
+        return success;
+    }
+
+    template <template <typename,std::size_t> class data_t>
+    static inline bool convert(const arguments &args)
+    {
+        using namespace cslibs_ndt::map::tags;
+        if (args.from == static_map)
+            return args.to == static_map ? convert<static_map, static_map, data_t>(args) :
+                                           convert<static_map, dynamic_map, data_t>(args);
+        return args.to == static_map ? convert<dynamic_map, static_map, data_t>(args) :
+                                       convert<dynamic_map, dynamic_map, data_t>(args);
+    }
+};
+}
+}
+
+#endif // CSLIBS_NDT_SERIALIZATION_CONVERTER_TOOL_HPP
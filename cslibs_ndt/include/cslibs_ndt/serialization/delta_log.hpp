@@ -0,0 +1,486 @@
+#ifndef CSLIBS_NDT_SERIALIZATION_DELTA_LOG_HPP
+#define CSLIBS_NDT_SERIALIZATION_DELTA_LOG_HPP
+
+#include <cslibs_ndt/map/map.hpp>
+#include <cslibs_ndt/serialization/buffered_io.hpp>
+#include <cslibs_ndt/serialization/codec.hpp>
+#include <cslibs_ndt/serialization/filesystem.hpp>
+#include <cslibs_ndt/serialization/single_file.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <unordered_set>
+
+namespace cslibs_ndt {
+namespace serialization {
+/**
+ * Delta persistence layout:
+ *
+ *  <path>/base.bin    - full snapshot in the single file format
+ *  <path>/delta.log   - header followed by appended blocks
+ *
+ * Every block holds the bundles changed between two checkpoints. A record consists of the
+ * bundle index, a bit mask of the bins written and the distributions in the layout of the
+ * store files. A distribution shared by several changed bundles is only written once.
+ * Blocks carry a checksum, so a block torn by a crash is dropped on load.
+ */
+namespace delta {
+static constexpr char          magic[8]                = {'C','S','N','D','T','L','O','G'};
+static constexpr std::uint32_t version                 = 1u;
+static constexpr std::uint32_t block_magic             = 0x4b4c4244u;
+static constexpr std::size_t   default_compaction_size = 256ul << 20;
+
+struct header {
+    char          magic[8];
+    std::uint32_t version;
+    std::uint32_t dimension;
+    std::uint32_t option;
+    std::uint32_t data_type;
+    std::uint32_t scalar_size;
+    std::uint32_t reserved;
+};
+
+struct block {
+    std::uint32_t magic;
+    std::uint32_t reserved;
+    std::uint64_t count;
+    std::uint64_t size;
+    std::uint64_t checksum;
+};
+
+inline boost::filesystem::path base_path(const boost::filesystem::path &root)
+{
+    return root / boost::filesystem::path("base.bin");
+}
+
+inline boost::filesystem::path log_path(const boost::filesystem::path &root)
+{
+    return root / boost::filesystem::path("delta.log");
+}
+}
+
+/**
+ * @brief Append-only persistence of a map under construction.
+ *        checkpoint() collects the bundles changed since the previous checkpoint and hands
+ *        them to a background thread, which appends them to the log. Once the log exceeds
+ *        the compaction size, the same thread merges it into a new base snapshot without
+ *        touching the live map.
+ */
+template <map::tags::option option_t,
+          std::size_t Dim,
+          template <typename,std::size_t> class data_t,
+          typename T,
+          template <typename, typename, typename...> class backend_t = map::tags::default_types<option_t>::template default_backend_t>
+class DeltaLog
+{
+public:
+    using Ptr              = std::shared_ptr<DeltaLog>;
+    using path_t           = boost::filesystem::path;
+    using map_t            = cslibs_ndt::map::Map<option_t,Dim,data_t,T,backend_t>;
+    using index_t          = typename map_t::index_t;
+    using distribution_t   = typename map_t::distribution_t;
+    using bundle_t         = typename map_t::distribution_bundle_t;
+    using single_file_t    = single_file<option_t,Dim,data_t,T,backend_t>;
+
+    static_assert(map_t::bin_count <= 32ul, "Too many bins for the record mask.");
+
+    /**
+     * @brief Start a new log with a full snapshot of the map, an existing folder is replaced.
+     * @param map               map, its changes are tracked from here on
+     * @param path              log folder
+     * @param compaction_size   log size in bytes triggering the compaction
+     * @return the log or nullptr
+     */
+    static inline Ptr create(const map_t &map,
+                             const std::string &path,
+                             const std::size_t compaction_size = delta::default_compaction_size)
+    {
+        const path_t path_root(path);
+        if (!cslibs_ndt::common::serialization::create_directory(path_root))
+            return nullptr;
+
+        std::vector<index_t> dirty;
+        map.takeDirtyBundles(dirty);
+        if (!single_file_t::save(map, delta::base_path(path_root).string()))
+            return nullptr;
+
+        Ptr log(new DeltaLog(path_root, compaction_size));
+        return log->start(false, 0ul) ? log : nullptr;
+    }
+
+    /**
+     * @brief Load a map and continue its log.
+     * @param path              log folder
+     * @param map               loaded map
+     * @param compaction_size   log size in bytes triggering the compaction
+     * @return the log or nullptr
+     */
+    static inline Ptr open(const std::string &path,
+                           typename map_t::Ptr &map,
+                           const std::size_t compaction_size = delta::default_compaction_size)
+    {
+        const path_t path_root(path);
+        std::size_t log_size = 0ul;
+        if (!replay(path_root, map, log_size))
+            return nullptr;
+
+        Ptr log(new DeltaLog(path_root, compaction_size));
+        return log->start(true, log_size) ? log : nullptr;
+    }
+
+    /**
+     * @brief Load the base snapshot and apply all complete blocks of the log.
+     * @param path  log folder
+     * @param map   loaded map
+     * @return true, if the map could be loaded
+     */
+    static inline bool load(const std::string &path,
+                            typename map_t::Ptr &map)
+    {
+        std::size_t log_size = 0ul;
+        return replay(path_t(path), map, log_size);
+    }
+
+    inline virtual ~DeltaLog()
+    {
+        {
+            std::unique_lock<std::mutex> l(mutex_);
+            stop_ = true;
+        }
+        notify_.notify_one();
+        if (worker_.joinable())
+            worker_.join();
+        if (fd_ >= 0)
+            ::close(fd_);
+    }
+
+    DeltaLog(const DeltaLog &other) = delete;
+    DeltaLog& operator = (const DeltaLog &other) = delete;
+
+    /**
+     * @brief Queue the bundles changed since the last checkpoint, the map is only read
+     *        during this call. This takes the dirty bundles of the map, use
+     *        checkpoint(map, indices) if they are consumed elsewhere as well.
+     * @param map   map
+     * @return number of queued bundles
+     */
+    inline std::size_t checkpoint(const map_t &map)
+    {
+        std::vector<index_t> indices;
+        map.takeDirtyBundles(indices);
+        return checkpoint(map, indices);
+    }
+
+    /**
+     * @brief Queue the given bundles, e.g. the dirty bundles taken once from the map and
+     *        shared with other consumers like the incremental gridmaps. The map is only read
+     *        during this call.
+     * @param map       map
+     * @param indices   indices of the bundles changed since the last checkpoint
+     * @return number of queued bundles
+     */
+    inline std::size_t checkpoint(const map_t &map,
+                                  const std::vector<index_t> &indices)
+    {
+        if (indices.empty())
+            return 0ul;
+
+        MemoryOutput out;
+
+        std::unordered_set<const distribution_t*> written;
+        std::uint64_t count = 0ul;
+        for (const index_t &bi : indices) {
+            const bundle_t *bundle = map.get(bi);
+            if (!bundle)
+                continue;
+
+            std::uint32_t mask = 0u;
+            for (std::size_t i = 0 ; i < map_t::bin_count ; ++i)
+                if (bundle->at(i) && written.insert(bundle->at(i)).second)
+                    mask |= 1u << i;
+            if (mask == 0u)
+                continue;
+
+            std::int32_t index[Dim];
+            for (std::size_t j = 0 ; j < Dim ; ++j)
+                index[j] = static_cast<std::int32_t>(bi[j]);
+            out.write(reinterpret_cast<const char*>(index), sizeof(index));
+            out.write(reinterpret_cast<const char*>(&mask), sizeof(mask));
+            for (std::size_t i = 0 ; i < map_t::bin_count ; ++i)
+                if (mask & (1u << i))
+                    cslibs_ndt::write(*bundle->at(i), out);
+            ++count;
+        }
+
+        {
+            std::unique_lock<std::mutex> l(mutex_);
+            queue_.emplace_back(count, out.str());
+        }
+        notify_.notify_one();
+        return static_cast<std::size_t>(count);
+    }
+
+    /**
+     * @brief Block until all queued checkpoints are written.
+     * @return false, if writing failed
+     */
+    inline bool wait()
+    {
+        std::unique_lock<std::mutex> l(mutex_);
+        idle_.wait(l, [this]() { return queue_.empty() && !busy_; });
+        return !failed_;
+    }
+
+    inline bool good() const
+    {
+        return !failed_;
+    }
+
+    inline std::size_t getLogSize() const
+    {
+        return log_size_;
+    }
+
+private:
+    path_t                  path_root_;
+    std::size_t             compaction_size_;
+    int                     fd_;
+    std::atomic<std::size_t> log_size_;
+    std::atomic_bool        failed_;
+
+    std::thread             worker_;
+    std::mutex              mutex_;
+    std::condition_variable notify_;
+    std::condition_variable idle_;
+    std::deque<std::pair<std::uint64_t, std::string>> queue_;
+    bool                    busy_;
+    bool                    stop_;
+
+    inline DeltaLog(const path_t &path_root,
+                    const std::size_t compaction_size) :
+        path_root_(path_root),
+        compaction_size_(compaction_size),
+        fd_(-1),
+        log_size_(0ul),
+        failed_(false),
+        busy_(false),
+        stop_(false)
+    {
+    }
+
+    static inline delta::header makeHeader()
+    {
+        delta::header h;
+        std::memset(&h, 0, sizeof(h));
+        std::memcpy(h.magic, delta::magic, sizeof(delta::magic));
+        h.version     = delta::version;
+        h.dimension   = static_cast<std::uint32_t>(Dim);
+        h.option      = static_cast<std::uint32_t>(option_t);
+        h.data_type   = static_cast<std::uint32_t>(file::data_type_id<data_t>::value);
+        h.scalar_size = static_cast<std::uint32_t>(sizeof(T));
+        return h;
+    }
+
+    /**
+     * @brief Open the log file, a torn tail of an existing log is cut off.
+     */
+    inline bool start(const bool existing,
+                      const std::size_t log_size)
+    {
+        const std::string path = delta::log_path(path_root_).string();
+        fd_ = ::open(path.c_str(), existing ? O_WRONLY : (O_WRONLY | O_CREAT | O_TRUNC), 0644);
+        if (fd_ < 0) {
+            std::cerr << "Could not open '" << path << "'" << std::endl;
+            return false;
+        }
+
+        if (existing) {
+            if (::ftruncate(fd_, static_cast<off_t>(log_size)) != 0)
+                return false;
+            log_size_ = log_size;
+        } else {
+            const delta::header h = makeHeader();
+            if (!io::pwrite_all(fd_, reinterpret_cast<const char*>(&h), sizeof(h), 0ul))
+                return false;
+            log_size_ = sizeof(h);
+        }
+
+        worker_ = std::thread([this]() { run(); });
+        return true;
+    }
+
+    inline void run()
+    {
+        while (true) {
+            std::pair<std::uint64_t, std::string> entry;
+            {
+                std::unique_lock<std::mutex> l(mutex_);
+                notify_.wait(l, [this]() { return stop_ || !queue_.empty(); });
+                if (queue_.empty())
+                    return;
+                entry = std::move(queue_.front());
+                queue_.pop_front();
+                busy_ = true;
+            }
+
+            if (!append(entry.first, entry.second))
+                failed_ = true;
+            else if (log_size_ >= compaction_size_ && !compact())
+                failed_ = true;
+
+            {
+                std::unique_lock<std::mutex> l(mutex_);
+                busy_ = false;
+            }
+            idle_.notify_all();
+        }
+    }
+
+    inline bool append(const std::uint64_t count,
+                       const std::string &payload)
+    {
+        delta::block b;
+        b.magic    = delta::block_magic;
+        b.reserved = 0u;
+        b.count    = count;
+        b.size     = payload.size();
+        b.checksum = codec::checksum(payload.data(), payload.size());
+
+        const std::size_t offset = log_size_;
+        if (!io::pwrite_all(fd_, reinterpret_cast<const char*>(&b), sizeof(b), offset) ||
+                !io::pwrite_all(fd_, payload.data(), payload.size(), offset + sizeof(b)) ||
+                ::fdatasync(fd_) != 0) {
+            std::cerr << "Could not append to '" << delta::log_path(path_root_).string() << "'" << std::endl;
+            return false;
+        }
+        log_size_ = offset + sizeof(b) + payload.size();
+        return true;
+    }
+
+    /**
+     * @brief Merge the log into a new base snapshot and reset the log. The base is replaced
+     *        atomically, replaying the old log on top of the new base is harmless.
+     */
+    inline bool compact()
+    {
+        typename map_t::Ptr map;
+        std::size_t log_size = 0ul;
+        if (!replay(path_root_, map, log_size))
+            return false;
+
+        const path_t base = delta::base_path(path_root_);
+        const path_t tmp  = path_root_ / path_t("base.bin.tmp");
+        if (!single_file_t::save(*map, tmp.string()))
+            return false;
+
+        boost::system::error_code ec;
+        boost::filesystem::rename(tmp, base, ec);
+        if (ec) {
+            std::cerr << "Could not replace '" << base.string() << "': " << ec.message() << std::endl;
+            return false;
+        }
+
+        if (::ftruncate(fd_, static_cast<off_t>(sizeof(delta::header))) != 0)
+            return false;
+        log_size_ = sizeof(delta::header);
+        return true;
+    }
+
+    static inline bool replay(const path_t &path_root,
+                              typename map_t::Ptr &map,
+                              std::size_t &log_size)
+    {
+        if (!cslibs_ndt::common::serialization::check_directory(path_root) ||
+                !single_file_t::load(delta::base_path(path_root).string(), map))
+            return false;
+
+        const std::string path = delta::log_path(path_root).string();
+        BufferedInputFile in(path);
+        if (!in.is_open()) {
+            std::cerr << "Could not open '" << path << "'" << std::endl;
+            return false;
+        }
+
+        delta::header h;
+        const delta::header expected = makeHeader();
+        in.read(reinterpret_cast<char*>(&h), sizeof(h));
+        if (in.gcount() != sizeof(h) || std::memcmp(&h, &expected, sizeof(h)) != 0) {
+            std::cerr << "Log '" << path << "' does not match the requested map type." << std::endl;
+            return false;
+        }
+        log_size = sizeof(h);
+
+        std::string payload;
+        while (true) {
+            delta::block b;
+            in.read(reinterpret_cast<char*>(&b), sizeof(b));
+            if (in.gcount() != sizeof(b) || b.magic != delta::block_magic ||
+                    b.size > in.size() - log_size - sizeof(b))
+                break;
+
+            payload.resize(static_cast<std::size_t>(b.size));
+            in.read(&payload[0], static_cast<std::streamsize>(b.size));
+            if (static_cast<std::uint64_t>(in.gcount()) != b.size ||
+                    codec::checksum(payload.data(), payload.size()) != b.checksum)
+                break;
+
+            if (!apply(payload, b.count, *map)) {
+                std::cerr << "Log '" << path << "' is corrupt." << std::endl;
+                return false;
+            }
+            log_size += sizeof(b) + payload.size();
+        }
+
+        std::vector<index_t> dirty;
+        map->takeDirtyBundles(dirty);
+        return true;
+    }
+
+    static inline bool apply(const std::string &payload,
+                             const std::uint64_t count,
+                             map_t &map)
+    {
+        MemoryInput in(payload.data(), payload.size());
+
+        try {
+            for (std::uint64_t r = 0 ; r < count ; ++r) {
+                std::int32_t index[Dim];
+                std::uint32_t mask;
+                in.read(reinterpret_cast<char*>(index), sizeof(index));
+                in.read(reinterpret_cast<char*>(&mask), sizeof(mask));
+                if (!in)
+                    return false;
+
+                index_t bi;
+                for (std::size_t j = 0 ; j < Dim ; ++j)
+                    bi[j] = index[j];
+
+                /// bundles outside of a static map are skipped
+                bundle_t *bundle = map.getDistributionBundle(bi);
+                for (std::size_t i = 0 ; i < map_t::bin_count ; ++i) {
+                    if (!(mask & (1u << i)))
+                        continue;
+                    distribution_t d;
+                    cslibs_ndt::read(in, d);
+                    if (!in)
+                        return false;
+                    if (bundle)
+                        *bundle->at(i) = d;
+                }
+            }
+        } catch (const std::exception &e) {
+            std::cerr << "Failed applying log block '" << e.what() << std::endl;
+            return false;
+        }
+        return in.remaining() == 0ul;
+    }
+};
+
+}
+}
+
+#endif // CSLIBS_NDT_SERIALIZATION_DELTA_LOG_HPP
@@ -3,17 +3,58 @@
 
 #include <cslibs_ndt/map/map.hpp>
 
+#include <cslibs_ndt/serialization/buffered_io.hpp>
+#include <cslibs_ndt/serialization/codec.hpp>
 #include <cslibs_ndt/serialization/filesystem.hpp>
+#include <cslibs_ndt/serialization/mapped_file.hpp>
 #include <cslibs_ndt/serialization/storage.hpp>
+#include <cslibs_ndt/utility/bundles.hpp>
 
 #include <cslibs_math_2d/serialization/transform.hpp>
 #include <cslibs_math_3d/serialization/transform.hpp>
 
+#include <algorithm>
 #include <thread>
 #include <atomic>
 
 namespace cslibs_ndt {
 namespace serialization {
+namespace file {
+template <typename T>
+inline void encode(const cslibs_math_2d::Pose2<T> &pose, double (&origin)[7])
+{
+    std::fill(origin, origin + 7, 0.0);
+    origin[0] = static_cast<double>(pose.tx());
+    origin[1] = static_cast<double>(pose.ty());
+    origin[2] = static_cast<double>(pose.yaw());
+}
+
+template <typename T>
+inline void encode(const cslibs_math_3d::Pose3<T> &pose, double (&origin)[7])
+{
+    origin[0] = static_cast<double>(pose.tx());
+    origin[1] = static_cast<double>(pose.ty());
+    origin[2] = static_cast<double>(pose.tz());
+    origin[3] = static_cast<double>(pose.rotation().x());
+    origin[4] = static_cast<double>(pose.rotation().y());
+    origin[5] = static_cast<double>(pose.rotation().z());
+    origin[6] = static_cast<double>(pose.rotation().w());
+}
+
+template <typename T>
+inline void decode(const double (&origin)[7], cslibs_math_2d::Pose2<T> &pose)
+{
+    pose = cslibs_math_2d::Pose2<T>(static_cast<T>(origin[0]), static_cast<T>(origin[1]), static_cast<T>(origin[2]));
+}
+
+template <typename T>
+inline void decode(const double (&origin)[7], cslibs_math_3d::Pose3<T> &pose)
+{
+    pose = cslibs_math_3d::Pose3<T>(cslibs_math_3d::Vector3<T>(static_cast<T>(origin[0]), static_cast<T>(origin[1]), static_cast<T>(origin[2])),
+                                    cslibs_math_3d::Quaternion<T>(static_cast<T>(origin[3]), static_cast<T>(origin[4]),
+                                                                  static_cast<T>(origin[5]), static_cast<T>(origin[6])));
+}
+}
 
 template <map::tags::option option_t,
           std::size_t Dim,
@@ -49,6 +90,30 @@ struct loader<cslibs_ndt::map::tags::static_map,Dim,data_t,T,backend_t> {
     {
     }
 
+    static inline loader* create(const pose_t &pose,
+                                 const T& resolution,
+                                 const size_t &size,
+                                 const index_t &min_index,
+                                 const index_t &/*max_index*/,
+                                 const std::vector<index_t> &indices)
+    {
+        return new loader(pose, resolution, size, min_index, indices);
+    }
+
+    /**
+     * @brief Create an empty storage set up like the one of a loaded storage file.
+     */
+    inline void allocateStorage(const std::size_t i, storage_t &storage) const
+    {
+        const std::size_t off = (i > 1ul) ? 1ul : 0ul;
+        index_t offset;
+        for (std::size_t d=0; d<Dim; ++d)
+            offset[d] = cslibs_math::common::div<int>(min_index_[d], 2);
+        storage.reset(new typename map_t::distribution_storage_t);
+        storage->template set<cis::option::tags::array_size>(size_ + off);
+        storage->template set<cis::option::tags::array_offset>(offset);
+    }
+
     inline bool load(const std::size_t i, const path_t path, storage_t &storage) const
     {
         const std::size_t off = (i > 1ul) ? 1ul : 0ul;
@@ -58,22 +123,23 @@ struct loader<cslibs_ndt::map::tags::static_map,Dim,data_t,T,backend_t> {
         return binary_t::load(path, storage, size_ + off, offset);
     }
 
+    inline bool load(const std::size_t i, const path_t path, storage_t &storage,
+                     const std::size_t begin, const std::size_t length) const
+    {
+        const std::size_t off = (i > 1ul) ? 1ul : 0ul;
+        index_t offset;
+        for (std::size_t i=0; i<Dim; ++i)
+            offset[i] = cslibs_math::common::div<int>(min_index_[i], 2);
+        return binary_t::load(path, storage, size_ + off, offset, begin, length);
+    }
+
     inline void allocateBundles(const std::shared_ptr<bundle_storage_t>& bundles,
                                 const storages_t& storages) const
     {
         bundles->template set<cslibs_indexed_storage::option::tags::array_size>(size_ * 2ul);
         bundles->template set<cslibs_indexed_storage::option::tags::array_offset>(min_index_);
 
-        auto allocate_bundle = [&storages, &bundles](const index_t &bi) {
-            typename map_t::distribution_bundle_t b;
-            const typename map_t::index_list_t indices =
-                    utility::generate_indices<typename map_t::index_list_t,Dim>(bi);
-            for (std::size_t i = 0 ; i < map_t::bin_count ; ++i)
-                b[i] = storages[i]->get(indices[i]);
-            bundles->insert(bi, b);
-        };
-        for (const index_t &index : indices_)
-            allocate_bundle(index);
+        utility::allocate_bundles<map_t,Dim>(indices_, bundles, storages);
     }
 
     inline void createMap(const std::shared_ptr<bundle_storage_t>& bundles,
@@ -121,24 +187,39 @@ struct loader<cslibs_ndt::map::tags::dynamic_map,Dim,data_t,T,backend_t> {
     {
     }
 
+    static inline loader* create(const pose_t &pose,
+                                 const T& resolution,
+                                 const typename map_t::size_t &/*size*/,
+                                 const index_t &min_index,
+                                 const index_t &max_index,
+                                 const std::vector<index_t> &indices)
+    {
+        return new loader(pose, resolution, min_index, max_index, indices);
+    }
+
+    /**
+     * @brief Create an empty storage set up like the one of a loaded storage file.
+     */
+    inline void allocateStorage(const std::size_t /*i*/, storage_t &storage) const
+    {
+        storage.reset(new typename map_t::distribution_storage_t);
+    }
+
     inline bool load(const std::size_t i, const path_t path, storage_t &storage) const
     {
         return binary_t::load(path, storage);
     }
 
+    inline bool load(const std::size_t i, const path_t path, storage_t &storage,
+                     const std::size_t begin, const std::size_t length) const
+    {
+        return binary_t::load(path, storage, begin, length);
+    }
+
     inline void allocateBundles(const std::shared_ptr<bundle_storage_t>& bundles,
                                 const storages_t& storages) const
     {
-        auto allocate_bundle = [&storages, &bundles](const index_t &bi) {
-            typename map_t::distribution_bundle_t b;
-            const typename map_t::index_list_t indices =
-                    utility::generate_indices<typename map_t::index_list_t,Dim>(bi);
-            for (std::size_t i = 0 ; i < map_t::bin_count ; ++i)
-                b[i] = storages[i]->get(indices[i]);
-            bundles->insert(bi, b);
-        };
-        for (const index_t &index : indices_)
-            allocate_bundle(index);
+        utility::allocate_bundles<map_t,Dim>(indices_, bundles, storages);
     }
 
     inline void createMap(const std::shared_ptr<bundle_storage_t>& bundles,
@@ -161,69 +242,140 @@ struct loader<cslibs_ndt::map::tags::dynamic_map,Dim,data_t,T,backend_t> {
 };
 
 
+/**
+ * Binary map header (map.bin), readable with one call or usable in place from a mapping:
+ *
+ *  header
+ *  index table     - bundle_count * Dim int32, sorted lexicographically
+ *
+ * The checksum covers the index table. Files without the magic are read as the former
+ * headerless layout, i.e. origin, resolution, size and minimum index followed by the indices.
+ */
+namespace index_file {
+static constexpr char          magic[8] = {'C','S','N','D','T','I','D','X'};
+static constexpr std::uint32_t version  = 2u;
+
+struct header {
+    char          magic[8];
+    std::uint32_t version;
+    std::uint32_t dimension;
+    std::uint32_t option;
+    std::uint32_t scalar_size;
+    double        origin[7];
+    double        resolution;
+    std::uint64_t size[3];
+    std::int32_t  min_index[3];
+    std::int32_t  max_index[3];
+    std::uint64_t bundle_count;
+    std::uint64_t table_offset;
+    std::uint64_t checksum;
+};
+static_assert(std::is_standard_layout<header>::value, "index_file::header has to be standard layout.");
+}
+
 template <map::tags::option option_t,
           std::size_t Dim,
           template <typename,std::size_t> class data_t,
           typename T,
           template <typename, typename, typename...> class backend_t>
-struct header {};
-
-template <std::size_t Dim,
-          template <typename,std::size_t> class data_t,
-          typename T,
-          template <typename, typename, typename...> class backend_t>
-struct header<cslibs_ndt::map::tags::static_map,Dim,data_t,T,backend_t> {
-    using map_t    = cslibs_ndt::map::Map<cslibs_ndt::map::tags::static_map,Dim,data_t,T,backend_t>;
+struct binary_header {
+    using map_t    = cslibs_ndt::map::Map<option_t,Dim,data_t,T,backend_t>;
     using index_t  = typename map_t::index_t;
     using pose_t   = typename map_t::pose_t;
     using size_t   = typename map_t::size_t;
-    using loader_t = loader<cslibs_ndt::map::tags::static_map,Dim,data_t,T,backend_t>;
+    using loader_t = loader<option_t,Dim,data_t,T,backend_t>;
 
-    static inline void write(const map_t &map, YAML::Node &n)
-    {
-        std::vector<index_t> indices;
-        map.getBundleIndices(indices);
-        n["origin"]     = map.getInitialOrigin();
-        n["resolution"] = map.getResolution();
-        n["size"]       = map.getSize();
-        n["min_index"]  = map.getMinBundleIndex();
-        n["bundles"]    = indices;
-    }
+    static_assert(sizeof(index_t) == Dim * sizeof(std::int32_t), "Bundle indices have to be packed int32.");
 
-    static inline loader_t* load(const YAML::Node& n)
+    static inline std::size_t bundleCount(const map_t &map)
     {
-        const pose_t               origin     = n["origin"].as<pose_t>();
-        const T                    resolution = n["resolution"].as<T>();
-        const size_t               size       = n["size"].as<size_t>();
-        const index_t              min_index  = n["min_index"].as<index_t>();
-        const std::vector<index_t> indices    = n["bundles"].as<std::vector<index_t>>();
-
-        return new loader_t(origin,resolution,size,min_index,indices);
+        std::size_t count = 0;
+        map.traverse([&count](const index_t &, const typename map_t::distribution_bundle_t &) { ++count; });
+        return count;
     }
 
     static inline bool save(const map_t& map, const boost::filesystem::path &path)
     {
-        std::ofstream out(path.string(), std::ios::binary | std::ios::trunc);
+        std::vector<index_t> indices;
+        map.getBundleIndices(indices);
+        std::sort(indices.begin(), indices.end());
+
+        index_file::header h;
+        std::memset(&h, 0, sizeof(h));
+        std::memcpy(h.magic, index_file::magic, sizeof(index_file::magic));
+        h.version      = index_file::version;
+        h.dimension    = static_cast<std::uint32_t>(Dim);
+        h.option       = static_cast<std::uint32_t>(option_t);
+        h.scalar_size  = static_cast<std::uint32_t>(sizeof(T));
+        h.resolution   = static_cast<double>(map.getResolution());
+        file::encode(map.getInitialOrigin(), h.origin);
+        for (std::size_t i = 0 ; i < Dim ; ++i) {
+            h.size[i]      = static_cast<std::uint64_t>(map.getSize()[i]);
+            h.min_index[i] = map.getMinBundleIndex()[i];
+            h.max_index[i] = map.getMaxBundleIndex()[i];
+        }
+        h.bundle_count = indices.size();
+        h.table_offset = sizeof(h);
+        h.checksum     = codec::checksum(reinterpret_cast<const char*>(indices.data()), indices.size() * sizeof(index_t));
+
+        BufferedOutputFile out(path.string());
         if (!out.is_open()) {
             std::cerr << "Could not open '" << path.string() << std::endl;
             return false;
         }
+        out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        out.write(reinterpret_cast<const char*>(indices.data()), static_cast<std::streamsize>(indices.size() * sizeof(index_t)));
+        return out.close();
+    }
 
-        cslibs_math::serialization::transform::binary::write(map.getInitialOrigin(), out);
-        cslibs_math::serialization::io<T>::write(map.getResolution(), out);
-        cslibs_math::serialization::array::binary<std::size_t, Dim>::write(map.getSize(), out);
-        cslibs_math::serialization::array::binary<int, Dim>::write(map.getMinBundleIndex(), out);
+    static inline loader_t* load(const boost::filesystem::path &path)
+    {
+        const MappedFile::Ptr mapped = MappedFile::open(path.string(), true);
+        if (!mapped)
+            return nullptr;
 
-        std::vector<index_t> indices;
-        map.getBundleIndices(indices);
-        for (const auto& index : indices)
-            cslibs_math::serialization::array::binary<int, Dim>::write(index, out);
+        const index_file::header *h = mapped->as<index_file::header>(0ul);
+        if (!h || std::memcmp(h->magic, index_file::magic, sizeof(index_file::magic)) != 0)
+            return loadHeaderless(path);
 
-        out.close();
-        return true;
+        if (h->version != index_file::version) {
+            std::cerr << "Unsupported map header version " << h->version << ", expected " << index_file::version << "." << std::endl;
+            return nullptr;
+        }
+        if (h->dimension != Dim || h->option != static_cast<std::uint32_t>(option_t) || h->scalar_size != sizeof(T)) {
+            std::cerr << "Map header '" << path.string() << "' does not match the requested map type." << std::endl;
+            return nullptr;
+        }
+
+        const std::size_t count = static_cast<std::size_t>(h->bundle_count);
+        const char *table = mapped->as<char>(h->table_offset, count * sizeof(index_t));
+        if (!table && count > 0ul) {
+            std::cerr << "Map header '" << path.string() << "' is truncated." << std::endl;
+            return nullptr;
+        }
+        if (codec::checksum(table, count * sizeof(index_t)) != h->checksum) {
+            std::cerr << "Map header '" << path.string() << "' is corrupt." << std::endl;
+            return nullptr;
+        }
+
+        std::vector<index_t> indices(count);
+        if (count > 0ul)
+            std::memcpy(indices.data(), table, count * sizeof(index_t));
+
+        pose_t origin;
+        file::decode(h->origin, origin);
+        size_t size;
+        index_t min_index, max_index;
+        for (std::size_t i = 0 ; i < Dim ; ++i) {
+            size[i]      = static_cast<std::size_t>(h->size[i]);
+            min_index[i] = h->min_index[i];
+            max_index[i] = h->max_index[i];
+        }
+        return loader_t::create(origin, static_cast<T>(h->resolution), size, min_index, max_index, indices);
     }
 
-    static inline loader_t* load(const boost::filesystem::path &path)
+private:
+    static inline loader_t* loadHeaderless(const boost::filesystem::path &path)
     {
         std::ifstream in(path.string(), std::ios::binary);
         if (!in.is_open()) {
@@ -256,102 +408,123 @@ struct header<cslibs_ndt::map::tags::static_map,Dim,data_t,T,backend_t> {
             return nullptr;
         }
 
-        return new loader_t(origin,resolution,map_size,min_index,indices);
+        index_t max_index;
+        for (std::size_t i=0; i<Dim; ++i)
+            max_index[i] = min_index[i] + static_cast<int>(map_size[i]);
+        return loader_t::create(origin,resolution,map_size,min_index,max_index,indices);
     }
 };
 
+/**
+ * @brief Map meta data. The YAML nodes carry the meta data and the bundle list, so they can be
+ *        loaded without the binary header; directories prefer the binary header.
+ */
+template <map::tags::option option_t,
+          std::size_t Dim,
+          template <typename,std::size_t> class data_t,
+          typename T,
+          template <typename, typename, typename...> class backend_t>
+struct header {};
+
 template <std::size_t Dim,
           template <typename,std::size_t> class data_t,
           typename T,
           template <typename, typename, typename...> class backend_t>
-struct header<cslibs_ndt::map::tags::dynamic_map,Dim,data_t,T,backend_t> {
-    using map_t    = cslibs_ndt::map::Map<cslibs_ndt::map::tags::dynamic_map,Dim,data_t,T,backend_t>;
+struct header<cslibs_ndt::map::tags::static_map,Dim,data_t,T,backend_t> {
+    using map_t    = cslibs_ndt::map::Map<cslibs_ndt::map::tags::static_map,Dim,data_t,T,backend_t>;
     using index_t  = typename map_t::index_t;
     using pose_t   = typename map_t::pose_t;
     using size_t   = typename map_t::size_t;
-    using loader_t = loader<cslibs_ndt::map::tags::dynamic_map,Dim,data_t,T,backend_t>;
+    using loader_t = loader<cslibs_ndt::map::tags::static_map,Dim,data_t,T,backend_t>;
+    using binary_t = binary_header<cslibs_ndt::map::tags::static_map,Dim,data_t,T,backend_t>;
 
     static inline void write(const map_t &map, YAML::Node &n)
     {
         std::vector<index_t> indices;
         map.getBundleIndices(indices);
-        n["origin"]     = map.getInitialOrigin();
-        n["resolution"] = map.getResolution();
-        n["min_index"]  = map.getMinBundleIndex();
-        n["max_index"]  = map.getMaxBundleIndex();
-        n["bundles"]    = indices;
+        n["origin"]       = map.getInitialOrigin();
+        n["resolution"]   = map.getResolution();
+        n["size"]         = map.getSize();
+        n["min_index"]    = map.getMinBundleIndex();
+        n["bundle_count"] = indices.size();
+        n["bundles"]      = indices;
     }
 
-    static inline loader_t* load(const YAML::Node& n) {
+    static inline loader_t* load(const YAML::Node& n)
+    {
+        if (!n["bundles"]) {
+            std::cerr << "Meta data does not list the bundles, load the binary header instead." << std::endl;
+            return nullptr;
+        }
+
         const pose_t               origin     = n["origin"].as<pose_t>();
         const T                    resolution = n["resolution"].as<T>();
+        const size_t               size       = n["size"].as<size_t>();
         const index_t              min_index  = n["min_index"].as<index_t>();
-        const index_t              max_index  = n["max_index"].as<index_t>();
         const std::vector<index_t> indices    = n["bundles"].as<std::vector<index_t>>();
 
-        return new loader_t(origin,resolution,min_index,max_index,indices);
-    }    
+        return new loader_t(origin,resolution,size,min_index,indices);
+    }
 
     static inline bool save(const map_t& map, const boost::filesystem::path &path)
     {
-        std::ofstream out(path.string(), std::ios::binary | std::ios::trunc);
-        if (!out.is_open()) {
-            std::cerr << "Could not open '" << path.string() << std::endl;
-            return false;
-        }
+        return binary_t::save(map, path);
+    }
 
-        cslibs_math::serialization::transform::binary::write(map.getInitialOrigin(), out);
-        cslibs_math::serialization::io<T>::write(map.getResolution(), out);
-        cslibs_math::serialization::array::binary<std::size_t, Dim>::write(map.getSize(), out);
-        cslibs_math::serialization::array::binary<int, Dim>::write(map.getMinBundleIndex(), out);
+    static inline loader_t* load(const boost::filesystem::path &path)
+    {
+        return binary_t::load(path);
+    }
+};
+
+template <std::size_t Dim,
+          template <typename,std::size_t> class data_t,
+          typename T,
+          template <typename, typename, typename...> class backend_t>
+struct header<cslibs_ndt::map::tags::dynamic_map,Dim,data_t,T,backend_t> {
+    using map_t    = cslibs_ndt::map::Map<cslibs_ndt::map::tags::dynamic_map,Dim,data_t,T,backend_t>;
+    using index_t  = typename map_t::index_t;
+    using pose_t   = typename map_t::pose_t;
+    using size_t   = typename map_t::size_t;
+    using loader_t = loader<cslibs_ndt::map::tags::dynamic_map,Dim,data_t,T,backend_t>;
+    using binary_t = binary_header<cslibs_ndt::map::tags::dynamic_map,Dim,data_t,T,backend_t>;
 
+    static inline void write(const map_t &map, YAML::Node &n)
+    {
         std::vector<index_t> indices;
         map.getBundleIndices(indices);
-        for (const auto& index : indices)
-            cslibs_math::serialization::array::binary<int, Dim>::write(index, out);
-
-        out.close();
-        return true;
+        n["origin"]       = map.getInitialOrigin();
+        n["resolution"]   = map.getResolution();
+        n["min_index"]    = map.getMinBundleIndex();
+        n["max_index"]    = map.getMaxBundleIndex();
+        n["bundle_count"] = indices.size();
+        n["bundles"]      = indices;
     }
 
-    static inline loader_t* load(const boost::filesystem::path &path)
-    {
-        std::ifstream in(path.string(), std::ios::binary);
-        if (!in.is_open()) {
-            std::cerr << "Could not open '" << path.string() << std::endl;
+    static inline loader_t* load(const YAML::Node& n) {
+        if (!n["bundles"]) {
+            std::cerr << "Meta data does not list the bundles, load the binary header instead." << std::endl;
             return nullptr;
         }
 
-        pose_t origin;
-        T resolution;
-        size_t map_size;
-        index_t min_index;
-        std::vector<index_t> indices;
-        try {
-            in.seekg (0, std::ios::end);
-            const std::size_t size = in.tellg();
-            in.seekg (0, std::ios::beg);
-            std::size_t read = 0;
-            read += cslibs_math::serialization::transform::binary::read(in, origin);
-            resolution = cslibs_math::serialization::io<T>::read(in);
-            read += sizeof(T);
-            read += cslibs_math::serialization::array::binary<std::size_t, Dim>::read(in, map_size);
-            read += cslibs_math::serialization::array::binary<int, Dim>::read(in, min_index);
-            while (read < size) {
-                index_t index;
-                read += cslibs_math::serialization::array::binary<int, Dim>::read(in, index);
-                indices.push_back(index);
-            }
-        } catch (const std::exception &e) {
-            std::cerr << "Failed reading file '" << e.what() << std::endl;
-            return nullptr;
-        }
+        const pose_t               origin     = n["origin"].as<pose_t>();
+        const T                    resolution = n["resolution"].as<T>();
+        const index_t              min_index  = n["min_index"].as<index_t>();
+        const index_t              max_index  = n["max_index"].as<index_t>();
+        const std::vector<index_t> indices    = n["bundles"].as<std::vector<index_t>>();
 
-        index_t max_index;
-        for (std::size_t i=0; i<Dim; ++i)
-            max_index[i] = min_index[i] + static_cast<int>(map_size[i]);
         return new loader_t(origin,resolution,min_index,max_index,indices);
     }
+
+    static inline bool save(const map_t& map, const boost::filesystem::path &path)
+    {
+        return binary_t::save(map, path);
+    }
+
+    static inline loader_t* load(const boost::filesystem::path &path)
+    {
+        return binary_t::load(path);
+    }
 };
 
 }
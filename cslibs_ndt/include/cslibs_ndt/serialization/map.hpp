@@ -14,6 +14,7 @@
 #include <yaml-cpp/yaml.h>
 
 #include <fstream>
+#include <memory>
 #include <thread>
 #include <atomic>
 
@@ -36,8 +37,16 @@ struct binary
     using storages_t       = typename map_t::distribution_storage_array_t;
     using bundle_storage_t = typename map_t::distribution_bundle_storage_t;
 
+/**
+ * @brief Save a map into a folder of a header and one file per storage.
+ * @param map       map
+ * @param path      map folder
+ * @param parallel  write the storages with one thread each, otherwise one after another
+ * @return true, if the map could be written
+ */
 static inline bool save(const map_t &map,
-                        const std::string &path)
+                        const std::string &path,
+                        const bool parallel = true)
 {
     /// step one: check if the root diretory exists
     path_t path_root(path);
@@ -57,6 +66,12 @@ static inline bool save(const map_t &map,
 
     /// step four: write out the storages
     storages_t storages = map.getStorages();
+    if (!parallel) {
+        for (std::size_t i = 0 ; i < map_t::bin_count; ++i)
+            if (!binary_t::save(storages[i], paths[i]))
+                return false;
+        return true;
+    }
 
     std::array<std::thread, map_t::bin_count> threads;
     std::atomic_bool success(true);
@@ -92,25 +107,25 @@ inline static bool load(const std::string &path,
     std::shared_ptr<bundle_storage_t> bundles(new bundle_storage_t);
     storages_t storages;
 
-    /// load meta data
-    path_t path_file = path_root / path_t("map.yaml");
-    loader<option_t,Dim,data_t,T,backend_t>* l;
+    /// load meta data, the binary header holds the bundle index table
+    path_t path_file = path_root / path_t("map.bin");
+    std::unique_ptr<loader<option_t,Dim,data_t,T,backend_t>> l;
 
     if (cslibs_ndt::common::serialization::check_file_quiet(path_file)) {
-        YAML::Node n = YAML::LoadFile((path_root / path_file).string());
-        l = header<option_t,Dim,data_t,T,backend_t>::load(n);
+        l.reset(header<option_t,Dim,data_t,T,backend_t>::load(path_file));
     } else {
-        path_file = path_root / path_t("map.bin");
+        path_file = path_root / path_t("map.yaml");
         if (!cslibs_ndt::common::serialization::check_file_quiet(path_file)) {
-            std::cerr << "Both '" << (path_root / path_t("map_yaml")).string() << "'\n"
+            std::cerr << "Both '" << (path_root / path_t("map.bin")).string() << "'\n"
                       << "and  '" << path_file.string() << "'\n"
                       << "do not exist!" << std::endl;
             return false;
         }
-        l = header<option_t,Dim,data_t,T,backend_t>::load(path_file);
-        if (!l)
-            return false;
+        YAML::Node n = YAML::LoadFile(path_file.string());
+        l.reset(header<option_t,Dim,data_t,T,backend_t>::load(n));
     }
+    if (!l)
+        return false;
 
     std::array<std::thread, map_t::bin_count> threads;
     std::atomic_bool success(true);
@@ -128,8 +143,6 @@ inline static bool load(const std::string &path,
 
     l->allocateBundles(bundles, storages);
     l->createMap(bundles, storages, map);
-
-    delete l;
     return true;
 }
 };
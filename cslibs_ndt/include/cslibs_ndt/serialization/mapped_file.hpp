@@ -0,0 +1,107 @@
+#ifndef CSLIBS_NDT_SERIALIZATION_MAPPED_FILE_HPP
+#define CSLIBS_NDT_SERIALIZATION_MAPPED_FILE_HPP
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <memory>
+#include <string>
+
+namespace cslibs_ndt {
+namespace serialization {
+
+/**
+ * @brief Read-only memory mapping of a whole file, unmapped on destruction.
+ */
+class MappedFile
+{
+public:
+    using Ptr      = std::shared_ptr<MappedFile>;
+    using ConstPtr = std::shared_ptr<const MappedFile>;
+
+    inline ~MappedFile()
+    {
+        if (data_)
+            ::munmap(data_, size_);
+    }
+
+    MappedFile(const MappedFile &other) = delete;
+    MappedFile& operator = (const MappedFile &other) = delete;
+
+    /**
+     * @brief Map a file.
+     * @param path          file path
+     * @param sequential    advise sequential instead of random access
+     * @return the mapping or nullptr
+     */
+    static inline Ptr open(const std::string &path,
+                           const bool sequential = false)
+    {
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            std::cerr << "Could not open '" << path << "'" << std::endl;
+            return nullptr;
+        }
+
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || st.st_size <= 0) {
+            std::cerr << "Could not stat '" << path << "'" << std::endl;
+            ::close(fd);
+            return nullptr;
+        }
+
+        const std::size_t size = static_cast<std::size_t>(st.st_size);
+        void *data = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED) {
+            std::cerr << "Could not map '" << path << "'" << std::endl;
+            return nullptr;
+        }
+        ::madvise(data, size, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+
+        return Ptr(new MappedFile(data, size));
+    }
+
+    inline const char* data() const
+    {
+        return static_cast<const char*>(data_);
+    }
+
+    inline std::size_t size() const
+    {
+        return size_;
+    }
+
+    /**
+     * @brief Typed access to a range of the mapping.
+     * @param offset    byte offset, has to respect the alignment of type
+     * @param count     number of elements
+     * @return pointer to the first element or nullptr, if the range exceeds the file
+     */
+    template <typename type>
+    inline const type* as(const std::size_t offset,
+                          const std::size_t count = 1ul) const
+    {
+        if (offset > size_ || count > (size_ - offset) / sizeof(type))
+            return nullptr;
+        return reinterpret_cast<const type*>(data() + offset);
+    }
+
+private:
+    inline MappedFile(void *data, const std::size_t size) :
+        data_(data),
+        size_(size)
+    {
+    }
+
+    void        *data_;
+    std::size_t  size_;
+};
+
+}
+}
+
+#endif // CSLIBS_NDT_SERIALIZATION_MAPPED_FILE_HPP
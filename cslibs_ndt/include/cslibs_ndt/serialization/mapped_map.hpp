@@ -0,0 +1,289 @@
+#ifndef CSLIBS_NDT_SERIALIZATION_MAPPED_MAP_HPP
+#define CSLIBS_NDT_SERIALIZATION_MAPPED_MAP_HPP
+
+#include <cslibs_ndt/serialization/single_file.hpp>
+#include <cslibs_gridmaps/utility/inverse_model.hpp>
+
+namespace cslibs_ndt {
+namespace serialization {
+
+/**
+ * @brief Read-only map served directly from a memory mapped single file map.
+ *        Nothing is deserialized or allocated, pages are loaded by the operating system
+ *        on first access. Sampling is thread-safe and matches the sampling of the map the
+ *        file was written from.
+ */
+template <std::size_t Dim,
+          template <typename,std::size_t> class data_t,
+          typename T>
+class MappedMap
+{
+public:
+    using Ptr       = std::shared_ptr<MappedMap<Dim,data_t,T>>;
+    using ConstPtr  = std::shared_ptr<const MappedMap<Dim,data_t,T>>;
+
+    using pose_t    = typename map::traits<Dim,T>::pose_t;
+    using point_t   = typename map::traits<Dim,T>::point_t;
+    using index_t   = std::array<int,Dim>;
+    using entry_t   = file::bundle_entry<Dim>;
+    using record_t  = file::record<T,Dim>;
+    using ivm_t     = cslibs_gridmaps::utility::InverseModel<T>;
+
+    static constexpr std::size_t bin_count = utility::two_pow(Dim);
+    static constexpr T           div_count = 1.0 / static_cast<T>(bin_count);
+
+    /**
+     * @brief Map a file written by single_file<...>::save, static and dynamic maps are accepted.
+     *        Only the header is read, bundles and records are paged in on first access.
+     *        Files of static maps carry a block table, so that a lookup only touches the
+     *        bundle table and records of one block.
+     * @param path  file path
+     * @return the map or nullptr
+     */
+    static inline Ptr open(const std::string &path)
+    {
+        const MappedFile::Ptr mapped = MappedFile::open(path);
+        if (!mapped)
+            return nullptr;
+
+        file::header h;
+        if (!file::read_header(*mapped, h) ||
+                (h.option != static_cast<std::uint32_t>(map::tags::static_map) &&
+                 h.option != static_cast<std::uint32_t>(map::tags::dynamic_map)))
+            return nullptr;
+        if (!file::check(h, Dim, static_cast<map::tags::option>(h.option),
+                         file::data_type_id<data_t>::value, sizeof(T), sizeof(record_t)))
+            return nullptr;
+
+        Ptr map(new MappedMap(mapped, h));
+        map->entries_ = mapped->as<entry_t>(h.bundle_table_offset, h.bundle_count);
+        bool complete = map->entries_ || h.bundle_count == 0ul;
+        for (std::size_t i = 0 ; i < bin_count ; ++i) {
+            map->records_[i] = mapped->as<record_t>(h.record_offsets[i], h.record_counts[i]);
+            complete &= map->records_[i] || h.record_counts[i] == 0ul;
+        }
+        if (h.block_size > 0ul) {
+            map->blocks_ = mapped->as<file::block_entry>(h.block_table_offset, map->block_count_);
+            complete &= map->blocks_ != nullptr;
+            for (std::size_t b = 0 ; complete && b < map->block_count_ ; ++b)
+                complete &= map->blocks_[b].first + map->blocks_[b].count <= h.bundle_count;
+        }
+        if (!complete) {
+            std::cerr << "Map file '" << path << "' is truncated." << std::endl;
+            return nullptr;
+        }
+        return map;
+    }
+
+    inline T getResolution() const
+    {
+        return resolution_;
+    }
+
+    inline T getBundleResolution() const
+    {
+        return bundle_resolution_;
+    }
+
+    inline const pose_t& getInitialOrigin() const
+    {
+        return w_T_m_;
+    }
+
+    inline std::size_t getBundleCount() const
+    {
+        return bundle_count_;
+    }
+
+    inline std::size_t getByteSize() const
+    {
+        return mapped_->size();
+    }
+
+    /**
+     * @brief Number of blocks, 0 if the file has no block table.
+     */
+    inline std::size_t getBlockCount() const
+    {
+        return blocks_ ? block_count_ : 0ul;
+    }
+
+    /**
+     * @brief Bundle table entry of a bundle index, found by binary search within its block.
+     * @return the entry or nullptr
+     */
+    inline const entry_t* getBundle(const index_t &bi) const
+    {
+        const entry_t *begin = entries_;
+        const entry_t *end   = entries_ + bundle_count_;
+        if (blocks_) {
+            std::size_t b;
+            if (!file::to_block<Dim>(header_, bi, b))
+                return nullptr;
+            begin = entries_ + blocks_[b].first;
+            end   = begin + blocks_[b].count;
+        }
+
+        const entry_t *it = std::lower_bound(begin, end, bi, [](const entry_t &e, const index_t &i) {
+            return std::lexicographical_compare(e.index, e.index + Dim, i.begin(), i.end());
+        });
+        return it != end && std::equal(it->index, it->index + Dim, bi.begin()) ? it : nullptr;
+    }
+
+    /**
+     * @brief Ask the operating system to page in the bundles and records of the block
+     *        containing a point, e.g. ahead of a scan around a predicted pose.
+     */
+    inline void prefetch(const point_t &p) const
+    {
+        if (!blocks_)
+            return;
+
+        const point_t pm = m_T_w_ * p;
+        index_t bi;
+        for (std::size_t i = 0 ; i < Dim ; ++i)
+            bi[i] = static_cast<int>(std::floor(pm(i) * bundle_resolution_inv_));
+        std::size_t b;
+        if (!file::to_block<Dim>(header_, bi, b) || blocks_[b].count == 0ul)
+            return;
+
+        const entry_t *begin = entries_ + blocks_[b].first;
+        const entry_t *end   = begin + blocks_[b].count;
+        advise(begin, end);
+        for (std::size_t i = 0 ; i < bin_count ; ++i) {
+            /// records are mostly contiguous, distributions shared with earlier blocks are not
+            const record_t *first = nullptr;
+            const record_t *last  = nullptr;
+            for (const entry_t *e = begin ; e < end ; ++e) {
+                const record_t *r = getRecord(i, e->records[i]);
+                if (!r)
+                    continue;
+                if (first && r >= first && r <= last + 1) {
+                    last = std::max(last, r);
+                    continue;
+                }
+                if (first)
+                    advise(first, last + 1);
+                first = last = r;
+            }
+            if (first)
+                advise(first, last + 1);
+        }
+    }
+
+    inline const record_t* getRecord(const std::size_t bin,
+                                     const std::uint32_t position) const
+    {
+        return position != file::invalid && position < record_counts_[bin] ? records_[bin] + position : nullptr;
+    }
+
+    inline T sampleNonNormalized(const point_t &p) const
+    {
+        static_assert(file::data_type_id<data_t>::value == file::data_type::distribution,
+                      "Occupancy maps have to be sampled with an inverse sensor model.");
+        return sample(p, [](const record_t &) { return T(1.0); });
+    }
+
+    inline T sampleNonNormalized(const point_t &p,
+                                 const typename ivm_t::Ptr &ivm) const
+    {
+        static_assert(file::data_type_id<data_t>::value != file::data_type::distribution,
+                      "Distribution maps are sampled without an inverse sensor model.");
+        if (!ivm)
+            throw std::runtime_error("[MappedMap]: inverse model not set");
+
+        const T l_free     = ivm->getLogOddsFree();
+        const T l_occupied = ivm->getLogOddsOccupied();
+        const T l_prior    = ivm->getLogOddsPrior();
+        return sample(p, [l_free, l_occupied, l_prior](const record_t &r) {
+            return cslibs_math::common::LogOdds<T>::from(
+                        r.free * l_free + r.occupied * l_occupied - (r.free + r.occupied - 1) * l_prior);
+        });
+    }
+
+private:
+    using vector_t      = Eigen::Matrix<T,Dim,1>;
+    using matrix_t      = Eigen::Matrix<T,Dim,Dim>;
+
+    const MappedFile::Ptr                      mapped_;
+    const file::header                         header_;
+    const std::size_t                          bundle_count_;
+    const std::size_t                          block_count_;
+    const T                                    resolution_;
+    const T                                    bundle_resolution_;
+    const T                                    bundle_resolution_inv_;
+    pose_t                                     w_T_m_;
+    pose_t                                     m_T_w_;
+    const entry_t                             *entries_;
+    const file::block_entry                   *blocks_;
+    std::array<const record_t*, bin_count>     records_;
+    std::array<std::size_t, bin_count>         record_counts_;
+
+    inline MappedMap(const MappedFile::Ptr &mapped,
+                     const file::header &h) :
+        mapped_(mapped),
+        header_(h),
+        bundle_count_(static_cast<std::size_t>(h.bundle_count)),
+        block_count_(blocks(h)),
+        resolution_(static_cast<T>(h.resolution)),
+        bundle_resolution_(0.5 * resolution_),
+        bundle_resolution_inv_(1.0 / bundle_resolution_),
+        entries_(nullptr),
+        blocks_(nullptr)
+    {
+        file::decode(h.origin, w_T_m_);
+        m_T_w_ = w_T_m_.inverse();
+        for (std::size_t i = 0 ; i < bin_count ; ++i)
+            record_counts_[i] = static_cast<std::size_t>(h.record_counts[i]);
+    }
+
+    static inline std::size_t blocks(const file::header &h)
+    {
+        if (h.block_size == 0ul)
+            return 0ul;
+        std::size_t count = 1ul;
+        for (std::size_t i = 0 ; i < Dim ; ++i)
+            count *= static_cast<std::size_t>(h.block_counts[i]);
+        return count;
+    }
+
+    template <typename value_t>
+    inline void advise(const value_t *begin, const value_t *end) const
+    {
+        static const std::size_t page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+        const std::size_t first = reinterpret_cast<std::size_t>(begin) / page * page;
+        const std::size_t last  = reinterpret_cast<std::size_t>(end);
+        ::madvise(reinterpret_cast<void*>(first), last - first, MADV_WILLNEED);
+    }
+
+    template <typename occupancy_t>
+    inline T sample(const point_t &p,
+                    const occupancy_t &occupancy) const
+    {
+        const point_t pm = m_T_w_ * p;
+        index_t bi;
+        for (std::size_t i = 0 ; i < Dim ; ++i)
+            bi[i] = static_cast<int>(std::floor(pm(i) * bundle_resolution_inv_));
+
+        const entry_t *e = getBundle(bi);
+        if (!e)
+            return T();
+
+        T retval = T();
+        for (std::size_t i = 0 ; i < bin_count ; ++i) {
+            const record_t *r = getRecord(i, e->records[i]);
+            if (!r || !r->valid)
+                continue;
+
+            const vector_t q = pm.data() - Eigen::Map<const vector_t>(r->mean);
+            const T exponent = q.dot(Eigen::Map<const matrix_t>(r->information) * q);
+            retval += div_count * std::exp(-0.5 * exponent) * occupancy(*r);
+        }
+        return retval;
+    }
+};
+
+}
+}
+
+#endif // CSLIBS_NDT_SERIALIZATION_MAPPED_MAP_HPP
@@ -0,0 +1,439 @@
+#ifndef CSLIBS_NDT_SERIALIZATION_SINGLE_FILE_HPP
+#define CSLIBS_NDT_SERIALIZATION_SINGLE_FILE_HPP
+
+#include <cslibs_ndt/map/map.hpp>
+#include <cslibs_ndt/serialization/loader.hpp>
+#include <cslibs_ndt/serialization/mapped_file.hpp>
+#include <cslibs_ndt/serialization/storage.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+
+namespace cslibs_ndt {
+namespace serialization {
+/**
+ * Single file map format, all sections start at multiples of file::alignment:
+ *
+ *  header
+ *  bundle table    - bundle_entry per bundle, sorted lexicographically by bundle index
+ *  block table     - static maps only, block_entry per block of block_size^Dim bundles
+ *  records         - one flat record array per storage, referenced by the bundle table
+ *  stores          - one section per storage, byte-identical to the store_<i>.bin files
+ *
+ * The header, the bundle table and the records can be used in place from a read-only
+ * memory mapping (see MappedMap), the stores carry the full distributions to rebuild a map.
+ * With a block table, the bundle table is sorted by block first and the records follow the
+ * bundle table, so a lookup only touches the pages of a single block.
+ */
+namespace file {
+static constexpr char          magic[8]      = {'C','S','N','D','T','M','A','P'};
+static constexpr std::uint32_t version       = 2u;
+static constexpr std::size_t   alignment     = 64ul;
+static constexpr std::size_t   block_size    = 16ul;
+static constexpr std::size_t   max_bin_count = 8ul;
+static constexpr std::uint32_t invalid       = 0xFFFFFFFFu;
+
+enum class data_type : std::uint32_t { distribution = 0u, occupancy = 1u, weighted_occupancy = 2u };
+
+template <template <typename,std::size_t> class data_t>
+struct data_type_id {};
+template <>
+struct data_type_id<cslibs_ndt::Distribution>                  { static constexpr data_type value = data_type::distribution; };
+template <>
+struct data_type_id<cslibs_ndt::OccupancyDistribution>         { static constexpr data_type value = data_type::occupancy; };
+template <>
+struct data_type_id<cslibs_ndt::WeightedOccupancyDistribution> { static constexpr data_type value = data_type::weighted_occupancy; };
+
+struct header {
+    char          magic[8];
+    std::uint32_t version;
+    std::uint32_t dimension;
+    std::uint32_t option;
+    std::uint32_t data_type;
+    std::uint32_t scalar_size;
+    std::uint32_t bin_count;
+    std::uint64_t bundle_count;
+    std::uint64_t bundle_table_offset;
+    std::uint64_t record_size;
+    std::uint64_t record_counts[max_bin_count];
+    std::uint64_t record_offsets[max_bin_count];
+    std::uint64_t store_offsets[max_bin_count];
+    std::uint64_t store_sizes[max_bin_count];
+    double        origin[7];
+    double        resolution;
+    std::uint64_t size[3];
+    std::int32_t  min_index[3];
+    std::int32_t  max_index[3];
+    /// version 2
+    std::uint64_t block_size;
+    std::uint64_t block_table_offset;
+    std::uint64_t block_counts[3];
+};
+static_assert(std::is_standard_layout<header>::value, "file::header has to be standard layout.");
+
+/**
+ * @brief Range of the bundle table holding the bundles of one block.
+ */
+struct block_entry {
+    std::uint64_t first;
+    std::uint64_t count;
+};
+
+template <std::size_t Dim>
+struct bundle_entry {
+    std::int32_t  index[Dim];
+    std::uint32_t records[utility::two_pow(Dim)];   /// position in the record array of each storage or invalid
+
+    inline bool operator < (const bundle_entry &other) const
+    {
+        return std::lexicographical_compare(index, index + Dim, other.index, other.index + Dim);
+    }
+};
+
+/**
+ * @brief Everything needed to sample a distribution without reconstructing it.
+ */
+template <typename T, std::size_t Dim>
+struct record {
+    T             mean[Dim];
+    T             information[Dim * Dim];       /// column major
+    T             free;                         /// free count or weight, occupancy maps only
+    T             occupied;                     /// occupied count or weight, occupancy maps only
+    std::uint32_t valid;
+    std::uint32_t reserved;
+};
+
+template <typename T, std::size_t Dim, typename distribution_t>
+inline void to_record(const distribution_t &d, record<T,Dim> &r)
+{
+    r.valid = d.valid() ? 1u : 0u;
+    if (r.valid) {
+        const auto &mean = d.getMean();
+        const auto &information = d.getInformationMatrix();
+        for (std::size_t i = 0 ; i < Dim ; ++i) {
+            r.mean[i] = mean(i);
+            for (std::size_t j = 0 ; j < Dim ; ++j)
+                r.information[j * Dim + i] = information(i, j);
+        }
+    }
+}
+
+template <typename T, std::size_t Dim>
+inline record<T,Dim> to_record(const Distribution<T,Dim> &d)
+{
+    record<T,Dim> r;
+    std::memset(&r, 0, sizeof(r));
+    to_record(d, r);
+    return r;
+}
+
+template <typename T, std::size_t Dim>
+inline record<T,Dim> to_record(const OccupancyDistribution<T,Dim> &d)
+{
+    record<T,Dim> r;
+    std::memset(&r, 0, sizeof(r));
+    if (d.getDistribution())
+        to_record(*(d.getDistribution()), r);
+    r.free     = static_cast<T>(d.numFree());
+    r.occupied = static_cast<T>(d.numOccupied());
+    return r;
+}
+
+template <typename T, std::size_t Dim>
+inline record<T,Dim> to_record(const WeightedOccupancyDistribution<T,Dim> &d)
+{
+    record<T,Dim> r;
+    std::memset(&r, 0, sizeof(r));
+    if (d.getDistribution())
+        to_record(*(d.getDistribution()), r);
+    r.free     = d.weightFree();
+    r.occupied = d.weightOccupied();
+    return r;
+}
+
+inline std::size_t align(const std::size_t offset)
+{
+    return (offset + alignment - 1ul) / alignment * alignment;
+}
+
+inline void pad(std::ofstream &out)
+{
+    static const char zeros[alignment] = {};
+    const std::size_t position = static_cast<std::size_t>(out.tellp());
+    out.write(zeros, static_cast<std::streamsize>(align(position) - position));
+}
+
+/**
+ * @brief Copy the header of a mapped file, fields added after version 1 are zero for older files.
+ * @return false, if the file is too small
+ */
+inline bool read_header(const MappedFile &mapped, header &h)
+{
+    static constexpr std::size_t size_v1 = offsetof(header, block_size);
+    if (mapped.size() < size_v1)
+        return false;
+
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(&h, mapped.data(), size_v1);
+    if (h.version >= 2u && mapped.size() >= sizeof(h))
+        std::memcpy(&h, mapped.data(), sizeof(h));
+    return true;
+}
+
+/**
+ * @brief Block coordinates of a bundle index.
+ * @return false, if the bundle lies outside of the block grid
+ */
+template <std::size_t Dim>
+inline bool to_block(const header &h, const std::array<int,Dim> &bi, std::size_t &block)
+{
+    block = 0ul;
+    for (std::size_t i = Dim ; i > 0ul ; --i) {
+        const std::int64_t offset = static_cast<std::int64_t>(bi[i-1]) - h.min_index[i-1];
+        if (offset < 0 || static_cast<std::uint64_t>(offset) / h.block_size >= h.block_counts[i-1])
+            return false;
+        block = block * static_cast<std::size_t>(h.block_counts[i-1]) + static_cast<std::size_t>(offset) / h.block_size;
+    }
+    return true;
+}
+
+/**
+ * @brief Check that a file header matches the expected map type.
+ */
+inline bool check(const header &h,
+                  const std::size_t dimension,
+                  const map::tags::option option,
+                  const data_type type,
+                  const std::size_t scalar_size,
+                  const std::size_t record_size)
+{
+    if (std::memcmp(h.magic, magic, sizeof(magic)) != 0) {
+        std::cerr << "Not a map file." << std::endl;
+        return false;
+    }
+    if (h.version != 1u && h.version != version) {
+        std::cerr << "Unsupported map file version " << h.version << ", expected " << version << "." << std::endl;
+        return false;
+    }
+    if (h.dimension != dimension || h.option != static_cast<std::uint32_t>(option) ||
+            h.data_type != static_cast<std::uint32_t>(type) || h.scalar_size != scalar_size ||
+            h.record_size != record_size || h.bin_count != utility::two_pow(dimension)) {
+        std::cerr << "Map file does not match the requested map type." << std::endl;
+        return false;
+    }
+    return true;
+}
+}
+
+template <map::tags::option option_t,
+          std::size_t Dim,
+          template <typename,std::size_t> class data_t,
+          typename T,
+          template <typename, typename, typename...> class backend_t = map::tags::default_types<option_t>::template default_backend_t>
+struct single_file
+{
+    using map_t            = cslibs_ndt::map::Map<option_t,Dim,data_t,T,backend_t>;
+    using index_t          = typename map_t::index_t;
+    using pose_t           = typename map_t::pose_t;
+    using distribution_t   = typename map_t::distribution_t;
+    template <typename type>
+    using data_if          = typename map_t::template data_if<type>;
+    using binary_t         = cslibs_ndt::binary<data_if, data_t, T, Dim, Dim, backend_t>;
+    using storages_t       = typename map_t::distribution_storage_array_t;
+    using bundle_storage_t = typename map_t::distribution_bundle_storage_t;
+    using loader_t         = loader<option_t,Dim,data_t,T,backend_t>;
+    using entry_t          = file::bundle_entry<Dim>;
+    using record_t         = file::record<T,Dim>;
+
+    static_assert(map_t::bin_count <= file::max_bin_count, "Too many storages for the file format.");
+
+    static inline bool save(const map_t &map,
+                            const std::string &path)
+    {
+        BufferedOutputFile out(path);
+        if (!out.is_open()) {
+            std::cerr << "Could not open '" << path << "'" << std::endl;
+            return false;
+        }
+
+        file::header h;
+        std::memset(&h, 0, sizeof(h));
+        std::memcpy(h.magic, file::magic, sizeof(file::magic));
+        h.version     = file::version;
+        h.dimension   = static_cast<std::uint32_t>(Dim);
+        h.option      = static_cast<std::uint32_t>(option_t);
+        h.data_type   = static_cast<std::uint32_t>(file::data_type_id<data_t>::value);
+        h.scalar_size = static_cast<std::uint32_t>(sizeof(T));
+        h.bin_count   = static_cast<std::uint32_t>(map_t::bin_count);
+        h.record_size = sizeof(record_t);
+        h.resolution  = static_cast<double>(map.getResolution());
+        file::encode(map.getInitialOrigin(), h.origin);
+        for (std::size_t i = 0 ; i < Dim ; ++i) {
+            h.size[i]      = static_cast<std::uint64_t>(map.getSize()[i]);
+            h.min_index[i] = map.getMinBundleIndex()[i];
+            h.max_index[i] = map.getMaxBundleIndex()[i];
+        }
+        out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        file::pad(out);
+
+        std::vector<std::pair<const index_t, const typename map_t::distribution_bundle_t*>> bundles;
+        map.getBundles(bundles);
+
+        /// static maps are split into blocks, so that the bundles of a block are contiguous
+        std::vector<std::size_t> blocks(bundles.size(), 0ul);
+        std::size_t block_count = 1ul;
+        if (option_t == map::tags::static_map && !bundles.empty()) {
+            h.block_size = file::block_size;
+            for (std::size_t j = 0 ; j < Dim ; ++j) {
+                h.block_counts[j] = static_cast<std::uint64_t>(h.max_index[j] - h.min_index[j]) / h.block_size + 1ul;
+                block_count *= static_cast<std::size_t>(h.block_counts[j]);
+            }
+            for (std::size_t b = 0 ; b < bundles.size() && h.block_size > 0ul ; ++b) {
+                if (!file::to_block<Dim>(h, bundles[b].first, blocks[b])) {
+                    /// bundle outside of the index range, fall back to a plain bundle table
+                    std::fill(blocks.begin(), blocks.end(), 0ul);
+                    std::fill(h.block_counts, h.block_counts + 3, 0ul);
+                    h.block_size = 0ul;
+                    block_count  = 1ul;
+                }
+            }
+        }
+
+        std::vector<std::size_t> order(bundles.size());
+        for (std::size_t b = 0 ; b < order.size() ; ++b)
+            order[b] = b;
+        std::sort(order.begin(), order.end(), [&blocks, &bundles](const std::size_t a, const std::size_t b) {
+            return blocks[a] != blocks[b] ? blocks[a] < blocks[b] : bundles[a].first < bundles[b].first;
+        });
+
+        /// bundle table and flattened storages, records are stored in the order of the bundle table
+        std::array<std::vector<record_t>, map_t::bin_count> records;
+        std::array<std::unordered_map<const distribution_t*, std::uint32_t>, map_t::bin_count> positions;
+        std::vector<entry_t> entries(bundles.size());
+        std::vector<file::block_entry> block_table(h.block_size > 0ul ? block_count : 0ul, file::block_entry{0ul, 0ul});
+        for (std::size_t k = 0 ; k < order.size() ; ++k) {
+            const std::size_t b = order[k];
+            entry_t &e = entries[k];
+            for (std::size_t j = 0 ; j < Dim ; ++j)
+                e.index[j] = bundles[b].first[j];
+            for (std::size_t i = 0 ; i < map_t::bin_count ; ++i) {
+                const distribution_t *d = bundles[b].second->at(i);
+                e.records[i] = file::invalid;
+                if (!d)
+                    continue;
+                const auto it = positions[i].emplace(d, static_cast<std::uint32_t>(records[i].size()));
+                if (it.second)
+                    records[i].emplace_back(file::to_record(*d));
+                e.records[i] = it.first->second;
+            }
+            if (!block_table.empty()) {
+                file::block_entry &block = block_table[blocks[b]];
+                if (block.count == 0ul)
+                    block.first = k;
+                ++block.count;
+            }
+        }
+
+        h.bundle_count        = entries.size();
+        h.bundle_table_offset = static_cast<std::uint64_t>(out.tellp());
+        out.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(entry_t)));
+        file::pad(out);
+
+        if (!block_table.empty()) {
+            h.block_table_offset = static_cast<std::uint64_t>(out.tellp());
+            out.write(reinterpret_cast<const char*>(block_table.data()), static_cast<std::streamsize>(block_table.size() * sizeof(file::block_entry)));
+            file::pad(out);
+        }
+
+        for (std::size_t i = 0 ; i < map_t::bin_count ; ++i) {
+            h.record_counts[i]  = records[i].size();
+            h.record_offsets[i] = static_cast<std::uint64_t>(out.tellp());
+            out.write(reinterpret_cast<const char*>(records[i].data()), static_cast<std::streamsize>(records[i].size() * sizeof(record_t)));
+            file::pad(out);
+        }
+
+        /// full distributions
+        const storages_t &storages = map.getStorages();
+        for (std::size_t i = 0 ; i < map_t::bin_count ; ++i) {
+            h.store_offsets[i] = static_cast<std::uint64_t>(out.tellp());
+            binary_t::save(storages[i], out);
+            h.store_sizes[i]   = static_cast<std::uint64_t>(out.tellp()) - h.store_offsets[i];
+            file::pad(out);
+        }
+
+        out.seekp(0, std::ios::beg);
+        out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        return out.close();
+    }
+
+    static inline bool load(const std::string &path,
+                            typename map_t::Ptr &map)
+    {
+        /// the header and the bundle table are used in place
+        const MappedFile::Ptr mapped = MappedFile::open(path, true);
+        if (!mapped)
+            return false;
+
+        file::header header;
+        if (!file::read_header(*mapped, header) ||
+                !file::check(header, Dim, option_t, file::data_type_id<data_t>::value, sizeof(T), sizeof(record_t)))
+            return false;
+        const file::header *h = &header;
+
+        const entry_t *entries = mapped->as<entry_t>(h->bundle_table_offset, h->bundle_count);
+        if (!entries && h->bundle_count > 0ul) {
+            std::cerr << "Map file '" << path << "' is truncated." << std::endl;
+            return false;
+        }
+
+        std::vector<index_t> indices(h->bundle_count);
+        for (std::size_t b = 0 ; b < indices.size() ; ++b)
+            for (std::size_t j = 0 ; j < Dim ; ++j)
+                indices[b][j] = entries[b].index[j];
+
+        pose_t origin;
+        file::decode(h->origin, origin);
+        typename map_t::size_t size;
+        index_t min_index, max_index;
+        for (std::size_t j = 0 ; j < Dim ; ++j) {
+            size[j]      = static_cast<std::size_t>(h->size[j]);
+            min_index[j] = h->min_index[j];
+            max_index[j] = h->max_index[j];
+        }
+        const std::unique_ptr<loader_t> l(loader_t::create(origin, static_cast<T>(h->resolution), size, min_index, max_index, indices));
+
+        std::shared_ptr<bundle_storage_t> bundles(new bundle_storage_t);
+        storages_t storages;
+
+        std::array<std::thread, map_t::bin_count> threads;
+        std::atomic_bool success(true);
+        for (std::size_t i = 0 ; i < map_t::bin_count ; ++i) {
+            const std::size_t begin  = static_cast<std::size_t>(h->store_offsets[i]);
+            const std::size_t length = static_cast<std::size_t>(h->store_sizes[i]);
+            threads[i] = std::thread([&l, &storages, &path, i, begin, length, &success](){
+                success = l->load(i, path, storages[i], begin, length) && success;
+            });
+        }
+        for (std::size_t i = 0 ; i < map_t::bin_count ; ++i)
+            threads[i].join();
+
+        if (!success)
+            return false;
+
+        l->allocateBundles(bundles, storages);
+        l->createMap(bundles, storages, map);
+        return true;
+    }
+};
+
+}
+}
+
+#endif // CSLIBS_NDT_SERIALIZATION_SINGLE_FILE_HPP
@@ -9,6 +9,7 @@
 #include <cslibs_ndt/common/occupancy_distribution.hpp>
 #include <cslibs_ndt/common/weighted_occupancy_distribution.hpp>
 #include <cslibs_ndt/serialization/filesystem.hpp>
+#include <cslibs_ndt/serialization/buffered_io.hpp>
 
 #include <cslibs_math/serialization/array.hpp>
 #include <cslibs_math/serialization/distribution.hpp>
@@ -17,6 +18,7 @@
 #include <cslibs_math/serialization/stable_weighted_distribution.hpp>
 
 #include <fstream>
+#include <limits>
 #include <yaml-cpp/yaml.h>
 
 namespace cis = cslibs_indexed_storage;
@@ -101,19 +103,31 @@ struct binary {
     inline static bool save(const std::shared_ptr<storage_t> &storage,
                             const boost::filesystem::path &path)
     {
-        std::ofstream out(path.string(), std::ios::binary | std::ios::trunc);
+        serialization::BufferedOutputFile out(path.string());
         if (!out.is_open()) {
             std::cerr << "Could not open '" << path.string() << std::endl;
             return false;
         }
 
+        save(storage, out);
+        if (!out.close()) {
+            std::cerr << "Failed writing file '" << path.string() << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Append all entries of a storage to an open stream, the layout is the one of a store file.
+     */
+    inline static void save(const std::shared_ptr<storage_t> &storage,
+                            std::ofstream &out)
+    {
         auto write = [&out] (const index_t &index, const data_t &data) {
             cslibs_math::serialization::array::binary<int, Dim>::write(index, out);
             cslibs_ndt::write(data, out);
         };
         storage->traverse(write);
-        out.close();
-        return true;
     }
 
     inline static bool load(const boost::filesystem::path &path,
@@ -134,26 +148,56 @@ struct binary {
         return loadStorage(path, storage);
     }
 
+    /**
+     * @brief Load the entries stored in the byte range [begin, begin + length) of a file.
+     */
+    inline static bool load(const boost::filesystem::path &path,
+                            std::shared_ptr<storage_t> &storage,
+                            const std::size_t begin,
+                            const std::size_t length)
+    {
+        storage.reset(new storage_t);
+        return loadStorage(path, storage, begin, length);
+    }
+
+    inline static bool load(const boost::filesystem::path &path,
+                            std::shared_ptr<storage_t> &storage,
+                            const size_t &size,
+                            const index_t &offset,
+                            const std::size_t begin,
+                            const std::size_t length)
+    {
+        storage.reset(new storage_t);
+        storage->template set<cis::option::tags::array_size>(size);
+        storage->template set<cis::option::tags::array_offset>(offset);
+        return loadStorage(path, storage, begin, length);
+    }
+
 private:
     inline static bool loadStorage(const boost::filesystem::path &path,
-                                   std::shared_ptr<storage_t> &storage)
+                                   std::shared_ptr<storage_t> &storage,
+                                   const std::size_t begin  = 0ul,
+                                   const std::size_t length = std::numeric_limits<std::size_t>::max())
     {
-        std::ifstream in(path.string(), std::ios::binary);
+        /// records are decoded from large pread blocks instead of per field file accesses
+        serialization::BufferedInputFile in(path.string(), begin, length);
         if (!in.is_open()) {
             std::cerr << "Could not open '" << path.string() << std::endl;
             return false;
         }
 
         try {
-            in.seekg (0, std::ios::end);
-            const std::size_t size = in.tellg();
-            in.seekg (0, std::ios::beg);
+            const std::size_t size = in.size();
             std::size_t read = 0;
             while (read < size) {
                 index_t index;
                 data_t  data;
                 read += cslibs_math::serialization::array::binary<int, Dim>::read(in, index);
                 read += cslibs_ndt::read(in, data);
+                if (!in) {
+                    std::cerr << "File '" << path.string() << "' is truncated." << std::endl;
+                    return false;
+                }
                 storage->insert(index, data);
             }
         } catch (const std::exception &e) {
@@ -0,0 +1,543 @@
+#ifndef CSLIBS_NDT_SERIALIZATION_TILED_MAP_HPP
+#define CSLIBS_NDT_SERIALIZATION_TILED_MAP_HPP
+
+#include <cslibs_ndt/map/map.hpp>
+#include <cslibs_ndt/serialization/map.hpp>
+#include <cslibs_ndt/utility/parallel.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+
+namespace cslibs_ndt {
+namespace serialization {
+/**
+ * Tiled layout of dynamic maps, a directory containing
+ *
+ *  tiles.bin   - origin, resolution, tile size and the tile index: tile index, min and max bundle
+ *                index and bundle count of every tile
+ *  tile_<k>/   - tile k, a self-contained dynamic map as written by binary<dynamic_map,...>
+ *
+ * A tile covers tile_size^Dim bundles. Distributions shared by bundles of neighbouring tiles are
+ * stored in each of them, so every tile samples exactly like the original map.
+ */
+template <std::size_t Dim,
+          template <typename,std::size_t> class data_t,
+          typename T,
+          template <typename, typename, typename...> class backend_t = map::tags::default_types<map::tags::dynamic_map>::template default_backend_t>
+struct tiled
+{
+    using map_t          = cslibs_ndt::map::Map<map::tags::dynamic_map,Dim,data_t,T,backend_t>;
+    using index_t        = typename map_t::index_t;
+    using pose_t         = typename map_t::pose_t;
+    using bundle_t       = typename map_t::distribution_bundle_t;
+    using binary_t       = binary<map::tags::dynamic_map,Dim,data_t,T,backend_t>;
+    using path_t         = boost::filesystem::path;
+
+    struct tile_t {
+        index_t     index;
+        index_t     min_index;      /// bundle indices
+        index_t     max_index;
+        std::size_t bundle_count;
+    };
+    using tiles_t = std::vector<tile_t>;
+
+    static inline index_t toTileIndex(const index_t &bi,
+                                      const std::size_t tile_size)
+    {
+        const int s = static_cast<int>(tile_size);
+        index_t ti;
+        for (std::size_t i = 0 ; i < Dim ; ++i)
+            ti[i] = bi[i] >= 0 ? bi[i] / s : -((-bi[i] + s - 1) / s);
+        return ti;
+    }
+
+    static inline path_t tilePath(const path_t &root,
+                                  const std::size_t k)
+    {
+        return root / path_t("tile_" + std::to_string(k));
+    }
+
+    /**
+     * @brief Split a map into tiles and write them.
+     * @param map       dynamic map
+     * @param path      root directory
+     * @param tile_size number of bundles per tile edge
+     * @return true, if all tiles and the tile index were written
+     */
+    static inline bool save(const map_t &map,
+                            const std::string &path,
+                            const std::size_t tile_size = 32ul)
+    {
+        const path_t path_root(path);
+        if (tile_size == 0ul || !cslibs_ndt::common::serialization::create_directory(path_root))
+            return false;
+
+        std::vector<std::pair<const index_t, const bundle_t*>> bundles;
+        map.getBundles(bundles);
+        std::map<index_t, std::vector<std::pair<index_t, const bundle_t*>>> groups;
+        for (const auto &b : bundles)
+            groups[toTileIndex(b.first, tile_size)].emplace_back(b.first, b.second);
+
+        tiles_t tiles;
+        std::vector<const std::vector<std::pair<index_t, const bundle_t*>>*> contents;
+        for (const auto &g : groups) {
+            tile_t t;
+            t.index        = g.first;
+            t.min_index    = g.second.front().first;
+            t.max_index    = g.second.front().first;
+            t.bundle_count = g.second.size();
+            for (const auto &b : g.second) {
+                for (std::size_t i = 0 ; i < Dim ; ++i) {
+                    t.min_index[i] = std::min(t.min_index[i], b.first[i]);
+                    t.max_index[i] = std::max(t.max_index[i], b.first[i]);
+                }
+            }
+            tiles.emplace_back(t);
+            contents.emplace_back(&g.second);
+        }
+
+        /// every tile gets its own map carrying copies of the distributions of its bundles
+        std::atomic_bool success(true);
+        utility::parallel_for(0ul, tiles.size(), [&](const std::size_t k) {
+            map_t tile(map.getInitialOrigin(), map.getResolution());
+            for (const auto &b : *contents[k]) {
+                bundle_t *target = tile.getDistributionBundle(b.first);
+                for (std::size_t i = 0 ; i < map_t::bin_count ; ++i) {
+                    if (b.second->at(i))
+                        *(target->at(i)) = *(b.second->at(i));
+                }
+            }
+            if (!binary_t::save(tile, tilePath(path_root, k).string()))
+                success = false;
+        });
+
+        return success && saveIndex(path_root / path_t("tiles.bin"), map, tile_size, tiles);
+    }
+
+    static inline bool loadIndex(const std::string &path,
+                                 pose_t &origin,
+                                 T &resolution,
+                                 std::size_t &tile_size,
+                                 tiles_t &tiles)
+    {
+        const path_t path_file = path_t(path) / path_t("tiles.bin");
+        std::ifstream in(path_file.string(), std::ios::binary);
+        if (!in.is_open()) {
+            std::cerr << "Could not open '" << path_file.string() << std::endl;
+            return false;
+        }
+
+        try {
+            cslibs_math::serialization::transform::binary::read(in, origin);
+            resolution = cslibs_math::serialization::io<T>::read(in);
+            tile_size  = cslibs_math::serialization::io<std::size_t>::read(in);
+            const std::size_t count = cslibs_math::serialization::io<std::size_t>::read(in);
+            tiles.resize(count);
+            for (tile_t &t : tiles) {
+                cslibs_math::serialization::array::binary<int, Dim>::read(in, t.index);
+                cslibs_math::serialization::array::binary<int, Dim>::read(in, t.min_index);
+                cslibs_math::serialization::array::binary<int, Dim>::read(in, t.max_index);
+                t.bundle_count = cslibs_math::serialization::io<std::size_t>::read(in);
+            }
+        } catch (const std::exception &e) {
+            std::cerr << "Failed reading file '" << e.what() << std::endl;
+            return false;
+        }
+        return static_cast<bool>(in);
+    }
+
+    static inline bool loadTile(const std::string &path,
+                                const std::size_t k,
+                                typename map_t::Ptr &tile)
+    {
+        return binary_t::load(tilePath(path_t(path), k).string(), tile);
+    }
+
+    /**
+     * @brief Load all tiles into one map.
+     * @param path      root directory
+     * @param map       dynamic map
+     * @return true, if the tile index and all tiles were read
+     */
+    static inline bool load(const std::string &path,
+                            typename map_t::Ptr &map)
+    {
+        pose_t origin;
+        T resolution;
+        std::size_t tile_size;
+        tiles_t tiles;
+        if (!loadIndex(path, origin, resolution, tile_size, tiles))
+            return false;
+
+        typename map_t::Ptr result(new map_t(origin, resolution));
+        for (std::size_t k = 0 ; k < tiles.size() ; ++k) {
+            typename map_t::Ptr tile;
+            if (!loadTile(path, k, tile))
+                return false;
+            tile->traverse([&result](const index_t &bi, const bundle_t &b) {
+                bundle_t *target = result->getDistributionBundle(bi);
+                for (std::size_t i = 0 ; i < map_t::bin_count ; ++i) {
+                    if (b.at(i))
+                        *(target->at(i)) = *(b.at(i));
+                }
+            });
+        }
+        map = result;
+        return true;
+    }
+
+private:
+    static inline bool saveIndex(const path_t &path,
+                                 const map_t &map,
+                                 const std::size_t tile_size,
+                                 const tiles_t &tiles)
+    {
+        std::ofstream out(path.string(), std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            std::cerr << "Could not open '" << path.string() << std::endl;
+            return false;
+        }
+
+        cslibs_math::serialization::transform::binary::write(map.getInitialOrigin(), out);
+        cslibs_math::serialization::io<T>::write(map.getResolution(), out);
+        cslibs_math::serialization::io<std::size_t>::write(tile_size, out);
+        cslibs_math::serialization::io<std::size_t>::write(tiles.size(), out);
+        for (const tile_t &t : tiles) {
+            cslibs_math::serialization::array::binary<int, Dim>::write(t.index, out);
+            cslibs_math::serialization::array::binary<int, Dim>::write(t.min_index, out);
+            cslibs_math::serialization::array::binary<int, Dim>::write(t.max_index, out);
+            cslibs_math::serialization::io<std::size_t>::write(t.bundle_count, out);
+        }
+
+        out.close();
+        return static_cast<bool>(out);
+    }
+};
+
+/**
+ * @brief Dynamic map backed by a tiled map directory, only the tiles around regions of interest
+ *        are kept in memory. Tiles can be loaded synchronously or requested from a background
+ *        thread, which lets a robot stream the map while it moves.
+ *        Sampling is lock-free and may run concurrently to loading and eviction; positions
+ *        in tiles which are not loaded sample to zero.
+ */
+template <std::size_t Dim,
+          template <typename,std::size_t> class data_t,
+          typename T,
+          template <typename, typename, typename...> class backend_t = map::tags::default_types<map::tags::dynamic_map>::template default_backend_t>
+class TiledMap
+{
+public:
+    using Ptr          = std::shared_ptr<TiledMap<Dim,data_t,T,backend_t>>;
+    using ConstPtr     = std::shared_ptr<const TiledMap<Dim,data_t,T,backend_t>>;
+
+    using tiled_t      = tiled<Dim,data_t,T,backend_t>;
+    using map_t        = typename tiled_t::map_t;
+    using index_t      = typename map_t::index_t;
+    using pose_t       = typename map_t::pose_t;
+    using point_t      = typename map_t::point_t;
+    using tile_t       = typename tiled_t::tile_t;
+    using tile_map_t   = std::map<index_t, typename map_t::ConstPtr>;
+
+    inline ~TiledMap()
+    {
+        {
+            std::unique_lock<std::mutex> l(queue_mutex_);
+            stop_ = true;
+        }
+        queue_condition_.notify_all();
+        if (worker_.joinable())
+            worker_.join();
+    }
+
+    TiledMap(const TiledMap &other) = delete;
+    TiledMap& operator = (const TiledMap &other) = delete;
+
+    /**
+     * @brief Open a tiled map directory, only the tile index is read.
+     * @param path  root directory written by tiled<...>::save
+     * @return the map or nullptr
+     */
+    static inline Ptr open(const std::string &path)
+    {
+        pose_t origin;
+        T resolution;
+        std::size_t tile_size;
+        typename tiled_t::tiles_t tiles;
+        if (!tiled_t::loadIndex(path, origin, resolution, tile_size, tiles) || tile_size == 0ul)
+            return nullptr;
+
+        Ptr map(new TiledMap(path, origin, resolution, tile_size));
+        for (std::size_t k = 0 ; k < tiles.size() ; ++k)
+            map->tiles_.emplace(tiles[k].index, k);
+        TiledMap *m = map.get();
+        map->worker_ = std::thread([m]() { m->run(); });
+        return map;
+    }
+
+    inline T getResolution() const
+    {
+        return resolution_;
+    }
+
+    inline T getBundleResolution() const
+    {
+        return bundle_resolution_;
+    }
+
+    inline const pose_t& getInitialOrigin() const
+    {
+        return w_T_m_;
+    }
+
+    inline std::size_t getTileSize() const
+    {
+        return tile_size_;
+    }
+
+    inline std::size_t getTileCount() const
+    {
+        return tiles_.size();
+    }
+
+    inline std::size_t getLoadedTileCount() const
+    {
+        return std::atomic_load(&loaded_)->size();
+    }
+
+    /**
+     * @brief Snapshot of the loaded tiles, unaffected by later loading and eviction.
+     */
+    inline std::shared_ptr<const tile_map_t> getLoadedTiles() const
+    {
+        return std::atomic_load(&loaded_);
+    }
+
+    inline typename map_t::ConstPtr getTile(const index_t &tile_index) const
+    {
+        const std::shared_ptr<const tile_map_t> loaded = std::atomic_load(&loaded_);
+        const auto it = loaded->find(tile_index);
+        return it != loaded->end() ? it->second : nullptr;
+    }
+
+    /**
+     * @brief Load all missing tiles intersecting a region of interest and wait for them.
+     * @param center    center of the region in world coordinates
+     * @param radius    half extent of the region along the world axes
+     * @return number of loaded tiles intersecting the region
+     */
+    inline std::size_t load(const point_t &center,
+                            const T radius)
+    {
+        std::vector<index_t> missing;
+        std::size_t count = 0;
+        const std::shared_ptr<const tile_map_t> loaded = std::atomic_load(&loaded_);
+        forEachTile(center, radius, [&missing, &count, &loaded](const index_t &ti, const std::size_t) {
+            if (loaded->find(ti) == loaded->end())
+                missing.emplace_back(ti);
+            else
+                ++count;
+        });
+
+        std::atomic<std::size_t> success(0ul);
+        utility::parallel_for(0ul, missing.size(), [this, &missing, &success](const std::size_t i) {
+            if (loadTile(missing[i]))
+                ++success;
+        });
+        return count + success;
+    }
+
+    /**
+     * @brief Queue all missing tiles intersecting a region of interest for loading in the background,
+     *        the region is given like for load.
+     */
+    inline void request(const point_t &center,
+                        const T radius)
+    {
+        const std::shared_ptr<const tile_map_t> loaded = std::atomic_load(&loaded_);
+        bool queued = false;
+        {
+            std::unique_lock<std::mutex> l(queue_mutex_);
+            forEachTile(center, radius, [this, &loaded, &queued](const index_t &ti, const std::size_t) {
+                if (loaded->find(ti) == loaded->end() && pending_.insert(ti).second) {
+                    queue_.emplace_back(ti);
+                    queued = true;
+                }
+            });
+        }
+        if (queued)
+            queue_condition_.notify_one();
+    }
+
+    /**
+     * @brief Drop all loaded tiles not intersecting a region of interest.
+     */
+    inline void evict(const point_t &center,
+                      const T radius)
+    {
+        std::set<index_t> keep;
+        forEachTile(center, radius, [&keep](const index_t &ti, const std::size_t) {
+            keep.insert(ti);
+        });
+
+        std::unique_lock<std::mutex> l(publish_mutex_);
+        std::shared_ptr<tile_map_t> next(new tile_map_t);
+        for (const auto &t : *std::atomic_load(&loaded_)) {
+            if (keep.count(t.first) > 0ul)
+                next->emplace(t);
+        }
+        std::atomic_store(&loaded_, std::shared_ptr<const tile_map_t>(next));
+    }
+
+    /**
+     * @brief Stream the map around a moving position, tiles within load_radius are requested,
+     *        tiles beyond evict_radius are dropped. evict_radius > load_radius avoids thrashing.
+     */
+    inline void update(const point_t &center,
+                       const T load_radius,
+                       const T evict_radius)
+    {
+        evict(center, std::max(load_radius, evict_radius));
+        request(center, load_radius);
+    }
+
+    /**
+     * @brief Block until all requested tiles are loaded.
+     */
+    inline void wait()
+    {
+        std::unique_lock<std::mutex> l(queue_mutex_);
+        idle_condition_.wait(l, [this]() { return pending_.empty(); });
+    }
+
+    template <typename ... args_t>
+    inline T sampleNonNormalized(const point_t &p,
+                                 const args_t &... args) const
+    {
+        const point_t p_m = m_T_w_ * p;
+        index_t bi;
+        for (std::size_t i = 0 ; i < Dim ; ++i)
+            bi[i] = static_cast<int>(std::floor(p_m(i) * bundle_resolution_inv_));
+
+        const std::shared_ptr<const tile_map_t> loaded = std::atomic_load(&loaded_);
+        const auto it = loaded->find(tiled_t::toTileIndex(bi, tile_size_));
+        return it != loaded->end() ? it->second->sampleNonNormalized(p_m, bi, args...) : T();
+    }
+
+private:
+    const std::string                       path_;
+    const pose_t                            w_T_m_;
+    const pose_t                            m_T_w_;
+    const T                                 resolution_;
+    const T                                 bundle_resolution_;
+    const T                                 bundle_resolution_inv_;
+    const std::size_t                       tile_size_;
+    const T                                 tile_extent_;
+    std::map<index_t, std::size_t>          tiles_;
+
+    std::shared_ptr<const tile_map_t>       loaded_;
+    std::mutex                              publish_mutex_;
+
+    std::thread                             worker_;
+    std::mutex                              queue_mutex_;
+    std::condition_variable                 queue_condition_;
+    std::condition_variable                 idle_condition_;
+    std::deque<index_t>                     queue_;
+    std::set<index_t>                       pending_;
+    bool                                    stop_;
+
+    inline TiledMap(const std::string &path,
+                    const pose_t &origin,
+                    const T resolution,
+                    const std::size_t tile_size) :
+        path_(path),
+        w_T_m_(origin),
+        m_T_w_(origin.inverse()),
+        resolution_(resolution),
+        bundle_resolution_(0.5 * resolution),
+        bundle_resolution_inv_(1.0 / bundle_resolution_),
+        tile_size_(tile_size),
+        tile_extent_(static_cast<T>(tile_size) * bundle_resolution_),
+        loaded_(new tile_map_t),
+        stop_(false)
+    {
+    }
+
+    /**
+     * @brief Visit all tiles intersecting a region of interest. The region is a box aligned with
+     *        the world axes, the tiles are selected by its bounding box in map coordinates.
+     */
+    template <typename Fn>
+    inline void forEachTile(const point_t &center,
+                            const T radius,
+                            const Fn &function) const
+    {
+        using vector_t = Eigen::Matrix<T,Dim,1>;
+        const vector_t c = (m_T_w_ * center).data();
+        vector_t extent = vector_t::Zero();
+        for (std::size_t j = 0 ; j < Dim ; ++j) {
+            vector_t e = center.data();
+            e(j) += radius;
+            extent += ((m_T_w_ * point_t(e)).data() - c).cwiseAbs();
+        }
+
+        index_t lo, hi;
+        for (std::size_t i = 0 ; i < Dim ; ++i) {
+            lo[i] = static_cast<int>(std::floor((c(i) - extent(i)) / tile_extent_));
+            hi[i] = static_cast<int>(std::floor((c(i) + extent(i)) / tile_extent_));
+        }
+        for (const auto &t : tiles_) {
+            bool inside = true;
+            for (std::size_t i = 0 ; i < Dim ; ++i)
+                inside &= t.first[i] >= lo[i] && t.first[i] <= hi[i];
+            if (inside)
+                function(t.first, t.second);
+        }
+    }
+
+    inline bool loadTile(const index_t &ti)
+    {
+        const auto it = tiles_.find(ti);
+        typename map_t::Ptr tile;
+        if (it == tiles_.end() || !tiled_t::loadTile(path_, it->second, tile)) {
+            std::cerr << "[TiledMap]: Could not load tile " << (it != tiles_.end() ? it->second : tiles_.size()) << "." << std::endl;
+            return false;
+        }
+
+        std::unique_lock<std::mutex> l(publish_mutex_);
+        std::shared_ptr<tile_map_t> next(new tile_map_t(*std::atomic_load(&loaded_)));
+        (*next)[ti] = tile;
+        std::atomic_store(&loaded_, std::shared_ptr<const tile_map_t>(next));
+        return true;
+    }
+
+    inline void run()
+    {
+        std::unique_lock<std::mutex> l(queue_mutex_);
+        while (true) {
+            queue_condition_.wait(l, [this]() { return stop_ || !queue_.empty(); });
+            if (stop_)
+                return;
+
+            const index_t ti = queue_.front();
+            queue_.pop_front();
+            l.unlock();
+            loadTile(ti);
+            l.lock();
+
+            pending_.erase(ti);
+            if (pending_.empty())
+                idle_condition_.notify_all();
+        }
+    }
+};
+
+}
+}
+
+#endif // CSLIBS_NDT_SERIALIZATION_TILED_MAP_HPP
@@ -0,0 +1,47 @@
+#ifndef CSLIBS_NDT_UTILITY_BUNDLES_HPP
+#define CSLIBS_NDT_UTILITY_BUNDLES_HPP
+
+#include <cslibs_ndt/utility/binary_indices.hpp>
+#include <cslibs_ndt/utility/parallel.hpp>
+
+#include <memory>
+#include <vector>
+
+namespace cslibs_ndt {
+namespace utility {
+/**
+ * @brief Build the bundle storage of a map from filled distribution storages. The storage
+ *        lookups of all bundles are resolved in parallel, the bundle storage, which is not
+ *        thread-safe, is filled afterwards.
+ * @param indices       bundle indices
+ * @param bundles       bundle storage to fill
+ * @param storages      distribution storages
+ * @param num_threads   maximum number of threads
+ */
+template <typename map_t, std::size_t Dim>
+inline void allocate_bundles(const std::vector<typename map_t::index_t>                          &indices,
+                             const std::shared_ptr<typename map_t::distribution_bundle_storage_t> &bundles,
+                             const typename map_t::distribution_storage_array_t                 &storages,
+                             const std::size_t num_threads = default_thread_count())
+{
+    using bundle_t     = typename map_t::distribution_bundle_t;
+    using index_list_t = typename map_t::index_list_t;
+
+    /// small maps are not worth the threads
+    static constexpr std::size_t min_bundles_per_thread = 4096ul;
+
+    std::vector<bundle_t> resolved(indices.size());
+    parallel_for(0ul, indices.size(), [&indices, &storages, &resolved](const std::size_t j) {
+        const index_list_t bin_indices = generate_indices<index_list_t,Dim>(indices[j]);
+        bundle_t &b = resolved[j];
+        for (std::size_t i = 0 ; i < map_t::bin_count ; ++i)
+            b[i] = storages[i]->get(bin_indices[i]);
+    }, std::min(num_threads, indices.size() / min_bundles_per_thread + 1ul));
+
+    for (std::size_t j = 0 ; j < indices.size() ; ++j)
+        bundles->insert(indices[j], resolved[j]);
+}
+}
+}
+
+#endif // CSLIBS_NDT_UTILITY_BUNDLES_HPP
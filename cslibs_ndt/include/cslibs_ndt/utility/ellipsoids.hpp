@@ -0,0 +1,169 @@
+#ifndef CSLIBS_NDT_UTILITY_ELLIPSOIDS_HPP
+#define CSLIBS_NDT_UTILITY_ELLIPSOIDS_HPP
+
+#include <cslibs_ndt/map/traits.hpp>
+#include <cslibs_ndt/utility/parallel.hpp>
+#include <cslibs_ndt/utility/symmetric_eigen.hpp>
+
+#include <cslibs_math/statistics/stable_distribution.hpp>
+
+#include <Eigen/Core>
+#include <Eigen/StdVector>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace cslibs_ndt {
+namespace utility {
+/**
+ * @brief 1-sigma ellipsoids of the selected distributions of a map in a target frame, shared by
+ *        the compact 2D and 3D marker exports. collect() walks the storages twice, counting the
+ *        visible distributions per storage and then filling preallocated arrays in parallel, and
+ *        decomposes all covariances in one batch. forEachVertex() places a unit mesh on every
+ *        ellipsoid, with a finer mesh for those near the viewpoint.
+ */
+template <typename T, std::size_t Dim>
+class Ellipsoids
+{
+public:
+    using vector_t   = Eigen::Matrix<T,Dim,1>;
+    using matrix_t   = Eigen::Matrix<T,Dim,Dim>;
+    using gaussian_t = cslibs_math::statistics::StableDistribution<T,Dim,3>;
+
+    /**
+     * @brief Collect the selected distributions within the maximum distance of the viewpoint.
+     * @param src               map
+     * @param origin            transform from the map to the target frame
+     * @param select            returns the Gaussian of a distribution and sets its alpha, or nullptr to skip it
+     * @param viewpoint         viewpoint in the target frame
+     * @param near_distance     distance up to which the fine mesh is used
+     * @param maximum_distance  distance up to which distributions are visible
+     */
+    template <typename map_t, typename transform_t, typename select_t>
+    inline void collect(const map_t &src,
+                        const transform_t &origin,
+                        const select_t &select,
+                        const vector_t &viewpoint,
+                        const T near_distance,
+                        const T maximum_distance)
+    {
+        using index_t        = typename map_t::index_t;
+        using distribution_t = typename map_t::distribution_t;
+        using point_t        = typename cslibs_ndt::map::traits<Dim,T>::point_t;
+
+        const vector_t translation = (origin * point_t(vector_t::Zero().eval())).data();
+        matrix_t rotation;
+        for (std::size_t d = 0 ; d < Dim ; ++ d) {
+            vector_t e = vector_t::Zero();
+            e(d) = static_cast<T>(1);
+            rotation.col(d) = (origin * point_t(e)).data() - translation;
+        }
+
+        auto visible = [&rotation, &translation, &viewpoint, maximum_distance](const gaussian_t &g, vector_t &p, T &distance) {
+            p        = rotation * g.getMean() + translation;
+            distance = (p - viewpoint).norm();
+            return distance <= maximum_distance;
+        };
+
+        const auto &storages = src.getStorages();
+        const std::size_t n = storages.size();
+        std::vector<std::size_t> offsets(n + 1, 0ul);
+        parallel_for(0ul, n, [&storages, &select, &visible, &offsets](const std::size_t i) {
+            storages[i]->traverse([&select, &visible, &offsets, i](const index_t &, const distribution_t &d) {
+                T alpha;
+                T distance;
+                vector_t p;
+                const gaussian_t *g = select(d, alpha);
+                if (g && visible(*g, p, distance))
+                    ++ offsets[i + 1];
+            });
+        }, n);
+        for (std::size_t i = 0 ; i < n ; ++ i)
+            offsets[i + 1] += offsets[i];
+
+        const std::size_t count = offsets[n];
+        batch_.resize(count);
+        means_.resize(count);
+        alphas_.resize(count);
+        near_.resize(count);
+        parallel_for(0ul, n, [&](const std::size_t i) {
+            std::size_t k = offsets[i];
+            storages[i]->traverse([&](const index_t &, const distribution_t &d) {
+                T alpha;
+                T distance;
+                vector_t p;
+                const gaussian_t *g = select(d, alpha);
+                if (!g || !visible(*g, p, distance))
+                    return;
+                batch_.set(k, rotation * g->getCovariance() * rotation.transpose());
+                means_[k]  = p;
+                alphas_[k] = alpha;
+                near_[k]   = distance <= near_distance;
+                ++ k;
+            });
+        }, n);
+        batch_.compute();
+    }
+
+    inline std::size_t size() const
+    {
+        return means_.size();
+    }
+
+    inline const vector_t &mean(const std::size_t k) const
+    {
+        return means_[k];
+    }
+
+    inline T alpha(const std::size_t k) const
+    {
+        return alphas_[k];
+    }
+
+    /**
+     * @brief Number of vertices of all ellipsoids, which are numbered consecutively.
+     */
+    template <typename mesh_t>
+    inline std::size_t vertices(const mesh_t &fine,
+                                const mesh_t &coarse)
+    {
+        vertices_.assign(size() + 1, 0ul);
+        for (std::size_t k = 0 ; k < size() ; ++ k)
+            vertices_[k + 1] = vertices_[k] + (near_[k] ? fine.size() : coarse.size());
+        return vertices_.back();
+    }
+
+    /**
+     * @brief Call function(k, i, v) in parallel for vertex i at v of ellipsoid k, vertices() has
+     *        to be called with the same meshes first.
+     */
+    template <typename mesh_t, typename Fn>
+    inline void forEachVertex(const mesh_t &fine,
+                              const mesh_t &coarse,
+                              const Fn &function) const
+    {
+        parallel_for(0ul, size(), [&](const std::size_t k) {
+            const vector_t eval = batch_.values(k);
+            matrix_t axes = batch_.vectors(k);
+            for (std::size_t j = 0 ; j < Dim ; ++ j)
+                axes.col(j) *= std::max(static_cast<T>(5e-5), std::sqrt(std::max(T(0.), eval(j))));
+
+            const mesh_t &mesh = near_[k] ? fine : coarse;
+            for (std::size_t j = 0 ; j < mesh.size() ; ++ j)
+                function(k, vertices_[k] + j, (means_[k] + axes * mesh[j]).eval());
+        });
+    }
+
+private:
+    SymmetricEigenBatch<T,Dim>                                  batch_;
+    std::vector<vector_t, Eigen::aligned_allocator<vector_t>>   means_;
+    std::vector<T>                                              alphas_;
+    std::vector<uint8_t>                                        near_;
+    std::vector<std::size_t>                                    vertices_;
+};
+}
+}
+
+#endif // CSLIBS_NDT_UTILITY_ELLIPSOIDS_HPP
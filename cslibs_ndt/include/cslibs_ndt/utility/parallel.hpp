@@ -0,0 +1,86 @@
+#ifndef CSLIBS_NDT_UTILITY_PARALLEL_HPP
+#define CSLIBS_NDT_UTILITY_PARALLEL_HPP
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace cslibs_ndt {
+namespace utility {
+
+/**
+ * @brief Number of worker threads used if nothing else is specified.
+ * @return hardware concurrency, at least one
+ */
+static inline std::size_t default_thread_count()
+{
+    const std::size_t n = std::thread::hardware_concurrency();
+    return n > 0ul ? n : 1ul;
+}
+
+/**
+ * @brief Split [begin, end) into contiguous chunks, one per thread, and call
+ *        function(thread, first, last) for each of them.
+ *        The calling thread processes the first chunk itself.
+ * @param begin         first element
+ * @param end           one past the last element
+ * @param function      chunk function
+ * @param num_threads   maximum number of threads
+ */
+template <typename Fn>
+static inline void parallel_for_chunks(const std::size_t begin,
+                                       const std::size_t end,
+                                       const Fn         &function,
+                                       std::size_t       num_threads = default_thread_count())
+{
+    if (end <= begin)
+        return;
+
+    const std::size_t count = end - begin;
+    num_threads = std::max(1ul, std::min(num_threads, count));
+    if (num_threads == 1ul) {
+        function(0ul, begin, end);
+        return;
+    }
+
+    const std::size_t chunk = (count + num_threads - 1ul) / num_threads;
+    std::vector<std::thread> threads;
+    threads.reserve(num_threads - 1ul);
+    for (std::size_t t = 1ul ; t < num_threads ; ++t) {
+        const std::size_t first = begin + t * chunk;
+        const std::size_t last  = std::min(end, first + chunk);
+        if (first >= last)
+            break;
+        threads.emplace_back([&function, t, first, last]() {
+            function(t, first, last);
+        });
+    }
+    function(0ul, begin, std::min(end, begin + chunk));
+
+    for (auto &thread : threads)
+        thread.join();
+}
+
+/**
+ * @brief Call function(i) for every i in [begin, end) using up to num_threads threads.
+ * @param begin         first element
+ * @param end           one past the last element
+ * @param function      element function
+ * @param num_threads   maximum number of threads
+ */
+template <typename Fn>
+static inline void parallel_for(const std::size_t begin,
+                                const std::size_t end,
+                                const Fn         &function,
+                                const std::size_t num_threads = default_thread_count())
+{
+    parallel_for_chunks(begin, end, [&function](const std::size_t, const std::size_t first, const std::size_t last) {
+        for (std::size_t i = first ; i < last ; ++i)
+            function(i);
+    }, num_threads);
+}
+
+}
+}
+
+#endif // CSLIBS_NDT_UTILITY_PARALLEL_HPP
@@ -0,0 +1,235 @@
+#ifndef CSLIBS_NDT_UTILITY_SYMMETRIC_EIGEN_HPP
+#define CSLIBS_NDT_UTILITY_SYMMETRIC_EIGEN_HPP
+
+#include <cslibs_ndt/utility/parallel.hpp>
+
+#include <Eigen/Core>
+
+#include <array>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+namespace cslibs_ndt {
+namespace utility {
+/**
+ * @brief Closed-form eigendecomposition of many symmetric 2x2 or 3x3 matrices at once, e.g. the
+ *        covariances of a map for visualisation. The upper triangles are stored as structure of
+ *        arrays and decomposed in branch-free loops over blocks, which run in parallel.
+ *        Eigenvalues are ascending, eigenvectors are the columns of a rotation matrix.
+ *        For nearly repeated eigenvalues the eigenvectors are less accurate than those of the
+ *        iterative solver used by the distributions.
+ */
+template <typename T, std::size_t Dim>
+class SymmetricEigenBatch
+{
+public:
+    static_assert(Dim == 2 || Dim == 3, "Only 2x2 and 3x3 matrices are supported.");
+
+    static constexpr std::size_t entries = Dim * (Dim + 1) / 2;
+    static constexpr std::size_t block   = 1024;
+
+    using matrix_t = Eigen::Matrix<T,Dim,Dim>;
+    using values_t = Eigen::Matrix<T,Dim,1>;
+
+    inline std::size_t size() const
+    {
+        return a_[0].size();
+    }
+
+    inline void resize(const std::size_t size)
+    {
+        for (auto &a : a_)
+            a.resize(size);
+    }
+
+    /**
+     * @brief Set the upper triangle of matrix i, different matrices can be set concurrently.
+     */
+    inline void set(const std::size_t i,
+                    const matrix_t &m)
+    {
+        std::size_t k = 0;
+        for (std::size_t r = 0 ; r < Dim ; ++ r) {
+            for (std::size_t c = r ; c < Dim ; ++ c)
+                a_[k++][i] = m(r,c);
+        }
+    }
+
+    inline void push_back(const matrix_t &m)
+    {
+        resize(size() + 1);
+        set(size() - 1, m);
+    }
+
+    inline void compute(const std::size_t num_threads = default_thread_count())
+    {
+        const std::size_t n = size();
+        for (auto &l : l_)
+            l.resize(n);
+        for (auto &v : v_)
+            v.resize(n);
+
+        const std::size_t blocks = (n + block - 1) / block;
+        parallel_for(0ul, blocks, [this, n](const std::size_t b) {
+            decompose(b * block, std::min(n, (b + 1) * block), std::integral_constant<std::size_t,Dim>());
+        }, num_threads);
+    }
+
+    inline values_t values(const std::size_t i) const
+    {
+        values_t l;
+        for (std::size_t k = 0 ; k < Dim ; ++ k)
+            l(k) = l_[k][i];
+        return l;
+    }
+
+    inline matrix_t vectors(const std::size_t i) const
+    {
+        matrix_t v;
+        for (std::size_t c = 0 ; c < Dim ; ++ c) {
+            for (std::size_t r = 0 ; r < Dim ; ++ r)
+                v(r,c) = v_[c * Dim + r][i];
+        }
+        return v;
+    }
+
+private:
+    std::array<std::vector<T>, entries>     a_;     /// upper triangle, row major
+    std::array<std::vector<T>, Dim>         l_;     /// eigenvalues
+    std::array<std::vector<T>, Dim * Dim>   v_;     /// eigenvectors, column major
+
+    inline void decompose(const std::size_t begin,
+                          const std::size_t end,
+                          std::integral_constant<std::size_t,2>)
+    {
+        const T *a00 = a_[0].data(), *a01 = a_[1].data(), *a11 = a_[2].data();
+        T *l0 = l_[0].data(), *l1 = l_[1].data();
+        T *v00 = v_[0].data(), *v10 = v_[1].data(), *v01 = v_[2].data(), *v11 = v_[3].data();
+        for (std::size_t i = begin ; i < end ; ++ i) {
+            const T t = T(0.5) * (a00[i] + a11[i]);
+            const T h = T(0.5) * (a00[i] - a11[i]);
+            const T d = std::sqrt(h * h + a01[i] * a01[i]);
+            l0[i] = t - d;
+            l1[i] = t + d;
+
+            /// eigenvector of the larger eigenvalue at angle theta
+            const T theta = T(0.5) * std::atan2(a01[i], h);
+            const T c = std::cos(theta);
+            const T s = std::sin(theta);
+            v00[i] =  s;
+            v10[i] = -c;
+            v01[i] =  c;
+            v11[i] =  s;
+        }
+    }
+
+    inline void decompose(const std::size_t begin,
+                          const std::size_t end,
+                          std::integral_constant<std::size_t,3>)
+    {
+        const T pi_2_3 = static_cast<T>(2.0 * M_PI / 3.0);
+        for (std::size_t i = begin ; i < end ; ++ i) {
+            const T a00 = a_[0][i], a01 = a_[1][i], a02 = a_[2][i];
+            const T a11 = a_[3][i], a12 = a_[4][i], a22 = a_[5][i];
+
+            /// trigonometric solution of the characteristic polynomial
+            const T q  = (a00 + a11 + a22) / T(3);
+            const T d0 = a00 - q;
+            const T d1 = a11 - q;
+            const T d2 = a22 - q;
+            const T p1 = a01 * a01 + a02 * a02 + a12 * a12;
+            const T p  = std::sqrt((d0 * d0 + d1 * d1 + d2 * d2 + T(2) * p1) / T(6));
+            const T ip = T(1) / std::max(p, std::numeric_limits<T>::min());
+            const T b00 = d0 * ip, b11 = d1 * ip, b22 = d2 * ip;
+            const T b01 = a01 * ip, b02 = a02 * ip, b12 = a12 * ip;
+            const T r   = T(0.5) * (b00 * (b11 * b22 - b12 * b12) -
+                                    b01 * (b01 * b22 - b12 * b02) +
+                                    b02 * (b01 * b12 - b11 * b02));
+            const T phi = std::acos(std::min(T(1), std::max(T(-1), r))) / T(3);
+            const T l2  = q + T(2) * p * std::cos(phi);
+            const T l0  = q + T(2) * p * std::cos(phi + pi_2_3);
+            const T l1  = T(3) * q - l0 - l2;
+
+            /// the eigenvector of the better separated extreme eigenvalue first
+            const T scale = std::max(std::max(std::max(std::abs(a00), std::abs(a11)), std::max(std::abs(a22), std::abs(a01))),
+                                     std::max(std::abs(a02), std::abs(a12)));
+            const T eps   = std::numeric_limits<T>::epsilon() * T(64) * scale * scale;
+            const bool upper = l2 - l1 >= l1 - l0;
+
+            T u[3];
+            T nu = nullspace(a00, a01, a02, a11, a12, a22, upper ? l2 : l0, u);
+            const bool valid_u = nu > eps;
+            u[0] = valid_u ? u[0] / nu : T(0);
+            u[1] = valid_u ? u[1] / nu : T(0);
+            u[2] = valid_u ? u[2] / nu : T(1);
+
+            /// the other extreme, orthogonal to the first, any orthogonal vector if repeated
+            T w[3];
+            nullspace(a00, a01, a02, a11, a12, a22, upper ? l0 : l2, w);
+            const T uw = u[0] * w[0] + u[1] * w[1] + u[2] * w[2];
+            w[0] -= uw * u[0];
+            w[1] -= uw * u[1];
+            w[2] -= uw * u[2];
+            T nw = std::sqrt(w[0] * w[0] + w[1] * w[1] + w[2] * w[2]);
+            const bool valid_w = nw > eps;
+            const bool x_major = std::abs(u[0]) > std::abs(u[2]);
+            const T o[3] = {x_major ? -u[1] : T(0), x_major ? u[0] : -u[2], x_major ? T(0) : u[1]};
+            const T no = std::sqrt(o[0] * o[0] + o[1] * o[1] + o[2] * o[2]);
+            nw = valid_w ? nw : no;
+            w[0] = (valid_w ? w[0] : o[0]) / nw;
+            w[1] = (valid_w ? w[1] : o[1]) / nw;
+            w[2] = (valid_w ? w[2] : o[2]) / nw;
+
+            const T *e0 = upper ? w : u;
+            const T *e2 = upper ? u : w;
+            l_[0][i] = l0;
+            l_[1][i] = l1;
+            l_[2][i] = l2;
+            v_[0][i] = e0[0];
+            v_[1][i] = e0[1];
+            v_[2][i] = e0[2];
+            v_[3][i] = e2[1] * e0[2] - e2[2] * e0[1];
+            v_[4][i] = e2[2] * e0[0] - e2[0] * e0[2];
+            v_[5][i] = e2[0] * e0[1] - e2[1] * e0[0];
+            v_[6][i] = e2[0];
+            v_[7][i] = e2[1];
+            v_[8][i] = e2[2];
+        }
+    }
+
+    /**
+     * @brief Largest cross product of two rows of A - lI, orthogonal to the rows if l is an
+     *        eigenvalue of A.
+     * @return length of the cross product
+     */
+    static inline T nullspace(const T a00, const T a01, const T a02,
+                              const T a11, const T a12, const T a22,
+                              const T l, T *v)
+    {
+        const T r0[3] = {a00 - l, a01, a02};
+        const T r1[3] = {a01, a11 - l, a12};
+        const T r2[3] = {a02, a12, a22 - l};
+        const T c01[3] = {r0[1] * r1[2] - r0[2] * r1[1], r0[2] * r1[0] - r0[0] * r1[2], r0[0] * r1[1] - r0[1] * r1[0]};
+        const T c02[3] = {r0[1] * r2[2] - r0[2] * r2[1], r0[2] * r2[0] - r0[0] * r2[2], r0[0] * r2[1] - r0[1] * r2[0]};
+        const T c12[3] = {r1[1] * r2[2] - r1[2] * r2[1], r1[2] * r2[0] - r1[0] * r2[2], r1[0] * r2[1] - r1[1] * r2[0]};
+        const T n01 = c01[0] * c01[0] + c01[1] * c01[1] + c01[2] * c01[2];
+        const T n02 = c02[0] * c02[0] + c02[1] * c02[1] + c02[2] * c02[2];
+        const T n12 = c12[0] * c12[0] + c12[1] * c12[1] + c12[2] * c12[2];
+        const T *c = n01 >= n02 ? (n01 >= n12 ? c01 : c12) : (n02 >= n12 ? c02 : c12);
+        v[0] = c[0];
+        v[1] = c[1];
+        v[2] = c[2];
+        return std::sqrt(std::max(std::max(n01, n02), n12));
+    }
+};
+
+template <typename T, std::size_t Dim>
+constexpr std::size_t SymmetricEigenBatch<T,Dim>::entries;
+template <typename T, std::size_t Dim>
+constexpr std::size_t SymmetricEigenBatch<T,Dim>::block;
+}
+}
+
+#endif // CSLIBS_NDT_UTILITY_SYMMETRIC_EIGEN_HPP
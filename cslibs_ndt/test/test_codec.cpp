@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+
+#include <cslibs_ndt/serialization/codec.hpp>
+#include <cslibs_math/random/random.hpp>
+
+const std::size_t NUM_SAMPLES = 1000;
+using rng_t = cslibs_math::random::Uniform<double,1>;
+
+namespace codec = cslibs_ndt::serialization::codec;
+
+TEST(Test_cslibs_ndt, testCodecVarint)
+{
+    rng_t rng(-1e9, +1e9);
+    std::string buffer;
+    std::vector<std::int64_t> values;
+    for (std::size_t i=0; i<NUM_SAMPLES; ++i) {
+        values.emplace_back(static_cast<std::int64_t>(rng.get()));
+        codec::put_varint(buffer, codec::zigzag(values.back()));
+    }
+
+    const char *p = buffer.data();
+    for (const std::int64_t v : values) {
+        std::uint64_t e;
+        EXPECT_TRUE(codec::get_varint(p, buffer.data() + buffer.size(), e));
+        EXPECT_EQ(v, codec::unzigzag(e));
+    }
+    EXPECT_EQ(p, buffer.data() + buffer.size());
+}
+
+TEST(Test_cslibs_ndt, testCodecMorton)
+{
+    rng_t rng(0.0, 1e6);
+    for (std::size_t i=0; i<NUM_SAMPLES; ++i) {
+        const std::array<std::uint64_t,3> c = {{
+            static_cast<std::uint64_t>(rng.get()),
+            static_cast<std::uint64_t>(rng.get()),
+            static_cast<std::uint64_t>(rng.get())
+        }};
+        EXPECT_EQ(c, codec::morton<3>::decode(codec::morton<3>::encode(c)));
+    }
+}
+
+TEST(Test_cslibs_ndt, testCodecLZ)
+{
+    rng_t rng(0.0, 16.0);
+    std::string block, raw;
+    for (std::size_t i=0; i<NUM_SAMPLES; ++i)
+        block.push_back(static_cast<char>(rng.get()));
+    for (std::size_t i=0; i<100; ++i)
+        raw += block;
+
+    std::string shuffled(raw.size(), '\0'), unshuffled(raw.size(), '\0');
+    codec::shuffle(raw.data(), raw.size() / 8ul, 8ul, &shuffled[0]);
+    codec::unshuffle(shuffled.data(), raw.size() / 8ul, 8ul, &unshuffled[0]);
+    EXPECT_EQ(raw, unshuffled);
+
+    std::string compressed, decompressed;
+    EXPECT_TRUE(codec::compress(codec::type::lz, raw, compressed));
+    EXPECT_LT(compressed.size(), raw.size());
+    EXPECT_TRUE(codec::decompress(codec::type::lz, compressed.data(), compressed.size(), raw.size(), decompressed));
+    EXPECT_EQ(raw, decompressed);
+
+    // corrupt input has to be rejected
+    EXPECT_FALSE(codec::decompress(codec::type::lz, compressed.data(), compressed.size() / 2ul, raw.size(), decompressed));
+}
+
+int main(int argc, char *argv[])
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -2,11 +2,13 @@
 #define CSLIBS_NDT_2D_CONVERSION_DISTANCE_GRIDMAP_HPP
 
 #include <cslibs_ndt/map/map.hpp>
+#include <cslibs_ndt_2d/conversion/rasterize.hpp>
 
 #include <cslibs_ndt_2d/dynamic_maps/gridmap.hpp>
 #include <cslibs_ndt_2d/dynamic_maps/occupancy_gridmap.hpp>
 
 #include <cslibs_gridmaps/static_maps/distance_gridmap.h>
+#include <cslibs_gridmaps/static_maps/probability_gridmap.h>
 #include <cslibs_gridmaps/static_maps/algorithms/distance_transform.hpp>
 
 namespace cslibs_ndt_2d {
@@ -34,33 +36,8 @@ inline void from(
                             std::ceil(src.getWidth()  / sampling_resolution)));
     std::fill(dst->getData().begin(), dst->getData().end(), T(0.0));
 
-    const T bundle_resolution = src.getBundleResolution();
-    const int chunk_step = static_cast<int>(bundle_resolution / sampling_resolution);
-
-    using index_t = std::array<int, 2>;
-    const index_t min_bi = src.getMinBundleIndex();
-
-    const auto& origin = src.getInitialOrigin();
-    src.traverse([&src, &dst, &origin, &bundle_resolution, &sampling_resolution, &chunk_step, &min_bi, &bilinear]
-                  (const index_t &bi, const typename src_map_t::distribution_bundle_t &b){
-        for (int k = 0 ; k < chunk_step ; ++ k) {
-            for (int l = 0 ; l < chunk_step ; ++ l) {
-                const cslibs_math_2d::Point2<T> p(static_cast<T>(bi[0]) * bundle_resolution + static_cast<T>(k) * sampling_resolution,
-                                                  static_cast<T>(bi[1]) * bundle_resolution + static_cast<T>(l) * sampling_resolution);
-                const std::size_t u = (bi[0] - min_bi[0]) * chunk_step + k;
-                const std::size_t v = (bi[1] - min_bi[1]) * chunk_step + l;
-                if (bilinear) {
-                    const std::array<T,2> w{
-                        (bi[0] & 1) ? (static_cast<T>(k)/static_cast<T>(chunk_step)) :
-                                      (T(1.) - static_cast<T>(k)/static_cast<T>(chunk_step)),
-                        (bi[1] & 1) ? (static_cast<T>(l)/static_cast<T>(chunk_step)) :
-                                      (T(1.) - static_cast<T>(l)/static_cast<T>(chunk_step))};
-                    dst->at(u,v) = src.sampleNonNormalizedBilinear(p, w, &b);
-                } else
-                    dst->at(u,v) = src.sampleNonNormalized(p, &b);
-            }
-        }
-    });
+    const raster<T> r(src.getBundleResolution(), sampling_resolution);
+    rasterize(src, r, kernel::likelihood<src_map_t>(src, bilinear), output::to_value(*dst));
 
     std::vector<T> occ = dst->getData();
     cslibs_gridmaps::static_maps::algorithms::DistanceTransform<T,T,T> distance_transform(
@@ -94,33 +71,8 @@ inline void from(
                             std::ceil(src.getWidth()  / sampling_resolution)));
     std::fill(dst->getData().begin(), dst->getData().end(), T(0.0));
 
-    const T bundle_resolution = src.getBundleResolution();
-    const int chunk_step = static_cast<int>(bundle_resolution / sampling_resolution);
-
-    using index_t = std::array<int, 2>;
-    const index_t min_bi = src.getMinBundleIndex();
-
-    const auto& origin = src.getInitialOrigin();
-    src.traverse([&src, &dst, &origin, &bundle_resolution, &sampling_resolution, &chunk_step, &min_bi, &inverse_model, &bilinear]
-                  (const index_t &bi, const typename src_map_t::distribution_bundle_t &b){
-        for (int k = 0 ; k < chunk_step ; ++ k) {
-            for (int l = 0 ; l < chunk_step ; ++ l) {
-                const cslibs_math_2d::Point2<T> p(static_cast<T>(bi[0]) * bundle_resolution + static_cast<T>(k) * sampling_resolution,
-                                                  static_cast<T>(bi[1]) * bundle_resolution + static_cast<T>(l) * sampling_resolution);
-                const std::size_t u = (bi[0] - min_bi[0]) * chunk_step + k;
-                const std::size_t v = (bi[1] - min_bi[1]) * chunk_step + l;
-                if (bilinear) {
-                    const std::array<T,2> w{
-                        (bi[0] & 1) ? (static_cast<T>(k)/static_cast<T>(chunk_step)) :
-                                      (T(1.) - static_cast<T>(k)/static_cast<T>(chunk_step)),
-                        (bi[1] & 1) ? (static_cast<T>(l)/static_cast<T>(chunk_step)) :
-                                      (T(1.) - static_cast<T>(l)/static_cast<T>(chunk_step))};
-                    dst->at(u,v) = src.sampleNonNormalizedBilinear(p, w, &b, inverse_model);
-                } else
-                    dst->at(u,v) = src.sampleNonNormalized(p, &b, inverse_model);
-            }
-        }
-    });
+    const raster<T> r(src.getBundleResolution(), sampling_resolution);
+    rasterize(src, r, kernel::likelihood<src_map_t>(src, inverse_model, bilinear), output::to_value(*dst));
 
     std::vector<T> occ = dst->getData();
     cslibs_gridmaps::static_maps::algorithms::DistanceTransform<T,T,T> distance_transform(
@@ -128,6 +80,84 @@ inline void from(
     distance_transform.apply(occ, dst->getWidth(), dst->getData());
 }
 
+/**
+ * @brief Probability and distance gridmap from a single sampling pass, the probabilities are
+ *        the input of the distance transform. Like the probability conversion, partially
+ *        allocated bundles are only allocated on request.
+ */
+template <cslibs_ndt::map::tags::option option_t,
+          typename T,
+          template <typename, typename, typename...> class backend_t>
+inline void from(
+        const typename cslibs_ndt::map::Map<option_t,2,cslibs_ndt::Distribution,T,backend_t> &src,
+        typename cslibs_gridmaps::static_maps::ProbabilityGridmap<T,T>::Ptr &probability,
+        typename cslibs_gridmaps::static_maps::DistanceGridmap<T,T>::Ptr &distance,
+        const T &sampling_resolution,
+        const T &maximum_distance = 2.0,
+        const T &threshold        = 0.169,
+        const bool allocate_all   = false,
+        const bool& bilinear      = false)
+{
+    if (allocate_all)
+        src.allocatePartiallyAllocatedBundles();
+
+    using src_map_t = cslibs_ndt::map::Map<option_t,2,cslibs_ndt::Distribution,T,backend_t>;
+    probability.reset(new cslibs_gridmaps::static_maps::ProbabilityGridmap<T,T>(src.getOrigin(),
+                                                                               sampling_resolution,
+                                                                               std::ceil(src.getHeight() / sampling_resolution),
+                                                                               std::ceil(src.getWidth()  / sampling_resolution)));
+    distance.reset(new cslibs_gridmaps::static_maps::DistanceGridmap<T,T>(src.getOrigin(),
+                                                                         sampling_resolution,
+                                                                         std::ceil(src.getHeight() / sampling_resolution),
+                                                                         std::ceil(src.getWidth()  / sampling_resolution)));
+    std::fill(probability->getData().begin(), probability->getData().end(), T(0.0));
+
+    const raster<T> r(src.getBundleResolution(), sampling_resolution);
+    rasterize(src, r, kernel::likelihood<src_map_t>(src, bilinear), output::to_value(*probability));
+
+    cslibs_gridmaps::static_maps::algorithms::DistanceTransform<T,T,T> distance_transform(
+                sampling_resolution, maximum_distance, threshold);
+    distance_transform.apply(probability->getData(), distance->getWidth(), distance->getData());
+}
+
+template <cslibs_ndt::map::tags::option option_t,
+          typename T,
+          template <typename, typename, typename...> class backend_t>
+inline void from(
+        const typename cslibs_ndt::map::Map<option_t,2,cslibs_ndt::OccupancyDistribution,T,backend_t> &src,
+        typename cslibs_gridmaps::static_maps::ProbabilityGridmap<T,T>::Ptr &probability,
+        typename cslibs_gridmaps::static_maps::DistanceGridmap<T,T>::Ptr &distance,
+        const T &sampling_resolution,
+        const typename cslibs_gridmaps::utility::InverseModel<T>::Ptr &inverse_model,
+        const T &maximum_distance = 2.0,
+        const T &threshold        = 0.169,
+        const bool allocate_all   = false,
+        const bool& bilinear      = false)
+{
+    if (!inverse_model)
+        return;
+    if (allocate_all)
+        src.allocatePartiallyAllocatedBundles();
+
+    using src_map_t = cslibs_ndt::map::Map<option_t,2,cslibs_ndt::OccupancyDistribution,T,backend_t>;
+    probability.reset(new cslibs_gridmaps::static_maps::ProbabilityGridmap<T,T>(src.getOrigin(),
+                                                                               sampling_resolution,
+                                                                               std::ceil(src.getHeight() / sampling_resolution),
+                                                                               std::ceil(src.getWidth()  / sampling_resolution)));
+    distance.reset(new cslibs_gridmaps::static_maps::DistanceGridmap<T,T>(src.getOrigin(),
+                                                                         sampling_resolution,
+                                                                         std::ceil(src.getHeight() / sampling_resolution),
+                                                                         std::ceil(src.getWidth()  / sampling_resolution)));
+    std::fill(probability->getData().begin(), probability->getData().end(), T(0.0));
+
+    const raster<T> r(src.getBundleResolution(), sampling_resolution);
+    rasterize(src, r, kernel::likelihood<src_map_t>(src, inverse_model, bilinear), output::to_value(*probability));
+
+    cslibs_gridmaps::static_maps::algorithms::DistanceTransform<T,T,T> distance_transform(
+                sampling_resolution, maximum_distance, threshold);
+    distance_transform.apply(probability->getData(), distance->getWidth(), distance->getData());
+}
+
 template <typename T>
 inline void from(
         const typename cslibs_ndt_2d::dynamic_maps::Gridmap<T>::Ptr &src,
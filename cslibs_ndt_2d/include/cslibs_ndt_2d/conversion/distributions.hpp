@@ -3,6 +3,7 @@
 
 #include <cslibs_ndt_2d/dynamic_maps/gridmap.hpp>
 #include <cslibs_ndt_2d/dynamic_maps/occupancy_gridmap.hpp>
+#include <cslibs_ndt/utility/ellipsoids.hpp>
 
 #include <cslibs_math/color/color.hpp>
 #include <cslibs_math/common/angle.hpp>
@@ -208,6 +209,200 @@ inline void from(
     from(*src,*dst,ivm,time,frame,transform,color,occupancy_threshold);
 }
 
+namespace markers {
+/**
+ * @brief Level of detail of the compact export. Distributions further than maximum_distance
+ *        from the viewpoint are culled, those further than near_distance are drawn with fewer
+ *        segments. Distances are measured in the target frame.
+ */
+template <typename T>
+struct lod
+{
+    inline lod(const cslibs_math_2d::Point2<T> &viewpoint = cslibs_math_2d::Point2<T>(),
+               const T near_distance    = std::numeric_limits<T>::max(),
+               const T maximum_distance = std::numeric_limits<T>::max(),
+               const std::size_t near_segments = 16,
+               const std::size_t far_segments  = 6) :
+        viewpoint(viewpoint),
+        near_distance(near_distance),
+        maximum_distance(maximum_distance),
+        near_segments(near_segments),
+        far_segments(far_segments)
+    {
+    }
+
+    cslibs_math_2d::Point2<T>   viewpoint;
+    T                           near_distance;
+    T                           maximum_distance;
+    std::size_t                 near_segments;
+    std::size_t                 far_segments;
+};
+
+/**
+ * @brief Unit circle as a fan of triangles in the xy-plane.
+ */
+template <typename T>
+inline std::vector<Eigen::Matrix<T,2,1>> disc(const std::size_t segments)
+{
+    std::vector<Eigen::Matrix<T,2,1>> m;
+    for (std::size_t i = 0 ; i < segments ; ++ i) {
+        const T a0 = static_cast<T>(2.0 * M_PI * i / segments);
+        const T a1 = static_cast<T>(2.0 * M_PI * (i + 1) / segments);
+        m.emplace_back(Eigen::Matrix<T,2,1>::Zero());
+        m.emplace_back(std::cos(a0), std::sin(a0));
+        m.emplace_back(std::cos(a1), std::sin(a1));
+    }
+    return m;
+}
+
+/**
+ * @brief Write the selected distributions of all storages as 1-sigma ellipses into a single
+ *        triangle list.
+ * @param src       map
+ * @param origin    transform from the map to the target frame
+ * @param select    returns the Gaussian of a distribution and sets its alpha, or nullptr to skip it
+ * @param l         level of detail
+ * @param color     color of the ellipses
+ * @param dst       triangle list, points and colors are overwritten
+ */
+template <typename T, typename map_t, typename select_t>
+inline void write(const map_t &src,
+                  const cslibs_math_2d::Pose2<T> &origin,
+                  const select_t &select,
+                  const lod<T> &l,
+                  const cslibs_math::color::Color<T> &color,
+                  visualization_msgs::Marker &dst)
+{
+    cslibs_ndt::utility::Ellipsoids<T,2> ellipses;
+    ellipses.collect(src, origin, select, l.viewpoint.data(), l.near_distance, l.maximum_distance);
+
+    const std::vector<Eigen::Matrix<T,2,1>> fine   = disc<T>(l.near_segments);
+    const std::vector<Eigen::Matrix<T,2,1>> coarse = disc<T>(l.far_segments);
+    const std::size_t vertices = ellipses.vertices(fine, coarse);
+    dst.points.resize(vertices);
+    dst.colors.resize(vertices);
+    ellipses.forEachVertex(fine, coarse, [&ellipses, &color, &dst](const std::size_t k, const std::size_t i, const Eigen::Matrix<T,2,1> &v) {
+        geometry_msgs::Point &p = dst.points[i];
+        p.x = v(0);
+        p.y = v(1);
+        p.z = 0;
+        std_msgs::ColorRGBA &c = dst.colors[i];
+        c.r = color.r;
+        c.g = color.g;
+        c.b = color.b;
+        c.a = ellipses.alpha(k);
+    });
+}
+
+inline void header(const ros::Time& time,
+                   const std::string &frame,
+                   visualization_msgs::Marker &dst)
+{
+    dst.header.stamp       = time;
+    dst.header.frame_id    = frame;
+    dst.ns                 = "distributions";
+    dst.id                 = 0;
+    dst.type               = visualization_msgs::Marker::TRIANGLE_LIST;
+    dst.action             = visualization_msgs::Marker::ADD;
+    dst.pose.orientation.w = 1;
+    dst.scale.x            = 1;
+    dst.scale.y            = 1;
+    dst.scale.z            = 1;
+    dst.color.a            = 1;
+    dst.lifetime           = ros::Duration(2000.);
+}
+}
+
+/**
+ * @brief Compact visualisation of all distributions as a single triangle list marker.
+ */
+template <cslibs_ndt::map::tags::option option_t,
+          typename T,
+          template <typename, typename, typename...> class backend_t>
+inline void from(
+        const cslibs_ndt::map::Map<option_t,2,cslibs_ndt::Distribution,T,backend_t> &src,
+        visualization_msgs::Marker &dst,
+        const ros::Time& time,
+        const std::string &frame,
+        const typename cslibs_math_2d::Pose2<T> &transform = typename cslibs_math_2d::Pose2<T>(),
+        const cslibs_math::color::Color<T> &color = cslibs_math::color::Color<T>(0.0, 0.45, 0.63),
+        const markers::lod<T> &lod = markers::lod<T>())
+{
+    using gaussian_t = cslibs_math::statistics::StableDistribution<T,2,3>;
+    auto select = [](const cslibs_ndt::Distribution<T,2> &d, T &alpha) -> const gaussian_t* {
+        alpha = 1;
+        return d.valid() ? &d : nullptr;
+    };
+    markers::header(time, frame, dst);
+    markers::write(src, transform * src.getInitialOrigin(), select, lod, color, dst);
+}
+
+template <typename T>
+inline void from(
+        const typename cslibs_ndt_2d::dynamic_maps::Gridmap<T>::Ptr &src,
+        visualization_msgs::Marker::Ptr &dst,
+        const ros::Time& time,
+        const std::string &frame,
+        const typename cslibs_math_2d::Pose2<T> &transform = typename cslibs_math_2d::Pose2<T>(),
+        const cslibs_math::color::Color<T> &color = cslibs_math::color::Color<T>(0.0, 0.45, 0.63),
+        const markers::lod<T> &lod = markers::lod<T>())
+{
+    if (!src)
+        return;
+    dst.reset(new visualization_msgs::Marker());
+
+    from(*src,*dst,time,frame,transform,color,lod);
+}
+
+/**
+ * @brief Compact visualisation of the occupied distributions as a single triangle list marker,
+ *        with the occupancy as alpha.
+ */
+template <cslibs_ndt::map::tags::option option_t,
+          typename T,
+          template <typename, typename, typename...> class backend_t>
+inline void from(
+        const cslibs_ndt::map::Map<option_t,2,cslibs_ndt::OccupancyDistribution,T,backend_t> &src,
+        visualization_msgs::Marker &dst,
+        const typename cslibs_gridmaps::utility::InverseModel<T>::Ptr &ivm,
+        const ros::Time& time,
+        const std::string &frame,
+        const typename cslibs_math_2d::Pose2<T> &transform = typename cslibs_math_2d::Pose2<T>(),
+        const cslibs_math::color::Color<T> &color = cslibs_math::color::Color<T>(0.0, 0.45, 0.63),
+        const T &occupancy_threshold = 0.5,
+        const markers::lod<T> &lod = markers::lod<T>())
+{
+    using gaussian_t = cslibs_math::statistics::StableDistribution<T,2,3>;
+    auto select = [&ivm, &occupancy_threshold](const cslibs_ndt::OccupancyDistribution<T,2> &d, T &alpha) -> const gaussian_t* {
+        const auto &g = d.getDistribution();
+        if (!g || !g->valid())
+            return nullptr;
+        alpha = d.getOccupancy(ivm);
+        return alpha >= occupancy_threshold ? g.get() : nullptr;
+    };
+    markers::header(time, frame, dst);
+    markers::write(src, transform * src.getInitialOrigin(), select, lod, color, dst);
+}
+
+template <typename T>
+inline void from(
+        const typename cslibs_ndt_2d::dynamic_maps::OccupancyGridmap<T>::Ptr &src,
+        visualization_msgs::Marker::Ptr &dst,
+        const typename cslibs_gridmaps::utility::InverseModel<T>::Ptr& ivm,
+        const ros::Time& time,
+        const std::string &frame,
+        const typename cslibs_math_2d::Pose2<T> &transform = typename cslibs_math_2d::Pose2<T>(),
+        const cslibs_math::color::Color<T> &color = cslibs_math::color::Color<T>(0.0, 0.45, 0.63),
+        const T &occupancy_threshold = 0.5,
+        const markers::lod<T> &lod = markers::lod<T>())
+{
+    if (!src || !ivm)
+        return;
+    dst.reset(new visualization_msgs::Marker());
+
+    from(*src,*dst,ivm,time,frame,transform,color,occupancy_threshold,lod);
+}
+
 }
 }
 
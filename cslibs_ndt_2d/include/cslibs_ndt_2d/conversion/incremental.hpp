@@ -0,0 +1,353 @@
+#ifndef CSLIBS_NDT_2D_CONVERSION_INCREMENTAL_HPP
+#define CSLIBS_NDT_2D_CONVERSION_INCREMENTAL_HPP
+
+#include <cslibs_ndt/map/map.hpp>
+#include <cslibs_ndt_2d/conversion/rasterize.hpp>
+
+#include <cslibs_gridmaps/static_maps/probability_gridmap.h>
+#include <cslibs_gridmaps/static_maps/distance_gridmap.h>
+#include <cslibs_gridmaps/static_maps/likelihood_field_gridmap.h>
+#include <cslibs_gridmaps/static_maps/algorithms/distance_transform.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace cslibs_ndt_2d {
+namespace conversion {
+/**
+ * @brief Probability, distance and likelihood field gridmap of a map, kept up to date by
+ *        incremental updates. Only the bundles changed since the last update are rasterised
+ *        again, and the distance transform is recomputed within the maximum distance of the
+ *        changed cells. Everything is regenerated when the extent of the map has changed.
+ *        The gridmaps are created by the first update.
+ *        Like the conversions with allocate_all, partially allocated bundles are allocated
+ *        before they are rasterised, by the first update for the whole map and afterwards for
+ *        the bundles around the changed ones. Otherwise the gridmaps only match conversions
+ *        without allocate_all.
+ */
+template <typename map_t, typename T>
+class IncrementalGridmaps
+{
+public:
+    using kernel_t                   = kernel::likelihood<map_t>;
+    using index_t                    = typename map_t::index_t;
+    using probability_gridmap_t      = cslibs_gridmaps::static_maps::ProbabilityGridmap<T,T>;
+    using distance_gridmap_t         = cslibs_gridmaps::static_maps::DistanceGridmap<T,T>;
+    using likelihood_field_gridmap_t = cslibs_gridmaps::static_maps::LikelihoodFieldGridmap<T,T>;
+
+    /**
+     * @param kernel                likelihood kernel of the map, it keeps a reference to the map
+     * @param sampling_resolution   resolution of the gridmaps
+     * @param maximum_distance      maximum distance of the distance transform
+     * @param sigma_hit             standard deviation of the likelihood field
+     * @param threshold             occupancy threshold of the distance transform
+     * @param allocate_all          allocate partially allocated bundles of the map
+     */
+    inline IncrementalGridmaps(const kernel_t &kernel,
+                               const T sampling_resolution,
+                               const T maximum_distance = 2.0,
+                               const T sigma_hit        = 0.5,
+                               const T threshold        = 0.169,
+                               const bool allocate_all  = true) :
+        kernel_(kernel),
+        raster_(kernel.src.getBundleResolution(), sampling_resolution),
+        sampling_resolution_(sampling_resolution),
+        maximum_distance_(maximum_distance),
+        exp_factor_hit_(0.5 / (sigma_hit * sigma_hit)),
+        threshold_(threshold),
+        allocate_all_(allocate_all),
+        margin_(static_cast<std::size_t>(std::ceil(maximum_distance / sampling_resolution)) + 1ul)
+    {
+        assert(threshold <= 1.0);
+        assert(threshold >= 0.0);
+    }
+
+    /**
+     * @brief Update with the bundles the map reports as changed. This takes the dirty bundles
+     *        of the map, use update(indices) if they are consumed elsewhere as well, e.g. take
+     *        them once and pass them to DeltaLog::checkpoint(map, indices) and update(indices).
+     * @return true, if the gridmaps were regenerated completely
+     */
+    inline bool update()
+    {
+        std::vector<index_t> dirty;
+        kernel_.src.takeDirtyBundles(dirty);
+        return update(dirty);
+    }
+
+    /**
+     * @brief Update with changed bundles.
+     * @param dirty     indices of the bundles changed since the last update
+     * @return true, if the gridmaps were regenerated completely
+     */
+    inline bool update(const std::vector<index_t> &dirty)
+    {
+        const map_t &src = kernel_.src;
+        if (probability_ && allocate_all_)
+            allocate(dirty);
+        if (!probability_ || min_bi_ != src.getMinBundleIndex() || max_bi_ != src.getMaxBundleIndex()) {
+            regenerate();
+            return true;
+        }
+        if (dirty.empty())
+            return false;
+
+        /// a changed distribution is shared with the neighbouring bundles, bundles allocated
+        /// for these neighbours share their distributions as well
+        const std::vector<index_t> indices = neighbours(dirty, allocate_all_ ? 2 : 1);
+
+        using bundle_t = typename map_t::distribution_bundle_t;
+        std::vector<std::pair<const index_t, const bundle_t*>> bundles;
+        std::vector<index_t> changed;
+        for (const index_t &bi : indices) {
+            if (const bundle_t *b = src.get(bi)) {
+                bundles.emplace_back(bi, b);
+                changed.emplace_back(bi);
+            }
+        }
+        if (bundles.empty())
+            return false;
+
+        rasterize(src, bundles, raster_, kernel_, output::to_value(*probability_));
+
+        /// distances change within the maximum distance of a changed cell
+        std::vector<region> windows;
+        std::size_t area = 0ul;
+        for (const region &r : merge(changed, 2ul * margin_)) {
+            windows.emplace_back(grow(r, margin_));
+            area += windows.back().area();
+        }
+        if (2ul * area >= width_ * height_) {
+            transform(region{0ul, 0ul, width_, height_}, region{0ul, 0ul, width_, height_});
+            return false;
+        }
+        for (const region &w : windows)
+            transform(w, grow(w, margin_));
+        return false;
+    }
+
+    inline typename probability_gridmap_t::Ptr getProbabilityGridmap() const
+    {
+        return probability_;
+    }
+
+    inline typename distance_gridmap_t::Ptr getDistanceGridmap() const
+    {
+        return distance_;
+    }
+
+    inline typename likelihood_field_gridmap_t::Ptr getLikelihoodFieldGridmap() const
+    {
+        return likelihood_field_;
+    }
+
+private:
+    /// cells [u0,u1) x [v0,v1)
+    struct region {
+        std::size_t u0;
+        std::size_t v0;
+        std::size_t u1;
+        std::size_t v1;
+
+        inline std::size_t area() const
+        {
+            return (u1 - u0) * (v1 - v0);
+        }
+    };
+
+    const kernel_t                              kernel_;
+    const raster<T>                             raster_;
+    const T                                     sampling_resolution_;
+    const T                                     maximum_distance_;
+    const T                                     exp_factor_hit_;
+    const T                                     threshold_;
+    const bool                                  allocate_all_;
+    const std::size_t                           margin_;
+
+    index_t                                     min_bi_;
+    index_t                                     max_bi_;
+    std::size_t                                 width_;
+    std::size_t                                 height_;
+    typename probability_gridmap_t::Ptr         probability_;
+    typename distance_gridmap_t::Ptr            distance_;
+    typename likelihood_field_gridmap_t::Ptr    likelihood_field_;
+
+    inline void regenerate()
+    {
+        const map_t &src = kernel_.src;
+        if (allocate_all_)
+            src.allocatePartiallyAllocatedBundles();
+        min_bi_ = src.getMinBundleIndex();
+        max_bi_ = src.getMaxBundleIndex();
+
+        const auto origin = src.getOrigin();
+        const std::size_t height = static_cast<std::size_t>(std::ceil(src.getHeight() / sampling_resolution_));
+        const std::size_t width  = static_cast<std::size_t>(std::ceil(src.getWidth()  / sampling_resolution_));
+        probability_.reset(new probability_gridmap_t(origin, sampling_resolution_, height, width));
+        distance_.reset(new distance_gridmap_t(origin, sampling_resolution_, height, width));
+        likelihood_field_.reset(new likelihood_field_gridmap_t(origin, sampling_resolution_, height, width));
+        width_  = probability_->getWidth();
+        height_ = probability_->getHeight();
+        std::fill(probability_->getData().begin(), probability_->getData().end(), T(0.0));
+
+        rasterize(src, raster_, kernel_, output::to_value(*probability_));
+        transform(region{0ul, 0ul, width_, height_}, region{0ul, 0ul, width_, height_});
+    }
+
+    /**
+     * @brief Indices of the bundles within the given distance of the changed ones, limited
+     *        to the extent of the gridmaps.
+     */
+    inline std::vector<index_t> neighbours(const std::vector<index_t> &dirty,
+                                           const int distance) const
+    {
+        std::vector<index_t> indices;
+        indices.reserve(dirty.size() * static_cast<std::size_t>((2 * distance + 1) * (2 * distance + 1)));
+        for (const index_t &bi : dirty) {
+            for (int i = -distance ; i <= distance ; ++ i) {
+                for (int j = -distance ; j <= distance ; ++ j) {
+                    const index_t n = {{bi[0] + i, bi[1] + j}};
+                    if (n[0] >= min_bi_[0] && n[0] <= max_bi_[0] && n[1] >= min_bi_[1] && n[1] <= max_bi_[1])
+                        indices.emplace_back(n);
+                }
+            }
+        }
+        std::sort(indices.begin(), indices.end());
+        indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+        return indices;
+    }
+
+    /**
+     * @brief Allocate the partially allocated bundles whose distributions may have changed,
+     *        new bundles outside the extent cause a regeneration.
+     */
+    inline void allocate(const std::vector<index_t> &dirty) const
+    {
+        const map_t &src = kernel_.src;
+        for (const index_t &bi : dirty) {
+            for (int i = -1 ; i <= 1 ; ++ i) {
+                for (int j = -1 ; j <= 1 ; ++ j) {
+                    const index_t n = {{bi[0] + i, bi[1] + j}};
+                    if (const typename map_t::distribution_bundle_t *b = src.get(n))
+                        src.allocatePartiallyAllocatedBundle(n, b);
+                }
+            }
+        }
+    }
+
+    inline region cells(const index_t &bi) const
+    {
+        const std::size_t u = static_cast<std::size_t>(bi[0] - min_bi_[0]) * raster_.chunk_step;
+        const std::size_t v = static_cast<std::size_t>(bi[1] - min_bi_[1]) * raster_.chunk_step;
+        return region{u, v,
+                      std::min(width_,  u + static_cast<std::size_t>(raster_.chunk_step)),
+                      std::min(height_, v + static_cast<std::size_t>(raster_.chunk_step))};
+    }
+
+    inline region grow(const region &r, const std::size_t m) const
+    {
+        return region{r.u0 > m ? r.u0 - m : 0ul,
+                      r.v0 > m ? r.v0 - m : 0ul,
+                      std::min(width_,  r.u1 + m),
+                      std::min(height_, r.v1 + m)};
+    }
+
+    /**
+     * @brief Cells of groups of changed bundles closer than the given distance, so overlapping
+     *        windows are transformed once. The bundles are grown by half the distance on the
+     *        grid of bundles, every connected component yields the cells of its bundles.
+     *        Components are not merged again if their regions come close, that only repeats
+     *        some work of the transform.
+     */
+    inline std::vector<region> merge(const std::vector<index_t> &changed,
+                                     const std::size_t distance) const
+    {
+        const int step = std::max(1, raster_.chunk_step);
+        const int radius = static_cast<int>((distance + 2ul * static_cast<std::size_t>(step) - 1ul) /
+                                          (2ul * static_cast<std::size_t>(step)));
+        const int w = max_bi_[0] - min_bi_[0] + 1;
+        const int h = max_bi_[1] - min_bi_[1] + 1;
+
+        /// -2: free, -1: grown and not labelled yet, >= 0: component
+        std::vector<int> label(static_cast<std::size_t>(w * h), -2);
+        for (const index_t &bi : changed) {
+            const int u = bi[0] - min_bi_[0];
+            const int v = bi[1] - min_bi_[1];
+            for (int j = std::max(0, v - radius) ; j <= std::min(h - 1, v + radius) ; ++ j) {
+                for (int i = std::max(0, u - radius) ; i <= std::min(w - 1, u + radius) ; ++ i)
+                    label[static_cast<std::size_t>(j * w + i)] = -1;
+            }
+        }
+
+        int components = 0;
+        std::vector<int> open;
+        for (const index_t &bi : changed) {
+            const int start = (bi[1] - min_bi_[1]) * w + (bi[0] - min_bi_[0]);
+            if (label[static_cast<std::size_t>(start)] != -1)
+                continue;
+
+            label[static_cast<std::size_t>(start)] = components;
+            open.emplace_back(start);
+            while (!open.empty()) {
+                const int c = open.back();
+                open.pop_back();
+                const int u = c % w;
+                const int v = c / w;
+                for (int j = std::max(0, v - 1) ; j <= std::min(h - 1, v + 1) ; ++ j) {
+                    for (int i = std::max(0, u - 1) ; i <= std::min(w - 1, u + 1) ; ++ i) {
+                        int &l = label[static_cast<std::size_t>(j * w + i)];
+                        if (l == -1) {
+                            l = components;
+                            open.emplace_back(j * w + i);
+                        }
+                    }
+                }
+            }
+            ++ components;
+        }
+
+        std::vector<region> regions(static_cast<std::size_t>(components), region{width_, height_, 0ul, 0ul});
+        for (const index_t &bi : changed) {
+            region &r = regions[static_cast<std::size_t>(label[static_cast<std::size_t>((bi[1] - min_bi_[1]) * w + (bi[0] - min_bi_[0]))])];
+            const region c = cells(bi);
+            r.u0 = std::min(r.u0, c.u0);
+            r.v0 = std::min(r.v0, c.v0);
+            r.u1 = std::max(r.u1, c.u1);
+            r.v1 = std::max(r.v1, c.v1);
+        }
+        return regions;
+    }
+
+    /**
+     * @brief Distance transform of the input region, written to the output region it contains.
+     *        The input has to extend the output by the maximum distance to be exact.
+     */
+    inline void transform(const region &out,
+                          const region &in)
+    {
+        const std::size_t width = in.u1 - in.u0;
+        std::vector<T> occ(in.area());
+        std::vector<T> dist(in.area());
+        for (std::size_t v = in.v0 ; v < in.v1 ; ++ v) {
+            for (std::size_t u = in.u0 ; u < in.u1 ; ++ u)
+                occ[(v - in.v0) * width + (u - in.u0)] = probability_->at(u,v);
+        }
+
+        cslibs_gridmaps::static_maps::algorithms::DistanceTransform<T,T,T> distance_transform(
+                    sampling_resolution_, maximum_distance_, threshold_);
+        distance_transform.apply(occ, width, dist);
+
+        for (std::size_t v = out.v0 ; v < out.v1 ; ++ v) {
+            for (std::size_t u = out.u0 ; u < out.u1 ; ++ u) {
+                const T z = dist[(v - in.v0) * width + (u - in.u0)];
+                distance_->at(u,v)         = z;
+                likelihood_field_->at(u,v) = std::exp(-z * z * exp_factor_hit_);
+            }
+        }
+    }
+};
+}
+}
+
+#endif // CSLIBS_NDT_2D_CONVERSION_INCREMENTAL_HPP
@@ -1,6 +1,7 @@
 #ifndef CSLIBS_NDT_2D_FLATTEN_HPP
 #define CSLIBS_NDT_2D_FLATTEN_HPP
 
+#include <cslibs_ndt/conversion/merge.hpp>
 #include <cslibs_ndt_2d/dynamic_maps/gridmap.hpp>
 #include <cslibs_ndt_2d/static_maps/mono_gridmap.hpp>
 
@@ -8,7 +9,8 @@ namespace cslibs_ndt_2d {
 namespace conversion {
 template <typename T>
 inline typename cslibs_ndt_2d::static_maps::mono::Gridmap<T>::Ptr merge(
-        const typename cslibs_ndt_2d::dynamic_maps::Gridmap<T>::Ptr& src)
+        const typename cslibs_ndt_2d::dynamic_maps::Gridmap<T>::Ptr& src,
+        const std::size_t num_threads = cslibs_ndt::utility::default_thread_count())
 {
     if (!src)
         return nullptr;
@@ -20,24 +22,18 @@ inline typename cslibs_ndt_2d::static_maps::mono::Gridmap<T>::Ptr merge(
     const std::array<std::size_t, 2> size = {{static_cast<std::size_t>(max_distribution_index[0] - min_distribution_index[0] + 1),
                                               static_cast<std::size_t>(max_distribution_index[1] - min_distribution_index[1] + 1)}};
 
-    using src_map_t = cslibs_ndt_2d::dynamic_maps::Gridmap<T>;
     using dst_map_t = cslibs_ndt_2d::static_maps::mono::Gridmap<T>;
 
-    typename dst_map_t::Ptr dst(new dst_map_t(src->getInitialOrigin(),
-                                              src->getBundleResolution(),
-                                              size,
-                                              min_distribution_index));
-
-    auto traverse = [&dst](const index_t &i, const typename src_map_t::distribution_bundle_t &b)
-    {
-        typename dst_map_t::distribution_t* dst_d = dst->getDistribution(i);
-        for(const typename src_map_t::distribution_t *src_d : b) {
-            *dst_d += *src_d;
-        }
-    };
-
-    src->traverse(traverse);
-    return dst;
+    typename dst_map_t::distribution_storage_ptr_t storage(new typename dst_map_t::distribution_storage_t);
+    storage->template set<cis::option::tags::array_size>(size[0], size[1]);
+    storage->template set<cis::option::tags::array_offset>(min_distribution_index[0], min_distribution_index[1]);
+    cslibs_ndt::conversion::merge(*src, *storage, min_distribution_index, max_distribution_index, 64ul, num_threads);
+
+    return typename dst_map_t::Ptr(new dst_map_t(src->getInitialOrigin(),
+                                                 src->getBundleResolution(),
+                                                 size,
+                                                 min_distribution_index,
+                                                 storage));
 }
 }
 }
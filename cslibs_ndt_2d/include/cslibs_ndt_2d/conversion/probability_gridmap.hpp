@@ -3,6 +3,7 @@
 
 #include <cslibs_ndt/map/map.hpp>
 #include <cslibs_ndt_2d/static_maps/mono_gridmap.hpp>
+#include <cslibs_ndt_2d/conversion/rasterize.hpp>
 
 #include <cslibs_ndt_2d/dynamic_maps/gridmap.hpp>
 #include <cslibs_ndt_2d/dynamic_maps/occupancy_gridmap.hpp>
@@ -42,32 +43,8 @@ inline void from(
                             std::ceil(src.getWidth()  / sampling_resolution)));
     std::fill(dst->getData().begin(), dst->getData().end(), default_value);
 
-    const T bundle_resolution = src.getBundleResolution();
-    const int chunk_step = static_cast<int>(bundle_resolution / sampling_resolution);
-
-    using index_t = std::array<int, 2>;
-    const index_t min_bi = src.getMinBundleIndex();
-
-    src.traverse([&src, &dst, &bundle_resolution, &sampling_resolution, &chunk_step, &min_bi, &bilinear]
-                  (const index_t &bi, const typename src_map_t::distribution_bundle_t &b){
-        for (int k = 0 ; k < chunk_step ; ++ k) {
-            for (int l = 0 ; l < chunk_step ; ++ l) {
-                const cslibs_math_2d::Point2<T> p(static_cast<T>(bi[0]) * bundle_resolution + static_cast<T>(k) * sampling_resolution,
-                                                  static_cast<T>(bi[1]) * bundle_resolution + static_cast<T>(l) * sampling_resolution);
-                const std::size_t u = (bi[0] - min_bi[0]) * chunk_step + k;
-                const std::size_t v = (bi[1] - min_bi[1]) * chunk_step + l;
-                if (bilinear) {
-                    const std::array<T,2> w{
-                        (bi[0] & 1) ? (static_cast<T>(k)/static_cast<T>(chunk_step)) :
-                                      (T(1.) - static_cast<T>(k)/static_cast<T>(chunk_step)),
-                        (bi[1] & 1) ? (static_cast<T>(l)/static_cast<T>(chunk_step)) :
-                                      (T(1.) - static_cast<T>(l)/static_cast<T>(chunk_step))};
-                    dst->at(u,v) = src.sampleNonNormalizedBilinear(p, w, &b);
-                } else
-                    dst->at(u,v) = src.sampleNonNormalized(p, &b);
-            }
-        }
-    });
+    const raster<T> r(src.getBundleResolution(), sampling_resolution);
+    rasterize(src, r, kernel::likelihood<src_map_t>(src, bilinear), output::to_value(*dst));
 }
 
 template <cslibs_ndt::map::tags::option option_t,
@@ -95,32 +72,8 @@ inline void from(
                             std::ceil(src.getWidth()  / sampling_resolution)));
     std::fill(dst->getData().begin(), dst->getData().end(), default_value);
 
-    const T bundle_resolution = src.getBundleResolution();
-    const int chunk_step = static_cast<int>(bundle_resolution / sampling_resolution);
-
-    using index_t = std::array<int, 2>;
-    const index_t min_bi = src.getMinBundleIndex();
-
-    src.traverse([&src, &dst, &bundle_resolution, &sampling_resolution, &chunk_step, &min_bi, &inverse_model, &bilinear]
-                  (const index_t &bi, const typename src_map_t::distribution_bundle_t &b){
-        for (int k = 0 ; k < chunk_step ; ++ k) {
-            for (int l = 0 ; l < chunk_step ; ++ l) {
-                const cslibs_math_2d::Point2<T> p(static_cast<T>(bi[0]) * bundle_resolution + static_cast<T>(k) * sampling_resolution,
-                                                  static_cast<T>(bi[1]) * bundle_resolution + static_cast<T>(l) * sampling_resolution);
-                const std::size_t u = (bi[0] - min_bi[0]) * chunk_step + k;
-                const std::size_t v = (bi[1] - min_bi[1]) * chunk_step + l;
-                if (bilinear) {
-                    const std::array<T,2> w{
-                        (bi[0] & 1) ? (static_cast<T>(k)/static_cast<T>(chunk_step)) :
-                                      (T(1.) - static_cast<T>(k)/static_cast<T>(chunk_step)),
-                        (bi[1] & 1) ? (static_cast<T>(l)/static_cast<T>(chunk_step)) :
-                                      (T(1.) - static_cast<T>(l)/static_cast<T>(chunk_step))};
-                    dst->at(u,v) = src.sampleNonNormalizedBilinear(p, w, &b, inverse_model);
-                } else
-                    dst->at(u,v) = src.sampleNonNormalized(p, &b, inverse_model);
-            }
-        }
-    });
+    const raster<T> r(src.getBundleResolution(), sampling_resolution);
+    rasterize(src, r, kernel::likelihood<src_map_t>(src, inverse_model, bilinear), output::to_value(*dst));
 }
 
 template <cslibs_ndt::map::tags::option option_t,
@@ -148,33 +101,8 @@ inline void from(
                             std::ceil(src.getWidth()  / sampling_resolution)));
     std::fill(dst->getData().begin(), dst->getData().end(), default_value);
 
-    const T bundle_resolution = src.getBundleResolution();
-    const int chunk_step = static_cast<int>(bundle_resolution / sampling_resolution);
-
-    using index_t = std::array<int, 2>;
-    const index_t min_bi = src.getMinBundleIndex();
-
-    const auto& origin = src.getInitialOrigin();
-    src.traverse([&src, &dst, &origin, &bundle_resolution, &sampling_resolution, &chunk_step, &min_bi, &inverse_model, &bilinear]
-                  (const index_t &bi, const typename src_map_t::distribution_bundle_t &b){
-        for (int k = 0 ; k < chunk_step ; ++ k) {
-            for (int l = 0 ; l < chunk_step ; ++ l) {
-                const cslibs_math_2d::Point2<T> p(static_cast<T>(bi[0]) * bundle_resolution + static_cast<T>(k) * sampling_resolution,
-                                                  static_cast<T>(bi[1]) * bundle_resolution + static_cast<T>(l) * sampling_resolution);
-                const std::size_t u = (bi[0] - min_bi[0]) * chunk_step + k;
-                const std::size_t v = (bi[1] - min_bi[1]) * chunk_step + l;
-                if (bilinear) {
-                    const std::array<T,2> w{
-                        (bi[0] & 1) ? (static_cast<T>(k)/static_cast<T>(chunk_step)) :
-                                      (T(1.) - static_cast<T>(k)/static_cast<T>(chunk_step)),
-                        (bi[1] & 1) ? (static_cast<T>(l)/static_cast<T>(chunk_step)) :
-                                      (T(1.) - static_cast<T>(l)/static_cast<T>(chunk_step))};
-                    dst->at(u,v) = src.sampleNonNormalizedBilinear(p, w, &b, inverse_model);
-                } else
-                    dst->at(u,v) = src.sampleNonNormalized(p, &b, inverse_model);
-             }
-        }
-    });
+    const raster<T> r(src.getBundleResolution(), sampling_resolution);
+    rasterize(src, r, kernel::likelihood<src_map_t>(src, inverse_model, bilinear), output::to_value(*dst));
 }
 
 template <typename T>
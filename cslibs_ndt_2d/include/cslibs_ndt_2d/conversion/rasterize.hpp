@@ -0,0 +1,317 @@
+#ifndef CSLIBS_NDT_2D_CONVERSION_RASTERIZE_HPP
+#define CSLIBS_NDT_2D_CONVERSION_RASTERIZE_HPP
+
+#include <cslibs_ndt/map/map.hpp>
+#include <cslibs_ndt/utility/parallel.hpp>
+
+#include <cslibs_math_2d/linear/point.hpp>
+#include <cslibs_gridmaps/utility/inverse_model.hpp>
+
+#include <vector>
+
+namespace cslibs_ndt_2d {
+namespace conversion {
+/**
+ * @brief Sub-cell layout of a bundle sampled at a finer resolution. Offsets and bilinear
+ *        weights only depend on the sub-cell and the parity of the bundle index, so they
+ *        are computed once per conversion instead of once per cell.
+ */
+template <typename T>
+struct raster
+{
+    inline raster(const T bundle_resolution,
+                  const T sampling_resolution) :
+        bundle_resolution(bundle_resolution),
+        chunk_step(static_cast<int>(bundle_resolution / sampling_resolution)),
+        offsets(static_cast<std::size_t>(std::max(0, chunk_step))),
+        weights{{std::vector<T>(offsets.size()), std::vector<T>(offsets.size())}}
+    {
+        for (int k = 0 ; k < chunk_step ; ++ k) {
+            const T w = static_cast<T>(k) / static_cast<T>(chunk_step);
+            offsets[k]    = static_cast<T>(k) * sampling_resolution;
+            weights[0][k] = T(1.) - w;
+            weights[1][k] = w;
+        }
+    }
+
+    /**
+     * @brief Bilinear weights of a sub-cell, as computed by get_bilinear_interpolation_weights.
+     */
+    inline std::array<T,2> weight(const std::array<int,2> &bi, const int k, const int l) const
+    {
+        return {{weights[bi[0] & 1][k], weights[bi[1] & 1][l]}};
+    }
+
+    const T                             bundle_resolution;
+    const int                           chunk_step;
+    std::vector<T>                      offsets;
+    std::array<std::vector<T>, 2>       weights;    /// by parity of the bundle index
+};
+
+namespace kernel {
+/**
+ * @brief Per-cell kernels evaluate a bundle at a point of the raster. A bundle is empty if
+ *        none of its distributions contributes to the sample, its cells are then not sampled.
+ *        prepare() updates the lazily computed information matrix of a distribution, so that
+ *        sampling it does not write.
+ */
+template <typename map_t>
+struct likelihood {};
+
+template <cslibs_ndt::map::tags::option option_t,
+          typename T,
+          template <typename, typename, typename...> class backend_t>
+struct likelihood<cslibs_ndt::map::Map<option_t,2,cslibs_ndt::Distribution,T,backend_t>>
+{
+    using map_t    = cslibs_ndt::map::Map<option_t,2,cslibs_ndt::Distribution,T,backend_t>;
+    using bundle_t = typename map_t::distribution_bundle_t;
+
+    inline likelihood(const map_t &src,
+                      const bool bilinear = false) :
+        src(src),
+        bilinear(bilinear)
+    {
+    }
+
+    inline bool empty(const bundle_t *b) const
+    {
+        for (std::size_t i = 0 ; i < map_t::bin_count ; ++ i) {
+            if (b->at(i) && b->at(i)->getN() > 0)
+                return false;
+        }
+        return true;
+    }
+
+    inline void prepare(const typename map_t::distribution_t &d) const
+    {
+        d.getInformationMatrix();
+    }
+
+    inline T operator () (const cslibs_math_2d::Point2<T> &p, const std::array<T,2> &w, const bundle_t *b) const
+    {
+        return bilinear ? src.sampleNonNormalizedBilinear(p, w, b) :
+                          src.sampleNonNormalized(p, b);
+    }
+
+    const map_t &src;
+    const bool   bilinear;
+};
+
+template <typename map_t, typename T>
+struct occupancy_likelihood
+{
+    using bundle_t = typename map_t::distribution_bundle_t;
+    using ivm_t    = typename cslibs_gridmaps::utility::InverseModel<T>;
+
+    inline occupancy_likelihood(const map_t &src,
+                                const typename ivm_t::Ptr &inverse_model,
+                                const bool bilinear = false) :
+        src(src),
+        inverse_model(inverse_model),
+        bilinear(bilinear)
+    {
+    }
+
+    inline bool empty(const bundle_t *b) const
+    {
+        for (std::size_t i = 0 ; i < map_t::bin_count ; ++ i) {
+            if (b->at(i) && b->at(i)->getDistribution())
+                return false;
+        }
+        return true;
+    }
+
+    inline void prepare(const typename map_t::distribution_t &d) const
+    {
+        if (const auto &g = d.getDistribution())
+            g->getInformationMatrix();
+    }
+
+    inline T operator () (const cslibs_math_2d::Point2<T> &p, const std::array<T,2> &w, const bundle_t *b) const
+    {
+        return bilinear ? src.sampleNonNormalizedBilinear(p, w, b, inverse_model) :
+                          src.sampleNonNormalized(p, b, inverse_model);
+    }
+
+    const map_t               &src;
+    const typename ivm_t::Ptr  inverse_model;
+    const bool                 bilinear;
+};
+
+template <cslibs_ndt::map::tags::option option_t,
+          typename T,
+          template <typename, typename, typename...> class backend_t>
+struct likelihood<cslibs_ndt::map::Map<option_t,2,cslibs_ndt::OccupancyDistribution,T,backend_t>> :
+        public occupancy_likelihood<cslibs_ndt::map::Map<option_t,2,cslibs_ndt::OccupancyDistribution,T,backend_t>,T>
+{
+    using occupancy_likelihood<cslibs_ndt::map::Map<option_t,2,cslibs_ndt::OccupancyDistribution,T,backend_t>,T>::occupancy_likelihood;
+};
+
+template <cslibs_ndt::map::tags::option option_t,
+          typename T,
+          template <typename, typename, typename...> class backend_t>
+struct likelihood<cslibs_ndt::map::Map<option_t,2,cslibs_ndt::WeightedOccupancyDistribution,T,backend_t>> :
+        public occupancy_likelihood<cslibs_ndt::map::Map<option_t,2,cslibs_ndt::WeightedOccupancyDistribution,T,backend_t>,T>
+{
+    using occupancy_likelihood<cslibs_ndt::map::Map<option_t,2,cslibs_ndt::WeightedOccupancyDistribution,T,backend_t>,T>::occupancy_likelihood;
+};
+}
+
+namespace output {
+/**
+ * @brief Outputs receive the sample of every cell (u,v) of the raster.
+ */
+template <typename grid_t>
+struct value
+{
+    template <typename T>
+    inline void operator () (const std::size_t u, const std::size_t v, const T sample) const
+    {
+        grid.at(u,v) = sample;
+    }
+
+    grid_t &grid;
+};
+
+/**
+ * @brief Writes OCCUPIED for samples at or above the threshold, FREE otherwise.
+ */
+template <typename grid_t, typename T>
+struct binary
+{
+    inline void operator () (const std::size_t u, const std::size_t v, const T sample) const
+    {
+        grid.at(u,v) = sample >= threshold ? grid_t::OCCUPIED : grid_t::FREE;
+    }
+
+    grid_t  &grid;
+    const T  threshold;
+};
+
+/**
+ * @brief Several outputs filled in the same pass.
+ */
+template <typename... outputs_t>
+struct all
+{
+    template <typename T>
+    inline void operator () (const std::size_t, const std::size_t, const T) const
+    {
+    }
+};
+
+template <typename output_t, typename... outputs_t>
+struct all<output_t, outputs_t...>
+{
+    template <typename T>
+    inline void operator () (const std::size_t u, const std::size_t v, const T sample) const
+    {
+        first(u, v, sample);
+        rest(u, v, sample);
+    }
+
+    output_t            first;
+    all<outputs_t...>   rest;
+};
+
+template <typename grid_t>
+inline value<grid_t> to_value(grid_t &grid)
+{
+    return value<grid_t>{grid};
+}
+
+template <typename grid_t, typename T>
+inline binary<grid_t,T> to_binary(grid_t &grid, const T threshold)
+{
+    return binary<grid_t,T>{grid, threshold};
+}
+
+inline all<> to_all()
+{
+    return all<>();
+}
+
+template <typename output_t, typename... outputs_t>
+inline all<output_t, outputs_t...> to_all(const output_t &first, const outputs_t&... rest)
+{
+    return all<output_t, outputs_t...>{first, to_all(rest...)};
+}
+}
+
+/**
+ * @brief Sample bundles of a map on a regular grid of sub-cells. Bundles are split across
+ *        threads, each bundle covers a disjoint tile of chunk_step x chunk_step cells of the
+ *        output, so no synchronization is needed. Neighbouring bundles share distributions,
+ *        which are therefore prepared up front, one storage per thread, and only read while
+ *        sampling.
+ * @param src           map
+ * @param bundles       bundles to sample
+ * @param r             sub-cell layout
+ * @param kernel        evaluates a bundle at a point in map coordinates, see kernel::likelihood
+ * @param out           receives the sample of each cell (u,v) relative to the minimum bundle
+ *                      index, several outputs are combined with output::to_all
+ * @param num_threads   maximum number of threads
+ */
+template <typename map_t, typename T, typename kernel_t, typename output_t>
+inline void rasterize(const map_t &src,
+                      const std::vector<std::pair<const typename map_t::index_t, const typename map_t::distribution_bundle_t*>> &bundles,
+                      const raster<T> &r,
+                      const kernel_t &kernel,
+                      const output_t &out,
+                      const std::size_t num_threads = cslibs_ndt::utility::default_thread_count())
+{
+    using index_t        = typename map_t::index_t;
+    using bundle_t       = typename map_t::distribution_bundle_t;
+    using distribution_t = typename map_t::distribution_t;
+
+    const auto &storages = src.getStorages();
+    cslibs_ndt::utility::parallel_for(0ul, storages.size(), [&storages, &kernel](const std::size_t i) {
+        storages[i]->traverse([&kernel](const index_t &, const distribution_t &d) {
+            kernel.prepare(d);
+        });
+    }, num_threads);
+
+    const index_t min_bi = src.getMinBundleIndex();
+    cslibs_ndt::utility::parallel_for(0ul, bundles.size(), [&bundles, &r, &min_bi, &kernel, &out](const std::size_t i) {
+        const index_t  &bi = bundles[i].first;
+        const bundle_t *b  = bundles[i].second;
+        const std::size_t u0 = static_cast<std::size_t>(bi[0] - min_bi[0]) * r.chunk_step;
+        const std::size_t v0 = static_cast<std::size_t>(bi[1] - min_bi[1]) * r.chunk_step;
+        if (kernel.empty(b)) {
+            for (int k = 0 ; k < r.chunk_step ; ++ k) {
+                for (int l = 0 ; l < r.chunk_step ; ++ l)
+                    out(u0 + k, v0 + l, T());
+            }
+            return;
+        }
+
+        const T x = static_cast<T>(bi[0]) * r.bundle_resolution;
+        const T y = static_cast<T>(bi[1]) * r.bundle_resolution;
+        for (int k = 0 ; k < r.chunk_step ; ++ k) {
+            for (int l = 0 ; l < r.chunk_step ; ++ l) {
+                const cslibs_math_2d::Point2<T> p(x + r.offsets[k], y + r.offsets[l]);
+                out(u0 + k, v0 + l, kernel(p, r.weight(bi, k, l), b));
+            }
+        }
+    }, num_threads);
+}
+
+/**
+ * @brief Sample every bundle of a map on a regular grid of sub-cells.
+ */
+template <typename map_t, typename T, typename kernel_t, typename output_t>
+inline void rasterize(const map_t &src,
+                      const raster<T> &r,
+                      const kernel_t &kernel,
+                      const output_t &out,
+                      const std::size_t num_threads = cslibs_ndt::utility::default_thread_count())
+{
+    std::vector<std::pair<const typename map_t::index_t, const typename map_t::distribution_bundle_t*>> bundles;
+    src.getBundles(bundles);
+    rasterize(src, bundles, r, kernel, out, num_threads);
+}
+
+}
+}
+
+#endif // CSLIBS_NDT_2D_CONVERSION_RASTERIZE_HPP
@@ -3,6 +3,7 @@
 
 #include <cslibs_ndt/matching/alglib/function.hpp>
 #include <cslibs_ndt/map/map.hpp>
+#include <cslibs_ndt_2d/matching/pose_jacobian.hpp>
 
 #include <optimization.h>
 
@@ -31,6 +32,43 @@ public:
     };
 
     inline static void apply(const ::alglib::real_1d_array &x, ::alglib::real_1d_array &fi, void *ptr)
+    {
+        evaluate(x, fi, nullptr, ptr);
+    }
+
+    // residuals and their analytic jacobian, e.g. for minlmcreatevj
+    inline static void applyJacobian(const ::alglib::real_1d_array &x, ::alglib::real_1d_array &fi,
+                                     ::alglib::real_2d_array &jac, void *ptr)
+    {
+        evaluate(x, fi, &jac, ptr);
+    }
+
+    inline static double mapScore(const ::alglib::real_1d_array &x, const ::alglib::real_1d_array &fi, void* ptr)
+    {
+        // check that all necessary information is given
+        const auto& casted_ptr = (Functor*)ptr;
+        if (!casted_ptr) {
+            std::cerr << "Correct Functor not given..." << std::endl;
+            return 0;
+        }
+
+        // calculate scaling
+        const Functor& object   = *casted_ptr;
+        const double num_points = object.points_->size();
+        const double scale      = 1.0 / object.map_weight_; //std::sqrt(2.0 / object.map_weight_);
+        const double absolute   = 1.0 / num_points;
+
+        // extract score from fi
+        double score = 0.0;
+        for (std::size_t i=0; i<num_points; ++i)
+            score += (absolute - (fi[i] * scale));
+
+        return score;
+    }
+
+private:
+    inline static void evaluate(const ::alglib::real_1d_array &x, ::alglib::real_1d_array &fi,
+                                ::alglib::real_2d_array *jac, void *ptr)
     {
         // check that all necessary information is given
         const auto& casted_ptr = (Functor*)ptr;
@@ -49,44 +87,40 @@ public:
         const double& rot_weight   = /*std::sqrt*/(object.rotation_weight_);    //*0.5;
 
         const typename ndt_t::pose_t current_transform(x[0],x[1],x[2]);
+        const PoseJacobian2d jacobian(x[2]);
+        typename ndt_t::gradient_t dq;
 
         // evaluate function
         std::size_t i=0;
         const double num_points =  static_cast<double>(points.size());
         for (const auto& p : points) {
             const typename ndt_t::point_t q = current_transform * typename ndt_t::point_t(p(0),p(1));
-            const double score = map.sampleNonNormalized(q);
-            fi[i++] = map_weight * (std::isnormal(score) ? (1.0 - score) : 1.0) / num_points;
+            const double score = jac ? map.sampleNonNormalized(q, dq) : map.sampleNonNormalized(q);
+            const bool normal = std::isnormal(score);
+            if (jac) {
+                const Eigen::Matrix<double,1,3> d = normal ?
+                            Eigen::Matrix<double,1,3>(-map_weight / num_points * dq.template cast<double>().transpose() * jacobian(p(0),p(1))) :
+                            Eigen::Matrix<double,1,3>::Zero();
+                for (std::size_t j=0; j<3; ++j)
+                    (*jac)[i][j] = d(j);
+            }
+            fi[i++] = map_weight * (normal ? (1.0 - score) : 1.0) / num_points;
         }
 
         // calculate translational and rotational function component
         const auto& initial_guess = (object.initial_guess_);
+        const double rot_diff = cslibs_math::common::angle::difference(x[2], initial_guess[2]);
+        if (jac) {
+            for (std::size_t r=i; r<i+3; ++r)
+                for (std::size_t j=0; j<3; ++j)
+                    (*jac)[r][j] = 0.0;
+            (*jac)[i][0]   = trans_weight;
+            (*jac)[i+1][1] = trans_weight;
+            (*jac)[i+2][2] = rot_diff > 0.0 ? rot_weight : (rot_diff < 0.0 ? -rot_weight : 0.0);
+        }
         fi[i++] = trans_weight * (x[0] - initial_guess[0]);
         fi[i++] = trans_weight * (x[1] - initial_guess[1]);
-        fi[i++] = rot_weight * std::fabs(cslibs_math::common::angle::difference(x[2], initial_guess[2]));
-    }
-
-    inline static double mapScore(const ::alglib::real_1d_array &x, const ::alglib::real_1d_array &fi, void* ptr)
-    {
-        // check that all necessary information is given
-        const auto& casted_ptr = (Functor*)ptr;
-        if (!casted_ptr) {
-            std::cerr << "Correct Functor not given..." << std::endl;
-            return 0;
-        }
-
-        // calculate scaling
-        const Functor& object   = *casted_ptr;
-        const double num_points = object.points_->size();
-        const double scale      = 1.0 / object.map_weight_; //std::sqrt(2.0 / object.map_weight_);
-        const double absolute   = 1.0 / num_points;
-
-        // extract score from fi
-        double score = 0.0;
-        for (std::size_t i=0; i<num_points; ++i)
-            score += (absolute - (fi[i] * scale));
-
-        return score;
+        fi[i++] = rot_weight * std::fabs(rot_diff);
     }
 };
 
@@ -0,0 +1,84 @@
+#ifndef CSLIBS_NDT_2D_MATCHING_CERES_GLOBAL_SEARCH_HPP
+#define CSLIBS_NDT_2D_MATCHING_CERES_GLOBAL_SEARCH_HPP
+
+#include <cslibs_ndt/matching/search/global_search.hpp>
+#include <cslibs_ndt_2d/matching/ceres/problem.hpp>
+
+namespace cslibs_ndt {
+namespace matching {
+namespace ceres {
+
+/**
+ * @brief Refine the hypotheses of a global search with the 2d scan match problem and rescore them.
+ *        Hypotheses are refined in parallel, each with its own problem, the candidates are sorted
+ *        by descending score afterwards.
+ * @param search        the global search the candidates originate from
+ * @param points        points in local coordinates
+ * @param candidates    hypotheses to be refined
+ * @param options       solver options, options.num_threads should be 1 when refining in parallel
+ * @param num_threads   number of hypotheses refined at once
+ * @param args          cost functor arguments, e.g. map and inverse sensor model
+ */
+template <typename ndt_t, Flag flag_t = Flag::DIRECT, typename points_t, typename ... args_t>
+inline void Refine2d(const search::GlobalSearch<ndt_t> &search,
+                     const points_t &points,
+                     typename search::GlobalSearch<ndt_t>::candidates_t &candidates,
+                     const ::ceres::Solver::Options &options,
+                     const std::size_t num_threads,
+                     const args_t &...args)
+{
+    using pose_t = typename ndt_t::pose_t;
+
+    utility::parallel_for(0ul, candidates.size(), [&](const std::size_t i) {
+        auto &candidate = candidates[i];
+        double translation[2] = {static_cast<double>(candidate.pose.tx()),
+                                 static_cast<double>(candidate.pose.ty())};
+        double rotation[1]    = {static_cast<double>(candidate.pose.yaw())};
+
+        ::ceres::Problem problem;
+        Problem2d<ndt_t, flag_t>(0.0, 0.0, 1.0,
+                                 cslibs_math::linear::Vector<double,2>(translation[0], translation[1]), rotation[0],
+                                 translation, rotation, problem, false, points, args...);
+
+        ::ceres::Solver::Summary summary;
+        ::ceres::Solve(options, &problem, &summary);
+        if (!summary.IsSolutionUsable())
+            return;
+
+        const pose_t refined(translation[0], translation[1], rotation[0]);
+        const double score = search.score(refined, points);
+        if (score >= candidate.score) {
+            candidate.pose  = refined;
+            candidate.score = score;
+        }
+    }, num_threads);
+
+    std::sort(candidates.begin(), candidates.end());
+}
+
+/**
+ * @brief Global relocalisation, multi-hypothesis search followed by a refinement of the best
+ *        refine_count hypotheses.
+ */
+template <typename ndt_t, Flag flag_t = Flag::DIRECT, typename points_t, typename ... args_t>
+inline typename search::GlobalSearch<ndt_t>::candidates_t
+Relocalize2d(const search::GlobalSearch<ndt_t> &search,
+             const typename ndt_t::pose_t &center,
+             const points_t &points,
+             const typename search::GlobalSearch<ndt_t>::Parameters &parameters,
+             const std::size_t refine_count,
+             const ::ceres::Solver::Options &options,
+             const args_t &...args)
+{
+    auto candidates = search.search(center, points, parameters);
+    if (candidates.size() > refine_count)
+        candidates.resize(refine_count);
+    Refine2d<ndt_t, flag_t>(search, points, candidates, options, parameters.num_threads, args...);
+    return candidates;
+}
+
+}
+}
+}
+
+#endif // CSLIBS_NDT_2D_MATCHING_CERES_GLOBAL_SEARCH_HPP
@@ -3,6 +3,7 @@
 
 #include <cslibs_ndt/map/map.hpp>
 #include <cslibs_ndt/matching/ceres/map/scan_match_cost_functor.hpp>
+#include <cslibs_ndt/matching/ceres/map/sample_grid.hpp>
 
 #include <ceres/cubic_interpolation.h>
 
@@ -98,6 +99,7 @@ class ScanMatchCostFunctor<
     using transform_t = typename ndt_t::pose_t;
     using bundle_t = typename ndt_t::distribution_bundle_t;
     using index_t = typename ndt_t::index_t;
+    using grid_t = SampleGrid<2>;
 
     template <typename>
     friend class ::ceres::BiCubicInterpolator;
@@ -115,10 +117,30 @@ protected:
     {
     }
 
+    /**
+     * @brief Interpolate on a precomputed sample grid instead of sampling the map on demand,
+     *        the grid can be created once with SampleGrid<2>::create and shared between solves.
+     */
+    explicit inline ScanMatchCostFunctor(const ndt_t& map,
+                                         const typename ivm_t::Ptr& ivm,
+                                         const typename grid_t::ConstPtr& grid) :
+        map_(map),
+        ivm_(ivm),
+        grid_(grid),
+        sampling_resolution_(grid->getSamplingResolution()),
+        interpolator_(*this)
+    {
+    }
+
     template <int _D>
     inline void Evaluate(const Eigen::Matrix<double,_D,1>& q, double* const value) const
     {
-        *value = 1.0 - map_.sampleNonNormalized(point_t(q(0),q(1)), ivm_);
+        if (grid_)
+            interpolator_.Evaluate(q(0) / sampling_resolution_,
+                                   q(1) / sampling_resolution_,
+                                   value);
+        else
+            *value = 1.0 - map_.sampleNonNormalized(point_t(q(0),q(1)), ivm_);
     }
 
     template <typename JetT, int _D>
@@ -132,6 +154,10 @@ protected:
 private:
     inline void GetValue(const int row, const int column, double* const value) const
     {
+        if (grid_) {
+            grid_->GetValue(row, column, value);
+            return;
+        }
         *value = 1.0 - map_.sampleNonNormalized(
                     point_t(row * sampling_resolution_,
                             column * sampling_resolution_),
@@ -140,6 +166,7 @@ private:
 
     const ndt_t& map_;
     const typename ivm_t::Ptr& ivm_;
+    const typename grid_t::ConstPtr grid_;
     const double sampling_resolution_;
     const ::ceres::BiCubicInterpolator<ScanMatchCostFunctor<ndt_t,Flag::INTERPOLATION>> interpolator_;
 };
@@ -3,6 +3,7 @@
 
 #include <cslibs_ndt/matching/nlopt/function.hpp>
 #include <cslibs_ndt/map/map.hpp>
+#include <cslibs_ndt_2d/matching/pose_jacobian.hpp>
 
 namespace cslibs_ndt {
 namespace matching {
@@ -32,12 +33,6 @@ public:
 
     inline static double apply(unsigned n, const double *x, double *grad, void* ptr)
     {
-        // since f is discontinuous, use derivative-free algorithms!
-        if (grad) {
-            std::cerr << "Gradient not implemented..." << std::endl;
-            return 0;
-        }
-
         // check that all necessary information is given
         const auto& casted_ptr = (Functor*)ptr;
         if (!casted_ptr) {
@@ -53,11 +48,20 @@ public:
         double fi = 0;
         const typename ndt_t::pose_t current_transform(x[0],x[1],x[2]);
 
-        // evaluate function
+        // evaluate function (and map gradient, f is only piecewise smooth at bundle borders)
+        Eigen::Matrix<double,1,3> map_grad = Eigen::Matrix<double,1,3>::Zero();
+        const PoseJacobian2d jacobian(x[2]);
+        typename ndt_t::gradient_t dq;
         for (const auto& p : points) {
             const typename ndt_t::point_t q = current_transform * typename ndt_t::point_t(p(0),p(1));
-            const double score = map.sampleNonNormalized(q);
-            fi += std::isnormal(score) ? (1.0 - score) : 1.0;
+            const double score = grad ? map.sampleNonNormalized(q, dq) : map.sampleNonNormalized(q);
+            if (std::isnormal(score)) {
+                fi += 1.0 - score;
+                if (grad)
+                    map_grad -= dq.template cast<double>().transpose() * jacobian(p(0),p(1));
+            } else {
+                fi += 1.0;
+            }
         }
 
         // calculate translational and rotational function component
@@ -66,10 +70,19 @@ public:
         const double rot_diff = cslibs_math::common::angle::difference(x[2], initial_guess[2]);
 
         // apply weights
-        fi = object.map_weight_ * fi / static_cast<double>(points.size()) +
+        const double num_points = static_cast<double>(points.size());
+        fi = object.map_weight_ * fi / num_points +
              object.translation_weight_ * trans_diff +
              object.rotation_weight_ * std::fabs(rot_diff);
 
+        if (grad) {
+            const double trans_grad = trans_diff > 0.0 ? object.translation_weight_ / trans_diff : 0.0;
+            grad[0] = object.map_weight_ * map_grad(0) / num_points + trans_grad * (x[0] - initial_guess[0]);
+            grad[1] = object.map_weight_ * map_grad(1) / num_points + trans_grad * (x[1] - initial_guess[1]);
+            grad[2] = object.map_weight_ * map_grad(2) / num_points +
+                      object.rotation_weight_ * (rot_diff > 0.0 ? 1.0 : (rot_diff < 0.0 ? -1.0 : 0.0));
+        }
+
         return fi;
     }
 
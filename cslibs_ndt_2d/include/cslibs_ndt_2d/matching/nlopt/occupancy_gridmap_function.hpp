@@ -3,6 +3,7 @@
 
 #include <cslibs_ndt/matching/nlopt/function.hpp>
 #include <cslibs_ndt/map/map.hpp>
+#include <cslibs_ndt_2d/matching/pose_jacobian.hpp>
 
 namespace cslibs_ndt {
 namespace matching {
@@ -33,12 +34,6 @@ public:
 
     inline static double apply(unsigned n, const double *x, double *grad, void* ptr)
     {
-        // since f is discontinuous, use derivative-free algorithms!
-        if (grad) {
-            std::cerr << "Gradient not implemented..." << std::endl;
-            return 0;
-        }
-
         // check that all necessary information is given
         const auto& casted_ptr = (Functor*)ptr;
         if (!casted_ptr) {
@@ -55,14 +50,21 @@ public:
         double fi = 0;
         const typename ndt_t::pose_t current_transform(x[0],x[1],x[2]);
 
-        // evaluate function
+        // evaluate function (and map gradient, f is only piecewise smooth at bundle borders)
         auto sq = [](const double& x) { return x * x; };
         const double num_points =  static_cast<double>(points.size());
+        Eigen::Matrix<double,1,3> map_grad = Eigen::Matrix<double,1,3>::Zero();
+        const PoseJacobian2d jacobian(x[2]);
+        typename ndt_t::gradient_t dq;
         for (const auto& p : points) {
             const typename ndt_t::point_t q = current_transform * typename ndt_t::point_t(p(0),p(1));
-            const double score = map.sampleNonNormalized(q, ivm);
-            fi += 0.5 * object.map_weight_ * sq((std::isnormal(score) ? (1.0 - score) : 1.0) / num_points);
+            const double score = grad ? map.sampleNonNormalized(q, ivm, dq) : map.sampleNonNormalized(q, ivm);
+            const double residual = (std::isnormal(score) ? (1.0 - score) : 1.0) / num_points;
+            fi += 0.5 * object.map_weight_ * sq(residual);
             //fi += std::isnormal(score) ? (1.0 - score) : 1.0;
+            if (grad && std::isnormal(score))
+                map_grad -= (object.map_weight_ * residual / num_points) *
+                        dq.template cast<double>().transpose() * jacobian(p(0),p(1));
         }
 
         // calculate translational and rotational function component
@@ -77,6 +79,12 @@ public:
         fi += object.translation_weight_ * (sq(x[0] - initial_guess[0]) + sq(x[1] - initial_guess[1]));
         fi += object.rotation_weight_ * sq(rot_diff);
 
+        if (grad) {
+            grad[0] = 0.5 * map_grad(0) + object.translation_weight_ * (x[0] - initial_guess[0]);
+            grad[1] = 0.5 * map_grad(1) + object.translation_weight_ * (x[1] - initial_guess[1]);
+            grad[2] = 0.5 * map_grad(2) + object.rotation_weight_ * rot_diff;
+        }
+
         return 0.5*fi;
     }
 
@@ -0,0 +1,46 @@
+#ifndef CSLIBS_NDT_2D_MATCHING_POSE_JACOBIAN_HPP
+#define CSLIBS_NDT_2D_MATCHING_POSE_JACOBIAN_HPP
+
+#include <cmath>
+#include <Eigen/Core>
+
+namespace cslibs_ndt {
+namespace matching {
+
+/**
+ * @brief Jacobian of q = R(yaw) * p + t with respect to the pose parameters (tx, ty, yaw).
+ */
+class PoseJacobian2d
+{
+public:
+    using jacobian_t = Eigen::Matrix<double,2,3>;
+
+    explicit inline PoseJacobian2d(const double yaw) :
+        cos_(std::cos(yaw)),
+        sin_(std::sin(yaw))
+    {
+    }
+
+    /**
+     * @brief Evaluate the jacobian.
+     * @param px    x coordinate of the point in local coordinates
+     * @param py    y coordinate of the point in local coordinates
+     * @return d q / d (tx, ty, yaw)
+     */
+    inline jacobian_t operator()(const double px, const double py) const
+    {
+        jacobian_t j;
+        j << 1.0, 0.0, -sin_ * px - cos_ * py,
+             0.0, 1.0,  cos_ * px - sin_ * py;
+        return j;
+    }
+
+private:
+    const double cos_;
+    const double sin_;
+};
+
+}
+}
+
+#endif // CSLIBS_NDT_2D_MATCHING_POSE_JACOBIAN_HPP
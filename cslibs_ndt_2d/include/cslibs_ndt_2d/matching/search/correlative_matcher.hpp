@@ -0,0 +1,170 @@
+#ifndef CSLIBS_NDT_2D_MATCHING_SEARCH_CORRELATIVE_MATCHER_HPP
+#define CSLIBS_NDT_2D_MATCHING_SEARCH_CORRELATIVE_MATCHER_HPP
+
+#include <cslibs_ndt/matching/search/branch_and_bound.hpp>
+#include <cslibs_ndt_2d/conversion/probability_gridmap.hpp>
+
+namespace cslibs_ndt {
+namespace matching {
+namespace search {
+
+/**
+ * @brief Real-time correlative scan matcher on a probability gridmap derived from an ndt map.
+ *        The gridmap is turned into a max-pooled score pyramid once, queries search a window
+ *        of translations and yaw angles with branch-and-bound, rotations are evaluated in
+ *        parallel. Translations are discretized with the gridmap resolution.
+ */
+template <typename T>
+class CorrelativeMatcher2d
+{
+public:
+    using Ptr        = std::shared_ptr<CorrelativeMatcher2d<T>>;
+    using ConstPtr   = std::shared_ptr<const CorrelativeMatcher2d<T>>;
+    using gridmap_t  = cslibs_gridmaps::static_maps::ProbabilityGridmap<T,T>;
+    using pose_t     = cslibs_math_2d::Pose2<T>;
+    using point_t    = cslibs_math_2d::Point2<T>;
+    using bnb_t      = BranchAndBound<2>;
+    using pyramid_t  = typename bnb_t::pyramid_t;
+
+    struct Parameters {
+        double      linear_window;  /// half extent of the translation window [m]
+        double      angular_window; /// half extent of the yaw window [rad]
+        double      angular_step;   /// [rad], <= 0: derived from the scan extent
+        double      min_score;
+        std::size_t num_threads;
+        double      time_budget;    /// [s], <= 0: unbounded
+
+        inline Parameters() :
+            linear_window(1.0),
+            angular_window(M_PI / 6.0),
+            angular_step(0.0),
+            min_score(0.5),
+            num_threads(utility::default_thread_count()),
+            time_budget(0.0)
+        {
+        }
+    };
+
+    struct EIGEN_ALIGN16 Result {
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+        pose_t pose;
+        double score    = 0.0;
+        bool   found    = false;
+        bool   complete = true;
+    };
+
+    /**
+     * @brief Build the score pyramid of a probability gridmap.
+     * @param gridmap   the gridmap, values are expected in [0, 1]
+     * @param depth     number of pyramid levels
+     */
+    inline CorrelativeMatcher2d(const gridmap_t  &gridmap,
+                                const std::size_t depth = 7) :
+        resolution_(static_cast<double>(gridmap.getResolution())),
+        w_T_g_(gridmap.getOrigin()),
+        g_T_w_(gridmap.getOrigin().inverse()),
+        pyramid_(typename pyramid_t::index_t{{static_cast<int>(gridmap.getWidth()), static_cast<int>(gridmap.getHeight())}}, depth)
+    {
+        for (int v = 0 ; v < static_cast<int>(gridmap.getHeight()) ; ++v) {
+            for (int u = 0 ; u < static_cast<int>(gridmap.getWidth()) ; ++u) {
+                const T value = cslibs_ndt_2d::conversion::validate(gridmap.at(u,v));
+                pyramid_.at({{u,v}}) = static_cast<float>(value);
+            }
+        }
+        pyramid_.build();
+    }
+
+    /**
+     * @brief Convert an ndt map with cslibs_ndt_2d::conversion::from and build the matcher.
+     * @param map                   the ndt map
+     * @param sampling_resolution   resolution of the score grid
+     * @param depth                 number of pyramid levels
+     * @param args                  additional conversion arguments, e.g. an inverse sensor model
+     */
+    template <typename ndt_t, typename ... args_t>
+    static inline Ptr create(const ndt_t &map,
+                             const T sampling_resolution,
+                             const std::size_t depth,
+                             const args_t &...args)
+    {
+        typename gridmap_t::Ptr gridmap;
+        cslibs_ndt_2d::conversion::from(map, gridmap, sampling_resolution, args...);
+        return gridmap ? Ptr(new CorrelativeMatcher2d<T>(*gridmap, depth)) : nullptr;
+    }
+
+    inline const pyramid_t& getPyramid() const
+    {
+        return pyramid_;
+    }
+
+    /**
+     * @brief Search the best pose within the window around a center pose.
+     * @param center        center of the search window in world coordinates
+     * @param points        points in local coordinates
+     * @param parameters    search parameters
+     * @return the best pose in world coordinates
+     */
+    template <typename points_t>
+    inline Result match(const pose_t     &center,
+                        const points_t   &points,
+                        const Parameters &parameters) const
+    {
+        Result result;
+        if (points.empty())
+            return result;
+
+        double max_range = 0.0;
+        for (const auto &p : points)
+            max_range = std::max(max_range, static_cast<double>(p.length()));
+        double angular_step = parameters.angular_step;
+        if (angular_step <= 0.0) {
+            angular_step = max_range > resolution_ ?
+                        std::acos(1.0 - (resolution_ * resolution_) / (2.0 * max_range * max_range)) : 0.1;
+        }
+        const int yaw_steps = static_cast<int>(std::ceil(parameters.angular_window / angular_step));
+
+        const pose_t g_center = g_T_w_ * center;
+        const double resolution_inv = 1.0 / resolution_;
+        auto rotate = [&](const std::size_t k, typename bnb_t::cells_t &cells) {
+            const pose_t pose(g_center.tx(), g_center.ty(),
+                              g_center.yaw() + static_cast<T>((static_cast<int>(k) - yaw_steps) * angular_step));
+            cells.reserve(points.size());
+            for (const auto &p : points) {
+                const point_t q = pose * p;
+                cells.emplace_back(static_cast<double>(q(0)) * resolution_inv,
+                                   static_cast<double>(q(1)) * resolution_inv);
+            }
+        };
+
+        typename bnb_t::Parameters bnb_parameters;
+        bnb_parameters.linear_window.fill(static_cast<int>(std::ceil(parameters.linear_window * resolution_inv)));
+        bnb_parameters.min_score   = parameters.min_score;
+        bnb_parameters.num_threads = parameters.num_threads;
+        bnb_parameters.time_budget = parameters.time_budget;
+
+        const typename bnb_t::Result r = bnb_t::match(pyramid_, static_cast<std::size_t>(2 * yaw_steps + 1), rotate, bnb_parameters);
+        result.found    = r.found;
+        result.complete = r.complete;
+        result.score    = r.score;
+        if (r.found) {
+            const pose_t pose(g_center.tx() + static_cast<T>(r.offset[0] * resolution_),
+                              g_center.ty() + static_cast<T>(r.offset[1] * resolution_),
+                              g_center.yaw() + static_cast<T>((static_cast<int>(r.rotation) - yaw_steps) * angular_step));
+            result.pose = w_T_g_ * pose;
+        }
+        return result;
+    }
+
+private:
+    const double resolution_;
+    const pose_t w_T_g_;
+    const pose_t g_T_w_;
+    pyramid_t    pyramid_;
+};
+
+}
+}
+}
+
+#endif // CSLIBS_NDT_2D_MATCHING_SEARCH_CORRELATIVE_MATCHER_HPP
@@ -2,7 +2,12 @@
 #define CSLIBS_NDT_2D_SERIALIZATION_HPP
 
 #include <cslibs_ndt/map/map.hpp>
+#include <cslibs_ndt/serialization/async.hpp>
+#include <cslibs_ndt/serialization/compressed.hpp>
+#include <cslibs_ndt/serialization/delta_log.hpp>
 #include <cslibs_ndt/serialization/map.hpp>
+#include <cslibs_ndt/serialization/mapped_map.hpp>
+#include <cslibs_ndt/serialization/tiled_map.hpp>
 
 namespace cslibs_ndt_2d {
 namespace serialization {
@@ -27,6 +32,116 @@ inline bool loadBinary(const std::string &path,
     return cslibs_ndt::serialization::binary<option_t,2,data_t,T,backend_t>::load(path,map);
 }
 
+template <cslibs_ndt::map::tags::option option_t,
+          template <typename,std::size_t> class data_t,
+          typename T,
+          template <typename, typename, typename...> class backend_t>
+inline std::future<bool> saveBinaryAsync(const cslibs_ndt::map::Map<option_t,2,data_t,T,backend_t> &map,
+                                         const std::string &path)
+{
+    return cslibs_ndt::serialization::async<option_t,2,data_t,T,backend_t>::save(map,path);
+}
+
+template <cslibs_ndt::map::tags::option option_t,
+          template <typename,std::size_t> class data_t,
+          typename T,
+          template <typename, typename, typename...> class backend_t>
+inline void saveBinaryAsync(const cslibs_ndt::map::Map<option_t,2,data_t,T,backend_t> &map,
+                            const std::string &path,
+                            const std::function<void(const bool)> &callback)
+{
+    cslibs_ndt::serialization::async<option_t,2,data_t,T,backend_t>::save(map,path,callback);
+}
+
+template <cslibs_ndt::map::tags::option option_t,
+          template <typename,std::size_t> class data_t,
+          typename T,
+          template <typename, typename, typename...> class backend_t>
+inline bool saveFile(const cslibs_ndt::map::Map<option_t,2,data_t,T,backend_t> &map,
+                     const std::string &path)
+{
+    return cslibs_ndt::serialization::single_file<option_t,2,data_t,T,backend_t>::save(map,path);
+}
+
+template <cslibs_ndt::map::tags::option option_t,
+          template <typename,std::size_t> class data_t,
+          typename T,
+          template <typename, typename, typename...> class backend_t>
+inline bool loadFile(const std::string &path,
+                     typename cslibs_ndt::map::Map<option_t,2,data_t,T,backend_t>::Ptr& map)
+{
+    return cslibs_ndt::serialization::single_file<option_t,2,data_t,T,backend_t>::load(path,map);
+}
+
+template <cslibs_ndt::map::tags::option option_t,
+          template <typename,std::size_t> class data_t,
+          typename T,
+          template <typename, typename, typename...> class backend_t>
+inline bool saveCompressed(const cslibs_ndt::map::Map<option_t,2,data_t,T,backend_t> &map,
+                           const std::string &path,
+                           const cslibs_ndt::serialization::codec::type codec = cslibs_ndt::serialization::codec::type::lz,
+                           const double precision = 0.0)
+{
+    return cslibs_ndt::serialization::compressed_file<option_t,2,data_t,T,backend_t>::save(map,path,codec,precision);
+}
+
+template <cslibs_ndt::map::tags::option option_t,
+          template <typename,std::size_t> class data_t,
+          typename T,
+          template <typename, typename, typename...> class backend_t>
+inline bool loadCompressed(const std::string &path,
+                           typename cslibs_ndt::map::Map<option_t,2,data_t,T,backend_t>::Ptr& map)
+{
+    return cslibs_ndt::serialization::compressed_file<option_t,2,data_t,T,backend_t>::load(path,map);
+}
+
+template <cslibs_ndt::map::tags::option option_t,
+          template <typename,std::size_t> class data_t,
+          typename T,
+          template <typename, typename, typename...> class backend_t>
+inline typename cslibs_ndt::serialization::DeltaLog<option_t,2,data_t,T,backend_t>::Ptr createDeltaLog(const cslibs_ndt::map::Map<option_t,2,data_t,T,backend_t> &map,
+                                                                                                         const std::string &path,
+                                                                                                         const std::size_t compaction_size = cslibs_ndt::serialization::delta::default_compaction_size)
+{
+    return cslibs_ndt::serialization::DeltaLog<option_t,2,data_t,T,backend_t>::create(map,path,compaction_size);
+}
+
+template <cslibs_ndt::map::tags::option option_t,
+          template <typename,std::size_t> class data_t,
+          typename T,
+          template <typename, typename, typename...> class backend_t>
+inline bool loadDeltaLog(const std::string &path,
+                         typename cslibs_ndt::map::Map<option_t,2,data_t,T,backend_t>::Ptr& map)
+{
+    return cslibs_ndt::serialization::DeltaLog<option_t,2,data_t,T,backend_t>::load(path,map);
+}
+
+template <template <typename,std::size_t> class data_t,
+          typename T>
+inline typename cslibs_ndt::serialization::MappedMap<2,data_t,T>::Ptr mapFile(const std::string &path)
+{
+    return cslibs_ndt::serialization::MappedMap<2,data_t,T>::open(path);
+}
+
+template <template <typename,std::size_t> class data_t,
+          typename T,
+          template <typename, typename, typename...> class backend_t>
+inline bool saveTiled(const cslibs_ndt::map::Map<cslibs_ndt::map::tags::dynamic_map,2,data_t,T,backend_t> &map,
+                      const std::string &path,
+                      const std::size_t tile_size = 32ul)
+{
+    return cslibs_ndt::serialization::tiled<2,data_t,T,backend_t>::save(map,path,tile_size);
+}
+
+template <template <typename,std::size_t> class data_t,
+          typename T,
+          template <typename, typename, typename...> class backend_t =
+              cslibs_ndt::map::tags::default_types<cslibs_ndt::map::tags::dynamic_map>::template default_backend_t>
+inline typename cslibs_ndt::serialization::TiledMap<2,data_t,T,backend_t>::Ptr openTiled(const std::string &path)
+{
+    return cslibs_ndt::serialization::TiledMap<2,data_t,T,backend_t>::open(path);
+}
+
 // TODO: load with only one template arg?
 
 }
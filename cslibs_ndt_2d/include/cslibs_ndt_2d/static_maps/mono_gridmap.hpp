@@ -54,11 +54,11 @@ public:
         w_T_m_(origin),
         m_T_w_(w_T_m_.inverse()),
         size_(size),
-        size_m_{{(size[0] + 1) * resolution,
-        (size[1] + 1) * resolution}},
+        size_m_{{size[0] * resolution,
+        size[1] * resolution}},
         min_index_(min_index),
-        max_index_{{min_index[0] + static_cast<int>(size[0]),
-        min_index[1] + static_cast<int>(size[1])}},
+        max_index_{{min_index[0] + static_cast<int>(size[0]) - 1,
+        min_index[1] + static_cast<int>(size[1]) - 1}},
         storage_(distribution_storage_ptr_t(new distribution_storage_t))
     {
         storage_->template set<cis::option::tags::array_size>(size[0], size[1]);
@@ -76,17 +76,36 @@ public:
         w_T_m_(origin_x, origin_y, origin_phi),
         m_T_w_(w_T_m_.inverse()),
         size_(size),
-        size_m_{{(size[0] + 1) * resolution,
-        (size[1] + 1) * resolution}},
+        size_m_{{size[0] * resolution,
+        size[1] * resolution}},
         min_index_(min_index),
-        max_index_{{min_index[0] + static_cast<int>(size[0]),
-        min_index[1] + static_cast<int>(size[1])}},
+        max_index_{{min_index[0] + static_cast<int>(size[0]) - 1,
+        min_index[1] + static_cast<int>(size[1]) - 1}},
         storage_(distribution_storage_ptr_t(new distribution_storage_t))
     {
         storage_->template set<cis::option::tags::array_size>(size[0], size[1]);
         storage_->template set<cis::option::tags::array_offset>(min_index[0], min_index[1]);
     }
 
+    inline Gridmap(const pose_t                     &origin,
+                   const T                          &resolution,
+                   const size_t                     &size,
+                   const index_t                    &min_index,
+                   const distribution_storage_ptr_t &storage) :
+        resolution_(resolution),
+        resolution_inv_(1.0 / resolution_),
+        w_T_m_(origin),
+        m_T_w_(w_T_m_.inverse()),
+        size_(size),
+        size_m_{{size[0] * resolution,
+        size[1] * resolution}},
+        min_index_(min_index),
+        max_index_{{min_index[0] + static_cast<int>(size[0]) - 1,
+        min_index[1] + static_cast<int>(size[1]) - 1}},
+        storage_(storage)
+    {
+    }
+
     inline Gridmap(const Gridmap &other) :
         resolution_(other.resolution_),
         resolution_inv_(other.resolution_inv_),
@@ -172,7 +191,7 @@ public:
             return;
 
         distribution_t *distribution = getAllocate(i);
-        distribution->data().add(p);
+        *distribution += p;
     }
 
     inline T sample(const point_t &p) const
@@ -187,7 +206,7 @@ public:
         distribution_t *distribution;
         distribution = storage_->get(i);
 
-        return distribution ? distribution->data().sample(p) : 0.0;
+        return distribution ? distribution->sample(p) : 0.0;
     }
 
     inline T sampleNonNormalized(const point_t &p) const
@@ -200,7 +219,7 @@ public:
                                  const index_t &i) const
     {
         distribution_t *distribution  = storage_->get(i);
-        return distribution ? distribution->data().sampleNonNormalized(p) : 0.0;
+        return distribution ? distribution->sampleNonNormalized(p) : 0.0;
     }
 
     inline distribution_t* get(const point_t &p) const
@@ -0,0 +1,15 @@
+#include <cslibs_ndt_2d/dynamic_maps/gridmap.hpp>
+#include <cslibs_ndt_2d/dynamic_maps/occupancy_gridmap.hpp>
+#include <cslibs_ndt_2d/static_maps/gridmap.hpp>
+#include <cslibs_ndt_2d/static_maps/occupancy_gridmap.hpp>
+
+#include <cslibs_ndt/serialization/converter_tool.hpp>
+
+/**
+ * Converts 2D maps between the serialization formats, static and dynamic layouts and resolutions,
+ * see cslibs_ndt/serialization/converter_tool.hpp for the options.
+ */
+int main(int argc, char *argv[])
+{
+    return cslibs_ndt::serialization::ConverterTool<2>::run(argc, argv, "cslibs_ndt_2d_map_converter");
+}
@@ -0,0 +1,13 @@
+#include <cslibs_ndt_2d/serialization/dynamic_maps/gridmap.hpp>
+#include <cslibs_ndt_2d/serialization/dynamic_maps/occupancy_gridmap.hpp>
+
+#include <cslibs_ndt/serialization/benchmark.hpp>
+
+/**
+ * Measures the throughput of the binary serialization of 2D maps,
+ * see cslibs_ndt/serialization/benchmark.hpp for the options.
+ */
+int main(int argc, char *argv[])
+{
+    return cslibs_ndt::serialization::SerializationBenchmark<2>::run(argc, argv, "cslibs_ndt_2d_serialization_benchmark");
+}
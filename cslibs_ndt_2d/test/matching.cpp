@@ -0,0 +1,313 @@
+#include <gtest/gtest.h>
+
+#include <cslibs_ndt_2d/dynamic_maps/gridmap.hpp>
+#include <cslibs_ndt_2d/dynamic_maps/occupancy_gridmap.hpp>
+#include <cslibs_ndt_2d/matching/search/correlative_matcher.hpp>
+#include <cslibs_ndt/matching/search/global_search.hpp>
+#include <cslibs_ndt/matching/ceres/map/sample_grid.hpp>
+
+#include <cslibs_math/random/random.hpp>
+
+const std::size_t NUM_MAP_SAMPLES  = 4000;
+const std::size_t NUM_SCAN_SAMPLES = 100;
+const std::size_t NUM_TEST_SAMPLES = 1000;
+
+template <std::size_t Dim>
+using rng_t = typename cslibs_math::random::Uniform<double, Dim>;
+
+using points_t = std::vector<cslibs_math_2d::Point2d>;
+
+/// walls of a room with some clutter inside
+points_t generateScene()
+{
+    rng_t<1> rng_t01(0.0, 1.0);
+    rng_t<1> rng_noise(-0.05, 0.05);
+
+    const std::vector<std::array<double,4>> segments = {{
+        {{-8.0, -6.0,  8.0, -6.0}},
+        {{ 8.0, -6.0,  8.0,  6.0}},
+        {{ 8.0,  6.0, -8.0,  6.0}},
+        {{-8.0,  6.0, -8.0, -6.0}},
+        {{-3.0, -6.0, -3.0, -1.0}},
+        {{ 2.0,  1.0,  6.0,  3.0}}
+    }};
+
+    points_t points;
+    for (std::size_t i = 0 ; i < NUM_MAP_SAMPLES ; ++i) {
+        const std::array<double,4> &s = segments[i % segments.size()];
+        const double t = rng_t01.get();
+        points.emplace_back(s[0] + t * (s[2] - s[0]) + rng_noise.get(),
+                            s[1] + t * (s[3] - s[1]) + rng_noise.get());
+    }
+    return points;
+}
+
+points_t generateScan(const points_t &scene,
+                      const cslibs_math_2d::Transform2d &w_T_s)
+{
+    rng_t<1> rng_index(0.0, static_cast<double>(scene.size()));
+    const cslibs_math_2d::Transform2d s_T_w = w_T_s.inverse();
+
+    points_t scan;
+    for (std::size_t i = 0 ; i < NUM_SCAN_SAMPLES ; ++i)
+        scan.emplace_back(s_T_w * scene[static_cast<std::size_t>(rng_index.get()) % scene.size()]);
+    return scan;
+}
+
+/// evaluates every pose of the search grid without pruning
+template <typename search_t>
+double exhaustiveMax(const search_t &search,
+                     const cslibs_math_2d::Transform2d &center,
+                     const points_t &scan,
+                     const typename search_t::Parameters &parameters)
+{
+    const double linear_step = search.getLinearStep();
+    const int    yaw_steps   = static_cast<int>(std::ceil(parameters.angular_window / parameters.angular_step));
+    const int    x_steps     = static_cast<int>(std::ceil(parameters.linear_window[0] / linear_step));
+    const int    y_steps     = static_cast<int>(std::ceil(parameters.linear_window[1] / linear_step));
+
+    double best = 0.0;
+    for (int k = -yaw_steps ; k <= yaw_steps ; ++k) {
+        for (int x = -x_steps ; x <= x_steps ; ++x) {
+            for (int y = -y_steps ; y <= y_steps ; ++y) {
+                const cslibs_math_2d::Transform2d pose(center.tx()  + x * linear_step,
+                                                       center.ty()  + y * linear_step,
+                                                       center.yaw() + k * parameters.angular_step);
+                best = std::max(best, search.score(pose, scan));
+            }
+        }
+    }
+    return best;
+}
+
+template <typename search_t>
+typename search_t::Parameters generateParameters()
+{
+    typename search_t::Parameters parameters;
+    parameters.linear_window.fill(1.5);
+    parameters.angular_window = 0.2;
+    parameters.angular_step   = 0.05;
+    parameters.max_candidates = 1;
+    parameters.min_score      = 0.0;
+    return parameters;
+}
+
+TEST(Test_cslibs_ndt_2d, testGlobalSearchGridmap)
+{
+    using map_t    = cslibs_ndt_2d::dynamic_maps::Gridmap<double>;
+    using search_t = cslibs_ndt::matching::search::GlobalSearch<map_t>;
+    rng_t<1> rng_yaw(-M_PI, M_PI);
+    rng_t<1> rng_offset(-1.0, 1.0);
+
+    const points_t scene = generateScene();
+    const cslibs_math_2d::Transform2d origin(rng_offset.get(), rng_offset.get(), rng_yaw.get());
+    map_t map(origin, 1.0);
+    cslibs_math_2d::Pointcloud2<double>::Ptr cloud(new cslibs_math_2d::Pointcloud2<double>());
+    for (const auto &p : scene)
+        cloud->insert(p);
+    map.insert(cloud);
+
+    const cslibs_math_2d::Transform2d w_T_s(rng_offset.get(), rng_offset.get(), 0.5 * rng_yaw.get());
+    const points_t scan = generateScan(scene, w_T_s);
+    const cslibs_math_2d::Transform2d center(w_T_s.tx()  + 0.5 * rng_offset.get(),
+                                             w_T_s.ty()  + 0.5 * rng_offset.get(),
+                                             w_T_s.yaw() + 0.1 * rng_offset.get());
+
+    const search_t search(map, 0.25, 4);
+    const typename search_t::Parameters parameters = generateParameters<search_t>();
+    const typename search_t::candidates_t candidates = search.search(center, scan, parameters);
+    ASSERT_FALSE(candidates.empty());
+
+    /// pruning must not lose the best pose of the grid
+    const double best = exhaustiveMax(search, center, scan, parameters);
+    EXPECT_GT(best, 0.0);
+    EXPECT_NEAR(candidates.front().score, search.score(candidates.front().pose, scan), 1e-6);
+    EXPECT_GE(candidates.front().score, best - 1e-6);
+}
+
+TEST(Test_cslibs_ndt_2d, testGlobalSearchOccupancyGridmap)
+{
+    using map_t    = cslibs_ndt_2d::dynamic_maps::OccupancyGridmap<double>;
+    using ivm_t    = cslibs_gridmaps::utility::InverseModel<double>;
+    using search_t = cslibs_ndt::matching::search::GlobalSearch<map_t>;
+    rng_t<1> rng_yaw(-M_PI, M_PI);
+    rng_t<1> rng_offset(-1.0, 1.0);
+
+    const points_t scene = generateScene();
+    const cslibs_math_2d::Transform2d origin(rng_offset.get(), rng_offset.get(), rng_yaw.get());
+    map_t map(origin, 1.0);
+    cslibs_math_2d::Pointcloud2<double>::Ptr cloud(new cslibs_math_2d::Pointcloud2<double>());
+    for (const auto &p : scene)
+        cloud->insert(p);
+    map.insert(cloud, cslibs_math_2d::Transform2d());
+
+    const cslibs_math_2d::Transform2d w_T_s(rng_offset.get(), rng_offset.get(), 0.5 * rng_yaw.get());
+    const points_t scan = generateScan(scene, w_T_s);
+    const cslibs_math_2d::Transform2d center(w_T_s.tx()  + 0.5 * rng_offset.get(),
+                                             w_T_s.ty()  + 0.5 * rng_offset.get(),
+                                             w_T_s.yaw() + 0.1 * rng_offset.get());
+
+    const typename ivm_t::Ptr ivm(new ivm_t(0.5, 0.45, 0.65));
+    const search_t search(map, 0.25, 4, ivm);
+    const typename search_t::Parameters parameters = generateParameters<search_t>();
+    const typename search_t::candidates_t candidates = search.search(center, scan, parameters);
+    ASSERT_FALSE(candidates.empty());
+
+    const double best = exhaustiveMax(search, center, scan, parameters);
+    EXPECT_GT(best, 0.0);
+    EXPECT_GE(candidates.front().score, best - 1e-6);
+}
+
+template <typename map_t>
+typename map_t::Ptr generateMap(const points_t &scene)
+{
+    rng_t<1> rng_yaw(-M_PI, M_PI);
+    rng_t<1> rng_offset(-1.0, 1.0);
+
+    const cslibs_math_2d::Transform2d origin(rng_offset.get(), rng_offset.get(), rng_yaw.get());
+    typename map_t::Ptr map(new map_t(origin, 1.0));
+    cslibs_math_2d::Pointcloud2<double>::Ptr cloud(new cslibs_math_2d::Pointcloud2<double>());
+    for (const auto &p : scene)
+        cloud->insert(p);
+    map->insert(cloud);
+    return map;
+}
+
+/// central differences of the non-normalized sample, only where the bundle does not change
+template <typename map_t, typename sample_t>
+bool finiteDifferences(const map_t &map,
+                       const cslibs_math_2d::Point2d &p,
+                       const sample_t &sample,
+                       Eigen::Vector2d &gradient)
+{
+    const double h = 1e-6;
+    const auto *bundle = map.get(p);
+    if (!bundle)
+        return false;
+
+    for (std::size_t i = 0 ; i < 2 ; ++i) {
+        const cslibs_math_2d::Point2d lo(p(0) - (i == 0 ? h : 0.0), p(1) - (i == 1 ? h : 0.0));
+        const cslibs_math_2d::Point2d hi(p(0) + (i == 0 ? h : 0.0), p(1) + (i == 1 ? h : 0.0));
+        if (map.get(lo) != bundle || map.get(hi) != bundle)
+            return false;
+        gradient(i) = (sample(hi) - sample(lo)) / (2.0 * h);
+    }
+    return true;
+}
+
+TEST(Test_cslibs_ndt_2d, testGradientGridmap)
+{
+    using map_t = cslibs_ndt_2d::dynamic_maps::Gridmap<double>;
+    rng_t<1> rng_offset(-0.3, 0.3);
+
+    const points_t scene = generateScene();
+    const typename map_t::Ptr map = generateMap<map_t>(scene);
+    auto sample = [&map](const cslibs_math_2d::Point2d &p) {
+        return map->sampleNonNormalized(p);
+    };
+
+    std::size_t checked = 0;
+    for (std::size_t i = 0 ; i < NUM_TEST_SAMPLES ; ++i) {
+        const cslibs_math_2d::Point2d p(scene[i](0) + rng_offset.get(), scene[i](1) + rng_offset.get());
+        typename map_t::gradient_t gradient;
+        const double s = map->sampleNonNormalized(p, gradient);
+        EXPECT_NEAR(s, sample(p), 1e-9);
+
+        Eigen::Vector2d expected;
+        if (!finiteDifferences(*map, p, sample, expected))
+            continue;
+        ++checked;
+        EXPECT_NEAR(gradient(0), expected(0), 1e-4);
+        EXPECT_NEAR(gradient(1), expected(1), 1e-4);
+    }
+    EXPECT_GT(checked, NUM_TEST_SAMPLES / 2);
+}
+
+TEST(Test_cslibs_ndt_2d, testGradientOccupancyGridmap)
+{
+    using map_t = cslibs_ndt_2d::dynamic_maps::OccupancyGridmap<double>;
+    using ivm_t = cslibs_gridmaps::utility::InverseModel<double>;
+    rng_t<1> rng_offset(-0.3, 0.3);
+
+    const points_t scene = generateScene();
+    const typename map_t::Ptr map = generateMap<map_t>(scene);
+    const typename ivm_t::Ptr ivm(new ivm_t(0.5, 0.45, 0.65));
+    auto sample = [&map, &ivm](const cslibs_math_2d::Point2d &p) {
+        return map->sampleNonNormalized(p, ivm);
+    };
+
+    std::size_t checked = 0;
+    for (std::size_t i = 0 ; i < NUM_TEST_SAMPLES ; ++i) {
+        const cslibs_math_2d::Point2d p(scene[i](0) + rng_offset.get(), scene[i](1) + rng_offset.get());
+        typename map_t::gradient_t gradient;
+        const double s = map->sampleNonNormalized(p, ivm, gradient);
+        EXPECT_NEAR(s, sample(p), 1e-9);
+
+        Eigen::Vector2d expected;
+        if (!finiteDifferences(*map, p, sample, expected))
+            continue;
+        ++checked;
+        EXPECT_NEAR(gradient(0), expected(0), 1e-4);
+        EXPECT_NEAR(gradient(1), expected(1), 1e-4);
+    }
+    EXPECT_GT(checked, NUM_TEST_SAMPLES / 2);
+}
+
+TEST(Test_cslibs_ndt_2d, testSampleGrid)
+{
+    using map_t  = cslibs_ndt_2d::dynamic_maps::Gridmap<double>;
+    using grid_t = cslibs_ndt::matching::ceres::SampleGrid<2>;
+    rng_t<1> rng_offset(-0.3, 0.3);
+
+    const points_t scene = generateScene();
+    const typename map_t::Ptr map = generateMap<map_t>(scene);
+    const double resolution = 0.1;
+    const typename grid_t::Ptr grid = grid_t::create(*map, resolution);
+    EXPECT_NE(grid, nullptr);
+    EXPECT_GT(grid->getTileCount(), 0ul);
+
+    /// cell c holds the cost of the world point c * resolution
+    for (std::size_t i = 0 ; i < NUM_TEST_SAMPLES ; ++i) {
+        const typename grid_t::index_t c = {{static_cast<int>(std::floor((scene[i](0) + rng_offset.get()) / resolution)),
+                                             static_cast<int>(std::floor((scene[i](1) + rng_offset.get()) / resolution))}};
+        const cslibs_math_2d::Point2d p(c[0] * resolution, c[1] * resolution);
+        EXPECT_NEAR(grid->at(c), 1.0 - map->sampleNonNormalized(p), 1e-9);
+    }
+}
+
+TEST(Test_cslibs_ndt_2d, testCorrelativeMatcher)
+{
+    using map_t     = cslibs_ndt_2d::dynamic_maps::Gridmap<double>;
+    using matcher_t = cslibs_ndt::matching::search::CorrelativeMatcher2d<double>;
+    rng_t<1> rng_yaw(-M_PI, M_PI);
+    rng_t<1> rng_offset(-1.0, 1.0);
+
+    const points_t scene = generateScene();
+    const typename map_t::Ptr map = generateMap<map_t>(scene);
+    const double resolution = 0.05;
+    const typename matcher_t::Ptr matcher = matcher_t::create(*map, resolution, 7ul);
+    ASSERT_NE(matcher, nullptr);
+
+    /// the scan is seen from a known pose, the search starts at a known offset to it
+    const cslibs_math_2d::Transform2d w_T_s(rng_offset.get(), rng_offset.get(), 0.5 * rng_yaw.get());
+    const points_t scan = generateScan(scene, w_T_s);
+    const cslibs_math_2d::Transform2d center(w_T_s.tx() + 0.3, w_T_s.ty() - 0.2, w_T_s.yaw() + 0.05);
+
+    typename matcher_t::Parameters parameters;
+    parameters.linear_window  = 0.5;
+    parameters.angular_window = 0.1;
+    parameters.min_score      = 0.1;
+    const typename matcher_t::Result result = matcher->match(center, scan, parameters);
+
+    EXPECT_TRUE(result.found);
+    EXPECT_TRUE(result.complete);
+    EXPECT_NEAR(result.pose.tx(),  w_T_s.tx(),  2.0 * resolution);
+    EXPECT_NEAR(result.pose.ty(),  w_T_s.ty(),  2.0 * resolution);
+    EXPECT_NEAR(cslibs_math::common::angle::difference(result.pose.yaw(), w_T_s.yaw()), 0.0, 0.02);
+}
+
+int main(int argc, char *argv[])
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
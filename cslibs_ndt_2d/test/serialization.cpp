@@ -4,11 +4,21 @@
 #include <cslibs_ndt_2d/serialization/dynamic_maps/occupancy_gridmap.hpp>
 #include <cslibs_ndt_2d/serialization/static_maps/gridmap.hpp>
 #include <cslibs_ndt_2d/serialization/static_maps/occupancy_gridmap.hpp>
+#include <cslibs_ndt_2d/serialization/serialization.hpp>
+#include <cslibs_ndt/serialization/converter.hpp>
+#include <cslibs_ndt/conversion/fuse.hpp>
 
 #include <cslibs_ndt_2d/conversion/gridmap.hpp>
 #include <cslibs_ndt_2d/conversion/occupancy_gridmap.hpp>
+#include <cslibs_ndt_2d/conversion/probability_gridmap.hpp>
+#include <cslibs_ndt_2d/conversion/distance_gridmap.hpp>
+#include <cslibs_ndt_2d/conversion/likelihood_field_gridmap.hpp>
+#include <cslibs_ndt_2d/conversion/incremental.hpp>
+#include <cslibs_ndt_2d/conversion/distributions.hpp>
+#include <cslibs_ndt_2d/conversion/merge.hpp>
 
 #include <cslibs_math/random/random.hpp>
+#include <algorithm>
 #include <fstream>
 
 const std::size_t MIN_NUM_SAMPLES = 10;
@@ -354,6 +364,190 @@ TEST(Test_cslibs_ndt_2d, testStaticOccupancyGridmapConversion)
     testStaticOccMap(map, map_double_converted);
 }
 
+/// the bundle-wise conversion which the bulk conversion replaced, empty distributions stay default
+template <typename src_map_t, typename dst_map_t>
+void convertPerBundle(const typename src_map_t::Ptr &src,
+                      const typename dst_map_t::Ptr &dst)
+{
+    using index_t = typename src_map_t::index_t;
+    using db_t    = typename src_map_t::distribution_bundle_t;
+    src->traverse([&dst](const index_t &bi, const db_t &b) {
+        if (const typename dst_map_t::distribution_bundle_t *b_dst = dst->getDistributionBundle(bi)) {
+            for (std::size_t i = 0 ; i < 4 ; ++ i) {
+                if (b.at(i) && (b.at(i)->numFree() > 0 || b.at(i)->numOccupied() > 0))
+                    *(b_dst->at(i)) = *(b.at(i));
+            }
+        }
+    });
+}
+
+template <typename map_t>
+void testOccMapsEqual(const typename map_t::Ptr &expected,
+                      const typename map_t::Ptr &map)
+{
+    ASSERT_NE(map, nullptr);
+    for (std::size_t j = 0 ; j < 2 ; ++ j) {
+        EXPECT_EQ(expected->getMinBundleIndex()[j], map->getMinBundleIndex()[j]);
+        EXPECT_EQ(expected->getMaxBundleIndex()[j], map->getMaxBundleIndex()[j]);
+    }
+
+    using index_t = typename map_t::index_t;
+    using db_t    = typename map_t::distribution_bundle_t;
+    std::vector<index_t> indices;
+    std::vector<index_t> expected_indices;
+    map->getBundleIndices(indices);
+    expected->getBundleIndices(expected_indices);
+    EXPECT_EQ(expected_indices.size(), indices.size());
+
+    expected->traverse([&map](const index_t &bi, const db_t &b) {
+        const db_t *bb = map->get(bi);
+        ASSERT_NE(bb, nullptr);
+        for (std::size_t i = 0 ; i < 4 ; ++ i) {
+            ASSERT_NE(bb->at(i), nullptr);
+            EXPECT_EQ(b.at(i)->numFree(),     bb->at(i)->numFree());
+            EXPECT_EQ(b.at(i)->numOccupied(), bb->at(i)->numOccupied());
+
+            const auto d  = b.at(i)->getDistribution();
+            const auto dd = bb->at(i)->getDistribution();
+            EXPECT_EQ(d == nullptr, dd == nullptr);
+            if (d && dd) {
+                EXPECT_EQ(d->getN(), dd->getN());
+                for (std::size_t j = 0 ; j < 2 ; ++ j)
+                    EXPECT_NEAR(d->getMean()(j), dd->getMean()(j), 1e-6);
+            }
+        }
+    });
+}
+
+TEST(Test_cslibs_ndt_2d, testOccupancyGridmapConversionPerBundle)
+{
+    using dynamic_map_t = cslibs_ndt_2d::dynamic_maps::OccupancyGridmap<double>;
+    using static_map_t  = cslibs_ndt_2d::static_maps::OccupancyGridmap<double>;
+    const typename dynamic_map_t::Ptr map = generateDynamicOccMap();
+
+    // the bulk conversion matches the bundle-wise one, in both directions
+    const typename static_map_t::Ptr static_map = cslibs_ndt_2d::conversion::from<double>(map);
+    ASSERT_NE(static_map, nullptr);
+    const typename static_map_t::Ptr static_expected(new static_map_t(map->getInitialOrigin(),
+                                                                      map->getResolution(),
+                                                                      static_map->getSize(),
+                                                                      static_map->getMinBundleIndex()));
+    convertPerBundle<dynamic_map_t,static_map_t>(map, static_expected);
+    testOccMapsEqual<static_map_t>(static_expected, static_map);
+
+    const typename dynamic_map_t::Ptr dynamic_map = cslibs_ndt_2d::conversion::from<double>(static_map);
+    const typename dynamic_map_t::Ptr dynamic_expected(new dynamic_map_t(map->getInitialOrigin(),
+                                                                         map->getResolution()));
+    convertPerBundle<static_map_t,dynamic_map_t>(static_map, dynamic_expected);
+    testOccMapsEqual<dynamic_map_t>(dynamic_expected, dynamic_map);
+    testOccMapsEqual<dynamic_map_t>(map, dynamic_map);
+}
+
+TEST(Test_cslibs_ndt_2d, testDynamicGridmapMerge)
+{
+    using map_t   = cslibs_ndt_2d::dynamic_maps::Gridmap<double>;
+    using mono_t  = cslibs_ndt_2d::static_maps::mono::Gridmap<double>;
+    using index_t = typename map_t::index_t;
+    using db_t    = typename map_t::distribution_bundle_t;
+    using d_t     = typename map_t::distribution_t;
+    const typename map_t::Ptr map = generateDynamicMap();
+
+    const typename mono_t::Ptr merged = cslibs_ndt_2d::conversion::merge<double>(map);
+    ASSERT_NE(merged, nullptr);
+    for (std::size_t j = 0 ; j < 2 ; ++ j) {
+        EXPECT_EQ(map->getMinBundleIndex()[j], merged->getMinIndex()[j]);
+        EXPECT_EQ(map->getMaxBundleIndex()[j], merged->getMaxIndex()[j]);
+    }
+
+    // every cell holds the sum of the distributions of the bundle at its index
+    std::size_t bundles = 0;
+    map->traverse([&bundles](const index_t &, const db_t &) {
+        ++ bundles;
+    });
+    std::size_t cells = 0;
+    merged->traverse([&map, &cells](const index_t &bi, const d_t &d) {
+        ++ cells;
+        const db_t *b = map->getDistributionBundle(bi);
+        ASSERT_NE(b, nullptr);
+
+        d_t expected;
+        for (std::size_t i = 0 ; i < map_t::bin_count ; ++ i) {
+            if (const d_t *di = b->at(i))
+                expected += *di;
+        }
+        EXPECT_EQ(expected.getN(), d.getN());
+        for (std::size_t j = 0 ; j < 2 ; ++ j)
+            EXPECT_NEAR(expected.getMean()(j), d.getMean()(j), 1e-6);
+    });
+    EXPECT_EQ(bundles, cells);
+}
+
+template <typename gridmap_t>
+void testGridmapData(const typename gridmap_t::Ptr &gridmap,
+                     const typename gridmap_t::Ptr &gridmap_expected)
+{
+    ASSERT_NE(gridmap, nullptr);
+    ASSERT_NE(gridmap_expected, nullptr);
+    ASSERT_EQ(gridmap->getWidth(),  gridmap_expected->getWidth());
+    ASSERT_EQ(gridmap->getHeight(), gridmap_expected->getHeight());
+    for (std::size_t i = 0 ; i < gridmap->getData().size() ; ++ i)
+        EXPECT_NEAR(gridmap->getData()[i], gridmap_expected->getData()[i], 1e-6);
+}
+
+TEST(Test_cslibs_ndt_2d, testIncrementalGridmaps)
+{
+    using map_t         = cslibs_ndt_2d::dynamic_maps::Gridmap<double>;
+    using incremental_t = cslibs_ndt_2d::conversion::IncrementalGridmaps<map_t,double>;
+    const double sampling_resolution = 0.1;
+
+    for (const bool allocate_all : {false, true}) {
+        rng_t<1> rng_coord(-10.0, 10.0);
+        rng_t<1> rng_inner(-5.0, 5.0);
+        const cslibs_math_2d::Transform2d origin(rng_coord.get(), rng_coord.get(), rng_t<1>(-M_PI, M_PI).get());
+
+        // the incrementally converted map and a map converted once with the same data
+        typename map_t::Ptr map(new map_t(origin, 1.0));
+        typename map_t::Ptr map_expected(new map_t(origin, 1.0));
+        auto insert = [&map, &map_expected](const cslibs_math_2d::Pointcloud2<double>::Ptr &cloud) {
+            map->insert(cloud);
+            map_expected->insert(cloud);
+        };
+
+        // the corners fix the extent of the map frame, the later points lie well inside
+        cslibs_math_2d::Pointcloud2<double>::Ptr cloud(new cslibs_math_2d::Pointcloud2<double>());
+        for (const double x : {-12.0, 12.0}) {
+            for (const double y : {-12.0, 12.0})
+                cloud->insert(origin * cslibs_math_2d::Point2d(x, y));
+        }
+        for (std::size_t i = 0 ; i < 200 ; ++ i)
+            cloud->insert(origin * cslibs_math_2d::Point2d(rng_coord.get(), rng_coord.get()));
+        insert(cloud);
+
+        incremental_t incremental(typename incremental_t::kernel_t(*map), sampling_resolution,
+                                  2.0, 0.5, 0.169, allocate_all);
+        EXPECT_TRUE(incremental.update());
+
+        for (std::size_t c = 0 ; c < 3 ; ++ c) {
+            cslibs_math_2d::Pointcloud2<double>::Ptr points(new cslibs_math_2d::Pointcloud2<double>());
+            for (std::size_t i = 0 ; i < 20 ; ++ i)
+                points->insert(origin * cslibs_math_2d::Point2d(rng_inner.get(), rng_inner.get()));
+            insert(points);
+            EXPECT_FALSE(incremental.update());
+        }
+
+        typename cslibs_gridmaps::static_maps::ProbabilityGridmap<double,double>::Ptr     probability;
+        typename cslibs_gridmaps::static_maps::DistanceGridmap<double,double>::Ptr        distance;
+        typename cslibs_gridmaps::static_maps::LikelihoodFieldGridmap<double,double>::Ptr likelihood_field;
+        cslibs_ndt_2d::conversion::from(*map_expected, probability, sampling_resolution, allocate_all);
+        cslibs_ndt_2d::conversion::from(*map_expected, distance, sampling_resolution, 2.0, 0.169, allocate_all);
+        cslibs_ndt_2d::conversion::from(*map_expected, likelihood_field, sampling_resolution, 2.0, 0.5, 0.169, allocate_all);
+
+        testGridmapData<cslibs_gridmaps::static_maps::ProbabilityGridmap<double,double>>(incremental.getProbabilityGridmap(), probability);
+        testGridmapData<cslibs_gridmaps::static_maps::DistanceGridmap<double,double>>(incremental.getDistanceGridmap(), distance);
+        testGridmapData<cslibs_gridmaps::static_maps::LikelihoodFieldGridmap<double,double>>(incremental.getLikelihoodFieldGridmap(), likelihood_field);
+    }
+}
+
 TEST(Test_cslibs_ndt_2d, testDynamicGridmapFileBinarySerialization)
 {
     using map_t = cslibs_ndt_2d::dynamic_maps::Gridmap<double>;
@@ -422,6 +616,545 @@ TEST(Test_cslibs_ndt_2d, testStaticOccupancyGridmapFileBinarySerialization)
     testStaticOccMap(map, map_from_file);
 }
 
+TEST(Test_cslibs_ndt_2d, testDynamicGridmapSingleFileSerialization)
+{
+    using map_t = cslibs_ndt_2d::dynamic_maps::Gridmap<double>;
+    const typename map_t::Ptr map = generateDynamicMap();
+
+    // to file
+    EXPECT_TRUE(cslibs_ndt_2d::serialization::saveFile(*map, "/tmp/dynamic_map_file_2d.bin"));
+
+    // from file
+    typename map_t::Ptr map_from_file;
+    const bool success = cslibs_ndt::serialization::single_file<cslibs_ndt::map::tags::dynamic_map,2,cslibs_ndt::Distribution,double>::load(
+                "/tmp/dynamic_map_file_2d.bin", map_from_file);
+
+    // tests
+    EXPECT_TRUE(success);
+    testDynamicMap(map, map_from_file);
+
+    // memory mapped
+    const auto mapped = cslibs_ndt_2d::serialization::mapFile<cslibs_ndt::Distribution,double>("/tmp/dynamic_map_file_2d.bin");
+    EXPECT_NE(mapped, nullptr);
+
+    rng_t<1> rng_coord(-100.0, 100.0);
+    for (std::size_t i = 0 ; i < 1000 ; ++ i) {
+        const cslibs_math_2d::Point2d p(rng_coord.get(), rng_coord.get());
+        EXPECT_NEAR(map->sampleNonNormalized(p), mapped->sampleNonNormalized(p), 1e-6);
+    }
+}
+
+TEST(Test_cslibs_ndt_2d, testStaticOccupancyGridmapSingleFileSerialization)
+{
+    using map_t = cslibs_ndt_2d::static_maps::OccupancyGridmap<double>;
+    const typename map_t::Ptr map = cslibs_ndt_2d::conversion::from<double>(generateDynamicOccMap());
+
+    // to file
+    EXPECT_TRUE(cslibs_ndt_2d::serialization::saveFile(*map, "/tmp/static_occ_map_file_2d.bin"));
+
+    // from file
+    typename map_t::Ptr map_from_file;
+    const bool success = cslibs_ndt::serialization::single_file<cslibs_ndt::map::tags::static_map,2,cslibs_ndt::OccupancyDistribution,double>::load(
+                "/tmp/static_occ_map_file_2d.bin", map_from_file);
+
+    // tests
+    EXPECT_TRUE(success);
+    testStaticOccMap(map, map_from_file);
+
+    // memory mapped
+    const auto mapped = cslibs_ndt_2d::serialization::mapFile<cslibs_ndt::OccupancyDistribution,double>("/tmp/static_occ_map_file_2d.bin");
+    EXPECT_NE(mapped, nullptr);
+    EXPECT_GT(mapped->getBlockCount(), 0ul);
+
+    const cslibs_gridmaps::utility::InverseModel<double>::Ptr ivm(new cslibs_gridmaps::utility::InverseModel<double>(0.5, 0.45, 0.65));
+    rng_t<1> rng_coord(-10.0, 10.0);
+    for (std::size_t i = 0 ; i < 1000 ; ++ i) {
+        const cslibs_math_2d::Point2d p(rng_coord.get(), rng_coord.get());
+        mapped->prefetch(p);
+        EXPECT_NEAR(map->sampleNonNormalized(p, ivm), mapped->sampleNonNormalized(p, ivm), 1e-6);
+    }
+}
+
+TEST(Test_cslibs_ndt_2d, testDynamicGridmapTiledSerialization)
+{
+    using map_t = cslibs_ndt_2d::dynamic_maps::Gridmap<double>;
+    const typename map_t::Ptr map = generateDynamicMap();
+
+    // to file
+    EXPECT_TRUE(cslibs_ndt_2d::serialization::saveTiled(*map, "/tmp/dynamic_map_tiled_2d", 4ul));
+
+    // only the tile index is read
+    const auto tiled = cslibs_ndt_2d::serialization::openTiled<cslibs_ndt::Distribution,double>("/tmp/dynamic_map_tiled_2d");
+    EXPECT_NE(tiled, nullptr);
+    EXPECT_GT(tiled->getTileCount(), 0ul);
+    EXPECT_EQ(tiled->getLoadedTileCount(), 0ul);
+
+    // region of interest
+    rng_t<1> rng_coord(-100.0, 100.0);
+    const cslibs_math_2d::Point2d center(rng_coord.get(), rng_coord.get());
+    const double radius = 4.0 * tiled->getTileSize() * tiled->getBundleResolution();
+    const std::size_t loaded = tiled->load(center, radius);
+    EXPECT_EQ(tiled->getLoadedTileCount(), loaded);
+
+    // the region is aligned with the world axes, the map is rotated
+    rng_t<1> rng_offset(-radius, radius);
+    for (std::size_t i = 0 ; i < 1000 ; ++ i) {
+        const cslibs_math_2d::Point2d p(center(0) + rng_offset.get(), center(1) + rng_offset.get());
+        EXPECT_NEAR(map->sampleNonNormalized(p), tiled->sampleNonNormalized(p), 1e-6);
+    }
+
+    // eviction and asynchronous streaming
+    tiled->evict(cslibs_math_2d::Point2d(1e6, 1e6), 1.0);
+    EXPECT_EQ(tiled->getLoadedTileCount(), 0ul);
+    tiled->request(center, radius);
+    tiled->wait();
+    EXPECT_EQ(tiled->getLoadedTileCount(), loaded);
+
+    // all tiles as one map, as done by the map converter
+    typename map_t::Ptr map_from_tiles;
+    EXPECT_TRUE((cslibs_ndt::serialization::tiled<2,cslibs_ndt::Distribution,double>::load("/tmp/dynamic_map_tiled_2d", map_from_tiles)));
+    ASSERT_NE(map_from_tiles, nullptr);
+    EXPECT_EQ(cslibs_ndt::serialization::format::detect("/tmp/dynamic_map_tiled_2d"), cslibs_ndt::serialization::format::type::tiled);
+    rng_t<1> rng_map(-10.0, 10.0);
+    for (std::size_t i = 0 ; i < 1000 ; ++ i) {
+        const cslibs_math_2d::Point2d p(rng_map.get(), rng_map.get());
+        EXPECT_NEAR(map->sampleNonNormalized(p), map_from_tiles->sampleNonNormalized(p), 1e-6);
+    }
+}
+
+TEST(Test_cslibs_ndt_2d, testDynamicGridmapCompressedSerialization)
+{
+    using map_t = cslibs_ndt_2d::dynamic_maps::Gridmap<double>;
+    const typename map_t::Ptr map = generateDynamicMap();
+
+    // to file
+    EXPECT_TRUE(cslibs_ndt_2d::serialization::saveCompressed(*map, "/tmp/dynamic_map_compressed_2d.bin"));
+
+    // from file
+    typename map_t::Ptr map_from_file;
+    const bool success = cslibs_ndt::serialization::compressed_file<cslibs_ndt::map::tags::dynamic_map,2,cslibs_ndt::Distribution,double>::load(
+                "/tmp/dynamic_map_compressed_2d.bin", map_from_file);
+
+    // tests
+    EXPECT_TRUE(success);
+    testDynamicMap(map, map_from_file);
+}
+
+TEST(Test_cslibs_ndt_2d, testDynamicGridmapQuantizedSerialization)
+{
+    using map_t = cslibs_ndt_2d::dynamic_maps::Gridmap<double>;
+    const typename map_t::Ptr map = generateDynamicMap();
+
+    // to file, means and covariances are quantized
+    const double precision = 1e-3;
+    EXPECT_TRUE(cslibs_ndt_2d::serialization::saveCompressed(*map, "/tmp/dynamic_map_quantized_2d.bin",
+                                                             cslibs_ndt::serialization::codec::type::lz, precision));
+
+    // from file
+    typename map_t::Ptr map_from_file;
+    const bool success = cslibs_ndt::serialization::compressed_file<cslibs_ndt::map::tags::dynamic_map,2,cslibs_ndt::Distribution,double>::load(
+                "/tmp/dynamic_map_quantized_2d.bin", map_from_file);
+    EXPECT_TRUE(success);
+    EXPECT_NE(map_from_file, nullptr);
+
+    // every mean component is off by at most precision * resolution / 2,
+    // every covariance entry by at most precision * resolution^2 / 2
+    const double resolution = map->getResolution();
+    const double mean_error = 0.5 * precision * resolution + 1e-9;
+    const double cov_error  = 0.5 * precision * resolution * resolution + 1e-9;
+    for (std::size_t i = 0 ; i < map_t::bin_count ; ++i) {
+        const auto &storage = map_from_file->getStorages()[i];
+        std::size_t count = 0;
+        map->getStorages()[i]->traverse([&storage, &count, mean_error, cov_error](const typename map_t::index_t &index, const typename map_t::distribution_t &d) {
+            const typename map_t::distribution_t *dd = storage->get(index);
+            EXPECT_NE(dd, nullptr);
+            if (!dd)
+                return;
+            ++count;
+
+            EXPECT_EQ(d.getN(), dd->getN());
+            for (std::size_t j = 0 ; j < 2 ; ++ j)
+                EXPECT_NEAR(d.getMean()(j), dd->getMean()(j), mean_error);
+            if (d.getN() < 2)
+                return;
+            const double n_1 = static_cast<double>(d.getN() - 1);
+            for (std::size_t j = 0 ; j < 2 ; ++ j)
+                for (std::size_t k = 0 ; k < 2 ; ++ k)
+                    EXPECT_NEAR(d.getScatter()(j, k) / n_1, dd->getScatter()(j, k) / n_1, cov_error);
+        });
+
+        std::size_t count_from_file = 0;
+        storage->traverse([&count_from_file](const typename map_t::index_t &, const typename map_t::distribution_t &) {
+            ++count_from_file;
+        });
+        EXPECT_EQ(count, count_from_file);
+    }
+}
+
+TEST(Test_cslibs_ndt_2d, testStaticOccupancyGridmapCompressedSerialization)
+{
+    using map_t = cslibs_ndt_2d::static_maps::OccupancyGridmap<double>;
+    const typename map_t::Ptr map = cslibs_ndt_2d::conversion::from<double>(generateDynamicOccMap());
+
+    // to file
+    EXPECT_TRUE(cslibs_ndt_2d::serialization::saveCompressed(*map, "/tmp/static_occ_map_compressed_2d.bin"));
+
+    // from file
+    typename map_t::Ptr map_from_file;
+    const bool success = cslibs_ndt::serialization::compressed_file<cslibs_ndt::map::tags::static_map,2,cslibs_ndt::OccupancyDistribution,double>::load(
+                "/tmp/static_occ_map_compressed_2d.bin", map_from_file);
+
+    // tests
+    EXPECT_TRUE(success);
+    testStaticOccMap(map, map_from_file);
+}
+
+TEST(Test_cslibs_ndt_2d, testDynamicGridmapDeltaLogSerialization)
+{
+    using map_t = cslibs_ndt_2d::dynamic_maps::Gridmap<double>;
+    const typename map_t::Ptr map = generateDynamicMap();
+
+    // base snapshot
+    const auto log = cslibs_ndt_2d::serialization::createDeltaLog(*map, "/tmp/dynamic_map_delta_2d");
+    EXPECT_NE(log, nullptr);
+    EXPECT_EQ(map->getDirtyBundleCount(), 0ul);
+
+    // incremental checkpoints
+    rng_t<1> rng_coord(-100.0, 100.0);
+    for (std::size_t c = 0 ; c < 3 ; ++ c) {
+        cslibs_math_2d::Pointcloud2<double>::Ptr cloud(new cslibs_math_2d::Pointcloud2<double>());
+        for (std::size_t i = 0 ; i < 100 ; ++ i)
+            cloud->insert(cslibs_math_2d::Point2d(rng_coord.get(), rng_coord.get()));
+        map->insert(cloud);
+
+        EXPECT_GT(map->getDirtyBundleCount(), 0ul);
+        EXPECT_GT(log->checkpoint(*map), 0ul);
+        EXPECT_EQ(map->getDirtyBundleCount(), 0ul);
+    }
+    EXPECT_TRUE(log->wait());
+
+    // base snapshot and log
+    typename map_t::Ptr map_from_file;
+    const bool success = cslibs_ndt::serialization::DeltaLog<cslibs_ndt::map::tags::dynamic_map,2,cslibs_ndt::Distribution,double>::load(
+                "/tmp/dynamic_map_delta_2d", map_from_file);
+
+    // tests
+    EXPECT_TRUE(success);
+    testDynamicMap(map, map_from_file);
+}
+
+TEST(Test_cslibs_ndt_2d, testDynamicGridmapDeltaLogIncremental)
+{
+    using map_t         = cslibs_ndt_2d::dynamic_maps::Gridmap<double>;
+    using index_t       = typename map_t::index_t;
+    using incremental_t = cslibs_ndt_2d::conversion::IncrementalGridmaps<map_t,double>;
+    const double sampling_resolution = 0.5;
+    const typename map_t::Ptr map = generateDynamicMap();
+
+    // both consumers start from the same state of the map
+    const auto log = cslibs_ndt_2d::serialization::createDeltaLog(*map, "/tmp/dynamic_map_delta_incremental_2d");
+    EXPECT_NE(log, nullptr);
+    incremental_t incremental(typename incremental_t::kernel_t(*map), sampling_resolution,
+                              2.0, 0.5, 0.169, false);
+    EXPECT_TRUE(incremental.update());
+
+    // the dirty bundles are taken once and passed to both
+    rng_t<1> rng_coord(-100.0, 100.0);
+    for (std::size_t c = 0 ; c < 3 ; ++ c) {
+        cslibs_math_2d::Pointcloud2<double>::Ptr cloud(new cslibs_math_2d::Pointcloud2<double>());
+        for (std::size_t i = 0 ; i < 100 ; ++ i)
+            cloud->insert(cslibs_math_2d::Point2d(rng_coord.get(), rng_coord.get()));
+        map->insert(cloud);
+
+        std::vector<index_t> dirty;
+        map->takeDirtyBundles(dirty);
+        EXPECT_FALSE(dirty.empty());
+        EXPECT_EQ(map->getDirtyBundleCount(), 0ul);
+        EXPECT_GT(log->checkpoint(*map, dirty), 0ul);
+        incremental.update(dirty);
+    }
+    EXPECT_TRUE(log->wait());
+
+    // the log restores the map
+    typename map_t::Ptr map_from_file;
+    const bool success = cslibs_ndt::serialization::DeltaLog<cslibs_ndt::map::tags::dynamic_map,2,cslibs_ndt::Distribution,double>::load(
+                "/tmp/dynamic_map_delta_incremental_2d", map_from_file);
+    EXPECT_TRUE(success);
+    testDynamicMap(map, map_from_file);
+
+    // the gridmaps match a conversion of the whole map
+    typename cslibs_gridmaps::static_maps::ProbabilityGridmap<double,double>::Ptr probability;
+    typename cslibs_gridmaps::static_maps::DistanceGridmap<double,double>::Ptr    distance;
+    cslibs_ndt_2d::conversion::from(*map, probability, sampling_resolution, false);
+    cslibs_ndt_2d::conversion::from(*map, distance, sampling_resolution, 2.0, 0.169, false);
+    testGridmapData<cslibs_gridmaps::static_maps::ProbabilityGridmap<double,double>>(incremental.getProbabilityGridmap(), probability);
+    testGridmapData<cslibs_gridmaps::static_maps::DistanceGridmap<double,double>>(incremental.getDistanceGridmap(), distance);
+}
+
+TEST(Test_cslibs_ndt_2d, testDynamicGridmapAsyncSerialization)
+{
+    using map_t = cslibs_ndt_2d::dynamic_maps::Gridmap<double>;
+    const typename map_t::Ptr map = generateDynamicMap();
+    const typename map_t::Ptr map_copy = cslibs_ndt_2d::conversion::from<double>(cslibs_ndt_2d::conversion::from<double>(map));
+
+    // to file, the map is modified while it is written
+    std::future<bool> saved = cslibs_ndt_2d::serialization::saveBinaryAsync(*map, "/tmp/dynamic_map_async_2d");
+    rng_t<1> rng_coord(-100.0, 100.0);
+    cslibs_math_2d::Pointcloud2<double>::Ptr cloud(new cslibs_math_2d::Pointcloud2<double>());
+    for (std::size_t i = 0 ; i < 100 ; ++ i)
+        cloud->insert(cslibs_math_2d::Point2d(rng_coord.get(), rng_coord.get()));
+    map->insert(cloud);
+    EXPECT_TRUE(saved.get());
+
+    // from file
+    typename map_t::Ptr map_from_file;
+    const bool success = cslibs_ndt_2d::dynamic_maps::loadBinary<double>("/tmp/dynamic_map_async_2d", map_from_file);
+
+    // tests
+    EXPECT_TRUE(success);
+    testDynamicMap(map_copy, map_from_file);
+}
+
+TEST(Test_cslibs_ndt_2d, testDynamicGridmapConverter)
+{
+    using map_t = cslibs_ndt_2d::dynamic_maps::Gridmap<double>;
+    using converter_t = cslibs_ndt::serialization::Converter<cslibs_ndt::map::tags::dynamic_map,cslibs_ndt::map::tags::dynamic_map,2,cslibs_ndt::Distribution,double>;
+    const typename map_t::Ptr map = generateDynamicMap();
+    EXPECT_TRUE(cslibs_ndt_2d::dynamic_maps::saveBinary<double>(map, "/tmp/dynamic_map_converter_2d"));
+
+    // directory to single file and compressed file
+    std::vector<converter_t::job> jobs;
+    jobs.emplace_back(converter_t::job{"/tmp/dynamic_map_converter_2d", "/tmp/dynamic_map_converter_2d.bin",
+                                       cslibs_ndt::serialization::format::type::file});
+    jobs.emplace_back(converter_t::job{"/tmp/dynamic_map_converter_2d", "/tmp/dynamic_map_converter_2d.ndtz",
+                                       cslibs_ndt::serialization::format::type::compressed});
+    std::size_t reports = 0;
+    EXPECT_TRUE(converter_t().run(jobs, [&reports](const converter_t::report &r) {
+        EXPECT_TRUE(r.success);
+        EXPECT_GT(r.bundles, 0ul);
+        ++reports;
+    }));
+    EXPECT_EQ(reports, jobs.size());
+
+    typename map_t::Ptr map_from_file;
+    EXPECT_TRUE(cslibs_ndt::serialization::single_file<cslibs_ndt::map::tags::dynamic_map,2,cslibs_ndt::Distribution,double>::load(
+                "/tmp/dynamic_map_converter_2d.bin", map_from_file));
+    testDynamicMap(map, map_from_file);
+
+    typename map_t::Ptr map_from_compressed;
+    EXPECT_EQ(cslibs_ndt::serialization::format::detect("/tmp/dynamic_map_converter_2d.ndtz"), cslibs_ndt::serialization::format::type::compressed);
+    EXPECT_TRUE(cslibs_ndt::serialization::compressed_file<cslibs_ndt::map::tags::dynamic_map,2,cslibs_ndt::Distribution,double>::load(
+                "/tmp/dynamic_map_converter_2d.ndtz", map_from_compressed));
+    testDynamicMap(map, map_from_compressed);
+
+    // uncompressed quantized records
+    cslibs_ndt::serialization::format::options options;
+    options.codec     = cslibs_ndt::serialization::codec::type::none;
+    options.precision = 1e-3;
+    const std::vector<converter_t::job> quantized_jobs(1, converter_t::job{"/tmp/dynamic_map_converter_2d", "/tmp/dynamic_map_converter_quantized_2d.ndtz",
+                                                                           cslibs_ndt::serialization::format::type::compressed});
+    EXPECT_TRUE(converter_t(0.0, options).run(quantized_jobs, converter_t::callback_t()));
+
+    typename map_t::Ptr map_from_quantized;
+    EXPECT_TRUE(cslibs_ndt::serialization::compressed_file<cslibs_ndt::map::tags::dynamic_map,2,cslibs_ndt::Distribution,double>::load(
+                "/tmp/dynamic_map_converter_quantized_2d.ndtz", map_from_quantized));
+    ASSERT_NE(map_from_quantized, nullptr);
+    const double mean_error = 0.5 * options.precision * map->getResolution() + 1e-9;
+    for (std::size_t i = 0 ; i < map_t::bin_count ; ++i) {
+        const auto &storage = map_from_quantized->getStorages()[i];
+        map->getStorages()[i]->traverse([&storage, mean_error](const typename map_t::index_t &index, const typename map_t::distribution_t &d) {
+            const typename map_t::distribution_t *dd = storage->get(index);
+            EXPECT_NE(dd, nullptr);
+            if (!dd)
+                return;
+            EXPECT_EQ(d.getN(), dd->getN());
+            for (std::size_t j = 0 ; j < 2 ; ++ j)
+                EXPECT_NEAR(d.getMean()(j), dd->getMean()(j), mean_error);
+        });
+    }
+}
+
+std::size_t countSamples(const typename cslibs_ndt_2d::dynamic_maps::Gridmap<double>::distribution_storage_ptr_t &storage)
+{
+    using map_t = cslibs_ndt_2d::dynamic_maps::Gridmap<double>;
+    std::size_t n = 0;
+    storage->traverse([&n](const typename map_t::index_t &, const typename map_t::distribution_t &d) {
+        n += d.getN();
+    });
+    return n;
+}
+
+TEST(Test_cslibs_ndt_2d, testDynamicGridmapResample)
+{
+    using map_t = cslibs_ndt_2d::dynamic_maps::Gridmap<double>;
+    const typename map_t::Ptr map = generateDynamicMap();
+
+    // resampling keeps all data, only the resolution changes
+    const typename map_t::Ptr resampled = cslibs_ndt::conversion::resample<2,cslibs_ndt::Distribution,double,cslibs_ndt::map::tags::dynamic_map>::from(map, 2.0 * map->getResolution());
+    EXPECT_NE(resampled, nullptr);
+    EXPECT_NEAR(resampled->getResolution(), 2.0 * map->getResolution(), 1e-6);
+    EXPECT_EQ(countSamples(map->getStorages()[0]), countSamples(resampled->getStorages()[0]));
+}
+
+TEST(Test_cslibs_ndt_2d, testDynamicGridmapPyramid)
+{
+    using map_t = cslibs_ndt_2d::dynamic_maps::Gridmap<double>;
+    const typename map_t::Ptr map = generateDynamicMap();
+    const std::size_t n = countSamples(map->getStorages()[0]);
+
+    // every level of detail keeps all data
+    const std::vector<typename map_t::Ptr> levels = cslibs_ndt::conversion::pyramid<2,cslibs_ndt::Distribution,double,cslibs_ndt::map::tags::dynamic_map>::from(map, 3);
+    EXPECT_EQ(levels.size(), 3ul);
+    for (std::size_t l = 0 ; l < levels.size() ; ++l) {
+        EXPECT_NEAR(levels[l]->getResolution(), static_cast<double>(2 << l) * map->getResolution(), 1e-6);
+        EXPECT_EQ(n, countSamples(levels[l]->getStorages()[0]));
+    }
+}
+
+TEST(Test_cslibs_ndt_2d, testDynamicGridmapFuse)
+{
+    using map_t = cslibs_ndt_2d::dynamic_maps::Gridmap<double>;
+    const typename map_t::Ptr map = generateDynamicMap();
+    const typename map_t::Ptr map_copy = cslibs_ndt_2d::conversion::from<double>(cslibs_ndt_2d::conversion::from<double>(map));
+    const typename map_t::Ptr resampled = cslibs_ndt::conversion::resample<2,cslibs_ndt::Distribution,double,cslibs_ndt::map::tags::dynamic_map>::from(map, 2.0 * map->getResolution());
+    const std::size_t n = countSamples(map->getStorages()[0]);
+
+    // fusion keeps the data of all maps, on the same grid and resampled alike
+    const typename map_t::Ptr fused = cslibs_ndt::conversion::fuse<2,cslibs_ndt::Distribution,double>::from(
+                std::vector<typename map_t::Ptr>{map, map_copy, resampled});
+    EXPECT_NE(fused, nullptr);
+    EXPECT_NEAR(fused->getResolution(), map->getResolution(), 1e-6);
+    for (const auto &storage : fused->getStorages())
+        EXPECT_EQ(3ul * n, countSamples(storage));
+}
+
+TEST(Test_cslibs_ndt_2d, testDynamicGridmapFuseTransformed)
+{
+    using map_t   = cslibs_ndt_2d::dynamic_maps::Gridmap<double>;
+    using index_t = typename map_t::index_t;
+    using fuse_t  = cslibs_ndt::conversion::fuse<2,cslibs_ndt::Distribution,double>;
+    rng_t<1> rng_coord(-10.0, 10.0);
+    rng_t<1> rng_angle(-M_PI, M_PI);
+    rng_t<1> rng_noise(-0.05, 0.05);
+    const double resolution = 1.0;
+
+    const cslibs_math_2d::Transform2d origin(rng_coord.get(), rng_coord.get(), rng_angle.get());
+    const cslibs_math_2d::Transform2d origin_other(rng_coord.get(), rng_coord.get(), rng_angle.get());
+
+    // tight clusters in the centers of bundles of the target, three bundles apart, so every
+    // distribution of the other map falls into a single bundle of the target
+    const double bundle_resolution = 0.5 * resolution;
+    auto cluster = [&](const index_t &bi, cslibs_math_2d::Pointcloud2<double>::Ptr &cloud) {
+        for (std::size_t i = 0 ; i < 10 ; ++ i)
+            cloud->insert(origin * cslibs_math_2d::Point2d((bi[0] + 0.5) * bundle_resolution + rng_noise.get(),
+                                                           (bi[1] + 0.5) * bundle_resolution + rng_noise.get()));
+    };
+    cslibs_math_2d::Pointcloud2<double>::Ptr cloud(new cslibs_math_2d::Pointcloud2<double>());
+    cslibs_math_2d::Pointcloud2<double>::Ptr cloud_other(new cslibs_math_2d::Pointcloud2<double>());
+    std::vector<index_t> changed;
+    for (int i = -4 ; i <= 4 ; ++ i) {
+        for (int j = -4 ; j <= 4 ; ++ j) {
+            const index_t bi = {{6 * i, 6 * j}};
+            if ((i + j) % 2) {
+                cluster(bi, cloud_other);
+                changed.emplace_back(bi);
+            } else {
+                cluster(bi, cloud);
+            }
+        }
+    }
+
+    // the other map is built in a rotated and translated frame
+    typename map_t::Ptr map(new map_t(origin, resolution));
+    typename map_t::Ptr map_other(new map_t(origin_other, resolution));
+    typename map_t::Ptr map_expected(new map_t(origin, resolution));
+    map->insert(cloud);
+    map_other->insert(cloud_other);
+    map_expected->insert(cloud);
+    map_expected->insert(cloud_other);
+
+    std::vector<index_t> dirty;
+    map->takeDirtyBundles(dirty);
+    fuse_t::into(*map_other, *map);
+
+    // the bundles receiving data are marked dirty
+    map->takeDirtyBundles(dirty);
+    std::sort(dirty.begin(), dirty.end());
+    for (const index_t &bi : changed)
+        EXPECT_TRUE(std::binary_search(dirty.begin(), dirty.end(), bi));
+
+    // same statistics as inserting the points directly
+    for (std::size_t i = 0 ; i < map_t::bin_count ; ++ i) {
+        const auto &storage = map->getStorages()[i];
+        EXPECT_EQ(countSamples(map_expected->getStorages()[i]), countSamples(storage));
+        map_expected->getStorages()[i]->traverse([&storage](const index_t &si, const typename map_t::distribution_t &d) {
+            const typename map_t::distribution_t *f = storage->get(si);
+            ASSERT_NE(f, nullptr);
+            EXPECT_EQ(d.getN(), f->getN());
+            if (!d.valid())
+                return;
+            for (std::size_t r = 0 ; r < 2 ; ++ r) {
+                EXPECT_NEAR(d.getMean()(r), f->getMean()(r), 1e-6);
+                for (std::size_t c = 0 ; c < 2 ; ++ c)
+                    EXPECT_NEAR(d.getCovariance()(r, c), f->getCovariance()(r, c), 1e-6);
+            }
+        });
+    }
+}
+
+TEST(Test_cslibs_ndt_2d, testDistributionsTriangleList)
+{
+    using map_t = cslibs_ndt_2d::dynamic_maps::Gridmap<double>;
+    rng_t<1> rng_noise(-0.3, 0.3);
+    typename map_t::Ptr map(new map_t(cslibs_math_2d::Transform2d(), 1.0));
+
+    // a near, a far and a culled cluster, the single point only yields invalid distributions
+    // that are skipped
+    cslibs_math_2d::Pointcloud2<double>::Ptr cloud(new cslibs_math_2d::Pointcloud2<double>());
+    for (const double x : {2.5, 30.5, 200.5}) {
+        for (std::size_t i = 0 ; i < 30 ; ++ i)
+            cloud->insert(cslibs_math_2d::Point2d(x + rng_noise.get(), 0.5 + rng_noise.get()));
+    }
+    cloud->insert(cslibs_math_2d::Point2d(6.5, 6.5));
+    map->insert(cloud);
+
+    const cslibs_ndt_2d::conversion::markers::lod<double> lod(cslibs_math_2d::Point2d(), 10.0, 100.0, 16, 6);
+    visualization_msgs::Marker marker;
+    cslibs_ndt_2d::conversion::from(*map, marker, ros::Time(), "map", cslibs_math_2d::Transform2d(),
+                                    cslibs_math::color::Color<double>(0.0, 0.45, 0.63), lod);
+    EXPECT_EQ(marker.type, visualization_msgs::Marker::TRIANGLE_LIST);
+
+    // fans of 16 triangles up to 10 m, of 6 triangles up to 100 m
+    using fan_t = std::pair<Eigen::Vector2d, std::size_t>;
+    std::vector<fan_t, Eigen::aligned_allocator<fan_t>> expected;
+    std::size_t vertices = 0;
+    for (const auto &storage : map->getStorages()) {
+        storage->traverse([&expected, &vertices](const typename map_t::index_t &, const typename map_t::distribution_t &d) {
+            if (!d.valid() || d.getMean().norm() > 100.0)
+                return;
+            expected.emplace_back(d.getMean(), d.getMean().norm() <= 10.0 ? 48ul : 18ul);
+            vertices += expected.back().second;
+        });
+    }
+    EXPECT_FALSE(expected.empty());
+    ASSERT_EQ(marker.points.size(), vertices);
+    ASSERT_EQ(marker.colors.size(), vertices);
+
+    // every fan is centered at the mean of a visible distribution
+    std::size_t i = 0;
+    while (i < marker.points.size()) {
+        const Eigen::Vector2d center(marker.points[i].x, marker.points[i].y);
+        const auto e = std::find_if(expected.begin(), expected.end(), [&center](const fan_t &e) {
+            return (e.first - center).norm() < 1e-6;
+        });
+        ASSERT_NE(e, expected.end());
+        EXPECT_NEAR(marker.colors[i].a, 1.0, 1e-6);
+        i += e->second;
+        expected.erase(e);
+    }
+    EXPECT_TRUE(expected.empty());
+}
+
 int main(int argc, char *argv[])
 {
     testing::InitGoogleTest(&argc, argv);
@@ -3,6 +3,7 @@
 
 #include <cslibs_ndt_3d/dynamic_maps/gridmap.hpp>
 #include <cslibs_ndt_3d/dynamic_maps/occupancy_gridmap.hpp>
+#include <cslibs_ndt/utility/ellipsoids.hpp>
 
 #include <cslibs_math/color/color.hpp>
 #include <cslibs_math/common/angle.hpp>
@@ -209,6 +210,219 @@ inline void from(
     from(*src,*dst,ivm,time,frame,transform,occupancy_threshold);
 }
 
+namespace markers {
+/**
+ * @brief Level of detail of the compact export. Distributions further than maximum_distance
+ *        from the viewpoint are culled, those further than near_distance are drawn as octahedra
+ *        instead of icosahedra. Distances are measured in the target frame.
+ */
+template <typename T>
+struct lod
+{
+    inline lod(const cslibs_math_3d::Point3<T> &viewpoint = cslibs_math_3d::Point3<T>(),
+               const T near_distance    = std::numeric_limits<T>::max(),
+               const T maximum_distance = std::numeric_limits<T>::max()) :
+        viewpoint(viewpoint),
+        near_distance(near_distance),
+        maximum_distance(maximum_distance)
+    {
+    }
+
+    cslibs_math_3d::Point3<T>   viewpoint;
+    T                           near_distance;
+    T                           maximum_distance;
+};
+
+/**
+ * @brief Unit sphere meshes as lists of outward facing triangles.
+ */
+template <typename T>
+inline const std::vector<Eigen::Matrix<T,3,1>> &icosahedron()
+{
+    static const std::vector<Eigen::Matrix<T,3,1>> mesh = [] {
+        const T g = static_cast<T>(0.5 * (1.0 + std::sqrt(5.0)));
+        const T v[12][3] = {{-1, g, 0}, { 1, g, 0}, {-1,-g, 0}, { 1,-g, 0},
+                            { 0,-1, g}, { 0, 1, g}, { 0,-1,-g}, { 0, 1,-g},
+                            { g, 0,-1}, { g, 0, 1}, {-g, 0,-1}, {-g, 0, 1}};
+        const int f[20][3] = {{0,11, 5}, {0, 5, 1}, {0, 1, 7}, {0, 7,10}, {0,10,11},
+                              {1, 5, 9}, {5,11, 4}, {11,10,2}, {10,7, 6}, {7, 1, 8},
+                              {3, 9, 4}, {3, 4, 2}, {3, 2, 6}, {3, 6, 8}, {3, 8, 9},
+                              {4, 9, 5}, {2, 4,11}, {6, 2,10}, {8, 6, 7}, {9, 8, 1}};
+        std::vector<Eigen::Matrix<T,3,1>> m;
+        for (const auto &face : f) {
+            for (const int i : face)
+                m.emplace_back(Eigen::Matrix<T,3,1>(v[i][0], v[i][1], v[i][2]).normalized());
+        }
+        return m;
+    }();
+    return mesh;
+}
+
+template <typename T>
+inline const std::vector<Eigen::Matrix<T,3,1>> &octahedron()
+{
+    static const std::vector<Eigen::Matrix<T,3,1>> mesh = [] {
+        std::vector<Eigen::Matrix<T,3,1>> m;
+        for (int i = 0 ; i < 8 ; ++ i) {
+            const Eigen::Matrix<T,3,1> x((i & 1) ? -1 : 1, 0, 0);
+            const Eigen::Matrix<T,3,1> y(0, (i & 2) ? -1 : 1, 0);
+            const Eigen::Matrix<T,3,1> z(0, 0, (i & 4) ? -1 : 1);
+            const bool ccw = x.cross(y).dot(z) > 0;
+            m.emplace_back(x);
+            m.emplace_back(ccw ? y : z);
+            m.emplace_back(ccw ? z : y);
+        }
+        return m;
+    }();
+    return mesh;
+}
+
+/**
+ * @brief Write the selected distributions of all storages as 1-sigma ellipsoids into a single
+ *        triangle list, colored by height.
+ * @param src       map
+ * @param origin    transform from the map to the target frame
+ * @param select    returns the Gaussian of a distribution and sets its alpha, or nullptr to skip it
+ * @param l         level of detail
+ * @param dst       triangle list, points and colors are overwritten
+ */
+template <typename T, typename map_t, typename select_t>
+inline void write(const map_t &src,
+                  const cslibs_math_3d::Pose3<T> &origin,
+                  const select_t &select,
+                  const lod<T> &l,
+                  visualization_msgs::Marker &dst)
+{
+    cslibs_ndt::utility::Ellipsoids<T,3> ellipsoids;
+    ellipsoids.collect(src, origin, select, l.viewpoint.data(), l.near_distance, l.maximum_distance);
+
+    const std::vector<Eigen::Matrix<T,3,1>> &fine   = icosahedron<T>();
+    const std::vector<Eigen::Matrix<T,3,1>> &coarse = octahedron<T>();
+    const std::size_t vertices = ellipsoids.vertices(fine, coarse);
+    dst.points.resize(vertices);
+    dst.colors.resize(vertices);
+    const T min_height = (origin * src.getMin())(2);
+    const T max_height = (origin * src.getMax())(2);
+    ellipsoids.forEachVertex(fine, coarse, [&ellipsoids, &dst, min_height, max_height](const std::size_t k, const std::size_t i, const Eigen::Matrix<T,3,1> &v) {
+        geometry_msgs::Point &p = dst.points[i];
+        p.x = v(0);
+        p.y = v(1);
+        p.z = v(2);
+        const cslibs_math::color::Color<T> color =
+                cslibs_math::color::interpolateColor(ellipsoids.mean(k)(2), min_height, max_height);
+        std_msgs::ColorRGBA &c = dst.colors[i];
+        c.r = color.r;
+        c.g = color.g;
+        c.b = color.b;
+        c.a = ellipsoids.alpha(k);
+    });
+}
+
+inline void header(const ros::Time& time,
+                   const std::string &frame,
+                   visualization_msgs::Marker &dst)
+{
+    dst.header.stamp       = time;
+    dst.header.frame_id    = frame;
+    dst.ns                 = "distributions";
+    dst.id                 = 0;
+    dst.type               = visualization_msgs::Marker::TRIANGLE_LIST;
+    dst.action             = visualization_msgs::Marker::ADD;
+    dst.pose.orientation.w = 1;
+    dst.scale.x            = 1;
+    dst.scale.y            = 1;
+    dst.scale.z            = 1;
+    dst.color.a            = 1;
+    dst.lifetime           = ros::Duration(2000.);
+}
+}
+
+/**
+ * @brief Compact visualisation of all distributions as a single triangle list marker.
+ */
+template <cslibs_ndt::map::tags::option option_t,
+          typename T,
+          template <typename, typename, typename...> class backend_t>
+inline void from(
+        const cslibs_ndt::map::Map<option_t,3,cslibs_ndt::Distribution,T,backend_t> &src,
+        visualization_msgs::Marker &dst,
+        const ros::Time& time,
+        const std::string &frame,
+        const typename cslibs_math_3d::Pose3<T> &transform = typename cslibs_math_3d::Pose3<T>(),
+        const markers::lod<T> &lod = markers::lod<T>())
+{
+    using gaussian_t = cslibs_math::statistics::StableDistribution<T,3,3>;
+    auto select = [](const cslibs_ndt::Distribution<T,3> &d, T &alpha) -> const gaussian_t* {
+        alpha = 1;
+        return d.valid() ? &d : nullptr;
+    };
+    markers::header(time, frame, dst);
+    markers::write(src, transform * src.getInitialOrigin(), select, lod, dst);
+}
+
+template <typename T>
+inline void from(
+        const typename cslibs_ndt_3d::dynamic_maps::Gridmap<T>::Ptr &src,
+        visualization_msgs::Marker::Ptr &dst,
+        const ros::Time& time,
+        const std::string &frame,
+        const typename cslibs_math_3d::Pose3<T> &transform = typename cslibs_math_3d::Pose3<T>(),
+        const markers::lod<T> &lod = markers::lod<T>())
+{
+    if (!src)
+        return;
+    dst.reset(new visualization_msgs::Marker());
+
+    from(*src,*dst,time,frame,transform,lod);
+}
+
+/**
+ * @brief Compact visualisation of the occupied distributions as a single triangle list marker,
+ *        with the occupancy as alpha.
+ */
+template <cslibs_ndt::map::tags::option option_t,
+          typename T,
+          template <typename, typename, typename...> class backend_t>
+inline void from(
+        const cslibs_ndt::map::Map<option_t,3,cslibs_ndt::OccupancyDistribution,T,backend_t> &src,
+        visualization_msgs::Marker &dst,
+        const typename cslibs_gridmaps::utility::InverseModel<T>::Ptr &ivm,
+        const ros::Time& time,
+        const std::string &frame,
+        const typename cslibs_math_3d::Pose3<T> &transform = typename cslibs_math_3d::Pose3<T>(),
+        const T occupancy_threshold = 0.5,
+        const markers::lod<T> &lod = markers::lod<T>())
+{
+    using gaussian_t = cslibs_math::statistics::StableDistribution<T,3,3>;
+    auto select = [&ivm, &occupancy_threshold](const cslibs_ndt::OccupancyDistribution<T,3> &d, T &alpha) -> const gaussian_t* {
+        const auto &g = d.getDistribution();
+        if (!g || !g->valid())
+            return nullptr;
+        alpha = d.getOccupancy(ivm);
+        return alpha >= occupancy_threshold ? g.get() : nullptr;
+    };
+    markers::header(time, frame, dst);
+    markers::write(src, transform * src.getInitialOrigin(), select, lod, dst);
+}
+
+template <typename T>
+inline void from(
+        const typename cslibs_ndt_3d::dynamic_maps::OccupancyGridmap<T>::Ptr &src,
+        visualization_msgs::Marker::Ptr &dst,
+        const typename cslibs_gridmaps::utility::InverseModel<T>::Ptr& ivm,
+        const ros::Time& time,
+        const std::string &frame,
+        const typename cslibs_math_3d::Pose3<T> &transform = typename cslibs_math_3d::Pose3<T>(),
+        const T occupancy_threshold = 0.5,
+        const markers::lod<T> &lod = markers::lod<T>())
+{
+    if (!src || !ivm)
+        return;
+    dst.reset(new visualization_msgs::Marker());
+
+    from(*src,*dst,ivm,time,frame,transform,occupancy_threshold,lod);
+}
+
 }
 }
 
@@ -0,0 +1,339 @@
+#ifndef CSLIBS_NDT_3D_CONVERSION_ELEVATION_MAP_HPP
+#define CSLIBS_NDT_3D_CONVERSION_ELEVATION_MAP_HPP
+
+#include <cslibs_ndt/map/map.hpp>
+#include <cslibs_ndt/utility/parallel.hpp>
+
+#include <cslibs_ndt_3d/dynamic_maps/gridmap.hpp>
+#include <cslibs_ndt_3d/dynamic_maps/occupancy_gridmap.hpp>
+
+#include <cslibs_math_2d/linear/pose.hpp>
+#include <cslibs_gridmaps/static_maps/probability_gridmap.h>
+
+#include <Eigen/Eigenvalues>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+namespace cslibs_ndt_3d {
+namespace conversion {
+/**
+ * @brief 2.5D elevation map with one cell per column of the map. Heights are given in the map
+ *        frame, cells without a surface are NaN.
+ */
+template <typename T>
+struct ElevationMap
+{
+    using Ptr = std::shared_ptr<ElevationMap<T>>;
+
+    inline ElevationMap(const cslibs_math_2d::Pose2<T> &origin,
+                        const T resolution,
+                        const std::size_t height,
+                        const std::size_t width) :
+        origin(origin),
+        resolution(resolution),
+        height(height),
+        width(width),
+        elevation(height * width, std::numeric_limits<T>::quiet_NaN()),
+        variance(height * width, std::numeric_limits<T>::quiet_NaN()),
+        slope(height * width, std::numeric_limits<T>::quiet_NaN())
+    {
+    }
+
+    inline std::size_t index(const std::size_t u, const std::size_t v) const
+    {
+        return v * width + u;
+    }
+
+    const cslibs_math_2d::Pose2<T> origin;
+    const T                        resolution;
+    const std::size_t              height;
+    const std::size_t              width;
+    std::vector<T>                 elevation;   /// mean height of the topmost surface
+    std::vector<T>                 variance;    /// height variance of the topmost surface
+    std::vector<T>                 slope;       /// inclination of the topmost surface in radians
+};
+
+namespace impl {
+/**
+ * @brief Gaussians of the first storage grouped by column. The first storage partitions the
+ *        inserted data, so every Gaussian belongs to exactly one column of the map resolution.
+ */
+template <typename T>
+struct columns
+{
+    using gaussian_t = cslibs_math::statistics::StableDistribution<T,3,3>;
+    using entry_t    = std::pair<const gaussian_t*, T>;
+
+    /**
+     * @param src       map
+     * @param select    returns the Gaussian of a distribution and sets its weight,
+     *                  or returns nullptr to skip it
+     */
+    template <typename map_t, typename select_t>
+    inline columns(const map_t &src,
+                   const select_t &select) :
+        resolution(src.getResolution()),
+        width(0ul),
+        height(0ul)
+    {
+        using index_t = typename map_t::index_t;
+        std::vector<std::pair<index_t, entry_t>> gaussians;
+        min = {{std::numeric_limits<int>::max(), std::numeric_limits<int>::max()}};
+        std::array<int,2> max = {{std::numeric_limits<int>::min(), std::numeric_limits<int>::min()}};
+        src.getStorages()[0]->traverse([&gaussians, &select, &max, this](const index_t &si, const typename map_t::distribution_t &d) {
+            T weight = T(1.0);
+            if (const gaussian_t *g = select(d, weight)) {
+                gaussians.emplace_back(si, entry_t(g, weight));
+                for (std::size_t i = 0 ; i < 2 ; ++ i) {
+                    min[i] = std::min(min[i], si[i]);
+                    max[i] = std::max(max[i], si[i]);
+                }
+            }
+        });
+        if (gaussians.empty()) {
+            min = {{0, 0}};
+            return;
+        }
+
+        width  = static_cast<std::size_t>(max[0] - min[0] + 1);
+        height = static_cast<std::size_t>(max[1] - min[1] + 1);
+        cells.reserve(gaussians.size());
+        for (const auto &g : gaussians)
+            cells.emplace_back(static_cast<std::size_t>(g.first[1] - min[1]) * width + static_cast<std::size_t>(g.first[0] - min[0]), g.second);
+        std::sort(cells.begin(), cells.end(), [](const std::pair<std::size_t, entry_t> &a, const std::pair<std::size_t, entry_t> &b) {
+            return a.first < b.first;
+        });
+
+        for (std::size_t i = 0 ; i < cells.size() ; ++ i) {
+            if (i == 0 || cells[i].first != cells[i - 1].first)
+                starts.emplace_back(i);
+        }
+        starts.emplace_back(cells.size());
+    }
+
+    /**
+     * @brief Origin of the first column in the map frame, projected to the plane.
+     */
+    template <typename map_t>
+    inline cslibs_math_2d::Pose2<T> origin(const map_t &src) const
+    {
+        const auto &o = src.getInitialOrigin();
+        return cslibs_math_2d::Pose2<T>(o.tx(), o.ty(), o.rotation().yaw()) *
+               cslibs_math_2d::Pose2<T>(static_cast<T>(min[0]) * resolution, static_cast<T>(min[1]) * resolution, T());
+    }
+
+    /**
+     * @brief Process the columns in parallel.
+     * @param function  called with the cell index and the range [begin, end) of its entries in cells
+     */
+    template <typename Fn>
+    inline void parallel(const Fn &function) const
+    {
+        const std::size_t n = starts.empty() ? 0ul : starts.size() - 1ul;
+        cslibs_ndt::utility::parallel_for(0ul, n, [this, &function](const std::size_t i) {
+            function(cells[starts[i]].first, starts[i], starts[i + 1]);
+        });
+    }
+
+    const T                                        resolution;
+    std::array<int,2>                              min;
+    std::size_t                                    width;
+    std::size_t                                    height;
+    std::vector<std::pair<std::size_t, entry_t>>   cells;
+    std::vector<std::size_t>                       starts;
+};
+
+/**
+ * @brief Columns are only vertical if the map frame is level, i.e. the map origin has no roll
+ *        and pitch.
+ */
+template <typename T, typename map_t>
+inline bool level(const map_t &src)
+{
+    const auto &o = src.getInitialOrigin();
+    const T tolerance = T(1e-6);
+    if (std::abs(o.roll()) <= tolerance && std::abs(o.pitch()) <= tolerance)
+        return true;
+    std::cerr << "[ElevationMap]: Map origin with roll " << o.roll() << " and pitch " << o.pitch()
+              << " is not level, columns would not be vertical." << std::endl;
+    return false;
+}
+
+/**
+ * @brief The topmost Gaussian below the maximum height defines the surface of a column, its
+ *        normal is the eigenvector of the smallest eigenvalue.
+ */
+template <typename T, typename map_t, typename select_t>
+inline void elevation(const map_t &src,
+                      const select_t &select,
+                      typename ElevationMap<T>::Ptr &dst,
+                      const T maximum_height)
+{
+    dst.reset();
+    if (!level<T>(src))
+        return;
+
+    const columns<T> c(src, select);
+    dst.reset(new ElevationMap<T>(c.origin(src), c.resolution, c.height, c.width));
+
+    ElevationMap<T> &e = *dst;
+    c.parallel([&c, &e, maximum_height](const std::size_t cell, const std::size_t begin, const std::size_t end) {
+        const typename columns<T>::gaussian_t *top = nullptr;
+        for (std::size_t i = begin ; i < end ; ++ i) {
+            const typename columns<T>::gaussian_t *g = c.cells[i].second.first;
+            const T z = g->getMean()(2);
+            if (z <= maximum_height && (!top || z > top->getMean()(2)))
+                top = g;
+        }
+        if (!top)
+            return;
+
+        const Eigen::Matrix<T,3,3> covariance = top->getCovariance();
+        Eigen::SelfAdjointEigenSolver<Eigen::Matrix<T,3,3>> solver;
+        solver.computeDirect(covariance);
+        const T nz = std::abs(solver.eigenvectors()(2,0));
+
+        e.elevation[cell] = top->getMean()(2);
+        e.variance[cell]  = covariance(2,2);
+        e.slope[cell]     = std::acos(std::min(T(1.0), nz));
+    });
+}
+
+/**
+ * @brief Each cell holds the maximum over the weighted Gaussians of its column with mean height
+ *        in [minimum_height, maximum_height], sampled at the column center and their mean height.
+ */
+template <typename T, typename map_t, typename select_t>
+inline void project(const map_t &src,
+                    const select_t &select,
+                    typename cslibs_gridmaps::static_maps::ProbabilityGridmap<T,T>::Ptr &dst,
+                    const T minimum_height,
+                    const T maximum_height)
+{
+    dst.reset();
+    if (!level<T>(src))
+        return;
+
+    const columns<T> c(src, select);
+    dst.reset(new cslibs_gridmaps::static_maps::ProbabilityGridmap<T,T>(c.origin(src), c.resolution, c.height, c.width));
+    std::fill(dst->getData().begin(), dst->getData().end(), T(0.0));
+
+    std::vector<T> &data = dst->getData();
+    c.parallel([&c, &data, minimum_height, maximum_height](const std::size_t cell, const std::size_t begin, const std::size_t end) {
+        const T x = (static_cast<T>(c.min[0] + static_cast<int>(cell % c.width)) + T(0.5)) * c.resolution;
+        const T y = (static_cast<T>(c.min[1] + static_cast<int>(cell / c.width)) + T(0.5)) * c.resolution;
+
+        T value = T();
+        for (std::size_t i = begin ; i < end ; ++ i) {
+            const typename columns<T>::gaussian_t *g = c.cells[i].second.first;
+            const T z = g->getMean()(2);
+            if (z < minimum_height || z > maximum_height)
+                continue;
+            value = std::max(value, c.cells[i].second.second * g->sampleNonNormalized(Eigen::Matrix<T,3,1>(x, y, z)));
+        }
+        data[cell] = value;
+    });
+}
+
+template <typename T>
+struct select_distribution
+{
+    inline const typename columns<T>::gaussian_t* operator () (const cslibs_ndt::Distribution<T,3> &d, T &) const
+    {
+        return d.valid() ? &d : nullptr;
+    }
+};
+
+template <typename T>
+struct select_occupancy
+{
+    inline const typename columns<T>::gaussian_t* operator () (const cslibs_ndt::OccupancyDistribution<T,3> &d, T &weight) const
+    {
+        if (!d.getDistribution() || !d.getDistribution()->valid())
+            return nullptr;
+        weight = d.getOccupancy(inverse_model);
+        return weight >= threshold ? d.getDistribution().get() : nullptr;
+    }
+
+    const typename cslibs_gridmaps::utility::InverseModel<T>::Ptr &inverse_model;
+    const T                                                        threshold;
+};
+}
+
+/**
+ * @brief Elevation map from the columns of a map, maps with a rolled or pitched origin are
+ *        rejected and dst is reset.
+ * @param src               map
+ * @param dst               elevation map at the resolution of the map
+ * @param maximum_height    Gaussians above are ignored, e.g. to look beneath overhangs
+ */
+template <cslibs_ndt::map::tags::option option_t,
+          typename T,
+          template <typename, typename, typename...> class backend_t>
+inline void from(
+        const cslibs_ndt::map::Map<option_t,3,cslibs_ndt::Distribution,T,backend_t> &src,
+        typename ElevationMap<T>::Ptr &dst,
+        const T &maximum_height = std::numeric_limits<T>::max())
+{
+    impl::elevation<T>(src, impl::select_distribution<T>(), dst, maximum_height);
+}
+
+/**
+ * @brief Elevation map from the occupied columns of a map.
+ * @param threshold         minimum occupancy of a surface
+ */
+template <cslibs_ndt::map::tags::option option_t,
+          typename T,
+          template <typename, typename, typename...> class backend_t>
+inline void from(
+        const cslibs_ndt::map::Map<option_t,3,cslibs_ndt::OccupancyDistribution,T,backend_t> &src,
+        typename ElevationMap<T>::Ptr &dst,
+        const typename cslibs_gridmaps::utility::InverseModel<T>::Ptr &inverse_model,
+        const T &threshold      = 0.169,
+        const T &maximum_height = std::numeric_limits<T>::max())
+{
+    if (!inverse_model)
+        return;
+    impl::elevation<T>(src, impl::select_occupancy<T>{inverse_model, threshold}, dst, maximum_height);
+}
+
+/**
+ * @brief 2D slice of a map between two heights, the whole column by default. Maps with a
+ *        rolled or pitched origin are rejected and dst is reset.
+ */
+template <cslibs_ndt::map::tags::option option_t,
+          typename T,
+          template <typename, typename, typename...> class backend_t>
+inline void from(
+        const cslibs_ndt::map::Map<option_t,3,cslibs_ndt::Distribution,T,backend_t> &src,
+        typename cslibs_gridmaps::static_maps::ProbabilityGridmap<T,T>::Ptr &dst,
+        const T &minimum_height = std::numeric_limits<T>::lowest(),
+        const T &maximum_height = std::numeric_limits<T>::max())
+{
+    impl::project<T>(src, impl::select_distribution<T>(), dst, minimum_height, maximum_height);
+}
+
+/**
+ * @brief 2D slice of a map between two heights, the samples are weighted by the occupancy.
+ */
+template <cslibs_ndt::map::tags::option option_t,
+          typename T,
+          template <typename, typename, typename...> class backend_t>
+inline void from(
+        const cslibs_ndt::map::Map<option_t,3,cslibs_ndt::OccupancyDistribution,T,backend_t> &src,
+        typename cslibs_gridmaps::static_maps::ProbabilityGridmap<T,T>::Ptr &dst,
+        const typename cslibs_gridmaps::utility::InverseModel<T>::Ptr &inverse_model,
+        const T &minimum_height = std::numeric_limits<T>::lowest(),
+        const T &maximum_height = std::numeric_limits<T>::max())
+{
+    if (!inverse_model)
+        return;
+    impl::project<T>(src, impl::select_occupancy<T>{inverse_model, T()}, dst, minimum_height, maximum_height);
+}
+}
+}
+
+#endif // CSLIBS_NDT_3D_CONVERSION_ELEVATION_MAP_HPP
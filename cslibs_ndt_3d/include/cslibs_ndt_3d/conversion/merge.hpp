@@ -0,0 +1,42 @@
+#ifndef CSLIBS_NDT_3D_CONVERSION_MERGE_HPP
+#define CSLIBS_NDT_3D_CONVERSION_MERGE_HPP
+
+#include <cslibs_ndt/conversion/merge.hpp>
+#include <cslibs_ndt_3d/dynamic_maps/gridmap.hpp>
+#include <cslibs_ndt_3d/static_maps/mono_gridmap.hpp>
+
+namespace cslibs_ndt_3d {
+namespace conversion {
+template <typename T>
+inline typename cslibs_ndt_3d::static_maps::mono::Gridmap<T>::Ptr merge(
+        const typename cslibs_ndt_3d::dynamic_maps::Gridmap<T>::Ptr& src,
+        const std::size_t num_threads = cslibs_ndt::utility::default_thread_count())
+{
+    if (!src)
+        return nullptr;
+
+    using index_t = std::array<int, 3>;
+    const index_t min_distribution_index = src->getMinBundleIndex();
+    const index_t max_distribution_index = src->getMaxBundleIndex();
+
+    const std::array<std::size_t, 3> size = {{static_cast<std::size_t>(max_distribution_index[0] - min_distribution_index[0] + 1),
+                                              static_cast<std::size_t>(max_distribution_index[1] - min_distribution_index[1] + 1),
+                                              static_cast<std::size_t>(max_distribution_index[2] - min_distribution_index[2] + 1)}};
+
+    using dst_map_t = cslibs_ndt_3d::static_maps::mono::Gridmap<T>;
+
+    typename dst_map_t::distribution_storage_ptr_t storage(new typename dst_map_t::distribution_storage_t);
+    storage->template set<cis::option::tags::array_size>(size[0], size[1], size[2]);
+    storage->template set<cis::option::tags::array_offset>(min_distribution_index[0], min_distribution_index[1], min_distribution_index[2]);
+    cslibs_ndt::conversion::merge(*src, *storage, min_distribution_index, max_distribution_index, 16ul, num_threads);
+
+    return typename dst_map_t::Ptr(new dst_map_t(src->getInitialOrigin(),
+                                                 src->getBundleResolution(),
+                                                 size,
+                                                 min_distribution_index,
+                                                 storage));
+}
+}
+}
+
+#endif // CSLIBS_NDT_3D_CONVERSION_MERGE_HPP
@@ -5,9 +5,13 @@
 #include <cslibs_ndt_3d/dynamic_maps/occupancy_gridmap.hpp>
 #include <cslibs_ndt_3d/static_maps/gridmap.hpp>
 #include <cslibs_ndt_3d/static_maps/occupancy_gridmap.hpp>
+#include <cslibs_ndt/utility/parallel.hpp>
 
 #include <sensor_msgs/PointCloud2.h>
 
+#include <cstring>
+#include <limits>
+
 namespace cslibs_ndt_3d {
 namespace conversion {
 inline void from(
@@ -31,7 +35,7 @@ inline void from(
     for (int i = 0; i < 4; ++i) {
         dst.fields[i].offset   = i * sizeof(float);
         dst.fields[i].datatype = sensor_msgs::PointField::FLOAT32;
-        dst.fields[i].count    = dst.width;
+        dst.fields[i].count    = 1;
     }
 
     // data
@@ -40,6 +44,156 @@ inline void from(
     memcpy(&dst.data[0], &tmp[0], data_size);
 }
 
+namespace pointcloud2 {
+/**
+ * @brief Optional fields of each point besides x, y, z and the channel, in the target frame.
+ *        covariance: cxx cxy cxz cyy cyz czz
+ *        eigen:      eigenvalues l0 l1 l2 and the orientation qx qy qz qw of the eigenvectors
+ */
+enum class fields { none, covariance, eigen };
+
+inline std::vector<std::string> names(const std::string &channel,
+                                      const fields extra)
+{
+    std::vector<std::string> n = {"x", "y", "z", channel};
+    if (extra == fields::covariance)
+        n.insert(n.end(), {"cxx", "cxy", "cxz", "cyy", "cyz", "czz"});
+    else if (extra == fields::eigen)
+        n.insert(n.end(), {"l0", "l1", "l2", "qx", "qy", "qz", "qw"});
+    return n;
+}
+
+/**
+ * @brief Set up the fields and allocate the data of a point cloud of float fields.
+ */
+inline void allocate(const std::vector<std::string> &names,
+                     const std::size_t size,
+                     sensor_msgs::PointCloud2 &dst)
+{
+    dst.width        = static_cast<uint32_t>(size);
+    dst.height       = 1;
+    dst.is_dense     = false;
+    dst.is_bigendian = false;
+    dst.point_step   = static_cast<uint32_t>(names.size() * sizeof(float));
+    dst.row_step     = dst.point_step * dst.width;
+
+    dst.fields.resize(names.size());
+    for (std::size_t i = 0 ; i < names.size() ; ++ i) {
+        dst.fields[i].name     = names[i];
+        dst.fields[i].offset   = static_cast<uint32_t>(i * sizeof(float));
+        dst.fields[i].datatype = sensor_msgs::PointField::FLOAT32;
+        dst.fields[i].count    = 1;
+    }
+
+    dst.data.clear();
+    dst.data.shrink_to_fit();
+    dst.data.resize(static_cast<std::size_t>(dst.row_step));
+}
+
+/**
+ * @brief Write the selected distributions of all storages into a point cloud. The points are
+ *        counted first, so the data is allocated once and every storage writes its own range
+ *        of it in parallel, without intermediate copies.
+ * @param src       map
+ * @param origin    transform from the map to the target frame
+ * @param select    returns the Gaussian of a distribution and sets its value, or nullptr to skip it
+ * @param channel   returns the fourth field of a point given its value, height and the height range
+ * @param name      name of the fourth field
+ * @param extra     optional fields
+ * @param dst       point cloud
+ */
+template <typename T, typename map_t, typename select_t, typename channel_t>
+inline void write(const map_t &src,
+                  const cslibs_math_3d::Pose3<T> &origin,
+                  const select_t &select,
+                  const channel_t &channel,
+                  const std::string &name,
+                  const fields extra,
+                  sensor_msgs::PointCloud2 &dst)
+{
+    using index_t        = typename map_t::index_t;
+    using distribution_t = typename map_t::distribution_t;
+    using gaussian_t     = cslibs_math::statistics::StableDistribution<T,3,3>;
+
+    const auto &storages = src.getStorages();
+    const std::size_t n = storages.size();
+
+    std::vector<std::size_t> offsets(n + 1, 0ul);
+    std::vector<T> min_z(n, std::numeric_limits<T>::max());
+    std::vector<T> max_z(n, std::numeric_limits<T>::lowest());
+    cslibs_ndt::utility::parallel_for(0ul, n, [&storages, &origin, &select, &offsets, &min_z, &max_z](const std::size_t i) {
+        storages[i]->traverse([&origin, &select, &offsets, &min_z, &max_z, i](const index_t &, const distribution_t &d) {
+            T value;
+            if (const gaussian_t *g = select(d, value)) {
+                const T z = (origin * cslibs_math_3d::Point3<T>(g->getMean()))(2);
+                min_z[i] = std::min(min_z[i], z);
+                max_z[i] = std::max(max_z[i], z);
+                ++ offsets[i + 1];
+            }
+        });
+    }, n);
+    for (std::size_t i = 0 ; i < n ; ++ i)
+        offsets[i + 1] += offsets[i];
+    const T z0 = n > 0ul ? *std::min_element(min_z.begin(), min_z.end()) : T();
+    const T z1 = n > 0ul ? *std::max_element(max_z.begin(), max_z.end()) : T();
+
+    allocate(names(name, extra), offsets[n], dst);
+
+    const std::size_t point_step = dst.point_step;
+    const Eigen::Matrix<T,3,3> rotation = origin.rotation().toEigen().toRotationMatrix();
+    uint8_t *data = dst.data.data();
+    cslibs_ndt::utility::parallel_for(0ul, n, [&](const std::size_t i) {
+        uint8_t *out = data + offsets[i] * point_step;
+        storages[i]->traverse([&](const index_t &, const distribution_t &d) {
+            T value;
+            const gaussian_t *g = select(d, value);
+            if (!g)
+                return;
+
+            float point[14] = {};
+            const cslibs_math_3d::Point3<T> p = origin * cslibs_math_3d::Point3<T>(g->getMean());
+            point[0] = static_cast<float>(p(0));
+            point[1] = static_cast<float>(p(1));
+            point[2] = static_cast<float>(p(2));
+            point[3] = channel(value, p(2), z0, z1);
+            if (extra == fields::covariance) {
+                const Eigen::Matrix<T,3,3> c = rotation * g->getCovariance() * rotation.transpose();
+                point[4] = static_cast<float>(c(0,0));
+                point[5] = static_cast<float>(c(0,1));
+                point[6] = static_cast<float>(c(0,2));
+                point[7] = static_cast<float>(c(1,1));
+                point[8] = static_cast<float>(c(1,2));
+                point[9] = static_cast<float>(c(2,2));
+            } else if (extra == fields::eigen) {
+                typename gaussian_t::eigen_values_t eval;
+                typename gaussian_t::eigen_vectors_t evec;
+                if (g->getEigenValuesVectors(eval, evec, true)) {
+                    /// the eigenvectors may form a reflection, which has no quaternion
+                    if (evec.determinant() < T())
+                        evec.col(2) = -evec.col(2);
+                    const Eigen::Quaternion<T> orientation = origin.rotation().toEigen() * Eigen::Quaternion<T>(evec);
+                    point[4]  = static_cast<float>(eval(0));
+                    point[5]  = static_cast<float>(eval(1));
+                    point[6]  = static_cast<float>(eval(2));
+                    point[7]  = static_cast<float>(orientation.x());
+                    point[8]  = static_cast<float>(orientation.y());
+                    point[9]  = static_cast<float>(orientation.z());
+                    point[10] = static_cast<float>(orientation.w());
+                }
+            }
+            std::memcpy(out, point, point_step);
+            out += point_step;
+        });
+    }, n);
+}
+
+template <typename T>
+inline float intensity(const T value, const T, const T, const T)
+{
+    return static_cast<float>(value);
+}
+}
+
 template <cslibs_ndt::map::tags::option option_t,
           typename T,
           template <typename, typename, typename...> class backend_t>
@@ -47,41 +201,18 @@ inline void from(
         const cslibs_ndt::map::Map<option_t,3,cslibs_ndt::Distribution,T,backend_t> &src,
         sensor_msgs::PointCloud2 &dst,
         const typename cslibs_math_3d::Pose3<T> &transform = typename cslibs_math_3d::Pose3<T>(),
-        const bool &allocate_all = false)
+        const bool &allocate_all = false,
+        const pointcloud2::fields extra = pointcloud2::fields::none)
 {
     if (allocate_all)
         src.allocatePartiallyAllocatedBundles();
 
-    using ndt_t = cslibs_ndt::map::Map<option_t,3,cslibs_ndt::Distribution,T,backend_t>;
-    using index_t = std::array<int, 3>;
-    using point_t = typename ndt_t::point_t;
-    using distribution_t = typename ndt_t::distribution_t;
-    auto sample = [](const distribution_t *d,
-                     const point_t &p) -> T {
-        return d ? d->sampleNonNormalized(p) : 0.0;
-        //return d && d->getDistribution() ? d->getDistribution()->sampleNonNormalized(p) : 0.0;
-    };
-
-    std::vector<float> tmp;
-    const auto& origin = transform * src.getInitialOrigin();
-    auto process_item = [&tmp, &origin, &sample](const index_t &bi, const distribution_t& d) {
-        /*const auto dd = d.getDistribution();
-        if (!dd)
-            return;*/
-
-        cslibs_math_3d::Point3<T> mean(/*dd->*/d.getMean());
-        cslibs_math_3d::Point3<T> p = origin * mean;
-        tmp.emplace_back(static_cast<float>(p(0)));
-        tmp.emplace_back(static_cast<float>(p(1)));
-        tmp.emplace_back(static_cast<float>(p(2)));
-        tmp.emplace_back(static_cast<float>(sample(&d,mean)));
+    using gaussian_t = cslibs_math::statistics::StableDistribution<T,3,3>;
+    auto select = [](const cslibs_ndt::Distribution<T,3> &d, T &value) -> const gaussian_t* {
+        value = d.sampleNonNormalized(d.getMean());
+        return &d;
     };
-
-    const auto& storages = src.getStorages();
-    for (const auto& storage : storages) {
-        storage->traverse(process_item);
-    }
-    from(tmp, dst);
+    pointcloud2::write(src, transform * src.getInitialOrigin(), select, &pointcloud2::intensity<T>, "intensity", extra, dst);
 }
 
 template <typename T>
@@ -89,12 +220,13 @@ inline void from(
         const typename cslibs_ndt_3d::dynamic_maps::Gridmap<T>::Ptr &src,
         sensor_msgs::PointCloud2 &dst,
         const typename cslibs_math_3d::Pose3<T> &transform = typename cslibs_math_3d::Pose3<T>(),
-        const bool &allocate_all = false)
+        const bool &allocate_all = false,
+        const pointcloud2::fields extra = pointcloud2::fields::none)
 {
     if (!src)
         return;
 
-    from(*src, dst, transform, allocate_all);
+    from(*src, dst, transform, allocate_all, extra);
 }
 
 template <cslibs_ndt::map::tags::option option_t,
@@ -106,47 +238,24 @@ inline void from(
         const typename cslibs_gridmaps::utility::InverseModel<T>::Ptr &ivm,
         const typename cslibs_math_3d::Pose3<T> &transform = typename cslibs_math_3d::Pose3<T>(),
         const T &threshold = 0.169,
-        const bool &allocate_all = false)
+        const bool &allocate_all = false,
+        const pointcloud2::fields extra = pointcloud2::fields::none)
 {
     if (allocate_all)
         src.allocatePartiallyAllocatedBundles();
 
-    using ndt_t = cslibs_ndt::map::Map<option_t,3,cslibs_ndt::OccupancyDistribution,T,backend_t>;
-    using index_t = std::array<int, 3>;
-    using point_t = typename ndt_t::point_t;
-    using distribution_t = typename ndt_t::distribution_t;
-    auto sample = [&ivm](const distribution_t *d,
-                         const point_t &p) -> T {
-        auto evaluate = [&ivm, &d, &p] {
-            const auto &handle = d;
-            return handle->getDistribution() ?
-                        handle->getDistribution()->sampleNonNormalized(p) * handle->getOccupancy(ivm) : T(0.0);
-        };
-        return d ? evaluate() : T(0.0);
+    using gaussian_t = cslibs_math::statistics::StableDistribution<T,3,3>;
+    auto select = [&ivm, &threshold](const cslibs_ndt::OccupancyDistribution<T,3> &d, T &value) -> const gaussian_t* {
+        const auto &g = d.getDistribution();
+        if (!g)
+            return nullptr;
+        const T occupancy = d.getOccupancy(ivm);
+        if (occupancy < threshold)
+            return nullptr;
+        value = g->sampleNonNormalized(g->getMean()) * occupancy;
+        return g.get();
     };
-
-    std::vector<float> tmp;
-    const auto& origin = transform * src.getInitialOrigin();
-    auto process_item = [&tmp, &origin, &sample, &ivm, &threshold](const index_t &bi, const distribution_t& d) {
-        if (d.getOccupancy(ivm) < threshold)
-            return;
-
-        const auto dd = d.getDistribution();
-        if (!dd)
-            return;
-        cslibs_math_3d::Point3<T> mean(dd->getMean());
-        cslibs_math_3d::Point3<T> p = origin * mean;
-        tmp.emplace_back(static_cast<float>(p(0)));
-        tmp.emplace_back(static_cast<float>(p(1)));
-        tmp.emplace_back(static_cast<float>(p(2)));
-        tmp.emplace_back(static_cast<float>(sample(&d,mean)));
-    };
-
-    const auto& storages = src.getStorages();
-    for (const auto& storage : storages) {
-        storage->traverse(process_item);
-    }
-    from(tmp, dst);
+    pointcloud2::write(src, transform * src.getInitialOrigin(), select, &pointcloud2::intensity<T>, "intensity", extra, dst);
 }
 
 template <typename T>
@@ -156,12 +265,13 @@ inline void from(
         const typename cslibs_gridmaps::utility::InverseModel<T>::Ptr &ivm,
         const typename cslibs_math_3d::Pose3<T> &transform = typename cslibs_math_3d::Pose3<T>(),
         const T &threshold = 0.169,
-        const bool &allocate_all = false)
+        const bool &allocate_all = false,
+        const pointcloud2::fields extra = pointcloud2::fields::none)
 {
     if (!src)
         return;
 
-    from(*src, dst, ivm, transform, threshold, allocate_all);
+    from(*src, dst, ivm, transform, threshold, allocate_all, extra);
 }
 
 }
@@ -5,57 +5,48 @@
 #include <cslibs_ndt_3d/dynamic_maps/occupancy_gridmap.hpp>
 #include <cslibs_ndt_3d/static_maps/gridmap.hpp>
 #include <cslibs_ndt_3d/static_maps/occupancy_gridmap.hpp>
-#include <cslibs_math_ros/sensor_msgs/conversion_3d.hpp>
+#include <cslibs_ndt_3d/conversion/sensor_msgs_pointcloud2.hpp>
+#include <cslibs_math/color/color.hpp>
 
 #include <sensor_msgs/PointCloud2.h>
 
 namespace cslibs_ndt_3d {
 namespace conversion {
+namespace pointcloud2 {
+/**
+ * @brief Color interpolated over the height range, packed into a float like the rgb field of PCL.
+ */
 template <typename T>
-struct ColorTransform {
-    ColorTransform(const double& min_z, const double& max_z) : min_z_(min_z), max_z_(max_z) {}
-    cslibs_math_3d::PointRGB3<T> apply(const cslibs_math_3d::PointRGB3<T>& p) const
-    {
-        return cslibs_math_3d::PointRGB3<T>(p.getPoint(), 1.0f, cslibs_math::color::interpolateColor<T>(p.getPoint()(2), min_z_, max_z_));
-    }
-
-private:
-    const double min_z_;
-    const double max_z_;
-};
+inline float rgb(const T, const T z, const T min_z, const T max_z)
+{
+    const cslibs_math::color::Color<T> c = cslibs_math::color::interpolateColor<T>(z, min_z, max_z);
+    const uint32_t packed = (static_cast<uint32_t>(c.r * 255.0) << 16) |
+                            (static_cast<uint32_t>(c.g * 255.0) << 8)  |
+                             static_cast<uint32_t>(c.b * 255.0);
+    float f;
+    std::memcpy(&f, &packed, sizeof(float));
+    return f;
+}
+}
 
 template <cslibs_ndt::map::tags::option option_t,
           typename T,
           template <typename, typename, typename...> class backend_t>
 inline void rgbFrom(
-        cslibs_ndt::map::Map<option_t,3,cslibs_ndt::Distribution,T,backend_t> &src,
+        const cslibs_ndt::map::Map<option_t,3,cslibs_ndt::Distribution,T,backend_t> &src,
         sensor_msgs::PointCloud2 &dst,
         const typename cslibs_math_3d::Pose3<T> &transform = typename cslibs_math_3d::Pose3<T>(),
-        const bool& allocate_all = false)
+        const bool& allocate_all = false,
+        const pointcloud2::fields extra = pointcloud2::fields::none)
 {
     if (allocate_all)
         src.allocatePartiallyAllocatedBundles();
 
-    using ndt_t = cslibs_ndt::map::Map<option_t,3,cslibs_ndt::Distribution,T,backend_t>;
-    using index_t = std::array<int, 3>;
-    using distribution_t = typename ndt_t::distribution_t;
-
-    cslibs_math_3d::PointcloudRGB3<T> cloud;
-    const auto& origin = transform * src.getInitialOrigin();
-    auto process_item = [&src, &cloud, &origin](const index_t &bi, const distribution_t& d) {
-        cslibs_math_3d::Point3<T> mean(d.data().getMean());
-        cloud.insert(cslibs_math_3d::PointRGB3<T>(origin * mean));
+    using gaussian_t = cslibs_math::statistics::StableDistribution<T,3,3>;
+    auto select = [](const cslibs_ndt::Distribution<T,3> &d, T &) -> const gaussian_t* {
+        return &d;
     };
-
-    const auto& storages = src.getStorages();
-    for (const auto& storage : storages) {
-        storage->traverse(process_item);
-    }
-
-    const T min_z = cloud.min().getPoint()(2);
-    const T max_z = cloud.max().getPoint()(2);
-    cloud.transform(ColorTransform<T>(min_z, max_z));
-    cslibs_math_ros::sensor_msgs::conversion_3d::from<T>(cloud, dst);
+    pointcloud2::write(src, transform * src.getInitialOrigin(), select, &pointcloud2::rgb<T>, "rgb", extra, dst);
 }
 
 template <typename T>
@@ -63,51 +54,36 @@ inline void rgbFrom(
         const typename cslibs_ndt_3d::dynamic_maps::Gridmap<T>::Ptr &src,
         sensor_msgs::PointCloud2 &dst,
         const typename cslibs_math_3d::Pose3<T> &transform = typename cslibs_math_3d::Pose3<T>(),
-        const bool& allocate_all = false)
+        const bool& allocate_all = false,
+        const pointcloud2::fields extra = pointcloud2::fields::none)
 {
     if (!src)
         return;
 
-    rgbFrom(*src, dst, transform, allocate_all);
+    rgbFrom(*src, dst, transform, allocate_all, extra);
 }
 
 template <cslibs_ndt::map::tags::option option_t,
           typename T,
           template <typename, typename, typename...> class backend_t>
 inline void rgbFrom(
-        cslibs_ndt::map::Map<option_t,3,cslibs_ndt::OccupancyDistribution,T,backend_t> &src,
+        const cslibs_ndt::map::Map<option_t,3,cslibs_ndt::OccupancyDistribution,T,backend_t> &src,
         sensor_msgs::PointCloud2 &dst,
         const typename cslibs_gridmaps::utility::InverseModel<T>::Ptr &ivm,
         const typename cslibs_math_3d::Pose3<T> &transform = typename cslibs_math_3d::Pose3<T>(),
         const T& threshold = 0.169,
-        const bool& allocate_all = false)
+        const bool& allocate_all = false,
+        const pointcloud2::fields extra = pointcloud2::fields::none)
 {
     if (allocate_all)
         src.allocatePartiallyAllocatedBundles();
 
-    using ndt_t = cslibs_ndt::map::Map<option_t,3,cslibs_ndt::OccupancyDistribution,T,backend_t>;
-    using index_t = std::array<int, 3>;
-    using distribution_t = typename ndt_t::distribution_t;
-
-    cslibs_math_3d::PointcloudRGB3<T> cloud;
-    const auto& origin = transform * src.getInitialOrigin();
-    auto process_item = [&src, &ivm, &cloud, &origin, &threshold](const index_t &bi, const distribution_t& d) {
-        const auto dd = d.getDistribution();
-        if (!dd || d.getOccupancy(ivm) < threshold)
-            return;
-        cslibs_math_3d::PointRGB3<T> mean(dd->getMean());
-        cloud.insert(cslibs_math_3d::PointRGB3<T>(origin * mean));
+    using gaussian_t = cslibs_math::statistics::StableDistribution<T,3,3>;
+    auto select = [&ivm, &threshold](const cslibs_ndt::OccupancyDistribution<T,3> &d, T &) -> const gaussian_t* {
+        const auto &g = d.getDistribution();
+        return g && d.getOccupancy(ivm) >= threshold ? g.get() : nullptr;
     };
-
-    const auto& storages = src.getStorages();
-    for (const auto& storage : storages) {
-        storage->traverse(process_item);
-    }
-
-    const T min_z = cloud.min().getPoint()(2);
-    const T max_z = cloud.max().getPoint()(2);
-    cloud.transform(ColorTransform<T>(min_z, max_z));
-    cslibs_math_ros::sensor_msgs::conversion_3d::from<T>(cloud, dst);
+    pointcloud2::write(src, transform * src.getInitialOrigin(), select, &pointcloud2::rgb<T>, "rgb", extra, dst);
 }
 
 template <typename T>
@@ -117,12 +93,13 @@ inline void rgbFrom(
         const typename cslibs_gridmaps::utility::InverseModel<T>::Ptr &ivm,
         const typename cslibs_math_3d::Pose3<T> &transform = typename cslibs_math_3d::Pose3<T>(),
         const T& threshold = 0.169,
-        const bool& allocate_all = false)
+        const bool& allocate_all = false,
+        const pointcloud2::fields extra = pointcloud2::fields::none)
 {
     if (!src)
         return;
 
-    rgbFrom<T>(*src, dst, ivm, transform, threshold, allocate_all);
+    rgbFrom<T>(*src, dst, ivm, transform, threshold, allocate_all, extra);
 }
 
 }
@@ -3,6 +3,7 @@
 
 #include <cslibs_ndt/matching/alglib/function.hpp>
 #include <cslibs_ndt/map/map.hpp>
+#include <cslibs_ndt_3d/matching/pose_jacobian.hpp>
 
 #include <optimization.h>
 
@@ -34,6 +35,78 @@ public:
     using FunctorQuaternion = Functor<7>;
 
     inline static void applyRPY(const ::alglib::real_1d_array &x, ::alglib::real_1d_array &fi, void *ptr)
+    {
+        evaluateRPY(x, fi, nullptr, ptr);
+    }
+
+    // residuals and their analytic jacobian, e.g. for minlmcreatevj
+    inline static void applyJacobianRPY(const ::alglib::real_1d_array &x, ::alglib::real_1d_array &fi,
+                                       ::alglib::real_2d_array &jac, void *ptr)
+    {
+        evaluateRPY(x, fi, &jac, ptr);
+    }
+
+    inline static double mapScoreRPY(const ::alglib::real_1d_array &x, const ::alglib::real_1d_array &fi, void* ptr)
+    {
+        // check that all necessary information is given
+        const auto& casted_ptr = (Functor<6>*)ptr;
+        if (!casted_ptr) {
+            std::cerr << "Correct Functor not given..." << std::endl;
+            return 0;
+        }
+
+        // calculate scaling
+        const Functor<6>& object = *casted_ptr;
+        const double num_points  = object.points_->size();
+        const double scale       = /*std::sqrt(2.0*/ 1.0 / object.map_weight_;
+        const double absolute    = 1.0 / num_points;
+
+        // extract score from fi
+        double score = 0.0;
+        for (std::size_t i=0; i<num_points; ++i)
+            score += (absolute - (fi[i] * scale));
+
+        return score;
+    }
+
+    inline static void applyQuaternion(const ::alglib::real_1d_array &x, ::alglib::real_1d_array &fi, void *ptr)
+    {
+        evaluateQuaternion(x, fi, nullptr, ptr);
+    }
+
+    // residuals and their analytic jacobian, e.g. for minlmcreatevj
+    inline static void applyJacobianQuaternion(const ::alglib::real_1d_array &x, ::alglib::real_1d_array &fi,
+                                       ::alglib::real_2d_array &jac, void *ptr)
+    {
+        evaluateQuaternion(x, fi, &jac, ptr);
+    }
+
+    inline static double mapScoreQuaternion(const ::alglib::real_1d_array &x, const ::alglib::real_1d_array &fi, void* ptr)
+    {
+        // check that all necessary information is given
+        const auto& casted_ptr = (Functor<7>*)ptr;
+        if (!casted_ptr) {
+            std::cerr << "Correct Functor not given..." << std::endl;
+            return 0;
+        }
+
+        // calculate scaling
+        const Functor<7>& object = *casted_ptr;
+        const double num_points  = object.points_->size();
+        const double scale       = /*std::sqrt(2.0*/ 1.0 / object.map_weight_;
+        const double absolute    = 1.0 / num_points;
+
+        // extract score from fi
+        double score = 0.0;
+        for (std::size_t i=0; i<num_points; ++i)
+            score += (absolute - (fi[i] * scale));
+
+        return score;
+    }
+
+private:
+    inline static void evaluateRPY(const ::alglib::real_1d_array &x, ::alglib::real_1d_array &fi,
+                                   ::alglib::real_2d_array *jac, void *ptr)
     {
         // check that all necessary information is given
         const auto& casted_ptr = (Functor<6>*)ptr;
@@ -52,50 +125,51 @@ public:
         const double& rot_weight   = /*std::sqrt*/(object.rotation_weight_);    //*0.5;
 
         const typename ndt_t::pose_t current_transform(x[0],x[1],x[2],x[3],x[4],x[5]); // xyz rpy
+        const PoseJacobian3dRPY jacobian(x[3],x[4],x[5]);
+        typename ndt_t::gradient_t dq;
 
         // evaluate function
         std::size_t i=0;
         const double num_points =  static_cast<double>(points.size());
         for (const auto& p : points) {
             const typename ndt_t::point_t q = current_transform * typename ndt_t::point_t(p(0),p(1),p(2));
-            const double score = map.sampleNonNormalized(q);
-            fi[i++] = map_weight * (std::isnormal(score) ? (1.0 - score) : 1.0) / num_points;
+            const double score = jac ? map.sampleNonNormalized(q, dq) : map.sampleNonNormalized(q);
+            const bool normal = std::isnormal(score);
+            if (jac) {
+                const Eigen::Matrix<double,1,6> d = normal ?
+                            Eigen::Matrix<double,1,6>(-map_weight / num_points * dq.template cast<double>().transpose() *
+                                                      jacobian(Eigen::Vector3d(p(0),p(1),p(2)))) :
+                            Eigen::Matrix<double,1,6>::Zero();
+                for (std::size_t j=0; j<6; ++j)
+                    (*jac)[i][j] = d(j);
+            }
+            fi[i++] = map_weight * (normal ? (1.0 - score) : 1.0) / num_points;
         }
 
         // calculate translational and rotational function component
         const auto& initial_guess = (object.initial_guess_);
+        if (jac) {
+            for (std::size_t r=i; r<i+6; ++r)
+                for (std::size_t j=0; j<6; ++j)
+                    (*jac)[r][j] = 0.0;
+            for (std::size_t j=0; j<3; ++j)
+                (*jac)[i+j][j] = trans_weight;
+        }
         fi[i++] = trans_weight * (x[0] - initial_guess[0]);
         fi[i++] = trans_weight * (x[1] - initial_guess[1]);
         fi[i++] = trans_weight * (x[2] - initial_guess[2]);
-        fi[i++] = rot_weight * std::fabs(cslibs_math::common::angle::difference(x[3], initial_guess[3]));
-        fi[i++] = rot_weight * std::fabs(cslibs_math::common::angle::difference(x[4], initial_guess[4]));
-        fi[i++] = rot_weight * std::fabs(cslibs_math::common::angle::difference(x[5], initial_guess[5]));
-    }
 
-    inline static double mapScoreRPY(const ::alglib::real_1d_array &x, const ::alglib::real_1d_array &fi, void* ptr)
-    {
-        // check that all necessary information is given
-        const auto& casted_ptr = (Functor<6>*)ptr;
-        if (!casted_ptr) {
-            std::cerr << "Correct Functor not given..." << std::endl;
-            return 0;
+        auto sign = [](const double v) { return v > 0.0 ? 1.0 : (v < 0.0 ? -1.0 : 0.0); };
+        for (std::size_t j=3; j<6; ++j) {
+            const double rot_diff = cslibs_math::common::angle::difference(x[j], initial_guess[j]);
+            if (jac)
+                (*jac)[i][j] = rot_weight * sign(rot_diff);
+            fi[i++] = rot_weight * std::fabs(rot_diff);
         }
-
-        // calculate scaling
-        const Functor<6>& object = *casted_ptr;
-        const double num_points  = object.points_->size();
-        const double scale       = /*std::sqrt(2.0*/ 1.0 / object.map_weight_;
-        const double absolute    = 1.0 / num_points;
-
-        // extract score from fi
-        double score = 0.0;
-        for (std::size_t i=0; i<num_points; ++i)
-            score += (absolute - (fi[i] * scale));
-
-        return score;
     }
 
-    inline static void applyQuaternion(const ::alglib::real_1d_array &x, ::alglib::real_1d_array &fi, void *ptr)
+    inline static void evaluateQuaternion(const ::alglib::real_1d_array &x, ::alglib::real_1d_array &fi,
+                                          ::alglib::real_2d_array *jac, void *ptr)
     {
         // check that all necessary information is given
         const auto& casted_ptr = (Functor<7>*)ptr;
@@ -116,54 +190,64 @@ public:
         const typename ndt_t::pose_t current_transform(
                     cslibs_math_3d::Vector3<_T>(x[0],x[1],x[2]),          // xyz
                     cslibs_math_3d::Quaternion<_T>(x[3],x[4],x[5],x[6])); // xyzw
+        const PoseJacobian3dQuaternion jacobian(x[3],x[4],x[5],x[6]);
+        typename ndt_t::gradient_t dq;
 
         // evaluate function
         std::size_t i=0;
         const double num_points =  static_cast<double>(points.size());
         for (const auto& p : points) {
             const typename ndt_t::point_t q = current_transform * typename ndt_t::point_t(p(0),p(1),p(2));
-            const double score = map.sampleNonNormalized(q);
-            fi[i++] = map_weight * (std::isnormal(score) ? (1.0 - score) : 1.0) / num_points;
+            const double score = jac ? map.sampleNonNormalized(q, dq) : map.sampleNonNormalized(q);
+            const bool normal = std::isnormal(score);
+            if (jac) {
+                const Eigen::Matrix<double,1,7> d = normal ?
+                            Eigen::Matrix<double,1,7>(-map_weight / num_points * dq.template cast<double>().transpose() *
+                                                      jacobian(Eigen::Vector3d(p(0),p(1),p(2)))) :
+                            Eigen::Matrix<double,1,7>::Zero();
+                for (std::size_t j=0; j<7; ++j)
+                    (*jac)[i][j] = d(j);
+            }
+            fi[i++] = map_weight * (normal ? (1.0 - score) : 1.0) / num_points;
         }
 
         // calculate translational and rotational function component
         const auto& initial_guess = (object.initial_guess_);
+        if (jac) {
+            for (std::size_t r=i; r<i+7; ++r)
+                for (std::size_t j=0; j<7; ++j)
+                    (*jac)[r][j] = 0.0;
+            for (std::size_t j=0; j<3; ++j)
+                (*jac)[i+j][j] = trans_weight;
+        }
         fi[i++] = trans_weight * (x[0] - initial_guess[0]);
         fi[i++] = trans_weight * (x[1] - initial_guess[1]);
         fi[i++] = trans_weight * (x[2] - initial_guess[2]);
 
+        auto sign = [](const double v) { return v > 0.0 ? 1.0 : (v < 0.0 ? -1.0 : 0.0); };
         const auto& rot = current_transform.rotation();
         const cslibs_math_3d::Quaternion<_T> initial_rot_inverse(
                     -initial_guess[3], -initial_guess[4], -initial_guess[5], initial_guess[6]);
         const auto& rot_diff = initial_rot_inverse * rot;
+        if (jac) {
+            // rot_diff (w, x, y, z) is linear in the rotation (x, y, z, w)
+            const double ax = -initial_guess[3], ay = -initial_guess[4], az = -initial_guess[5], aw = initial_guess[6];
+            Eigen::Matrix4d d_product;
+            d_product << -ax, -ay, -az,  aw,
+                          aw, -az,  ay,  ax,
+                          az,  aw, -ax,  ay,
+                         -ay,  ax,  aw,  az;
+            const Eigen::Matrix4d d_rot = d_product * jacobian.projection();
+            const double signs[4] = {sign(rot_diff.w()), sign(rot_diff.x()), sign(rot_diff.y()), sign(rot_diff.z())};
+            for (std::size_t r=0; r<4; ++r)
+                for (std::size_t j=0; j<4; ++j)
+                    (*jac)[i+r][3+j] = rot_weight * signs[r] * d_rot(r,j);
+        }
         fi[i++] = rot_weight * std::fabs(rot_diff.w());
         fi[i++] = rot_weight * std::fabs(rot_diff.x());
         fi[i++] = rot_weight * std::fabs(rot_diff.y());
         fi[i++] = rot_weight * std::fabs(rot_diff.z());
     }
-
-    inline static double mapScoreQuaternion(const ::alglib::real_1d_array &x, const ::alglib::real_1d_array &fi, void* ptr)
-    {
-        // check that all necessary information is given
-        const auto& casted_ptr = (Functor<7>*)ptr;
-        if (!casted_ptr) {
-            std::cerr << "Correct Functor not given..." << std::endl;
-            return 0;
-        }
-
-        // calculate scaling
-        const Functor<7>& object = *casted_ptr;
-        const double num_points  = object.points_->size();
-        const double scale       = /*std::sqrt(2.0*/ 1.0 / object.map_weight_;
-        const double absolute    = 1.0 / num_points;
-
-        // extract score from fi
-        double score = 0.0;
-        for (std::size_t i=0; i<num_points; ++i)
-            score += (absolute - (fi[i] * scale));
-
-        return score;
-    }
 };
 
 }
@@ -0,0 +1,93 @@
+#ifndef CSLIBS_NDT_3D_MATCHING_CERES_GLOBAL_SEARCH_HPP
+#define CSLIBS_NDT_3D_MATCHING_CERES_GLOBAL_SEARCH_HPP
+
+#include <cslibs_ndt/matching/search/global_search.hpp>
+#include <cslibs_ndt_3d/matching/ceres/problem.hpp>
+
+namespace cslibs_ndt {
+namespace matching {
+namespace ceres {
+
+/**
+ * @brief Refine the hypotheses of a global search with the 3d quaternion scan match problem and
+ *        rescore them. Hypotheses are refined in parallel, each with its own problem, the
+ *        candidates are sorted by descending score afterwards.
+ * @param search        the global search the candidates originate from
+ * @param points        points in local coordinates
+ * @param candidates    hypotheses to be refined
+ * @param options       solver options, options.num_threads should be 1 when refining in parallel
+ * @param only_yaw      only refine x, y and yaw, as searched
+ * @param num_threads   number of hypotheses refined at once
+ * @param args          cost functor arguments, e.g. map and inverse sensor model
+ */
+template <typename ndt_t, Flag flag_t = Flag::DIRECT, typename points_t, typename ... args_t>
+inline void Refine3d(const search::GlobalSearch<ndt_t> &search,
+                     const points_t &points,
+                     typename search::GlobalSearch<ndt_t>::candidates_t &candidates,
+                     const ::ceres::Solver::Options &options,
+                     const bool only_yaw,
+                     const std::size_t num_threads,
+                     const args_t &...args)
+{
+    using pose_t = typename ndt_t::pose_t;
+    using T      = typename search::GlobalSearch<ndt_t>::T;
+
+    utility::parallel_for(0ul, candidates.size(), [&](const std::size_t i) {
+        auto &candidate = candidates[i];
+        const auto &q = candidate.pose.rotation();
+        double translation[3] = {static_cast<double>(candidate.pose.tx()),
+                                 static_cast<double>(candidate.pose.ty()),
+                                 static_cast<double>(candidate.pose.tz())};
+        double rotation[4]    = {static_cast<double>(q.w()), static_cast<double>(q.x()),
+                                 static_cast<double>(q.y()), static_cast<double>(q.z())}; // wxyz
+
+        ::ceres::Problem problem;
+        Problem3dQuaternion<ndt_t, flag_t>(0.0, 0.0, 1.0,
+                                           cslibs_math::linear::Vector<double,3>(translation[0], translation[1], translation[2]),
+                                           cslibs_math_3d::Quaterniond(rotation[1], rotation[2], rotation[3], rotation[0]),
+                                           translation, rotation, problem, only_yaw, false, points, args...);
+
+        ::ceres::Solver::Summary summary;
+        ::ceres::Solve(options, &problem, &summary);
+        if (!summary.IsSolutionUsable())
+            return;
+
+        const pose_t refined(cslibs_math_3d::Vector3<T>(translation[0], translation[1], translation[2]),
+                             cslibs_math_3d::Quaternion<T>(rotation[1], rotation[2], rotation[3], rotation[0])); // xyzw
+        const double score = search.score(refined, points);
+        if (score >= candidate.score) {
+            candidate.pose  = refined;
+            candidate.score = score;
+        }
+    }, num_threads);
+
+    std::sort(candidates.begin(), candidates.end());
+}
+
+/**
+ * @brief Global relocalisation, multi-hypothesis search over x, y, z and yaw followed by a
+ *        refinement of the best refine_count hypotheses.
+ */
+template <typename ndt_t, Flag flag_t = Flag::DIRECT, typename points_t, typename ... args_t>
+inline typename search::GlobalSearch<ndt_t>::candidates_t
+Relocalize3d(const search::GlobalSearch<ndt_t> &search,
+             const typename ndt_t::pose_t &center,
+             const points_t &points,
+             const typename search::GlobalSearch<ndt_t>::Parameters &parameters,
+             const std::size_t refine_count,
+             const ::ceres::Solver::Options &options,
+             const bool only_yaw,
+             const args_t &...args)
+{
+    auto candidates = search.search(center, points, parameters);
+    if (candidates.size() > refine_count)
+        candidates.resize(refine_count);
+    Refine3d<ndt_t, flag_t>(search, points, candidates, options, only_yaw, parameters.num_threads, args...);
+    return candidates;
+}
+
+}
+}
+}
+
+#endif // CSLIBS_NDT_3D_MATCHING_CERES_GLOBAL_SEARCH_HPP
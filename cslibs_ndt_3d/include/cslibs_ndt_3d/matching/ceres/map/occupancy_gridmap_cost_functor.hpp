@@ -3,6 +3,8 @@
 
 #include <cslibs_ndt/map/map.hpp>
 #include <cslibs_ndt/matching/ceres/map/scan_match_cost_functor.hpp>
+#include <cslibs_ndt/matching/ceres/map/sample_grid.hpp>
+#include <cslibs_ndt/matching/ceres/map/tricubic_interpolator.hpp>
 
 namespace cslibs_ndt {
 namespace matching {
@@ -85,6 +87,91 @@ private:
     Eigen::Matrix<double,3,1> trans_;
 };
 
+template <cslibs_ndt::map::tags::option option_t,
+          typename _T,
+          template <typename, typename, typename...> class backend_t>
+class ScanMatchCostFunctor<
+        cslibs_ndt::map::Map<option_t,3,cslibs_ndt::OccupancyDistribution,_T,backend_t>,
+        Flag::INTERPOLATION>
+{
+    using ndt_t = cslibs_ndt::map::Map<option_t,3,cslibs_ndt::OccupancyDistribution,_T,backend_t>;
+
+    using ivm_t = typename ndt_t::inverse_sensor_model_t;
+    using point_t = typename ndt_t::point_t;
+    using grid_t = SampleGrid<3>;
+
+    template <typename>
+    friend class TriCubicInterpolator;
+
+    static constexpr int DATA_DIMENSION = 1;
+
+protected:
+    explicit inline ScanMatchCostFunctor(const ndt_t& map,
+                                         const typename ivm_t::Ptr& ivm,
+                                         const double& sampling_resolution) :
+        map_(map),
+        ivm_(ivm),
+        sampling_resolution_(sampling_resolution),
+        interpolator_(*this)
+    {
+    }
+
+    /**
+     * @brief Interpolate on a precomputed sample grid instead of sampling the map on demand,
+     *        the grid can be created once with SampleGrid<3>::create and shared between solves.
+     */
+    explicit inline ScanMatchCostFunctor(const ndt_t& map,
+                                         const typename ivm_t::Ptr& ivm,
+                                         const typename grid_t::ConstPtr& grid) :
+        map_(map),
+        ivm_(ivm),
+        grid_(grid),
+        sampling_resolution_(grid->getSamplingResolution()),
+        interpolator_(*this)
+    {
+    }
+
+    template <int _D>
+    inline void Evaluate(const Eigen::Matrix<double,_D,1>& q, double* const value) const
+    {
+        if (grid_)
+            interpolator_.Evaluate(q(0) / sampling_resolution_,
+                                   q(1) / sampling_resolution_,
+                                   q(2) / sampling_resolution_,
+                                   value);
+        else
+            *value = 1.0 - map_.sampleNonNormalized(point_t(q(0),q(1),q(2)), ivm_);
+    }
+
+    template <typename JetT, int _D>
+    inline void Evaluate(const Eigen::Matrix<JetT,_D,1>& q, JetT* const value) const
+    {
+        interpolator_.Evaluate(q(0) / sampling_resolution_,
+                               q(1) / sampling_resolution_,
+                               q(2) / sampling_resolution_,
+                               value);
+    }
+
+private:
+    inline void GetValue(const int row, const int column, const int slice, double* const value) const
+    {
+        if (grid_) {
+            grid_->GetValue(row, column, slice, value);
+            return;
+        }
+        *value = 1.0 - map_.sampleNonNormalized(
+                    point_t(row * sampling_resolution_,
+                            column * sampling_resolution_,
+                            slice * sampling_resolution_), ivm_);
+    }
+
+    const ndt_t& map_;
+    const typename ivm_t::Ptr& ivm_;
+    const typename grid_t::ConstPtr grid_;
+    const double sampling_resolution_;
+    const TriCubicInterpolator<ScanMatchCostFunctor<ndt_t,Flag::INTERPOLATION>> interpolator_;
+};
+
 }
 }
 }
@@ -3,6 +3,7 @@
 
 #include <cslibs_ndt/matching/nlopt/function.hpp>
 #include <cslibs_ndt/map/map.hpp>
+#include <cslibs_ndt_3d/matching/pose_jacobian.hpp>
 
 namespace cslibs_ndt {
 namespace matching {
@@ -39,12 +40,6 @@ public:
 
     inline static double applyRPY(unsigned n, const double *x, double *grad, void* ptr)
     {
-        // since f is discontinuous, use derivative-free algorithms!
-        if (grad) {
-            std::cerr << "Gradient not implemented..." << std::endl;
-            return 0;
-        }
-
         // check that all necessary information is given
         const auto& casted_ptr = (Functor<6>*)ptr;
         if (!casted_ptr) {
@@ -60,25 +55,48 @@ public:
         double fi = 0;
         const typename ndt_t::pose_t current_transform(x[0],x[1],x[2],x[3],x[4],x[5]); // xyz rpy
 
-        // evaluate function
+        // evaluate function (and map gradient, f is only piecewise smooth at bundle borders)
+        Eigen::Matrix<double,1,6> map_grad = Eigen::Matrix<double,1,6>::Zero();
+        const PoseJacobian3dRPY jacobian(x[3],x[4],x[5]);
+        typename ndt_t::gradient_t dq;
         for (const auto& p : points) {
             const typename ndt_t::point_t q = current_transform * typename ndt_t::point_t(p(0),p(1),p(2));
-            const double score = map.sampleNonNormalized(q);
-            fi += std::isnormal(score) ? (1.0 - score) : 1.0;
+            const double score = grad ? map.sampleNonNormalized(q, dq) : map.sampleNonNormalized(q);
+            const Eigen::Vector3d local(p(0),p(1),p(2));
+            if (std::isnormal(score)) {
+                fi += 1.0 - score;
+                if (grad)
+                    map_grad -= dq.template cast<double>().transpose() * jacobian(local);
+            } else {
+                fi += 1.0;
+            }
         }
 
         // calculate translational and rotational function component
         const auto& initial_guess = (object.initial_guess_);
         const double trans_diff   = hypot(x[0] - initial_guess[0], x[1] - initial_guess[1], x[2] - initial_guess[2]); // xyz
-        const double rot_diff     = hypot(cslibs_math::common::angle::difference(x[3], initial_guess[3]),  // rpy
-                                          cslibs_math::common::angle::difference(x[4], initial_guess[4]),
-                                          cslibs_math::common::angle::difference(x[5], initial_guess[5]));
+        const double rot_diffs[3] = {cslibs_math::common::angle::difference(x[3], initial_guess[3]),  // rpy
+                                     cslibs_math::common::angle::difference(x[4], initial_guess[4]),
+                                     cslibs_math::common::angle::difference(x[5], initial_guess[5])};
+        const double rot_diff     = hypot(rot_diffs[0], rot_diffs[1], rot_diffs[2]);
 
         // apply weights
-        fi = object.map_weight_ * fi / static_cast<double>(points.size()) +
+        const double num_points = static_cast<double>(points.size());
+        fi = object.map_weight_ * fi / num_points +
              object.translation_weight_ * trans_diff +
              object.rotation_weight_ * std::fabs(rot_diff);
 
+        if (grad) {
+            const double trans_grad = trans_diff > 0.0 ? object.translation_weight_ / trans_diff : 0.0;
+            const double rot_grad   = rot_diff   > 0.0 ? object.rotation_weight_    / rot_diff   : 0.0;
+            for (std::size_t i = 0 ; i < 6 ; ++i)
+                grad[i] = object.map_weight_ * map_grad(i) / num_points;
+            for (std::size_t i = 0 ; i < 3 ; ++i)
+                grad[i] += trans_grad * (x[i] - initial_guess[i]);
+            for (std::size_t i = 0 ; i < 3 ; ++i)
+                grad[3 + i] += rot_grad * rot_diffs[i];
+        }
+
         return fi;
     }
 
@@ -108,12 +126,6 @@ public:
 
     inline static double applyQuaternion(unsigned n, const double *x, double *grad, void* ptr)
     {
-        // since f is discontinuous, use derivative-free algorithms!
-        if (grad) {
-            std::cerr << "Gradient not implemented..." << std::endl;
-            return 0;
-        }
-
         // check that all necessary information is given
         const auto& casted_ptr = (Functor<7>*)ptr;
         if (!casted_ptr) {
@@ -132,25 +144,50 @@ public:
                     cslibs_math_3d::Quaternion<_T>(x[3],x[4],x[5],x[6])); // xyzw
         const auto& rot = current_transform.rotation();
 
-        // evaluate function
+        // evaluate function (and map gradient, f is only piecewise smooth at bundle borders)
+        Eigen::Matrix<double,1,7> map_grad = Eigen::Matrix<double,1,7>::Zero();
+        const PoseJacobian3dQuaternion jacobian(x[3],x[4],x[5],x[6]);
+        typename ndt_t::gradient_t dq;
         for (const auto& p : points) {
             const typename ndt_t::point_t q = current_transform * typename ndt_t::point_t(p(0),p(1),p(2));
-            const double score = map.sampleNonNormalized(q);
-            fi += std::isnormal(score) ? (1.0 - score) : 1.0;
+            const double score = grad ? map.sampleNonNormalized(q, dq) : map.sampleNonNormalized(q);
+            const Eigen::Vector3d local(p(0),p(1),p(2));
+            if (std::isnormal(score)) {
+                fi += 1.0 - score;
+                if (grad)
+                    map_grad -= dq.template cast<double>().transpose() * jacobian(local);
+            } else {
+                fi += 1.0;
+            }
         }
 
         // calculate translational and rotational function component
         const auto& initial_guess = (object.initial_guess_);
         const double trans_diff   = hypot(x[0] - initial_guess[0], x[1] - initial_guess[1], x[2] - initial_guess[2]); // xyz
-        const double rot_diff     = hypot(cslibs_math::common::angle::difference(rot.roll(), initial_guess[3]),  // rpy
-                                          cslibs_math::common::angle::difference(rot.pitch(), initial_guess[4]),
-                                          cslibs_math::common::angle::difference(rot.yaw(), initial_guess[5]));
+        const double rot_diffs[3] = {cslibs_math::common::angle::difference(rot.roll(), initial_guess[3]),  // rpy
+                                     cslibs_math::common::angle::difference(rot.pitch(), initial_guess[4]),
+                                     cslibs_math::common::angle::difference(rot.yaw(), initial_guess[5])};
+        const double rot_diff     = hypot(rot_diffs[0], rot_diffs[1], rot_diffs[2]);
 
         // apply weights
-        fi = object.map_weight_ * fi / static_cast<double>(points.size()) +
+        const double num_points = static_cast<double>(points.size());
+        fi = object.map_weight_ * fi / num_points +
              object.translation_weight_ * trans_diff +
              object.rotation_weight_ * std::fabs(rot_diff);
 
+        if (grad) {
+            const double trans_grad = trans_diff > 0.0 ? object.translation_weight_ / trans_diff : 0.0;
+            const double rot_grad   = rot_diff   > 0.0 ? object.rotation_weight_    / rot_diff   : 0.0;
+            for (std::size_t i = 0 ; i < 7 ; ++i)
+                grad[i] = object.map_weight_ * map_grad(i) / num_points;
+            for (std::size_t i = 0 ; i < 3 ; ++i)
+                grad[i] += trans_grad * (x[i] - initial_guess[i]);
+            const Eigen::Matrix<double,1,4> d_rot = rot_grad *
+                    Eigen::Matrix<double,1,3>(rot_diffs[0], rot_diffs[1], rot_diffs[2]) * jacobian.euler();
+            for (std::size_t i = 0 ; i < 4 ; ++i)
+                grad[3 + i] += d_rot(i);
+        }
+
         return fi;
     }
 
@@ -0,0 +1,160 @@
+#ifndef CSLIBS_NDT_3D_MATCHING_POSE_JACOBIAN_HPP
+#define CSLIBS_NDT_3D_MATCHING_POSE_JACOBIAN_HPP
+
+#include <cmath>
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+namespace cslibs_ndt {
+namespace matching {
+
+/**
+ * @brief Jacobian of q = R(roll, pitch, yaw) * p + t with respect to the pose
+ *        parameters (tx, ty, tz, roll, pitch, yaw), R = Rz(yaw) * Ry(pitch) * Rx(roll).
+ */
+class PoseJacobian3dRPY
+{
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    using jacobian_t = Eigen::Matrix<double,3,6>;
+
+    inline PoseJacobian3dRPY(const double roll, const double pitch, const double yaw)
+    {
+        const double cr = std::cos(roll),  sr = std::sin(roll);
+        const double cp = std::cos(pitch), sp = std::sin(pitch);
+        const double cy = std::cos(yaw),   sy = std::sin(yaw);
+
+        Eigen::Matrix3d rx, ry, rz, drx, dry, drz;
+        rx  << 1.0, 0.0, 0.0,   0.0,  cr, -sr,   0.0,  sr,  cr;
+        drx << 0.0, 0.0, 0.0,   0.0, -sr, -cr,   0.0,  cr, -sr;
+        ry  <<  cp, 0.0,  sp,   0.0, 1.0, 0.0,   -sp, 0.0,  cp;
+        dry << -sp, 0.0,  cp,   0.0, 0.0, 0.0,   -cp, 0.0, -sp;
+        rz  <<  cy, -sy, 0.0,    sy,  cy, 0.0,   0.0, 0.0, 1.0;
+        drz << -sy, -cy, 0.0,    cy, -sy, 0.0,   0.0, 0.0, 0.0;
+
+        d_roll_  = rz * ry * drx;
+        d_pitch_ = rz * dry * rx;
+        d_yaw_   = drz * ry * rx;
+    }
+
+    /**
+     * @brief Evaluate the jacobian.
+     * @param p     point in local coordinates
+     * @return d q / d (tx, ty, tz, roll, pitch, yaw)
+     */
+    inline jacobian_t operator()(const Eigen::Vector3d& p) const
+    {
+        jacobian_t j;
+        j.leftCols<3>().setIdentity();
+        j.col(3) = d_roll_  * p;
+        j.col(4) = d_pitch_ * p;
+        j.col(5) = d_yaw_   * p;
+        return j;
+    }
+
+private:
+    Eigen::Matrix3d d_roll_;
+    Eigen::Matrix3d d_pitch_;
+    Eigen::Matrix3d d_yaw_;
+};
+
+/**
+ * @brief Jacobian of q = R(quaternion) * p + t with respect to the pose
+ *        parameters (tx, ty, tz, qx, qy, qz, qw). The quaternion is treated as
+ *        normalized before use, so the rotational part is projected onto the
+ *        tangent space of the unit sphere.
+ */
+class PoseJacobian3dQuaternion
+{
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    using jacobian_t       = Eigen::Matrix<double,3,7>;
+    using euler_jacobian_t = Eigen::Matrix<double,3,4>;
+
+    inline PoseJacobian3dQuaternion(const double qx, const double qy, const double qz, const double qw)
+    {
+        const Eigen::Vector4d q(qx, qy, qz, qw);
+        const double norm = q.norm();
+        const Eigen::Vector4d u = q / norm;
+        projection_ = (Eigen::Matrix4d::Identity() - u * u.transpose()) / norm;
+
+        v_ = u.head<3>();
+        w_ = u(3);
+
+        /// d (roll, pitch, yaw) / d (x, y, z, w) of the unit quaternion
+        const double x = u(0), y = u(1), z = u(2), w = u(3);
+        auto atan2_derivative = [](const double a, const double b,
+                                   const Eigen::RowVector4d& da, const Eigen::RowVector4d& db) {
+            const double n = a * a + b * b;
+            return n > 0.0 ? Eigen::RowVector4d((b * da - a * db) / n) : Eigen::RowVector4d::Zero().eval();
+        };
+
+        euler_jacobian_t e;
+        e.row(0) = atan2_derivative(2.0 * (w * x + y * z), 1.0 - 2.0 * (x * x + y * y),
+                                    Eigen::RowVector4d(2.0 * w, 2.0 * z, 2.0 * y, 2.0 * x),
+                                    Eigen::RowVector4d(-4.0 * x, -4.0 * y, 0.0, 0.0));
+        const double s = 2.0 * (w * y - z * x);
+        e.row(1) = std::fabs(s) < 1.0 ?
+                    Eigen::RowVector4d(Eigen::RowVector4d(-2.0 * z, 2.0 * w, -2.0 * x, 2.0 * y) / std::sqrt(1.0 - s * s)) :
+                    Eigen::RowVector4d::Zero().eval();
+        e.row(2) = atan2_derivative(2.0 * (w * z + x * y), 1.0 - 2.0 * (y * y + z * z),
+                                    Eigen::RowVector4d(2.0 * y, 2.0 * x, 2.0 * w, 2.0 * z),
+                                    Eigen::RowVector4d(0.0, -4.0 * y, -4.0 * z, 0.0));
+        euler_ = e * projection_;
+    }
+
+    /**
+     * @brief Evaluate the jacobian.
+     * @param p     point in local coordinates
+     * @return d q / d (tx, ty, tz, qx, qy, qz, qw)
+     */
+    inline jacobian_t operator()(const Eigen::Vector3d& p) const
+    {
+        /// R p = p + 2 w (v x p) + 2 v x (v x p)
+        Eigen::Matrix3d skew_p;
+        skew_p <<   0.0, -p(2),  p(1),
+                   p(2),   0.0, -p(0),
+                  -p(1),  p(0),   0.0;
+
+        Eigen::Matrix<double,3,4> d_rotation;
+        d_rotation.leftCols<3>() = 2.0 * (-w_ * skew_p +
+                                          v_.dot(p) * Eigen::Matrix3d::Identity() +
+                                          v_ * p.transpose() -
+                                          2.0 * p * v_.transpose());
+        d_rotation.col(3) = 2.0 * v_.cross(p);
+
+        jacobian_t j;
+        j.leftCols<3>().setIdentity();
+        j.rightCols<4>() = d_rotation * projection_;
+        return j;
+    }
+
+    /**
+     * @brief Jacobian of the euler angles (roll, pitch, yaw) extracted from the quaternion.
+     * @return d (roll, pitch, yaw) / d (qx, qy, qz, qw)
+     */
+    inline const euler_jacobian_t& euler() const
+    {
+        return euler_;
+    }
+
+    /**
+     * @brief Derivative of the normalized quaternion with respect to the raw parameters.
+     * @return d (qx, qy, qz, qw) / ||q|| / d (qx, qy, qz, qw)
+     */
+    inline const Eigen::Matrix4d& projection() const
+    {
+        return projection_;
+    }
+
+private:
+    Eigen::Vector3d  v_;
+    double           w_;
+    Eigen::Matrix4d  projection_;
+    euler_jacobian_t euler_;
+};
+
+}
+}
+
+#endif // CSLIBS_NDT_3D_MATCHING_POSE_JACOBIAN_HPP
@@ -0,0 +1,198 @@
+#ifndef CSLIBS_NDT_3D_MATCHING_SEARCH_CORRELATIVE_MATCHER_HPP
+#define CSLIBS_NDT_3D_MATCHING_SEARCH_CORRELATIVE_MATCHER_HPP
+
+#include <cslibs_ndt/map/map.hpp>
+#include <cslibs_ndt/matching/search/branch_and_bound.hpp>
+
+namespace cslibs_ndt {
+namespace matching {
+namespace search {
+
+/**
+ * @brief Three-dimensional counterpart of CorrelativeMatcher2d. As there is no volumetric
+ *        probability gridmap, the score grid is sampled from the ndt map directly on a voxel
+ *        grid in map coordinates covering all bundles. Queries search a window of translations
+ *        (x, y, z) and yaw angles around the map z axis with branch-and-bound.
+ */
+template <typename ndt_t>
+class CorrelativeMatcher3d
+{
+public:
+    using Ptr        = std::shared_ptr<CorrelativeMatcher3d<ndt_t>>;
+    using ConstPtr   = std::shared_ptr<const CorrelativeMatcher3d<ndt_t>>;
+    using pose_t     = typename ndt_t::pose_t;
+    using point_t    = typename ndt_t::point_t;
+    using index_t    = typename ndt_t::index_t;
+    using T          = decltype(std::declval<ndt_t>().getResolution());
+    using bnb_t      = BranchAndBound<3>;
+    using pyramid_t  = typename bnb_t::pyramid_t;
+
+    struct Parameters {
+        double      linear_window;  /// half extent of the horizontal translation window [m]
+        double      height_window;  /// half extent of the vertical translation window [m]
+        double      angular_window; /// half extent of the yaw window [rad]
+        double      angular_step;   /// [rad], <= 0: derived from the scan extent
+        double      min_score;
+        std::size_t num_threads;
+        double      time_budget;    /// [s], <= 0: unbounded
+
+        inline Parameters() :
+            linear_window(1.0),
+            height_window(0.2),
+            angular_window(M_PI / 6.0),
+            angular_step(0.0),
+            min_score(0.5),
+            num_threads(utility::default_thread_count()),
+            time_budget(0.0)
+        {
+        }
+    };
+
+    struct EIGEN_ALIGN16 Result {
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+        pose_t pose;
+        double score    = 0.0;
+        bool   found    = false;
+        bool   complete = true;
+    };
+
+    /**
+     * @brief Sample the map into a voxel score pyramid.
+     * @param map                   the ndt map
+     * @param sampling_resolution   voxel size
+     * @param depth                 number of pyramid levels
+     * @param args                  additional sampling arguments, e.g. an inverse sensor model
+     */
+    template <typename ... args_t>
+    static inline Ptr create(const ndt_t      &map,
+                             const double      sampling_resolution,
+                             const std::size_t depth,
+                             const args_t &... args)
+    {
+        const double  bundle_resolution = static_cast<double>(map.getBundleResolution());
+        const index_t min_bi = map.getMinBundleIndex();
+        const index_t max_bi = map.getMaxBundleIndex();
+
+        typename pyramid_t::index_t size, offset;
+        for (std::size_t d = 0 ; d < 3 ; ++d) {
+            offset[d] = static_cast<int>(std::floor(min_bi[d] * bundle_resolution / sampling_resolution));
+            size[d]   = static_cast<int>(std::ceil((max_bi[d] + 1) * bundle_resolution / sampling_resolution)) - offset[d];
+        }
+
+        Ptr matcher(new CorrelativeMatcher3d<ndt_t>(map.getInitialOrigin(), sampling_resolution, offset, size, depth));
+
+        const double bundle_resolution_inv = 1.0 / bundle_resolution;
+        utility::parallel_for(0ul, static_cast<std::size_t>(std::max(0, size[2])), [&](const std::size_t z) {
+            for (int y = 0 ; y < size[1] ; ++y) {
+                for (int x = 0 ; x < size[0] ; ++x) {
+                    const typename pyramid_t::index_t c{{x, y, static_cast<int>(z)}};
+                    const point_t p(static_cast<T>((c[0] + offset[0] + 0.5) * sampling_resolution),
+                                    static_cast<T>((c[1] + offset[1] + 0.5) * sampling_resolution),
+                                    static_cast<T>((c[2] + offset[2] + 0.5) * sampling_resolution));
+                    const index_t bi{{static_cast<int>(std::floor(p(0) * bundle_resolution_inv)),
+                                      static_cast<int>(std::floor(p(1) * bundle_resolution_inv)),
+                                      static_cast<int>(std::floor(p(2) * bundle_resolution_inv))}};
+                    const double s = static_cast<double>(map.sampleNonNormalized(p, bi, args...));
+                    matcher->pyramid_.at(c) = std::isnormal(s) ? static_cast<float>(std::min(1.0, s)) : 0.0f;
+                }
+            }
+        });
+        matcher->pyramid_.build();
+        return matcher;
+    }
+
+    inline const pyramid_t& getPyramid() const
+    {
+        return pyramid_;
+    }
+
+    /**
+     * @brief Search the best pose within the window around a center pose.
+     * @param center        center of the search window in world coordinates
+     * @param points        points in local coordinates
+     * @param parameters    search parameters
+     * @return the best pose in world coordinates
+     */
+    template <typename points_t>
+    inline Result match(const pose_t     &center,
+                        const points_t   &points,
+                        const Parameters &parameters) const
+    {
+        Result result;
+        if (points.empty())
+            return result;
+
+        double max_range = 0.0;
+        for (const auto &p : points)
+            max_range = std::max(max_range, static_cast<double>(p.length()));
+        double angular_step = parameters.angular_step;
+        if (angular_step <= 0.0) {
+            angular_step = max_range > resolution_ ?
+                        std::acos(1.0 - (resolution_ * resolution_) / (2.0 * max_range * max_range)) : 0.1;
+        }
+        const int yaw_steps = static_cast<int>(std::ceil(parameters.angular_window / angular_step));
+
+        const pose_t m_center = m_T_w_ * center;
+        const double resolution_inv = 1.0 / resolution_;
+        auto rotation = [&](const std::size_t k) {
+            return cslibs_math_3d::Quaternion<T>(static_cast<T>((static_cast<int>(k) - yaw_steps) * angular_step)) * m_center.rotation();
+        };
+        auto rotate = [&](const std::size_t k, typename bnb_t::cells_t &cells) {
+            const pose_t pose(m_center.translation(), rotation(k));
+            cells.reserve(points.size());
+            for (const auto &p : points) {
+                const point_t q = pose * p;
+                cells.emplace_back(static_cast<double>(q(0)) * resolution_inv - offset_[0],
+                                   static_cast<double>(q(1)) * resolution_inv - offset_[1],
+                                   static_cast<double>(q(2)) * resolution_inv - offset_[2]);
+            }
+        };
+
+        typename bnb_t::Parameters bnb_parameters;
+        bnb_parameters.linear_window[0] = static_cast<int>(std::ceil(parameters.linear_window * resolution_inv));
+        bnb_parameters.linear_window[1] = bnb_parameters.linear_window[0];
+        bnb_parameters.linear_window[2] = static_cast<int>(std::ceil(parameters.height_window * resolution_inv));
+        bnb_parameters.min_score   = parameters.min_score;
+        bnb_parameters.num_threads = parameters.num_threads;
+        bnb_parameters.time_budget = parameters.time_budget;
+
+        const typename bnb_t::Result r = bnb_t::match(pyramid_, static_cast<std::size_t>(2 * yaw_steps + 1), rotate, bnb_parameters);
+        result.found    = r.found;
+        result.complete = r.complete;
+        result.score    = r.score;
+        if (r.found) {
+            const cslibs_math_3d::Vector3<T> t(m_center.tx() + static_cast<T>(r.offset[0] * resolution_),
+                                               m_center.ty() + static_cast<T>(r.offset[1] * resolution_),
+                                               m_center.tz() + static_cast<T>(r.offset[2] * resolution_));
+            result.pose = w_T_m_ * pose_t(t, rotation(r.rotation));
+        }
+        return result;
+    }
+
+private:
+    const double                 resolution_;
+    const pose_t                 w_T_m_;
+    const pose_t                 m_T_w_;
+    typename pyramid_t::index_t  offset_;
+    pyramid_t                    pyramid_;
+
+    inline CorrelativeMatcher3d(const pose_t &w_T_m,
+                                const double resolution,
+                                const typename pyramid_t::index_t &offset,
+                                const typename pyramid_t::index_t &size,
+                                const std::size_t depth) :
+        resolution_(resolution),
+        w_T_m_(w_T_m),
+        m_T_w_(w_T_m.inverse()),
+        offset_(offset),
+        pyramid_(size, depth)
+    {
+    }
+};
+
+}
+}
+}
+
+#endif // CSLIBS_NDT_3D_MATCHING_SEARCH_CORRELATIVE_MATCHER_HPP
@@ -0,0 +1,13 @@
+#include <cslibs_ndt_3d/serialization/dynamic_maps/gridmap.hpp>
+#include <cslibs_ndt_3d/serialization/dynamic_maps/occupancy_gridmap.hpp>
+
+#include <cslibs_ndt/serialization/benchmark.hpp>
+
+/**
+ * Measures the throughput of the binary serialization of 3D maps,
+ * see cslibs_ndt/serialization/benchmark.hpp for the options.
+ */
+int main(int argc, char *argv[])
+{
+    return cslibs_ndt::serialization::SerializationBenchmark<3>::run(argc, argv, "cslibs_ndt_3d_serialization_benchmark");
+}
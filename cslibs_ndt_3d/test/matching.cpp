@@ -0,0 +1,153 @@
+#include <gtest/gtest.h>
+
+#include <cslibs_ndt_3d/dynamic_maps/gridmap.hpp>
+#include <cslibs_ndt/matching/ceres/map/sample_grid.hpp>
+#include <cslibs_ndt/matching/ceres/map/tricubic_interpolator.hpp>
+
+#include <cslibs_math/random/random.hpp>
+
+const std::size_t NUM_MAP_SAMPLES  = 20000;
+const std::size_t NUM_TEST_SAMPLES = 1000;
+
+template <std::size_t Dim>
+using rng_t = typename cslibs_math::random::Uniform<double,Dim>;
+
+using points_t = std::vector<cslibs_math_3d::Point3d>;
+
+/// floor, walls and a box of a small room, spread around the surfaces
+points_t generateScene()
+{
+    rng_t<1> rng_t01(0.0, 1.0);
+    rng_t<1> rng_noise(-0.5, 0.5);
+
+    const std::vector<std::array<double,9>> planes = {{
+        /// origin, first and second axis
+        {{-2.0, -2.0,  0.0,   4.0, 0.0, 0.0,   0.0, 4.0, 0.0}},
+        {{-2.0, -2.0,  0.0,   4.0, 0.0, 0.0,   0.0, 0.0, 3.0}},
+        {{-2.0, -2.0,  0.0,   0.0, 4.0, 0.0,   0.0, 0.0, 3.0}},
+        {{ 0.0,  0.0,  1.0,   1.0, 0.0, 0.0,   0.0, 1.0, 0.0}}
+    }};
+
+    points_t points;
+    for (std::size_t i = 0 ; i < NUM_MAP_SAMPLES ; ++i) {
+        const std::array<double,9> &p = planes[i % planes.size()];
+        const double u = rng_t01.get();
+        const double v = rng_t01.get();
+        points.emplace_back(p[0] + u * p[3] + v * p[6] + rng_noise.get(),
+                            p[1] + u * p[4] + v * p[7] + rng_noise.get(),
+                            p[2] + u * p[5] + v * p[8] + rng_noise.get());
+    }
+    return points;
+}
+
+TEST(Test_cslibs_ndt_3d, testTriCubicSampleGrid)
+{
+    using map_t    = cslibs_ndt_3d::dynamic_maps::Gridmap<double>;
+    using grid_t   = cslibs_ndt::matching::ceres::SampleGrid<3>;
+    using interp_t = cslibs_ndt::matching::ceres::TriCubicInterpolator<grid_t>;
+    rng_t<1> rng_angle(-M_PI, M_PI);
+    rng_t<1> rng_offset(-0.3, 0.3);
+
+    const points_t scene = generateScene();
+    const cslibs_math_3d::Transform3d origin(cslibs_math_3d::Vector3d(rng_offset.get(), rng_offset.get(), rng_offset.get()),
+                                             cslibs_math_3d::Quaternion<double>(rng_angle.get(), rng_angle.get(), rng_angle.get()));
+    map_t map(origin, 1.0);
+    cslibs_math_3d::Pointcloud3d::Ptr cloud(new cslibs_math_3d::Pointcloud3d);
+    for (const auto &p : scene)
+        cloud->insert(p);
+    map.insert(cloud);
+
+    const double resolution = 0.05;
+    const typename grid_t::Ptr grid = grid_t::create(map, resolution);
+    ASSERT_NE(grid, nullptr);
+    const interp_t interpolator(*grid);
+
+    /// the grid holds 1 - sampleNonNormalized, it is compared where the map is smooth, i.e. where
+    /// the stencil of the interpolation and the finite differences stay in one bundle
+    const double h = 1e-6;
+    std::size_t checked = 0;
+    for (std::size_t i = 0 ; i < NUM_TEST_SAMPLES ; ++i) {
+        const cslibs_math_3d::Point3d p(scene[i](0) + rng_offset.get(),
+                                        scene[i](1) + rng_offset.get(),
+                                        scene[i](2) + rng_offset.get());
+        const auto *bundle = map.get(p);
+        if (!bundle)
+            continue;
+
+        std::array<int,3> c;
+        for (std::size_t j = 0 ; j < 3 ; ++j)
+            c[j] = static_cast<int>(std::floor(p(j) / resolution));
+        bool smooth = true;
+        for (int k = 0 ; k < 64 && smooth ; ++k) {
+            const cslibs_math_3d::Point3d q((c[0] + (k & 3) - 1)        * resolution,
+                                            (c[1] + ((k >> 2) & 3) - 1) * resolution,
+                                            (c[2] + ((k >> 4) & 3) - 1) * resolution);
+            smooth = map.get(q) == bundle;
+        }
+        if (!smooth)
+            continue;
+        ++checked;
+
+        double f;
+        std::array<double,3> df;
+        interpolator.Evaluate(p(0) / resolution, p(1) / resolution, p(2) / resolution, &f, &df[0], &df[1], &df[2]);
+        EXPECT_NEAR(f, 1.0 - map.sampleNonNormalized(p), 1e-2);
+
+        for (std::size_t j = 0 ; j < 3 ; ++j) {
+            const cslibs_math_3d::Point3d lo(p(0) - (j == 0 ? h : 0.0), p(1) - (j == 1 ? h : 0.0), p(2) - (j == 2 ? h : 0.0));
+            const cslibs_math_3d::Point3d hi(p(0) + (j == 0 ? h : 0.0), p(1) + (j == 1 ? h : 0.0), p(2) + (j == 2 ? h : 0.0));
+            const double expected = (map.sampleNonNormalized(hi) - map.sampleNonNormalized(lo)) / (2.0 * h);
+            EXPECT_NEAR(-df[j] / resolution, expected, 0.1 * std::max(1.0, std::fabs(expected)));
+        }
+    }
+    EXPECT_GT(checked, NUM_TEST_SAMPLES / 10);
+}
+
+TEST(Test_cslibs_ndt_3d, testGradientGridmap)
+{
+    using map_t = cslibs_ndt_3d::dynamic_maps::Gridmap<double>;
+    rng_t<1> rng_angle(-M_PI, M_PI);
+    rng_t<1> rng_offset(-0.3, 0.3);
+
+    const points_t scene = generateScene();
+    const cslibs_math_3d::Transform3d origin(cslibs_math_3d::Vector3d(rng_offset.get(), rng_offset.get(), rng_offset.get()),
+                                             cslibs_math_3d::Quaternion<double>(rng_angle.get(), rng_angle.get(), rng_angle.get()));
+    map_t map(origin, 1.0);
+    cslibs_math_3d::Pointcloud3d::Ptr cloud(new cslibs_math_3d::Pointcloud3d);
+    for (const auto &p : scene)
+        cloud->insert(p);
+    map.insert(cloud);
+
+    const double h = 1e-6;
+    std::size_t checked = 0;
+    for (std::size_t i = 0 ; i < NUM_TEST_SAMPLES ; ++i) {
+        const cslibs_math_3d::Point3d p(scene[i](0) + rng_offset.get(),
+                                        scene[i](1) + rng_offset.get(),
+                                        scene[i](2) + rng_offset.get());
+        typename map_t::gradient_t gradient;
+        EXPECT_NEAR(map.sampleNonNormalized(p, gradient), map.sampleNonNormalized(p), 1e-9);
+
+        const auto *bundle = map.get(p);
+        bool smooth = bundle != nullptr;
+        std::array<double,3> expected = {{0.0, 0.0, 0.0}};
+        for (std::size_t j = 0 ; j < 3 && smooth ; ++j) {
+            const cslibs_math_3d::Point3d lo(p(0) - (j == 0 ? h : 0.0), p(1) - (j == 1 ? h : 0.0), p(2) - (j == 2 ? h : 0.0));
+            const cslibs_math_3d::Point3d hi(p(0) + (j == 0 ? h : 0.0), p(1) + (j == 1 ? h : 0.0), p(2) + (j == 2 ? h : 0.0));
+            smooth = map.get(lo) == bundle && map.get(hi) == bundle;
+            expected[j] = (map.sampleNonNormalized(hi) - map.sampleNonNormalized(lo)) / (2.0 * h);
+        }
+        if (!smooth)
+            continue;
+        ++checked;
+
+        for (std::size_t j = 0 ; j < 3 ; ++j)
+            EXPECT_NEAR(gradient(j), expected[j], 1e-4);
+    }
+    EXPECT_GT(checked, NUM_TEST_SAMPLES / 2);
+}
+
+int main(int argc, char *argv[])
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
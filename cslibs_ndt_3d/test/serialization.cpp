@@ -7,8 +7,13 @@
 
 #include <cslibs_ndt_3d/conversion/gridmap.hpp>
 #include <cslibs_ndt_3d/conversion/occupancy_gridmap.hpp>
+#include <cslibs_ndt_3d/conversion/distributions.hpp>
+#include <cslibs_ndt_3d/conversion/merge.hpp>
+#include <cslibs_ndt_3d/conversion/sensor_msgs_pointcloud2.hpp>
+#include <cslibs_ndt_3d/conversion/elevation_map.hpp>
 
 #include <cslibs_math/random/random.hpp>
+#include <algorithm>
 #include <fstream>
 
 const std::size_t MIN_NUM_SAMPLES = 10;
@@ -399,6 +404,45 @@ TEST(Test_cslibs_ndt_3d, testStaticOccupancyGridmapConversion)
     testStaticOccMap(map, map_double_converted);
 }
 
+TEST(Test_cslibs_ndt_3d, testDynamicGridmapMerge)
+{
+    using map_t   = cslibs_ndt_3d::dynamic_maps::Gridmap<double>;
+    using mono_t  = cslibs_ndt_3d::static_maps::mono::Gridmap<double>;
+    using index_t = typename map_t::index_t;
+    using db_t    = typename map_t::distribution_bundle_t;
+    using d_t     = typename map_t::distribution_t;
+    const typename map_t::Ptr map = generateDynamicMap();
+
+    const typename mono_t::Ptr merged = cslibs_ndt_3d::conversion::merge<double>(map);
+    ASSERT_NE(merged, nullptr);
+    for (std::size_t j = 0 ; j < 3 ; ++ j) {
+        EXPECT_EQ(map->getMinBundleIndex()[j], merged->getMinIndex()[j]);
+        EXPECT_EQ(map->getMaxBundleIndex()[j], merged->getMaxIndex()[j]);
+    }
+
+    // every cell holds the sum of the distributions of the bundle at its index
+    std::size_t bundles = 0;
+    map->traverse([&bundles](const index_t &, const db_t &) {
+        ++ bundles;
+    });
+    std::size_t cells = 0;
+    merged->traverse([&map, &cells](const index_t &bi, const d_t &d) {
+        ++ cells;
+        const db_t *b = map->getDistributionBundle(bi);
+        ASSERT_NE(b, nullptr);
+
+        d_t expected;
+        for (std::size_t i = 0 ; i < map_t::bin_count ; ++ i) {
+            if (const d_t *di = b->at(i))
+                expected += *di;
+        }
+        EXPECT_EQ(expected.getN(), d.getN());
+        for (std::size_t j = 0 ; j < 3 ; ++ j)
+            EXPECT_NEAR(expected.getMean()(j), d.getMean()(j), 1e-6);
+    });
+    EXPECT_EQ(bundles, cells);
+}
+
 TEST(Test_cslibs_ndt_3d, testDynamicGridmapFileBinarySerialization)
 {
     using map_t = cslibs_ndt_3d::dynamic_maps::Gridmap<double>;
@@ -469,6 +513,238 @@ TEST(Test_cslibs_ndt_3d, testStaticOccupancyGridmapFileBinarySerialization)
     testStaticOccMap(map, map_from_file);
 }
 
+TEST(Test_cslibs_ndt_3d, testDistributionsTriangleList)
+{
+    using map_t = cslibs_ndt_3d::dynamic_maps::Gridmap<double>;
+    rng_t<1> rng_noise(-0.3, 0.3);
+    typename map_t::Ptr map(new map_t(cslibs_math_3d::Transform3d(), 1.0));
+
+    // a near, a far and a culled cluster, the single point only yields invalid distributions
+    // that are skipped
+    cslibs_math_3d::Pointcloud3d::Ptr cloud(new cslibs_math_3d::Pointcloud3d);
+    for (const double x : {2.5, 30.5, 200.5}) {
+        for (std::size_t i = 0 ; i < 60 ; ++ i)
+            cloud->insert(cslibs_math_3d::Point3d(x + rng_noise.get(), 0.5 + rng_noise.get(), 0.5 + rng_noise.get()));
+    }
+    cloud->insert(cslibs_math_3d::Point3d(6.5, 6.5, 6.5));
+    map->insert(cloud);
+
+    const cslibs_ndt_3d::conversion::markers::lod<double> lod(cslibs_math_3d::Point3d(), 10.0, 100.0);
+    visualization_msgs::Marker marker;
+    cslibs_ndt_3d::conversion::from(*map, marker, ros::Time(), "map", cslibs_math_3d::Transform3d(), lod);
+    EXPECT_EQ(marker.type, visualization_msgs::Marker::TRIANGLE_LIST);
+
+    // icosahedra up to 10 m, octahedra up to 100 m
+    using ellipsoid_t = std::pair<Eigen::Vector3d, std::size_t>;
+    std::vector<ellipsoid_t, Eigen::aligned_allocator<ellipsoid_t>> expected;
+    std::size_t vertices = 0;
+    for (const auto &storage : map->getStorages()) {
+        storage->traverse([&expected, &vertices](const typename map_t::index_t &, const typename map_t::distribution_t &d) {
+            if (!d.valid() || d.getMean().norm() > 100.0)
+                return;
+            expected.emplace_back(d.getMean(), d.getMean().norm() <= 10.0 ? 60ul : 24ul);
+            vertices += expected.back().second;
+        });
+    }
+    EXPECT_FALSE(expected.empty());
+    ASSERT_EQ(marker.points.size(), vertices);
+    ASSERT_EQ(marker.colors.size(), vertices);
+
+    // both meshes are symmetric, so the vertices of every ellipsoid are centered at the mean
+    // of a visible distribution
+    auto centroid = [&marker](const std::size_t begin, const std::size_t size) {
+        Eigen::Vector3d c = Eigen::Vector3d::Zero();
+        for (std::size_t j = begin ; j < std::min(begin + size, marker.points.size()) ; ++ j)
+            c += Eigen::Vector3d(marker.points[j].x, marker.points[j].y, marker.points[j].z);
+        return (c / static_cast<double>(size)).eval();
+    };
+    std::size_t i = 0;
+    while (i < marker.points.size()) {
+        auto e = expected.end();
+        for (const std::size_t size : {24ul, 60ul}) {
+            const Eigen::Vector3d c = centroid(i, size);
+            e = std::find_if(expected.begin(), expected.end(), [&c, size](const ellipsoid_t &e) {
+                return e.second == size && (e.first - c).norm() < 1e-6;
+            });
+            if (e != expected.end())
+                break;
+        }
+        ASSERT_NE(e, expected.end());
+        EXPECT_NEAR(marker.colors[i].a, 1.0, 1e-6);
+        i += e->second;
+        expected.erase(e);
+    }
+    EXPECT_TRUE(expected.empty());
+}
+
+TEST(Test_cslibs_ndt_3d, testPointcloud2Eigen)
+{
+    using map_t = cslibs_ndt_3d::dynamic_maps::Gridmap<double>;
+    rng_t<1> rng_x(-0.4, 0.4);
+    rng_t<1> rng_y(-0.15, 0.15);
+    rng_t<1> rng_z(-0.03, 0.03);
+    rng_t<1> rng_angle(-M_PI, M_PI);
+    typename map_t::Ptr map(new map_t(cslibs_math_3d::Transform3d(), 1.0));
+
+    // an anisotropic cluster, elongated along x and flat in z
+    cslibs_math_3d::Pointcloud3d::Ptr cloud(new cslibs_math_3d::Pointcloud3d);
+    for (std::size_t i = 0 ; i < 2000 ; ++ i)
+        cloud->insert(cslibs_math_3d::Point3d(0.5 + rng_x.get(), 0.5 + rng_y.get(), 0.5 + rng_z.get()));
+    map->insert(cloud);
+
+    const cslibs_math_3d::Transform3d transform(
+                cslibs_math_3d::Vector3d(1.0, 2.0, 3.0),
+                cslibs_math_3d::Quaternion<double>(rng_angle.get(), rng_angle.get(), rng_angle.get()));
+    sensor_msgs::PointCloud2 eigen;
+    sensor_msgs::PointCloud2 covariance;
+    cslibs_ndt_3d::conversion::from(*map, eigen, transform, false, cslibs_ndt_3d::conversion::pointcloud2::fields::eigen);
+    cslibs_ndt_3d::conversion::from(*map, covariance, transform, false, cslibs_ndt_3d::conversion::pointcloud2::fields::covariance);
+
+    // one float per field, one point per distribution
+    std::size_t n = 0;
+    for (const auto &storage : map->getStorages())
+        storage->traverse([&n](const typename map_t::index_t &, const typename map_t::distribution_t &) { ++ n; });
+    ASSERT_EQ(eigen.fields.size(), 11ul);
+    ASSERT_EQ(covariance.fields.size(), 10ul);
+    for (const auto &f : eigen.fields)
+        EXPECT_EQ(f.count, 1u);
+    EXPECT_EQ(eigen.width * eigen.height, n);
+    EXPECT_EQ(covariance.width * covariance.height, n);
+    EXPECT_EQ(eigen.point_step, 11u * sizeof(float));
+
+    // the orientation rotates the eigenvalues into the covariance of the target frame
+    std::size_t checked = 0;
+    for (std::size_t i = 0 ; i < n ; ++ i) {
+        float e[11];
+        float c[10];
+        std::memcpy(e, eigen.data.data() + i * eigen.point_step, sizeof(e));
+        std::memcpy(c, covariance.data.data() + i * covariance.point_step, sizeof(c));
+        if (e[4] == 0.f && e[5] == 0.f && e[6] == 0.f)
+            continue;
+
+        const Eigen::Quaterniond q(e[10], e[7], e[8], e[9]);
+        EXPECT_NEAR(q.norm(), 1.0, 1e-4);
+        const Eigen::Matrix3d r = q.normalized().toRotationMatrix();
+        const Eigen::Matrix3d rebuilt = r * Eigen::Vector3d(e[4], e[5], e[6]).asDiagonal() * r.transpose();
+        Eigen::Matrix3d expected;
+        expected << c[4], c[5], c[6],
+                    c[5], c[7], c[8],
+                    c[6], c[8], c[9];
+        EXPECT_TRUE(rebuilt.isApprox(expected, 1e-3));
+        ++ checked;
+    }
+    EXPECT_GT(checked, 0ul);
+}
+
+TEST(Test_cslibs_ndt_3d, testElevationMapTiltedPlane)
+{
+    using map_t = cslibs_ndt_3d::dynamic_maps::Gridmap<double>;
+    rng_t<1> rng_coord(0.0, 8.0);
+    rng_t<1> rng_noise(-0.01, 0.01);
+    typename map_t::Ptr map(new map_t(cslibs_math_3d::Transform3d(), 1.0));
+
+    // z = 0.1 + 0.05 x + 0.05 y stays within the first layer of cells
+    const double gradient = 0.05;
+    cslibs_math_3d::Pointcloud3d::Ptr cloud(new cslibs_math_3d::Pointcloud3d);
+    for (std::size_t i = 0 ; i < 20000 ; ++ i) {
+        const double x = rng_coord.get();
+        const double y = rng_coord.get();
+        cloud->insert(cslibs_math_3d::Point3d(x, y, 0.1 + gradient * (x + y) + rng_noise.get()));
+    }
+    map->insert(cloud);
+
+    typename cslibs_ndt_3d::conversion::ElevationMap<double>::Ptr elevation;
+    cslibs_ndt_3d::conversion::from(*map, elevation);
+    ASSERT_NE(elevation, nullptr);
+    ASSERT_EQ(elevation->width,  8ul);
+    ASSERT_EQ(elevation->height, 8ul);
+    EXPECT_NEAR(elevation->origin.tx(), 0.0, 1e-6);
+    EXPECT_NEAR(elevation->origin.ty(), 0.0, 1e-6);
+
+    // the mean height of a cell is the plane at its center, the slope the inclination of the plane,
+    // the height variance the one of the plane over the cell plus the noise
+    const double slope    = std::atan(gradient * std::sqrt(2.0));
+    const double variance = 2.0 * gradient * gradient / 12.0 + 0.01 * 0.01 / 3.0;
+    for (std::size_t v = 0 ; v < elevation->height ; ++ v) {
+        for (std::size_t u = 0 ; u < elevation->width ; ++ u) {
+            const std::size_t i = elevation->index(u, v);
+            EXPECT_NEAR(elevation->elevation[i], 0.1 + gradient * (static_cast<double>(u + v) + 1.0), 1e-2);
+            EXPECT_NEAR(elevation->slope[i], slope, 1e-2);
+            EXPECT_NEAR(elevation->variance[i], variance, 2e-4);
+        }
+    }
+
+    // columns of a rolled or pitched map are not vertical
+    typename map_t::Ptr tilted(new map_t(cslibs_math_3d::Transform3d(cslibs_math_3d::Vector3d(0.0, 0.0, 0.0),
+                                                                     cslibs_math_3d::Quaternion<double>(0.3, 0.0, 0.0)), 1.0));
+    tilted->insert(cloud);
+    cslibs_ndt_3d::conversion::from(*tilted, elevation);
+    EXPECT_EQ(elevation, nullptr);
+
+    cslibs_gridmaps::static_maps::ProbabilityGridmap<double,double>::Ptr slice;
+    cslibs_ndt_3d::conversion::from(*tilted, slice);
+    EXPECT_EQ(slice, nullptr);
+}
+
+TEST(Test_cslibs_ndt_3d, testElevationMapSlices)
+{
+    using map_t = cslibs_ndt_3d::dynamic_maps::Gridmap<double>;
+    rng_t<1> rng_noise(-0.2, 0.2);
+    typename map_t::Ptr map(new map_t(cslibs_math_3d::Transform3d(), 1.0));
+
+    // a ground cluster in every column of 4 x 4 cells and an overhang above the columns with x < 2
+    cslibs_math_3d::Pointcloud3d::Ptr cloud(new cslibs_math_3d::Pointcloud3d);
+    for (int x = 0 ; x < 4 ; ++ x) {
+        for (int y = 0 ; y < 4 ; ++ y) {
+            for (std::size_t i = 0 ; i < 100 ; ++ i) {
+                const double px = x + 0.5 + rng_noise.get();
+                const double py = y + 0.5 + rng_noise.get();
+                cloud->insert(cslibs_math_3d::Point3d(px, py, 0.5 + 0.25 * rng_noise.get()));
+                if (x < 2)
+                    cloud->insert(cslibs_math_3d::Point3d(px, py, 5.5 + rng_noise.get()));
+            }
+        }
+    }
+    map->insert(cloud);
+
+    using gridmap_t = cslibs_gridmaps::static_maps::ProbabilityGridmap<double,double>;
+    auto slice = [&map](const double minimum_height, const double maximum_height) {
+        typename gridmap_t::Ptr dst;
+        cslibs_ndt_3d::conversion::from(*map, dst, minimum_height, maximum_height);
+        EXPECT_NE(dst, nullptr);
+        EXPECT_EQ(dst ? dst->getData().size() : 0ul, 16ul);
+        return dst;
+    };
+
+    // every cell is sampled at its center and the mean height of the Gaussians within the slice
+    const typename gridmap_t::Ptr ground   = slice(0.0, 1.0);
+    const typename gridmap_t::Ptr overhang = slice(5.0, 6.0);
+    const typename gridmap_t::Ptr empty    = slice(2.0, 3.0);
+    ASSERT_TRUE(ground && overhang && empty);
+    for (std::size_t cell = 0 ; cell < 16ul ; ++ cell) {
+        const bool covered = cell % 4 < 2;
+        EXPECT_GT(ground->getData()[cell], 0.9);
+        EXPECT_LE(ground->getData()[cell], 1.0 + 1e-9);
+        if (covered)
+            EXPECT_GT(overhang->getData()[cell], 0.9);
+        else
+            EXPECT_EQ(overhang->getData()[cell], 0.0);
+        EXPECT_EQ(empty->getData()[cell], 0.0);
+    }
+
+    // the elevation is the overhang, unless the maximum height looks beneath it
+    typename cslibs_ndt_3d::conversion::ElevationMap<double>::Ptr top;
+    typename cslibs_ndt_3d::conversion::ElevationMap<double>::Ptr beneath;
+    cslibs_ndt_3d::conversion::from(*map, top);
+    cslibs_ndt_3d::conversion::from(*map, beneath, 3.0);
+    ASSERT_NE(top, nullptr);
+    ASSERT_NE(beneath, nullptr);
+    for (std::size_t cell = 0 ; cell < 16ul ; ++ cell) {
+        EXPECT_NEAR(top->elevation[cell], cell % 4 < 2 ? 5.5 : 0.5, 0.05);
+        EXPECT_NEAR(beneath->elevation[cell], 0.5, 0.05);
+    }
+}
+
 int main(int argc, char *argv[])
 {
     testing::InitGoogleTest(&argc, argv);